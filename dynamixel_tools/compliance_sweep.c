@@ -0,0 +1,407 @@
+/*******************************************************************************
+* RX-24F Compliance Sweep
+* Tries every combination of compliance margin, compliance slope and punch
+* (control table 26-29 and 48) on each joint and keeps the best one. For
+* each setting the joint
+*   - follows a trot trajectory for TRACK_S: tracking RMS error, and
+*   - steps by STEP_DEG and back: overshoot and settling time (to within
+*     SETTLE_DEG of the goal),
+* reading its present position as fast as the bus allows. The score is
+*   rms + OVERSHOOT_WEIGHT * overshoot + SETTLE_WEIGHT * settling time
+* (deg, deg, s); the lowest wins.
+*
+* The trajectory is a built-in trot cycle (stance ramp, cosine swing) around
+* 150 deg, or each joint's column of a goal position log written by
+* raspi_controller/simulate.py --out, replayed with its own timing.
+*
+* These registers are RAM and reset when the servo powers up: the best
+* settings go to a profile (id margin slope punch lines) that motor_server
+* and raspi_controller's Robot apply at startup. The servos get their
+* original settings back when the sweep ends. Run it with the robot on a
+* stand; 24 settings take about 80 s per joint.
+*
+* Usage: ./compliance_sweep [ids=1,2,...,8] [trajectory.csv|-] [out=compliance.profile]
+*******************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "dynamixel_sdk.h"
+
+// Control table addresses
+#define ADDR_RX_TORQUE_ENABLE    24
+#define ADDR_RX_CW_MARGIN        26   // + CCW margin (27), CW slope (28), CCW slope (29)
+#define ADDR_RX_GOAL_POSITION    30
+#define ADDR_RX_MOVING_SPEED     32
+#define ADDR_RX_PRESENT_POSITION 36
+#define ADDR_RX_PUNCH            48
+
+#define PROTOCOL_VERSION 1.0
+#define BAUDRATE       1000000
+#define DEVICENAME     "/dev/ttyUSB0"
+#define TORQUE_ENABLE  1
+#define TORQUE_DISABLE 0
+
+// RX-24F position units
+#define RX_RESOLUTION  1023.0
+#define RX_MAX_DEGREES 300.0
+#define DEG_PER_TICK   (RX_MAX_DEGREES / RX_RESOLUTION)
+#define CENTER_DEG     150.0
+
+// Built-in trot cycle: MotionRunner's 50 Hz goal updates
+#define TROT_PERIOD_S  0.5
+#define TROT_STANCE    0.6                // fraction of the cycle on the ground
+#define TROT_AMP_DEG   15.0
+#define GOAL_PERIOD_S  0.02
+
+// Test and score
+#define TRACK_S            1.5
+#define TRACK_SKIP_S       0.25           // getting onto the trajectory
+#define STEP_DEG           20.0
+#define STEP_HOLD_S        0.8
+#define SETTLE_DEG         1.0
+#define OVERSHOOT_WEIGHT   0.5
+#define SETTLE_WEIGHT      5.0
+#define MAX_JOINTS         8
+#define MAX_TRAJ           4096
+
+static const int MARGINS[] = { 0, 1, 2 };
+static const int SLOPES[] = { 16, 32, 64, 128 };
+static const int PUNCHES[] = { 32, 64 };
+#define N_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+typedef struct {
+    int margin, slope, punch;
+} compliance_t;
+
+typedef struct {
+    double rms, overshoot, settle_s, score;
+    int failed;              // samples whose goal write or read failed
+} result_t;
+
+// Goal position log: time (s from the first row) and goal (deg) per joint
+static double traj_t[MAX_TRAJ];
+static double traj_deg[MAX_JOINTS][MAX_TRAJ];
+static int traj_ids[MAX_JOINTS];
+static int n_traj_ids, n_traj;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int deg_to_pos(double deg)
+{
+    int p = (int)(deg / DEG_PER_TICK + 0.5);
+    return p < 0 ? 0 : p > 1023 ? 1023 : p;
+}
+
+// ----------------------------------------------------------------------------
+// Trajectory
+// ----------------------------------------------------------------------------
+
+// simulate.py --out: "t_ms,id1,id8,..." then one row of goal ticks per write.
+// The first second is move_to_neutral; the next TRACK_S + TRACK_SKIP_S are kept.
+static int load_trajectory(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    char line[512];
+    if (!fgets(line, sizeof(line), f)) {
+        fclose(f);
+        return -1;
+    }
+    char *tok = strtok(line, ",\n");
+    while ((tok = strtok(NULL, ",\n")) && n_traj_ids < MAX_JOINTS)
+        traj_ids[n_traj_ids++] = atoi(tok + 2);
+
+    double t0 = -1.0;
+    while (n_traj < MAX_TRAJ && fgets(line, sizeof(line), f)) {
+        double t = atof(strtok(line, ",\n")) / 1000.0;
+        if (t < 1.0)
+            continue;
+        if (t0 < 0.0)
+            t0 = t;
+        if (t - t0 > TRACK_S + TRACK_SKIP_S)
+            break;
+        traj_t[n_traj] = t - t0;
+        for (int j = 0; j < n_traj_ids && (tok = strtok(NULL, ",\n")); ++j)
+            traj_deg[j][n_traj] = atoi(tok) * DEG_PER_TICK;
+        n_traj++;
+    }
+    fclose(f);
+    return n_traj_ids > 0 && n_traj > 1 ? 0 : -1;
+}
+
+// Goal of joint id at time t into the trajectory (deg)
+static double trajectory_deg(int id, double t)
+{
+    for (int j = 0; n_traj && j < n_traj_ids; ++j) {
+        if (traj_ids[j] != id)
+            continue;
+        int i = 0;
+        while (i + 1 < n_traj && traj_t[i + 1] <= t)
+            i++;
+        return traj_deg[j][i];
+    }
+
+    // Built-in: held for GOAL_PERIOD_S as MotionRunner's ticks are
+    double tick = floor(t / GOAL_PERIOD_S) * GOAL_PERIOD_S;
+    double s = fmod(tick, TROT_PERIOD_S) / TROT_PERIOD_S;
+    if (s < TROT_STANCE)
+        return CENTER_DEG + TROT_AMP_DEG * (1.0 - 2.0 * s / TROT_STANCE);
+    s = (s - TROT_STANCE) / (1.0 - TROT_STANCE);
+    return CENTER_DEG - TROT_AMP_DEG * cos(M_PI * s);
+}
+
+// ----------------------------------------------------------------------------
+// Measurement
+// ----------------------------------------------------------------------------
+
+// Nonzero unless the last instruction got a status packet without an error
+static int txrx_failed(int port)
+{
+    return getLastTxRxResult(port, PROTOCOL_VERSION) != COMM_SUCCESS ||
+           getLastRxPacketError(port, PROTOCOL_VERSION) != 0;
+}
+
+// Returns 0 when every write succeeded
+static int set_compliance(int port, int id, const compliance_t *c)
+{
+    const uint16_t addr[4] = { ADDR_RX_CW_MARGIN, ADDR_RX_CW_MARGIN + 1,
+                               ADDR_RX_CW_MARGIN + 2, ADDR_RX_CW_MARGIN + 3 };
+    const int value[4] = { c->margin, c->margin, c->slope, c->slope };
+    for (int k = 0; k < 4; ++k) {
+        write1ByteTxRx(port, PROTOCOL_VERSION, id, addr[k], (uint8_t)value[k]);
+        if (txrx_failed(port))
+            return -1;
+    }
+    write2ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_PUNCH, (uint16_t)c->punch);
+    return txrx_failed(port) ? -1 : 0;
+}
+
+// CW margin and slope stand for both directions. Returns 0 on success.
+static int get_compliance(int port, int id, compliance_t *c)
+{
+    readTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_CW_MARGIN, 4);
+    if (txrx_failed(port))
+        return -1;
+    c->margin = getDataRead(port, PROTOCOL_VERSION, 1, 0);
+    c->slope = getDataRead(port, PROTOCOL_VERSION, 1, 2);
+    readTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_PUNCH, 2);
+    if (txrx_failed(port))
+        return -1;
+    c->punch = getDataRead(port, PROTOCOL_VERSION, 2, 0);
+    return 0;
+}
+
+// Send goal_deg when it changed, then read the present position (deg).
+// The write waits for its status packet (status return level 2), so it is
+// not taken for the read's reply. Returns -1 when either failed; *last_goal
+// only moves once the servo has acknowledged the goal.
+static double sample_once(int port, int id, double goal_deg, int *last_goal)
+{
+    int goal = deg_to_pos(goal_deg);
+    if (goal != *last_goal) {
+        write2ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_GOAL_POSITION, (uint16_t)goal);
+        if (txrx_failed(port))
+            return -1.0;
+        *last_goal = goal;
+    }
+    readTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_PRESENT_POSITION, 2);
+    if (txrx_failed(port))
+        return -1.0;
+    return getDataRead(port, PROTOCOL_VERSION, 2, 0) * DEG_PER_TICK;
+}
+
+// Step from start_deg to start_deg + delta; overshoot (deg) and settling time (s)
+static void step_response(int port, int id, double start_deg, double delta, int *last_goal,
+                          double *overshoot, double *settle_s, int *failed)
+{
+    double target = deg_to_pos(start_deg + delta) * DEG_PER_TICK;
+    double dir = delta > 0.0 ? 1.0 : -1.0;
+    double t0 = now_sec(), t;
+    *overshoot = 0.0;
+    *settle_s = STEP_HOLD_S;
+    int settled = 0;
+    while ((t = now_sec() - t0) < STEP_HOLD_S) {
+        double pos = sample_once(port, id, start_deg + delta, last_goal);
+        if (pos < 0.0) {
+            (*failed)++;
+            continue;
+        }
+        *overshoot = fmax(*overshoot, dir * (pos - target));
+        if (fabs(pos - target) > SETTLE_DEG) {
+            settled = 0;
+            *settle_s = STEP_HOLD_S;
+        } else if (!settled) {
+            settled = 1;
+            *settle_s = t;
+        }
+    }
+}
+
+static result_t run_setting(int port, int id, const compliance_t *c)
+{
+    result_t r = { 0 };
+    int last_goal = -1;
+    if (set_compliance(port, id, c) != 0) {
+        r.rms = r.overshoot = r.settle_s = r.score = INFINITY;
+        r.failed = -1;
+        return r;
+    }
+
+    // Tracking: RMS of present - goal once on the trajectory
+    double sq = 0.0, t0 = now_sec(), t;
+    int n = 0;
+    while ((t = now_sec() - t0) < TRACK_S + TRACK_SKIP_S) {
+        double goal = trajectory_deg(id, t);
+        double pos = sample_once(port, id, goal, &last_goal);
+        if (pos < 0.0) {
+            r.failed++;
+            continue;
+        }
+        if (t >= TRACK_SKIP_S) {
+            double e = pos - last_goal * DEG_PER_TICK;
+            sq += e * e;
+            n++;
+        }
+    }
+    r.rms = n ? sqrt(sq / n) : INFINITY;
+
+    // Step out from where the trajectory ended and back: the worse of the two
+    double start = last_goal * DEG_PER_TICK, delta = start > CENTER_DEG ? -STEP_DEG : STEP_DEG;
+    double os1, os2, st1, st2;
+    step_response(port, id, start, delta, &last_goal, &os1, &st1, &r.failed);
+    step_response(port, id, start + delta, -delta, &last_goal, &os2, &st2, &r.failed);
+    r.overshoot = fmax(os1, os2);
+    r.settle_s = fmax(st1, st2);
+
+    r.score = r.rms + OVERSHOOT_WEIGHT * r.overshoot + SETTLE_WEIGHT * r.settle_s;
+    return r;
+}
+
+// Every setting on one joint; the best goes to *best. Returns 0 on success.
+static int sweep_joint(int port, int id, compliance_t *best, result_t *best_r)
+{
+    compliance_t original;
+    write1ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_TORQUE_ENABLE, TORQUE_ENABLE);
+    if (getLastTxRxResult(port, PROTOCOL_VERSION) != COMM_SUCCESS || get_compliance(port, id, &original) != 0) {
+        fprintf(stderr, "[compliance_sweep] ID %d does not answer\n", id);
+        return -1;
+    }
+    printf("[compliance_sweep] ID %d (now margin %d, slope %d, punch %d)\n",
+           id, original.margin, original.slope, original.punch);
+    write2ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_MOVING_SPEED, 0);
+
+    best_r->score = INFINITY;
+    for (int m = 0; m < N_OF(MARGINS); ++m)
+        for (int s = 0; s < N_OF(SLOPES); ++s)
+            for (int p = 0; p < N_OF(PUNCHES); ++p) {
+                compliance_t c = { MARGINS[m], SLOPES[s], PUNCHES[p] };
+                result_t r = run_setting(port, id, &c);
+                if (r.failed < 0) {
+                    printf("  margin %d slope %3d punch %2d: could not be set\n", c.margin, c.slope, c.punch);
+                    fflush(stdout);
+                    continue;
+                }
+                printf("  margin %d slope %3d punch %2d: rms %5.2f deg, overshoot %5.2f deg, "
+                       "settle %3.0f ms, score %6.2f",
+                       c.margin, c.slope, c.punch, r.rms, r.overshoot, 1000.0 * r.settle_s, r.score);
+                if (r.failed)
+                    printf(" (%d failed samples)", r.failed);
+                printf("\n");
+                fflush(stdout);
+                if (r.score < best_r->score) {
+                    *best = c;
+                    *best_r = r;
+                }
+            }
+
+    if (set_compliance(port, id, &original) != 0)
+        fprintf(stderr, "[compliance_sweep] ID %d: could not restore its compliance\n", id);
+    write2ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_GOAL_POSITION, (uint16_t)deg_to_pos(CENTER_DEG));
+    if (best_r->score == INFINITY) {
+        fprintf(stderr, "[compliance_sweep] ID %d: no setting could be measured\n", id);
+        return -1;
+    }
+    printf("[compliance_sweep] ID %d best: margin %d, slope %d, punch %d (score %.2f, %d failed samples)\n",
+           id, best->margin, best->slope, best->punch, best_r->score, best_r->failed);
+    return 0;
+}
+
+static int parse_ids(const char *s, int *ids)
+{
+    int n = 0;
+    for (char *end; *s && n < MAX_JOINTS; s = *end ? end + 1 : end) {
+        long v = strtol(s, &end, 10);
+        if (end == s || v < 0 || v > 252)
+            return -1;
+        ids[n++] = (int)v;
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    int ids[MAX_JOINTS] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    int n_ids = MAX_JOINTS;
+    if (argc > 1 && (n_ids = parse_ids(argv[1], ids)) <= 0) {
+        printf("Usage: %s [ids=1,2,...,8] [trajectory.csv|-] [out=compliance.profile]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2 && strcmp(argv[2], "-") != 0 && load_trajectory(argv[2]) != 0) {
+        fprintf(stderr, "[compliance_sweep] Cannot read a goal position log from %s\n", argv[2]);
+        return 1;
+    }
+    const char *out = argc > 3 ? argv[3] : "compliance.profile";
+
+    int port_num = portHandler(DEVICENAME);
+    packetHandler();
+
+    if (!openPort(port_num)) {
+        fprintf(stderr, "[compliance_sweep] Failed to open port %s\n", DEVICENAME);
+        return 1;
+    }
+    if (!setBaudRate(port_num, BAUDRATE)) {
+        fprintf(stderr, "[compliance_sweep] Failed to set baudrate %d\n", BAUDRATE);
+        closePort(port_num);
+        return 1;
+    }
+    printf("[compliance_sweep] %d settings per joint on a %s trajectory\n",
+           N_OF(MARGINS) * N_OF(SLOPES) * N_OF(PUNCHES), n_traj ? argv[2] : "built-in trot");
+
+    compliance_t best[MAX_JOINTS];
+    result_t best_r[MAX_JOINTS];
+    int ok[MAX_JOINTS] = { 0 };
+    for (int j = 0; j < n_ids; ++j)
+        ok[j] = sweep_joint(port_num, ids[j], &best[j], &best_r[j]) == 0;
+
+    for (int j = 0; j < n_ids; ++j)
+        write1ByteTxRx(port_num, PROTOCOL_VERSION, ids[j], ADDR_RX_TORQUE_ENABLE, TORQUE_DISABLE);
+    closePort(port_num);
+
+    FILE *f = fopen(out, "w");
+    if (!f) {
+        perror(out);
+        return 1;
+    }
+    fprintf(f, "# compliance_sweep: id margin slope punch  (tracking rms deg, overshoot deg, settle ms)\n");
+    for (int j = 0; j < n_ids; ++j)
+        if (ok[j])
+            fprintf(f, "%d %d %d %d  # %.2f %.2f %.0f\n", ids[j], best[j].margin, best[j].slope,
+                    best[j].punch, best_r[j].rms, best_r[j].overshoot, 1000.0 * best_r[j].settle_s);
+    if (fclose(f) != 0) {
+        perror(out);
+        return 1;
+    }
+    printf("[compliance_sweep] Profile: %s\n", out);
+    return 0;
+}
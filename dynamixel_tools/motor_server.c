@@ -7,8 +7,10 @@
 #include "dynamixel_sdk.h"
 
 #define ADDR_RX_TORQUE_ENABLE    24
+#define ADDR_RX_CW_MARGIN        26   // + CCW margin (27), CW slope (28), CCW slope (29)
 #define ADDR_RX_GOAL_POSITION    30
 #define ADDR_RX_MOVING_SPEED     32
+#define ADDR_RX_PUNCH            48
 
 #define PROTOCOL_VERSION         1.0
 #define BAUDRATE       1000000
@@ -17,6 +19,9 @@
 #define TORQUE_ENABLE  1
 #define TORQUE_DISABLE 0
 
+// Written by compliance_sweep; Q8_COMPLIANCE_PROFILE overrides the path
+#define COMPLIANCE_PROFILE "compliance.profile"
+
 // ---- simple timer helper ----
 static double now_sec(void) {
     struct timespec ts;
@@ -24,6 +29,48 @@ static double now_sec(void) {
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
+// Nonzero unless the last write got a status packet without an error
+static int write_failed(int port_num)
+{
+    return getLastTxRxResult(port_num, PROTOCOL_VERSION) != COMM_SUCCESS ||
+           getLastRxPacketError(port_num, PROTOCOL_VERSION) != 0;
+}
+
+// Compliance margin, slope and punch from "id margin slope punch" lines
+// (# comments). They are RAM registers, so every start applies them again.
+// Returns the servos set; each servo whose writes failed is reported.
+static int apply_compliance_profile(int port_num, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    char line[256];
+    int applied = 0;
+    while (fgets(line, sizeof(line), f)) {
+        int id, margin, slope, punch;
+        if (sscanf(line, "%d %d %d %d", &id, &margin, &slope, &punch) != 4)
+            continue;
+        const uint16_t addr[4] = { ADDR_RX_CW_MARGIN, ADDR_RX_CW_MARGIN + 1,
+                                   ADDR_RX_CW_MARGIN + 2, ADDR_RX_CW_MARGIN + 3 };
+        const int value[4] = { margin, margin, slope, slope };
+        int failed = 0;
+        for (int k = 0; k < 4 && !failed; ++k) {
+            write1ByteTxRx(port_num, PROTOCOL_VERSION, id, addr[k], (uint8_t)value[k]);
+            failed = write_failed(port_num);
+        }
+        if (!failed) {
+            write2ByteTxRx(port_num, PROTOCOL_VERSION, id, ADDR_RX_PUNCH, (uint16_t)punch);
+            failed = write_failed(port_num);
+        }
+        if (failed)
+            fprintf(stderr, "[motor_server] Compliance failed on ID %d\n", id);
+        else
+            applied++;
+    }
+    fclose(f);
+    return applied;
+}
+
 int main(void)
 {
     // Joint IDs in fixed order: 1..8
@@ -62,6 +109,15 @@ int main(void)
     fprintf(stdout, "[motor_server] Moving speed set to max on IDs 1..8\n");
     fflush(stdout);
 
+    const char *profile = getenv("Q8_COMPLIANCE_PROFILE");
+    if (!profile)
+        profile = COMPLIANCE_PROFILE;
+    int n_compliance = apply_compliance_profile(port_num, profile);
+    if (n_compliance > 0) {
+        fprintf(stdout, "[motor_server] Compliance from %s on %d servos\n", profile, n_compliance);
+        fflush(stdout);
+    }
+
     // For measuring how many commands per second we receive
     double last_print = now_sec();
     int line_count = 0;
@@ -0,0 +1,427 @@
+/*******************************************************************************
+* RX-24F Servo System Identification
+* Drives one servo through steps and a chirp while reading present position,
+* speed and load as fast as the bus allows, then fits a rate-limited
+* first-order and second-order model (with dead time) to the response.
+*
+*   first order:   x' = clamp((u - x) / tau, +-vmax)
+*   second order:  v' = wn^2 (u - x) - 2 zeta wn v,  x' = v = clamp(v, +-vmax)
+*
+* u is the goal delayed by the dead time (bus, servo firmware). The model
+* file (key value lines) is what raspi_controller's ServoModel loads for
+* SimRobot / simulate.py; the CSV has every sample for plotting.
+*
+* The joint moves by up to amp_deg either way from 150 deg: run it with the
+* robot on a stand.
+*
+* Usage: ./servo_sysid ID [amp_deg=30] [chirp_hz=4] [out=servo_ID]
+*        writes out.model and out.csv
+*******************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "dynamixel_sdk.h"
+
+// Control table addresses
+#define ADDR_RX_TORQUE_ENABLE    24
+#define ADDR_RX_GOAL_POSITION    30
+#define ADDR_RX_MOVING_SPEED     32
+#define ADDR_RX_PRESENT_POSITION 36   // + present speed (38), present load (40)
+
+#define PROTOCOL_VERSION 1.0
+#define BAUDRATE       1000000
+#define DEVICENAME     "/dev/ttyUSB0"
+#define TORQUE_ENABLE  1
+#define TORQUE_DISABLE 0
+
+// RX-24F position / speed units
+#define RX_RESOLUTION  1023.0
+#define RX_MAX_DEGREES 300.0
+#define DEG_PER_TICK   (RX_MAX_DEGREES / RX_RESOLUTION)
+#define DPS_PER_UNIT   (0.111 * 6.0)      // 0.111 rpm
+#define CENTER_DEG     150.0
+
+// Test signal
+#define STEP_HOLD_S    0.6
+#define CHIRP_F0_HZ    0.2
+#define CHIRP_S        10.0
+#define MAX_SAMPLES    65536
+
+// Fit
+#define SIM_STEP_S     0.0005             // model integration step
+#define NM_ITERATIONS  400
+
+typedef struct {
+    double t;          // s since the start, when the read came back
+    double t_goal;     // s since the start, when goal was sent
+    double goal;       // deg
+    double pos;        // deg
+    double speed;      // deg/s (CCW positive)
+    double load;       // % of max torque (CCW positive)
+} sample_t;
+
+typedef struct {
+    int order;
+    double dead_s, vmax, tau, wn, zeta;
+} model_t;
+
+static sample_t samples[MAX_SAMPLES];
+static int n_samples;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int deg_to_pos(double deg)
+{
+    int p = (int)(deg / DEG_PER_TICK + 0.5);
+    return p < 0 ? 0 : p > 1023 ? 1023 : p;
+}
+
+// Bit 10 is the direction (set: CW, negative)
+static double signed_10bit(uint32_t v)
+{
+    double m = (double)(v & 0x3FF);
+    return (v & 0x400) ? -m : m;
+}
+
+// ----------------------------------------------------------------------------
+// Measurement
+// ----------------------------------------------------------------------------
+
+// Command goal_deg (when it changed) and read position, speed and load in
+// one 6-byte read. The goal write waits for its status packet (RX servos
+// answer every instruction at status return level 2), so it cannot be
+// taken for the read's reply. Returns 0 on success, -1 when the write or
+// the read failed (the sample is not recorded; a failed goal is resent).
+static int sample_once(int port, int id, double goal_deg, double t0)
+{
+    static int last_goal = -1;
+    static double t_goal;
+    int goal = deg_to_pos(goal_deg);
+    if (goal != last_goal) {
+        t_goal = now_sec() - t0;
+        write2ByteTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_GOAL_POSITION, (uint16_t)goal);
+        if (getLastTxRxResult(port, PROTOCOL_VERSION) != COMM_SUCCESS ||
+            getLastRxPacketError(port, PROTOCOL_VERSION) != 0)
+            return -1;
+        last_goal = goal;
+    }
+
+    readTxRx(port, PROTOCOL_VERSION, id, ADDR_RX_PRESENT_POSITION, 6);
+    if (getLastTxRxResult(port, PROTOCOL_VERSION) != COMM_SUCCESS ||
+        getLastRxPacketError(port, PROTOCOL_VERSION) != 0)
+        return -1;
+    if (n_samples == MAX_SAMPLES)
+        return 0;
+
+    sample_t *s = &samples[n_samples++];
+    s->t = now_sec() - t0;
+    s->t_goal = t_goal;
+    s->goal = goal * DEG_PER_TICK;
+    s->pos = getDataRead(port, PROTOCOL_VERSION, 2, 0) * DEG_PER_TICK;
+    s->speed = signed_10bit(getDataRead(port, PROTOCOL_VERSION, 2, 2)) * DPS_PER_UNIT;
+    s->load = signed_10bit(getDataRead(port, PROTOCOL_VERSION, 2, 4)) * 100.0 / 1023.0;
+    return 0;
+}
+
+// Hold goal_deg for seconds, sampling all the while
+static int hold(int port, int id, double goal_deg, double seconds, double t0)
+{
+    double end = now_sec() + seconds;
+    int errors = 0;
+    while (now_sec() < end)
+        errors += sample_once(port, id, goal_deg, t0) != 0;
+    return errors;
+}
+
+static int run_test(int port, int id, double amp, double chirp_hz)
+{
+    int errors = 0;
+    double t0 = now_sec();
+
+    // Steps of a quarter, half and the full amplitude, both ways: small
+    // ones show the linear response, large ones the rate limit
+    for (int k = 2; k >= 0; --k) {
+        double a = amp / (double)(1 << k);
+        errors += hold(port, id, CENTER_DEG + a, STEP_HOLD_S, t0);
+        errors += hold(port, id, CENTER_DEG, STEP_HOLD_S, t0);
+        errors += hold(port, id, CENTER_DEG - a, STEP_HOLD_S, t0);
+        errors += hold(port, id, CENTER_DEG, STEP_HOLD_S, t0);
+    }
+    printf("[servo_sysid] Steps done (%d samples)\n", n_samples);
+
+    // Linear chirp at half the amplitude, a new goal every sample
+    double c0 = now_sec();
+    double k_hz = (chirp_hz - CHIRP_F0_HZ) / CHIRP_S;
+    for (double t = 0.0; t < CHIRP_S; t = now_sec() - c0) {
+        double phase = 2.0 * M_PI * (CHIRP_F0_HZ * t + 0.5 * k_hz * t * t);
+        errors += sample_once(port, id, CENTER_DEG + 0.5 * amp * sin(phase), t0) != 0;
+    }
+    errors += hold(port, id, CENTER_DEG, STEP_HOLD_S, t0);
+    printf("[servo_sysid] Chirp %.1f-%.1f Hz done (%d samples)\n", CHIRP_F0_HZ, chirp_hz, n_samples);
+    return errors;
+}
+
+// ----------------------------------------------------------------------------
+// Model fit
+// ----------------------------------------------------------------------------
+
+// Replay the recorded goals through the model; RMS position error in deg
+static double simulate(const model_t *m, const sample_t *s, int n)
+{
+    double x = s[0].pos, v = 0.0;
+    double sq = 0.0;
+    int cmd = 0;         // latest sample whose goal has reached the servo
+
+    for (int i = 1; i < n; ++i) {
+        double t = s[i - 1].t;
+        while (t < s[i].t) {
+            double h = fmin(SIM_STEP_S, s[i].t - t);
+            while (cmd + 1 < n && s[cmd + 1].t_goal + m->dead_s <= t)
+                cmd++;
+            double u = s[cmd].goal;
+            if (m->order == 1) {
+                v = (u - x) / m->tau;
+            } else {
+                v += h * (m->wn * m->wn * (u - x) - 2.0 * m->zeta * m->wn * v);
+            }
+            v = fmax(-m->vmax, fmin(m->vmax, v));
+            x += h * v;
+            t += h;
+        }
+        double e = x - s[i].pos;
+        sq += e * e;
+    }
+    return sqrt(sq / (n - 1));
+}
+
+// Parameters are searched as logs (all positive)
+static void unpack(int order, const double *p, model_t *m)
+{
+    m->order = order;
+    m->dead_s = exp(p[0]);
+    m->vmax = exp(p[1]);
+    if (order == 1) {
+        m->tau = exp(p[2]);
+    } else {
+        m->wn = exp(p[2]);
+        m->zeta = exp(p[3]);
+    }
+}
+
+static double cost(int order, const double *p)
+{
+    model_t m;
+    unpack(order, p, &m);
+    return simulate(&m, samples, n_samples);
+}
+
+// Nelder-Mead over dim <= 4 parameters; p is the start and the result
+static double fit(int order, double *p, int dim)
+{
+    double x[5][4], f[5];
+    for (int i = 0; i <= dim; ++i) {
+        memcpy(x[i], p, sizeof(double) * dim);
+        if (i > 0)
+            x[i][i - 1] += 0.5;
+        f[i] = cost(order, x[i]);
+    }
+
+    for (int it = 0; it < NM_ITERATIONS; ++it) {
+        // Order: best first
+        for (int i = 1; i <= dim; ++i)
+            for (int j = i; j > 0 && f[j] < f[j - 1]; --j) {
+                double tf = f[j]; f[j] = f[j - 1]; f[j - 1] = tf;
+                double tx[4];
+                memcpy(tx, x[j], sizeof(tx));
+                memcpy(x[j], x[j - 1], sizeof(tx));
+                memcpy(x[j - 1], tx, sizeof(tx));
+            }
+        if (f[dim] - f[0] < 1e-6)
+            break;
+
+        double c[4] = {0}, xr[4], xe[4];
+        for (int i = 0; i < dim; ++i)
+            for (int d = 0; d < dim; ++d)
+                c[d] += x[i][d] / dim;
+        for (int d = 0; d < dim; ++d)
+            xr[d] = c[d] + (c[d] - x[dim][d]);
+        double fr = cost(order, xr);
+
+        if (fr < f[0]) {
+            for (int d = 0; d < dim; ++d)
+                xe[d] = c[d] + 2.0 * (c[d] - x[dim][d]);
+            double fe = cost(order, xe);
+            if (fe < fr) {
+                memcpy(x[dim], xe, sizeof(xe));
+                f[dim] = fe;
+            } else {
+                memcpy(x[dim], xr, sizeof(xr));
+                f[dim] = fr;
+            }
+        } else if (fr < f[dim - 1]) {
+            memcpy(x[dim], xr, sizeof(xr));
+            f[dim] = fr;
+        } else {
+            // Contract towards the centroid, or shrink towards the best
+            for (int d = 0; d < dim; ++d)
+                xe[d] = c[d] + 0.5 * (x[dim][d] - c[d]);
+            double fc = cost(order, xe);
+            if (fc < f[dim]) {
+                memcpy(x[dim], xe, sizeof(xe));
+                f[dim] = fc;
+            } else {
+                for (int i = 1; i <= dim; ++i) {
+                    for (int d = 0; d < dim; ++d)
+                        x[i][d] = x[0][d] + 0.5 * (x[i][d] - x[0][d]);
+                    f[i] = cost(order, x[i]);
+                }
+            }
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i <= dim; ++i)
+        if (f[i] < f[best])
+            best = i;
+    memcpy(p, x[best], sizeof(double) * dim);
+    return f[best];
+}
+
+// ----------------------------------------------------------------------------
+// Output
+// ----------------------------------------------------------------------------
+
+static int write_csv(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    fprintf(f, "t_s,goal_deg,present_deg,speed_dps,load_pct\n");
+    for (int i = 0; i < n_samples; ++i)
+        fprintf(f, "%.6f,%.3f,%.3f,%.1f,%.1f\n", samples[i].t, samples[i].goal, samples[i].pos,
+                samples[i].speed, samples[i].load);
+    return fclose(f);
+}
+
+static int write_model(const char *path, int id, double amp, double chirp_hz, int failed,
+                       const model_t *m1, double rms1, const model_t *m2, double rms2)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    double sample_ms = 1000.0 * samples[n_samples - 1].t / (n_samples - 1);
+    fprintf(f, "# servo_sysid: %d samples every %.2f ms (%d failed), steps up to %.0f deg, chirp to %.1f Hz, "
+            "%d baud\n", n_samples, sample_ms, failed, amp, chirp_hz, BAUDRATE);
+    fprintf(f, "id %d\n", id);
+    fprintf(f, "order %d\n", rms2 < rms1 ? 2 : 1);
+    fprintf(f, "dead_time_ms %.2f\n", 1000.0 * (rms2 < rms1 ? m2->dead_s : m1->dead_s));
+    fprintf(f, "vmax_dps %.1f\n", rms2 < rms1 ? m2->vmax : m1->vmax);
+    fprintf(f, "tau_ms %.2f\n", 1000.0 * m1->tau);
+    fprintf(f, "wn_hz %.3f\n", m2->wn / (2.0 * M_PI));
+    fprintf(f, "zeta %.3f\n", m2->zeta);
+    fprintf(f, "rms1_deg %.3f\n", rms1);
+    fprintf(f, "rms2_deg %.3f\n", rms2);
+    fprintf(f, "sample_ms %.3f\n", sample_ms);
+    return fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s ID [amp_deg=30] [chirp_hz=4] [out=servo_ID]\n", argv[0]);
+        return 1;
+    }
+    int id = atoi(argv[1]);
+    double amp = argc > 2 ? atof(argv[2]) : 30.0;
+    double chirp_hz = argc > 3 ? atof(argv[3]) : 4.0;
+    char out[256];
+    if (argc > 4)
+        snprintf(out, sizeof(out), "%s", argv[4]);
+    else
+        snprintf(out, sizeof(out), "servo_%d", id);
+    if (id < 0 || id > 252 || amp <= 0.0 || amp > 60.0 || chirp_hz <= CHIRP_F0_HZ) {
+        printf("Need an ID 0-252, 0 < amp_deg <= 60 and chirp_hz > %.1f\n", CHIRP_F0_HZ);
+        return 1;
+    }
+
+    int port_num = portHandler(DEVICENAME);
+    packetHandler();
+
+    if (!openPort(port_num)) {
+        fprintf(stderr, "[servo_sysid] Failed to open port %s\n", DEVICENAME);
+        return 1;
+    }
+    if (!setBaudRate(port_num, BAUDRATE)) {
+        fprintf(stderr, "[servo_sysid] Failed to set baudrate %d\n", BAUDRATE);
+        closePort(port_num);
+        return 1;
+    }
+
+    // Torque on, moving speed 0 (no limit) as MotionRunner runs it
+    write1ByteTxRx(port_num, PROTOCOL_VERSION, id, ADDR_RX_TORQUE_ENABLE, TORQUE_ENABLE);
+    if (getLastTxRxResult(port_num, PROTOCOL_VERSION) != COMM_SUCCESS) {
+        fprintf(stderr, "[servo_sysid] ID %d does not answer\n", id);
+        closePort(port_num);
+        return 1;
+    }
+    write2ByteTxRx(port_num, PROTOCOL_VERSION, id, ADDR_RX_MOVING_SPEED, 0);
+    write2ByteTxRx(port_num, PROTOCOL_VERSION, id, ADDR_RX_GOAL_POSITION, (uint16_t)deg_to_pos(CENTER_DEG));
+    printf("[servo_sysid] ID %d: moving to %.0f deg, then steps of up to %.0f deg and a chirp to %.1f Hz\n",
+           id, CENTER_DEG, amp, chirp_hz);
+    struct timespec settle = { 1, 0 };
+    nanosleep(&settle, NULL);
+
+    int errors = run_test(port_num, id, amp, chirp_hz);
+
+    write1ByteTxRx(port_num, PROTOCOL_VERSION, id, ADDR_RX_TORQUE_ENABLE, TORQUE_DISABLE);
+    closePort(port_num);
+
+    if (n_samples < 100) {
+        fprintf(stderr, "[servo_sysid] Only %d samples (%d failed)\n", n_samples, errors);
+        return 1;
+    }
+    printf("[servo_sysid] %d samples every %.2f ms, %d failed (goal write or read)\n", n_samples,
+           1000.0 * samples[n_samples - 1].t / (n_samples - 1), errors);
+
+    // Start from the fastest measured speed, 10 ms dead time, a 30 ms time
+    // constant / 5 Hz, critically damped
+    double vmax = 1.0;
+    for (int i = 0; i < n_samples; ++i)
+        vmax = fmax(vmax, fabs(samples[i].speed));
+    double p1[3] = { log(0.010), log(vmax), log(0.030) };
+    double p2[4] = { log(0.010), log(vmax), log(2.0 * M_PI * 5.0), log(1.0) };
+    // Restarting from the result gets the simplex out of narrow valleys
+    double rms1 = fit(1, p1, 3), rms2 = fit(2, p2, 4);
+    rms1 = fit(1, p1, 3);
+    rms2 = fit(2, p2, 4);
+    model_t m1, m2;
+    unpack(1, p1, &m1);
+    unpack(2, p2, &m2);
+
+    printf("[servo_sysid] First order:  dead time %.1f ms, vmax %.0f deg/s, tau %.1f ms: RMS %.2f deg\n",
+           1000.0 * m1.dead_s, m1.vmax, 1000.0 * m1.tau, rms1);
+    printf("[servo_sysid] Second order: dead time %.1f ms, vmax %.0f deg/s, %.2f Hz, zeta %.2f: RMS %.2f deg\n",
+           1000.0 * m2.dead_s, m2.vmax, m2.wn / (2.0 * M_PI), m2.zeta, rms2);
+
+    char path[300];
+    snprintf(path, sizeof(path), "%s.csv", out);
+    if (write_csv(path) != 0)
+        perror(path);
+    snprintf(path, sizeof(path), "%s.model", out);
+    if (write_model(path, id, amp, chirp_hz, errors, &m1, rms1, &m2, rms2) != 0) {
+        perror(path);
+        return 1;
+    }
+    printf("[servo_sysid] Model: %s (samples: %s.csv)\n", path, out);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*******************************************************************************
+* bench_link - gesture_link round trip on localhost, UDP and Unix socket
+*
+* A forked publisher sends one gesture per decision period, stamped with
+* its capture time, and answers pings in between (as classify_realtime.py
+* does between decisions). The parent subscribes and measures:
+*
+*   latency      capture -> subscriber read, on the shared clock (true value)
+*   estimated    the same through the clock-offset estimate, as the robot
+*                computes it across hosts
+*   offset       the estimate itself; both sides share CLOCK_MONOTONIC
+*                here, so any non-zero value is estimator error
+*
+* plus seq accounting (received / lost / stale) and ping round trips.
+*
+* Usage: ./bench_link [seconds=3] [rate_hz=50]
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gesture_link.h"
+
+#define SERVICE_NS   1000000     // publisher answers pings every 1 ms
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t t)
+{
+    struct timespec ts = { .tv_sec = t / 1000000000LL, .tv_nsec = t % 1000000000LL };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+        ;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void summarize(double *v, int n, double *mean, double *p99, double *max)
+{
+    *mean = *p99 = *max = 0.0;
+    if (n == 0)
+        return;
+    qsort(v, n, sizeof(double), cmp_double);
+    double s = 0.0;
+    for (int i = 0; i < n; ++i)
+        s += v[i];
+    *mean = s / n;
+    *p99 = v[(int)(0.99 * (n - 1))];
+    *max = v[n - 1];
+}
+
+static void publisher(const char *addr, int64_t end_ns, int rate_hz)
+{
+    gesture_pub_t *p = gesture_pub_create(addr);
+    if (!p) {
+        perror("gesture_pub_create");
+        _exit(1);
+    }
+    int64_t period = 1000000000LL / rate_hz;
+    int64_t next = now_ns();
+    for (int k = 0; next < end_ns; ++k) {
+        gesture_pub_send(p, 1 + k % (GL_GESTURE_COUNT - 1), 0.9f, now_ns(), 0);
+        next += period;
+        for (int64_t t = now_ns() + SERVICE_NS; t < next; t += SERVICE_NS) {
+            sleep_until(t);
+            gesture_pub_service(p);
+        }
+        sleep_until(next);
+    }
+    gesture_pub_destroy(p);
+    _exit(0);
+}
+
+static void run(const char *name, const char *addr, double seconds, int rate_hz)
+{
+    gesture_sub_t *s = gesture_sub_create(addr, 100);
+    if (!s) {
+        perror("gesture_sub_create");
+        return;
+    }
+
+    int64_t end_ns = now_ns() + (int64_t)(seconds * 1e9);
+    pid_t pid = fork();
+    if (pid == 0)
+        publisher(addr, end_ns, rate_hz);
+
+    int cap = (int)(seconds * rate_hz) + 16;
+    double *lat = calloc(cap, sizeof(double));
+    double *est = calloc(cap, sizeof(double));
+    int n_lat = 0, n_est = 0;
+    gl_gesture_t g[64];
+
+    while (now_ns() < end_ns + 200000000LL) {
+        int n = gesture_sub_poll(s, g, 64, 10);
+        for (int i = 0; i < n && n_lat < cap; ++i) {
+            lat[n_lat++] = (g[i].t_recv_ns - g[i].t_capture_ns) / 1e3;
+            if (g[i].latency_ns)
+                est[n_est++] = g[i].latency_ns / 1e3;
+        }
+    }
+    waitpid(pid, NULL, 0);
+
+    gl_sub_stats_t st;
+    gesture_sub_get_stats(s, &st);
+    double lm, lp, lx, em, ep, ex;
+    summarize(lat, n_lat, &lm, &lp, &lx);
+    summarize(est, n_est, &em, &ep, &ex);
+
+    printf("\n%s (%s)\n", name, addr);
+    printf("  received %llu  lost %llu  stale %llu  bad %llu\n",
+           (unsigned long long)st.received, (unsigned long long)st.lost,
+           (unsigned long long)st.stale, (unsigned long long)st.bad);
+    printf("  latency     mean %7.1f us  p99 %7.1f us  max %7.1f us\n", lm, lp, lx);
+    printf("  estimated   mean %7.1f us  p99 %7.1f us  max %7.1f us  (%d synced)\n", em, ep, ex, n_est);
+    printf("  offset %+.1f us (true 0)  min rtt %.1f us  pings %llu  pongs %llu\n",
+           st.offset_ns / 1e3, st.rtt_ns / 1e3,
+           (unsigned long long)st.pings, (unsigned long long)st.pongs);
+
+    free(lat);
+    free(est);
+    gesture_sub_destroy(s);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    int rate_hz = argc > 2 ? atoi(argv[2]) : 50;
+    if (seconds <= 0.0 || rate_hz <= 0 || rate_hz > 1000) {
+        fprintf(stderr, "usage: %s [seconds] [rate_hz]\n", argv[0]);
+        return 1;
+    }
+
+    char udp[64], unix_addr[64];
+    snprintf(udp, sizeof(udp), "udp:127.0.0.1:%d", GL_DEFAULT_PORT);
+    snprintf(unix_addr, sizeof(unix_addr), "unix:@q8-bench-link-%d", (int)getpid());
+
+    printf("%d gestures/s, %.1f s per transport\n", rate_hz, seconds);
+    run("UDP", udp, seconds, rate_hz);
+    run("Unix datagram", unix_addr, seconds, rate_hz);
+    return 0;
+}
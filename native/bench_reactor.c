@@ -0,0 +1,406 @@
+/*******************************************************************************
+* bench_reactor - io_uring reactor vs thread-per-device on pty stand-ins
+*
+* Two ptys play the hardware: a feeder thread writes Cyton frames into one
+* at 250 Hz (frame number in the aux bytes, send time recorded), and a sink
+* thread reads Dynamixel sync writes from the other (tick number in the
+* first two goal positions, arrival time recorded). The application side
+* consumes every frame and sends one sync write per control tick, either
+*
+*   reactor   one thread, q8_reactor_poll
+*   threads   cyton_reader thread + control thread sleeping on
+*             clock_nanosleep and doing blocking write() + main thread
+*             waiting on cyton_reader_wait
+*
+* Reported per design: frame latency (send -> application), tick lateness
+* (deadline -> application), servo latency (deadline -> bytes at the sink),
+* and the application's CPU time and context switches (process totals
+* minus the stand-in threads).
+*
+* Usage: ./bench_reactor [seconds=5] [tick_hz=100]
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cyton_reader.h"
+#include "dxl_packet.h"
+#include "q8_reactor.h"
+
+#define CYTON_HZ      250
+#define N_SERVOS      8
+#define ADDR_GOAL     30
+
+typedef struct {
+    int cyton_master, cyton_slave;
+    int dxl_master, dxl_slave;
+    int64_t t0_ns;                 // tick k is due at t0 + k * period
+    int64_t period_ns;
+    int64_t end_ns;
+    _Atomic int running;
+
+    int64_t *sent_ns;              // per frame number (feeder)
+    int max_frames;
+    int64_t *servo_ns;             // per tick number (sink)
+    int max_ticks;
+
+    // Application side
+    double *frame_lat;
+    int n_frame_lat;
+    double *tick_late;
+    int n_tick_late;
+
+    struct rusage feeder_ru, sink_ru;
+} bench_t;
+
+static int64_t now_ns(void)
+{
+    return cyton_monotonic_ns();
+}
+
+static void sleep_until(int64_t t_ns)
+{
+    struct timespec ts = { .tv_sec = t_ns / 1000000000LL, .tv_nsec = t_ns % 1000000000LL };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static int open_pty(int *master, int *slave)
+{
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0)
+        return -1;
+    *slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+    if (*slave < 0)
+        return -1;
+
+    // Raw both ways, like a USB serial adapter; reads return what is there
+    struct termios tio;
+    tcgetattr(*slave, &tio);
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(*slave, TCSANOW, &tio);
+    return 0;
+}
+
+static void record_rusage(struct rusage *out)
+{
+    getrusage(RUSAGE_THREAD, out);
+}
+
+// ----------------------------------------------------------------------------
+// Stand-ins
+// ----------------------------------------------------------------------------
+
+static void *feeder_thread(void *arg)
+{
+    bench_t *b = arg;
+    const int64_t period = 1000000000LL / CYTON_HZ;
+    int64_t next = now_ns();
+
+    for (int seq = 0; seq < b->max_frames && atomic_load(&b->running); ++seq) {
+        uint8_t p[CYTON_FRAME_BYTES] = {0};
+        p[0] = CYTON_START_BYTE;
+        p[1] = (uint8_t)seq;
+        for (int c = 0; c < CYTON_CHANNELS; ++c)
+            p[2 + 3 * c + 2] = (uint8_t)(seq + c);
+        p[26] = (uint8_t)(seq >> 24);
+        p[27] = (uint8_t)(seq >> 16);
+        p[28] = (uint8_t)(seq >> 8);
+        p[29] = (uint8_t)seq;
+        p[32] = CYTON_END_BYTE;
+
+        __atomic_store_n(&b->sent_ns[seq], now_ns(), __ATOMIC_RELEASE);
+        if (write(b->cyton_master, p, sizeof(p)) != (ssize_t)sizeof(p))
+            break;
+        next += period;
+        sleep_until(next);
+    }
+    record_rusage(&b->feeder_ru);
+    return NULL;
+}
+
+static void *sink_thread(void *arg)
+{
+    bench_t *b = arg;
+    uint8_t buf[1024];
+    int len = 0;
+
+    while (atomic_load(&b->running)) {
+        struct pollfd pfd = { .fd = b->dxl_master, .events = POLLIN };
+        if (poll(&pfd, 1, 50) <= 0)
+            continue;
+        ssize_t got = read(b->dxl_master, &buf[len], sizeof(buf) - len);
+        int64_t t = now_ns();
+        if (got <= 0)
+            break;
+        len += (int)got;
+
+        int i = 0;
+        while (len - i >= 8) {
+            const uint8_t *p = &buf[i];
+            if (p[0] != 0xFF || p[1] != 0xFF || p[4] != DXL_INST_SYNC_WRITE) {
+                i++;
+                continue;
+            }
+            int total = p[3] + 4;
+            if (len - i < total)
+                break;
+            int tick = p[8] | (p[9] << 8) | (p[11] << 16) | (p[12] << 24);
+            if (tick >= 0 && tick < b->max_ticks && b->servo_ns[tick] == 0)
+                b->servo_ns[tick] = t;
+            i += total;
+        }
+        memmove(buf, &buf[i], len - i);
+        len -= i;
+        if (len == (int)sizeof(buf))
+            len = 0;
+    }
+    record_rusage(&b->sink_ru);
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Application side, shared by both designs
+// ----------------------------------------------------------------------------
+
+static void on_frame(bench_t *b, const cyton_frame_t *f, int64_t t)
+{
+    int seq = (f->raw[26] << 24) | (f->raw[27] << 16) | (f->raw[28] << 8) | f->raw[29];
+    if (seq < 0 || seq >= b->max_frames || b->n_frame_lat >= b->max_frames)
+        return;
+    int64_t sent = __atomic_load_n(&b->sent_ns[seq], __ATOMIC_ACQUIRE);
+    if (sent)
+        b->frame_lat[b->n_frame_lat++] = (t - sent) / 1000.0;
+}
+
+// Goal positions for one tick; the tick number rides in the first two
+static void tick_packet(int tick, uint8_t *ids, uint8_t *data)
+{
+    for (int i = 0; i < N_SERVOS; ++i) {
+        ids[i] = (uint8_t)(i + 1);
+        data[2 * i] = 0x00;
+        data[2 * i + 1] = 0x02;           // 512: centre
+    }
+    data[0] = (uint8_t)tick;
+    data[1] = (uint8_t)(tick >> 8);
+    data[2] = (uint8_t)(tick >> 16);
+    data[3] = (uint8_t)(tick >> 24);
+}
+
+static void on_tick(bench_t *b, int tick, int64_t t)
+{
+    if (b->n_tick_late < b->max_ticks)
+        b->tick_late[b->n_tick_late++] = (t - (b->t0_ns + tick * b->period_ns)) / 1000.0;
+}
+
+// ----------------------------------------------------------------------------
+// Designs
+// ----------------------------------------------------------------------------
+
+static void run_reactor(bench_t *b, uint64_t *enters)
+{
+    q8_reactor_t *r = q8_reactor_create(b->cyton_slave, b->dxl_slave);
+    if (!r) {
+        perror("q8_reactor_create");
+        exit(1);
+    }
+    q8_reactor_set_tick(r, b->period_ns);
+    b->t0_ns = now_ns();                  // set_tick: first deadline one period from now
+
+    cyton_frame_t frames[64];
+    uint8_t ids[N_SERVOS], data[2 * N_SERVOS];
+    while (now_ns() < b->end_ns) {
+        q8_reactor_events_t ev;
+        int n = q8_reactor_poll(r, frames, 64, 100000000LL, &ev);
+        int64_t t = now_ns();
+        for (int i = 0; i < n; ++i)
+            on_frame(b, &frames[i], t);
+        if (ev.ticks > 0) {
+            int tick = (int)((ev.tick_ns - b->t0_ns + b->period_ns / 2) / b->period_ns);
+            on_tick(b, tick, t);
+            tick_packet(tick, ids, data);
+            q8_reactor_sync_write(r, ADDR_GOAL, 2, ids, data, N_SERVOS, 0);
+        }
+    }
+    q8_reactor_stats_t st;
+    q8_reactor_get_stats(r, &st);
+    *enters = st.enters;
+    q8_reactor_destroy(r);
+}
+
+static void *control_thread(void *arg)
+{
+    bench_t *b = arg;
+    uint8_t ids[N_SERVOS], data[2 * N_SERVOS], pkt[DXL_MAX_PACKET];
+
+    for (int tick = 1; ; ++tick) {
+        int64_t due = b->t0_ns + tick * b->period_ns;
+        if (due >= b->end_ns)
+            break;
+        sleep_until(due);
+        on_tick(b, tick, now_ns());
+        tick_packet(tick, ids, data);
+        int len = dxl_sync_write_packet(pkt, sizeof(pkt), ADDR_GOAL, 2, ids, data, N_SERVOS);
+        if (write(b->dxl_slave, pkt, len) != len)
+            break;
+    }
+    return NULL;
+}
+
+static void run_threads(bench_t *b)
+{
+    cyton_reader_t *r = cyton_reader_create(b->cyton_slave, 0, 4096);
+    if (!r || cyton_reader_start(r, 0) != Q8_OK) {
+        perror("cyton_reader_start");
+        exit(1);
+    }
+    int consumer = cyton_reader_add_consumer(r);
+
+    b->t0_ns = now_ns();
+    pthread_t control;
+    pthread_create(&control, NULL, control_thread, b);
+
+    cyton_frame_t frames[64];
+    while (now_ns() < b->end_ns) {
+        if (cyton_reader_wait(r, consumer, 100) <= 0)
+            continue;
+        int n = cyton_reader_read(r, consumer, frames, 64);
+        int64_t t = now_ns();
+        for (int i = 0; i < n; ++i)
+            on_frame(b, &frames[i], t);
+    }
+    pthread_join(control, NULL);
+    cyton_reader_destroy(r);
+}
+
+// ----------------------------------------------------------------------------
+// Reporting
+// ----------------------------------------------------------------------------
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void summarize(double *v, int n, double *mean, double *p99, double *max)
+{
+    *mean = *p99 = *max = 0.0;
+    if (n == 0)
+        return;
+    qsort(v, n, sizeof(double), cmp_double);
+    double s = 0.0;
+    for (int i = 0; i < n; ++i)
+        s += v[i];
+    *mean = s / n;
+    *p99 = v[(int)(0.99 * (n - 1))];
+    *max = v[n - 1];
+}
+
+static double tv_sec(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static void run(const char *name, int design, double seconds, int tick_hz)
+{
+    bench_t b;
+    memset(&b, 0, sizeof(b));
+    if (open_pty(&b.cyton_master, &b.cyton_slave) != 0 || open_pty(&b.dxl_master, &b.dxl_slave) != 0) {
+        perror("pty");
+        exit(1);
+    }
+    b.period_ns = 1000000000LL / tick_hz;
+    b.max_frames = (int)(seconds * CYTON_HZ) + CYTON_HZ;
+    b.max_ticks = (int)(seconds * tick_hz) + tick_hz;
+    b.sent_ns = calloc(b.max_frames, sizeof(int64_t));
+    b.frame_lat = calloc(b.max_frames, sizeof(double));
+    b.servo_ns = calloc(b.max_ticks, sizeof(int64_t));
+    b.tick_late = calloc(b.max_ticks, sizeof(double));
+    atomic_store(&b.running, 1);
+
+    struct rusage ru0, ru1;
+    getrusage(RUSAGE_SELF, &ru0);
+    pthread_t feeder, sink;
+    pthread_create(&sink, NULL, sink_thread, &b);
+    pthread_create(&feeder, NULL, feeder_thread, &b);
+    b.end_ns = now_ns() + (int64_t)(seconds * 1e9);
+
+    uint64_t enters = 0;
+    if (design == 0)
+        run_reactor(&b, &enters);
+    else
+        run_threads(&b);
+
+    atomic_store(&b.running, 0);
+    pthread_join(feeder, NULL);
+    pthread_join(sink, NULL);
+    getrusage(RUSAGE_SELF, &ru1);
+
+    double cpu = (tv_sec(ru1.ru_utime) + tv_sec(ru1.ru_stime)) - (tv_sec(ru0.ru_utime) + tv_sec(ru0.ru_stime))
+               - (tv_sec(b.feeder_ru.ru_utime) + tv_sec(b.feeder_ru.ru_stime))
+               - (tv_sec(b.sink_ru.ru_utime) + tv_sec(b.sink_ru.ru_stime));
+    long csw = (ru1.ru_nvcsw + ru1.ru_nivcsw) - (ru0.ru_nvcsw + ru0.ru_nivcsw)
+             - (b.feeder_ru.ru_nvcsw + b.feeder_ru.ru_nivcsw) - (b.sink_ru.ru_nvcsw + b.sink_ru.ru_nivcsw);
+
+    // Servo latency: deadline -> packet at the sink
+    int n_servo = 0;
+    double *servo_lat = calloc(b.max_ticks, sizeof(double));
+    for (int k = 0; k < b.max_ticks; ++k)
+        if (b.servo_ns[k])
+            servo_lat[n_servo++] = (b.servo_ns[k] - (b.t0_ns + k * b.period_ns)) / 1000.0;
+
+    double fm, fp, fx, tm, tp, tx, sm, sp, sx;
+    int n_frames = b.n_frame_lat, n_ticks = b.n_tick_late;
+    summarize(b.frame_lat, n_frames, &fm, &fp, &fx);
+    summarize(b.tick_late, n_ticks, &tm, &tp, &tx);
+    summarize(servo_lat, n_servo, &sm, &sp, &sx);
+
+    printf("\n%s\n", name);
+    printf("  frames %5d  frame latency   mean %7.1f us  p99 %7.1f us  max %7.1f us\n", n_frames, fm, fp, fx);
+    printf("  ticks  %5d  tick lateness   mean %7.1f us  p99 %7.1f us  max %7.1f us\n", n_ticks, tm, tp, tx);
+    printf("  writes %5d  servo latency   mean %7.1f us  p99 %7.1f us  max %7.1f us\n", n_servo, sm, sp, sx);
+    printf("  cpu %5.2f%%  context switches %6.0f/s", 100.0 * cpu / seconds, csw / seconds);
+    if (design == 0)
+        printf("  io_uring_enter %6.0f/s", enters / seconds);
+    printf("\n");
+
+    close(b.cyton_slave);
+    close(b.cyton_master);
+    close(b.dxl_slave);
+    close(b.dxl_master);
+    free(b.sent_ns);
+    free(b.frame_lat);
+    free(b.servo_ns);
+    free(b.tick_late);
+    free(servo_lat);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    int tick_hz = argc > 2 ? atoi(argv[2]) : 100;
+    if (seconds <= 0.0 || tick_hz <= 0) {
+        fprintf(stderr, "usage: %s [seconds] [tick_hz]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Cyton %d Hz, control %d Hz, %.1f s per design\n", CYTON_HZ, tick_hz, seconds);
+    run("reactor (io_uring, 1 thread)", 0, seconds, tick_hz);
+    run("thread per device (reader + control + main)", 1, seconds, tick_hz);
+    return 0;
+}
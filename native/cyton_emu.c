@@ -0,0 +1,536 @@
+/*******************************************************************************
+* cyton_emu - OpenBCI Cyton board emulator on a pseudo-terminal
+*
+* One thread does everything: it sleeps in ppoll() on the pty master (for
+* commands) until the next write is due, so writes stay on an absolute
+* schedule however long a command takes. Requests from other threads
+* (gesture, tilt, loss) go through the mutex and are picked up by the
+* generator at the next packet.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cyton_emu.h"
+#include "cyton_reader.h"
+
+#define ACCEL_EVERY     10                 // packets per accelerometer reading (25 Hz)
+#define RAMP_MS         80.0               // gesture onset / offset
+#define BAND_LOW_HZ     20.0
+#define BAND_HIGH_HZ    100.0
+#define ACCEL_NOISE_G   0.005
+#define MAX_COUNT       8388607
+#define DEFAULT_SEED    0x9E3779B97F4A7C15ULL
+#define RESYNC_NS       1000000000LL       // this far behind: restart the schedule
+
+static const char BANNER[] =
+    "OpenBCI V3 8-16 channel\nOn Board ADS1299 Device ID: 0x3E\n"
+    "LIS3DH Device ID: 0x33\nFirmware: v3.1.2\n$$$";
+
+// RMS per channel (uV) and wrist tilt for each gesture. The classifiers use
+// channels 0, 1, 4 and 5 (N1P, N2P, N5P, N6P).
+static const struct {
+    const char *name;
+    double uv[CYTON_CHANNELS];
+    double pitch_deg;
+    double roll_deg;
+} GESTURES[] = {
+    { "relaxed",  {  4,  4,  3,  3,  4,  4,  3,  3 },   0,   0 },
+    { "forward",  { 60, 25,  8,  6, 45, 15,  8,  6 },   0,  35 },
+    { "backward", { 20, 55,  6,  8, 15, 50,  6,  8 },   0, -35 },
+    { "left",     { 50, 10,  6,  6, 10, 40,  6,  6 },  35,   0 },
+    { "right",    { 10, 45,  6,  6, 40, 10,  6,  6 }, -35,   0 },
+    { "stop",     { 35, 35, 10, 10, 35, 35, 10, 10 },   0,   0 },
+    { "jump",     { 80, 70, 15, 15, 70, 80, 15, 15 },  20,   0 },
+};
+#define N_GESTURES ((int)(sizeof(GESTURES) / sizeof(GESTURES[0])))
+
+struct cyton_emu {
+    cyton_emu_config_t cfg;
+    int master;
+    int slave;                   // kept open so the pty survives clients
+    char path[64];
+    int wake[2];                 // pipe used to stop the thread
+    pthread_t thread;
+    int running;
+
+    // Requests and stats, shared with other threads
+    pthread_mutex_t lock;
+    int gesture;
+    double tilt[2];              // pitch, roll (deg)
+    double loss, loss_burst;
+    int changed;
+    cyton_emu_stats_t stats;
+
+    // Generator (thread, or the caller of generate while stopped)
+    uint64_t rng;
+    double spare;
+    int have_spare;
+    uint8_t counter;
+    uint64_t n;                  // samples generated
+    double amp[CYTON_CHANNELS];
+    double target[CYTON_CHANNELS];
+    double z[CYTON_CHANNELS][2]; // band-pass state
+    double b0, b2, a1, a2;       // band-pass (b1 = 0)
+    double bp_gain;              // scales band-passed unit noise to unit RMS
+    double ramp;
+    double accel_g[3];
+    double p_enter, p_exit;
+    int in_loss;
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ----------------------------------------------------------------------------
+// Signal model
+// ----------------------------------------------------------------------------
+static uint64_t rng_next(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double rng_uniform(cyton_emu_t *e)
+{
+    return (double)(rng_next(&e->rng) >> 11) * 0x1.0p-53;
+}
+
+static double rng_gauss(cyton_emu_t *e)
+{
+    if (e->have_spare) {
+        e->have_spare = 0;
+        return e->spare;
+    }
+    double u = rng_uniform(e), v = rng_uniform(e);
+    double r = sqrt(-2.0 * log(u > 0.0 ? u : 0x1.0p-53));
+    e->spare = r * sin(2.0 * M_PI * v);
+    e->have_spare = 1;
+    return r * cos(2.0 * M_PI * v);
+}
+
+// RBJ band-pass (0 dB peak) between BAND_LOW_HZ and BAND_HIGH_HZ, and the
+// gain that brings band-passed unit white noise back to unit RMS
+static void design_band(cyton_emu_t *e)
+{
+    double f0 = sqrt(BAND_LOW_HZ * BAND_HIGH_HZ);
+    double q = f0 / (BAND_HIGH_HZ - BAND_LOW_HZ);
+    double w0 = 2.0 * M_PI * f0 / CYTON_EMU_FS;
+    double alpha = sin(w0) / (2.0 * q);
+    double a0 = 1.0 + alpha;
+    e->b0 = alpha / a0;
+    e->b2 = -alpha / a0;
+    e->a1 = -2.0 * cos(w0) / a0;
+    e->a2 = (1.0 - alpha) / a0;
+
+    // Noise power gain = sum of the squared impulse response
+    double z1 = 0.0, z2 = 0.0, power = 0.0;
+    for (int i = 0; i < 4096; ++i) {
+        double x = i == 0 ? 1.0 : 0.0;
+        double y = e->b0 * x + z1;
+        z1 = -e->a1 * y + z2;
+        z2 = e->b2 * x - e->a2 * y;
+        power += y * y;
+    }
+    e->bp_gain = 1.0 / sqrt(power);
+}
+
+static void set_loss_model(cyton_emu_t *e, double loss, double burst)
+{
+    // Gilbert model: the bad state is entered with p_enter and left with
+    // p_exit = 1 / burst, which makes the stationary loss rate `loss`
+    if (burst < 1.0)
+        burst = 1.0;
+    e->p_exit = 1.0 / burst;
+    e->p_enter = loss > 0.0 ? loss / (burst * (1.0 - loss)) : 0.0;
+}
+
+// Take requests from other threads (gesture, tilt, loss)
+static void apply_requests(cyton_emu_t *e)
+{
+    pthread_mutex_lock(&e->lock);
+    if (e->changed) {
+        const double *uv = GESTURES[e->gesture].uv;
+        for (int c = 0; c < CYTON_CHANNELS; ++c)
+            e->target[c] = uv[c];
+        double pitch = e->tilt[0] * M_PI / 180.0, roll = e->tilt[1] * M_PI / 180.0;
+        // Inverse of imu_orient: roll = atan2(y, z), pitch = atan2(-x, |yz|)
+        e->accel_g[0] = -sin(pitch);
+        e->accel_g[1] = cos(pitch) * sin(roll);
+        e->accel_g[2] = cos(pitch) * cos(roll);
+        set_loss_model(e, e->loss, e->loss_burst);
+        e->changed = 0;
+    }
+    pthread_mutex_unlock(&e->lock);
+}
+
+static void put_be(uint8_t *p, int32_t v, int n)
+{
+    for (int i = n - 1; i >= 0; --i) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static int32_t clamp_round(double x, int32_t limit)
+{
+    if (x > limit)
+        return limit;
+    if (x < -limit)
+        return -limit;
+    return (int32_t)lrint(x);
+}
+
+// Next sample into p. Returns 1 if it reaches the port, 0 if lost.
+static int next_packet(cyton_emu_t *e, uint8_t *p, int *corrupted)
+{
+    p[0] = CYTON_START_BYTE;
+    p[1] = e->counter++;
+
+    double hum = e->cfg.mains_uv * sin(2.0 * M_PI * e->cfg.mains_hz * (double)e->n / CYTON_EMU_FS);
+    for (int c = 0; c < CYTON_CHANNELS; ++c) {
+        e->amp[c] += (e->target[c] - e->amp[c]) * e->ramp;
+        double w = rng_gauss(e);
+        double y = e->b0 * w + e->z[c][0];
+        e->z[c][0] = -e->a1 * y + e->z[c][1];
+        e->z[c][1] = e->b2 * w - e->a2 * y;
+        double uv = e->amp[c] * e->bp_gain * y + e->cfg.noise_uv * rng_gauss(e) + hum;
+        put_be(&p[2 + 3 * c], clamp_round(uv / CYTON_EMU_UV_PER_COUNT, MAX_COUNT), 3);
+    }
+
+    if (e->n % ACCEL_EVERY == 0) {
+        for (int a = 0; a < CYTON_AUX_AXES; ++a) {
+            double g = e->accel_g[a] + ACCEL_NOISE_G * rng_gauss(e);
+            put_be(&p[26 + 2 * a], clamp_round(g / CYTON_EMU_ACCEL_G, INT16_MAX), 2);
+        }
+    } else {
+        memset(&p[26], 0, 2 * CYTON_AUX_AXES);
+    }
+    p[CYTON_FRAME_BYTES - 1] = CYTON_END_BYTE;
+    e->n++;
+
+    // Transport faults
+    e->in_loss = e->in_loss ? rng_uniform(e) >= e->p_exit : rng_uniform(e) < e->p_enter;
+    if (e->in_loss)
+        return 0;
+    *corrupted = e->cfg.corrupt > 0.0 && rng_uniform(e) < e->cfg.corrupt;
+    if (*corrupted)
+        p[CYTON_FRAME_BYTES - 1] = 0x00;
+    return 1;
+}
+
+// n packet slots into out; returns the bytes that reach the port
+static int produce(cyton_emu_t *e, uint8_t *out, int n)
+{
+    apply_requests(e);
+    int len = 0, lost = 0, corrupted = 0;
+    for (int i = 0; i < n; ++i) {
+        int bad = 0;
+        if (next_packet(e, &out[len], &bad))
+            len += CYTON_FRAME_BYTES;
+        else
+            lost++;
+        corrupted += bad;
+    }
+    pthread_mutex_lock(&e->lock);
+    e->stats.packets += (uint64_t)n;
+    e->stats.lost += (uint64_t)lost;
+    e->stats.corrupted += (uint64_t)corrupted;
+    pthread_mutex_unlock(&e->lock);
+    return len;
+}
+
+// ----------------------------------------------------------------------------
+// Board
+// ----------------------------------------------------------------------------
+
+// Returns 1 / 0 for a start / stop command, -1 otherwise
+static int command(cyton_emu_t *e, uint8_t c)
+{
+    switch (c) {
+    case 'b':
+        return 1;
+    case 's':
+        return 0;
+    case 'v': {
+        // Soft reset: stops streaming. The banner is lost if nobody reads.
+        ssize_t done = write(e->master, BANNER, sizeof(BANNER) - 1);
+        (void)done;
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+static void *emu_thread(void *arg)
+{
+    cyton_emu_t *e = arg;
+    uint8_t out[CYTON_EMU_MAX_BURST * CYTON_FRAME_BYTES];
+    int64_t period = (int64_t)(1e9 * e->cfg.burst / e->cfg.rate_hz);
+    int64_t next = 0;
+    int streaming = 0;
+
+    for (;;) {
+        struct timespec ts, *tsp = NULL;
+        if (streaming) {
+            int64_t wait = next - now_ns();
+            if (wait < 0)
+                wait = 0;
+            ts.tv_sec = wait / 1000000000LL;
+            ts.tv_nsec = wait % 1000000000LL;
+            tsp = &ts;
+        }
+        struct pollfd fds[2] = {
+            { .fd = e->master, .events = POLLIN },
+            { .fd = e->wake[0], .events = POLLIN },
+        };
+        if (ppoll(fds, 2, tsp, NULL) < 0 && errno != EINTR)
+            break;
+        if (fds[1].revents)
+            break;
+
+        if (fds[0].revents & POLLIN) {
+            uint8_t cmd[64];
+            ssize_t got = read(e->master, cmd, sizeof(cmd));
+            for (ssize_t i = 0; i < got; ++i) {
+                int start = command(e, cmd[i]);
+                if (start == 1 && !streaming)
+                    next = now_ns();
+                if (start >= 0)
+                    streaming = start;
+            }
+            if (got > 0) {
+                pthread_mutex_lock(&e->lock);
+                e->stats.commands += (uint64_t)got;
+                e->stats.streaming = streaming;
+                pthread_mutex_unlock(&e->lock);
+            }
+        }
+
+        int64_t t = now_ns();
+        if (!streaming || t < next)
+            continue;
+
+        int len = produce(e, out, e->cfg.burst);
+        ssize_t done = len > 0 ? write(e->master, out, (size_t)len) : 0;
+        int unsent = done < 0 ? len : len - (int)done;
+
+        pthread_mutex_lock(&e->lock);
+        e->stats.sent += (uint64_t)((len - unsent) / CYTON_FRAME_BYTES);
+        e->stats.overflow += (uint64_t)((unsent + CYTON_FRAME_BYTES - 1) / CYTON_FRAME_BYTES);
+        if (t - next > e->stats.max_late_ns)
+            e->stats.max_late_ns = t - next;
+        pthread_mutex_unlock(&e->lock);
+
+        next += period;
+        if (t - next > RESYNC_NS)
+            next = t + period;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    e->stats.streaming = 0;
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+cyton_emu_t *cyton_emu_create(const cyton_emu_config_t *cfg)
+{
+    cyton_emu_config_t c = { 0 };
+    if (cfg)
+        c = *cfg;
+    if (c.rate_hz == 0.0)
+        c.rate_hz = CYTON_EMU_FS;
+    if (c.burst == 0)
+        c.burst = 1;
+    if (c.mains_hz == 0.0)
+        c.mains_hz = 60.0;
+    if (c.seed == 0)
+        c.seed = DEFAULT_SEED;
+    if (c.rate_hz < 0.0 || c.burst < 1 || c.burst > CYTON_EMU_MAX_BURST || c.loss < 0.0 || c.loss >= 1.0 ||
+        c.corrupt < 0.0 || c.corrupt > 1.0 || c.noise_uv < 0.0 || c.mains_uv < 0.0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    cyton_emu_t *e = calloc(1, sizeof(*e));
+    if (!e)
+        return NULL;
+    e->cfg = c;
+    e->master = e->slave = -1;
+    e->wake[0] = e->wake[1] = -1;
+    e->rng = c.seed;
+    e->ramp = 1.0 - exp(-1000.0 / (RAMP_MS * CYTON_EMU_FS));
+    e->loss = c.loss;
+    e->loss_burst = c.loss_burst;
+    e->changed = 1;
+    pthread_mutex_init(&e->lock, NULL);
+    design_band(e);
+    apply_requests(e);
+    for (int ch = 0; ch < CYTON_CHANNELS; ++ch)
+        e->amp[ch] = e->target[ch];
+
+    int err;
+    e->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (e->master < 0 || grantpt(e->master) != 0 || unlockpt(e->master) != 0 ||
+        ptsname_r(e->master, e->path, sizeof(e->path)) != 0) {
+        err = errno;
+        goto fail;
+    }
+    e->slave = open(e->path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (e->slave < 0 || pipe2(e->wake, O_CLOEXEC) != 0) {
+        err = errno;
+        goto fail;
+    }
+
+    // Raw, like the dongle's USB serial adapter (clients set their own mode)
+    struct termios tio;
+    tcgetattr(e->slave, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tcsetattr(e->slave, TCSANOW, &tio);
+    return e;
+
+fail:
+    cyton_emu_destroy(e);
+    errno = err;
+    return NULL;
+}
+
+void cyton_emu_destroy(cyton_emu_t *e)
+{
+    if (!e)
+        return;
+    cyton_emu_stop(e);
+    if (e->master >= 0)
+        close(e->master);
+    if (e->slave >= 0)
+        close(e->slave);
+    if (e->wake[0] >= 0) {
+        close(e->wake[0]);
+        close(e->wake[1]);
+    }
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+const char *cyton_emu_path(const cyton_emu_t *e)
+{
+    return e ? e->path : NULL;
+}
+
+int cyton_emu_start(cyton_emu_t *e)
+{
+    if (!e)
+        return Q8_ERR_ARG;
+    if (e->running)
+        return Q8_OK;
+    int rc = pthread_create(&e->thread, NULL, emu_thread, e);
+    if (rc != 0) {
+        errno = rc;
+        return Q8_ERR_IO;
+    }
+    e->running = 1;
+    return Q8_OK;
+}
+
+int cyton_emu_stop(cyton_emu_t *e)
+{
+    if (!e)
+        return Q8_ERR_ARG;
+    if (!e->running)
+        return Q8_OK;
+    uint8_t one = 1;
+    if (write(e->wake[1], &one, 1) != 1)
+        return Q8_ERR_IO;
+    pthread_join(e->thread, NULL);
+    uint8_t drain;
+    if (read(e->wake[0], &drain, 1) != 1)
+        return Q8_ERR_IO;
+    e->running = 0;
+    return Q8_OK;
+}
+
+const char *cyton_emu_gesture_name(int gesture)
+{
+    return gesture >= 0 && gesture < N_GESTURES ? GESTURES[gesture].name : NULL;
+}
+
+int cyton_emu_set_gesture(cyton_emu_t *e, int gesture)
+{
+    if (!e || gesture < 0 || gesture >= N_GESTURES)
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&e->lock);
+    e->gesture = gesture;
+    e->tilt[0] = GESTURES[gesture].pitch_deg;
+    e->tilt[1] = GESTURES[gesture].roll_deg;
+    e->changed = 1;
+    pthread_mutex_unlock(&e->lock);
+    return Q8_OK;
+}
+
+int cyton_emu_set_tilt(cyton_emu_t *e, double pitch_deg, double roll_deg)
+{
+    if (!e || !isfinite(pitch_deg) || !isfinite(roll_deg))
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&e->lock);
+    e->tilt[0] = pitch_deg;
+    e->tilt[1] = roll_deg;
+    e->changed = 1;
+    pthread_mutex_unlock(&e->lock);
+    return Q8_OK;
+}
+
+int cyton_emu_set_loss(cyton_emu_t *e, double loss, double loss_burst)
+{
+    if (!e || !(loss >= 0.0 && loss < 1.0))
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&e->lock);
+    e->loss = loss;
+    e->loss_burst = loss_burst;
+    e->changed = 1;
+    pthread_mutex_unlock(&e->lock);
+    return Q8_OK;
+}
+
+int cyton_emu_generate(cyton_emu_t *e, uint8_t *out, int n_packets)
+{
+    if (!e || !out || n_packets < 0 || e->running)
+        return Q8_ERR_ARG;
+    int len = 0;
+    while (len < n_packets * CYTON_FRAME_BYTES)
+        len += produce(e, &out[len], 1);
+    pthread_mutex_lock(&e->lock);
+    e->stats.sent += (uint64_t)n_packets;
+    pthread_mutex_unlock(&e->lock);
+    return n_packets;
+}
+
+int cyton_emu_get_stats(cyton_emu_t *e, cyton_emu_stats_t *out)
+{
+    if (!e || !out)
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&e->lock);
+    *out = e->stats;
+    out->gesture = e->gesture;
+    pthread_mutex_unlock(&e->lock);
+    return Q8_OK;
+}
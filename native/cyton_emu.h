@@ -0,0 +1,92 @@
+/*******************************************************************************
+* cyton_emu - OpenBCI Cyton board emulator on a pseudo-terminal
+*
+* Opens a pty whose slave side behaves like the Cyton dongle: 'b' starts the
+* stream, 's' stops it, 'v' answers with the board banner ("$$$"), other
+* commands are accepted and ignored. While streaming, a thread writes 33-byte
+* packets (0xA0, sample counter, 8 x 24-bit channels, 3 x 16-bit accel, 0xC0)
+* at rate_hz on an absolute schedule, burst packets per write.
+*
+* Signal model, per channel: white noise through a 20-100 Hz band-pass at
+* the 250 Hz sample rate (EMG-like), scaled to the RMS amplitude the current
+* gesture gives that channel and ramped over ~80 ms when the gesture changes,
+* plus mains hum and a broadband noise floor. Every 10th packet carries an
+* accelerometer reading (25 Hz, zeros in between) for the gesture's wrist
+* tilt (imu_orient conventions). The model always advances at 250 samples
+* per packet period of the real board, so rate_hz > 250 replays the same
+* signal faster.
+*
+* Transport faults: a packet is lost with probability loss, in bursts of
+* mean length loss_burst (Gilbert model; the sample counter still advances,
+* as with a radio dropout), and written with a bad stop byte with
+* probability corrupt.
+*******************************************************************************/
+
+#ifndef CYTON_EMU_H
+#define CYTON_EMU_H
+
+#include "q8native.h"
+
+#define CYTON_EMU_FS            250.0
+#define CYTON_EMU_MAX_BURST     64
+#define CYTON_EMU_UV_PER_COUNT  (4.5e6 / 24.0 / 8388607.0)   // ADS1299, gain 24
+#define CYTON_EMU_ACCEL_G       (0.002 / 16.0)              // g per accel count
+
+typedef struct {
+    double   rate_hz;      // packets per second (0: 250)
+    int      burst;        // packets per write (0: 1, at most CYTON_EMU_MAX_BURST)
+    double   loss;         // fraction of packets lost
+    double   loss_burst;   // mean packets per loss burst (< 1: 1)
+    double   corrupt;      // fraction of packets with a bad stop byte
+    double   noise_uv;     // broadband noise floor, RMS
+    double   mains_uv;     // mains hum amplitude
+    double   mains_hz;     // 50 or 60 (0: 60)
+    uint64_t seed;         // 0: fixed default
+} cyton_emu_config_t;
+
+typedef struct {
+    uint64_t packets;      // generated (sample counter steps)
+    uint64_t sent;         // written to the pty
+    uint64_t lost;
+    uint64_t corrupted;
+    uint64_t overflow;     // not written: nobody reading and the pty buffer full
+    uint64_t commands;     // command bytes received
+    int64_t  max_late_ns;  // worst lateness of a write against its schedule
+    int      streaming;
+    int      gesture;
+} cyton_emu_stats_t;
+
+typedef struct cyton_emu cyton_emu_t;
+
+// Open the pty (its slave is kept open, so clients can come and go). NULL
+// with errno set on failure.
+cyton_emu_t *cyton_emu_create(const cyton_emu_config_t *cfg);
+void cyton_emu_destroy(cyton_emu_t *e);
+
+// Slave device path to open as the serial port (e.g. /dev/pts/3)
+const char *cyton_emu_path(const cyton_emu_t *e);
+
+// Start / stop the thread that answers commands and streams
+int cyton_emu_start(cyton_emu_t *e);
+int cyton_emu_stop(cyton_emu_t *e);
+
+// Gesture names, index 0 .. n-1 (NULL past the end); 0 is "relaxed"
+const char *cyton_emu_gesture_name(int gesture);
+
+// Switch the signal model to a gesture (its channel pattern and wrist tilt).
+// Safe while streaming. Q8_ERR_ARG for an unknown gesture.
+int cyton_emu_set_gesture(cyton_emu_t *e, int gesture);
+
+// Override the wrist tilt until the next gesture change
+int cyton_emu_set_tilt(cyton_emu_t *e, double pitch_deg, double roll_deg);
+
+int cyton_emu_set_loss(cyton_emu_t *e, double loss, double loss_burst);
+
+// Packets as they would reach the port (loss and corruption applied) into
+// out (n_packets * CYTON_FRAME_BYTES), without the pty; only while stopped.
+// Returns the number written.
+int cyton_emu_generate(cyton_emu_t *e, uint8_t *out, int n_packets);
+
+int cyton_emu_get_stats(cyton_emu_t *e, cyton_emu_stats_t *out);
+
+#endif // CYTON_EMU_H
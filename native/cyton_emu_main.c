@@ -0,0 +1,180 @@
+/*******************************************************************************
+* cyton_emu - run the Cyton board emulator as a stand-alone device
+*
+* Prints the pty path; point the wristband scripts at it with OPENBCI_PORT:
+*
+*   ./cyton_emu 250 0.01 4 /tmp/cyton &
+*   OPENBCI_PORT=/tmp/cyton python3 classify_realtime.py
+*
+* rate_hz: packets per second, loss: fraction of packets lost, cycle_s: move
+* to the next gesture every cycle_s seconds (0: stay), link: also reachable
+* through this symlink. Lines on stdin change the signal while it runs:
+*
+*   <gesture>            relaxed, forward, backward, left, right, stop, jump
+*   tilt <pitch> <roll>  wrist tilt in degrees
+*   loss <frac> [burst]  packet loss, mean burst length in packets
+*   stats
+*
+* Usage: ./cyton_emu [rate_hz=250] [loss=0] [cycle_s=0] [link]
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cyton_emu.h"
+
+static volatile sig_atomic_t g_quit;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    g_quit = 1;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int find_gesture(const char *name)
+{
+    for (int g = 0; cyton_emu_gesture_name(g); ++g)
+        if (strcmp(cyton_emu_gesture_name(g), name) == 0)
+            return g;
+    return -1;
+}
+
+static void print_stats(cyton_emu_t *e)
+{
+    cyton_emu_stats_t s;
+    cyton_emu_get_stats(e, &s);
+    printf("%s, gesture %s: %llu packets, %llu sent, %llu lost, %llu corrupted, %llu overflow, "
+           "%llu command bytes, max late %.3f ms\n",
+           s.streaming ? "streaming" : "idle", cyton_emu_gesture_name(s.gesture),
+           (unsigned long long)s.packets, (unsigned long long)s.sent, (unsigned long long)s.lost,
+           (unsigned long long)s.corrupted, (unsigned long long)s.overflow,
+           (unsigned long long)s.commands, s.max_late_ns / 1e6);
+    fflush(stdout);
+}
+
+static void handle_line(cyton_emu_t *e, char *line)
+{
+    char word[32];
+    double a, b = 1.0;
+    if (sscanf(line, "%31s", word) != 1)
+        return;
+    int g = find_gesture(word);
+    if (g >= 0) {
+        cyton_emu_set_gesture(e, g);
+        printf("gesture %s\n", word);
+    } else if (strcmp(word, "tilt") == 0 && sscanf(line, "%*s %lf %lf", &a, &b) == 2) {
+        cyton_emu_set_tilt(e, a, b);
+        printf("tilt pitch %.1f roll %.1f\n", a, b);
+    } else if (strcmp(word, "loss") == 0 && sscanf(line, "%*s %lf %lf", &a, &b) >= 1) {
+        if (cyton_emu_set_loss(e, a, b) == Q8_OK)
+            printf("loss %.4f, bursts of %.1f\n", a, b);
+        else
+            printf("loss must be in [0, 1)\n");
+    } else if (strcmp(word, "stats") == 0) {
+        print_stats(e);
+        return;
+    } else {
+        printf("unknown command: %s\n", line);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    cyton_emu_config_t cfg = {
+        .rate_hz = argc > 1 ? atof(argv[1]) : 250.0,
+        .loss = argc > 2 ? atof(argv[2]) : 0.0,
+        .noise_uv = 1.0,
+        .mains_uv = 2.0,
+    };
+    double cycle_s = argc > 3 ? atof(argv[3]) : 0.0;
+    const char *link = argc > 4 ? argv[4] : NULL;
+    if (cfg.rate_hz <= 0.0 || cycle_s < 0.0) {
+        fprintf(stderr, "usage: %s [rate_hz] [loss] [cycle_s] [link]\n", argv[0]);
+        return 1;
+    }
+
+    cyton_emu_t *e = cyton_emu_create(&cfg);
+    if (!e) {
+        perror("cyton_emu_create");
+        return 1;
+    }
+    if (link) {
+        unlink(link);
+        if (symlink(cyton_emu_path(e), link) != 0) {
+            perror(link);
+            cyton_emu_destroy(e);
+            return 1;
+        }
+    }
+    if (cyton_emu_start(e) != Q8_OK) {
+        perror("cyton_emu_start");
+        cyton_emu_destroy(e);
+        return 1;
+    }
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Cyton emulator on %s%s%s, %.0f Hz, loss %.4f\n", cyton_emu_path(e),
+           link ? " -> " : "", link ? link : "", cfg.rate_hz, cfg.loss);
+    printf("OPENBCI_PORT=%s\n", link ? link : cyton_emu_path(e));
+    fflush(stdout);
+
+    int stdin_open = 1;
+    char line[256];
+    int line_len = 0;
+    int gesture = 0;
+    double next_cycle = now_s() + cycle_s;
+    while (!g_quit) {
+        struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&pfd, stdin_open ? 1 : 0, 200) > 0) {
+            ssize_t got = read(STDIN_FILENO, &line[line_len], sizeof(line) - 1 - line_len);
+            if (got <= 0)
+                stdin_open = 0;
+            else
+                line_len += (int)got;
+
+            // Whole lines only; an overlong line is dropped
+            char *nl;
+            while ((nl = memchr(line, '\n', line_len)) != NULL) {
+                *nl = '\0';
+                handle_line(e, line);
+                line_len -= (int)(nl + 1 - line);
+                memmove(line, nl + 1, line_len);
+            }
+            if (line_len == (int)sizeof(line) - 1)
+                line_len = 0;
+        }
+        if (cycle_s > 0.0 && now_s() >= next_cycle) {
+            if (!cyton_emu_gesture_name(++gesture))
+                gesture = 0;
+            cyton_emu_set_gesture(e, gesture);
+            printf("gesture %s\n", cyton_emu_gesture_name(gesture));
+            fflush(stdout);
+            next_cycle += cycle_s;
+        }
+    }
+
+    cyton_emu_stop(e);
+    print_stats(e);
+    cyton_emu_destroy(e);
+    if (link)
+        unlink(link);
+    return 0;
+}
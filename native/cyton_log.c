@@ -0,0 +1,497 @@
+/*******************************************************************************
+* cyton_log - segmented binary log of the raw Cyton byte stream
+*
+* Producers (the acquisition thread, Python's marker calls) copy records
+* into a byte ring under a mutex that is never held across I/O. The writer
+* thread wakes every WRITER_PERIOD_MS (or on flush / close), takes the
+* queued range, cuts it at segment boundaries and writes each piece with
+* one writev. Producers make no syscalls.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cyton_log.h"
+
+#define WRITER_PERIOD_MS  20
+
+static const char MAGIC[8] = { 'Q', '8', 'C', 'Y', 'T', 'L', 'O', 'G' };
+
+struct cyton_log {
+    char dir[PATH_MAX - 32];
+    int baud;
+    int64_t segment_bytes;
+
+    // Queued records (file format); head / tail are byte counts
+    uint8_t *queue;
+    uint64_t head, tail;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         // writer: flush or close requested
+    pthread_cond_t drained;      // head advanced
+    int stop;
+    cyton_log_stats_t stats;
+
+    // Writer thread only
+    int fd;
+    int segment;
+    int64_t seg_bytes;
+    pthread_t thread;
+};
+
+struct cyton_log_reader {
+    char dir[PATH_MAX - 32];
+    FILE *f;
+    int segment;                 // open segment (or next to open)
+    cyton_log_info_t info;
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void put_le(uint8_t *p, uint64_t v, int n)
+{
+    for (int i = 0; i < n; ++i)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static void segment_path(char *out, size_t cap, const char *dir, int segment)
+{
+    snprintf(out, cap, "%s/segment-%06d.cytlog", dir, segment);
+}
+
+// ----------------------------------------------------------------------------
+// Writing
+// ----------------------------------------------------------------------------
+static void ring_put(cyton_log_t *w, uint64_t pos, const uint8_t *src, size_t n)
+{
+    size_t off = pos & (CYTON_LOG_QUEUE - 1);
+    size_t first = n < CYTON_LOG_QUEUE - off ? n : CYTON_LOG_QUEUE - off;
+    memcpy(&w->queue[off], src, first);
+    memcpy(w->queue, src + first, n - first);
+}
+
+static void ring_get(const cyton_log_t *w, uint64_t pos, uint8_t *dst, size_t n)
+{
+    size_t off = pos & (CYTON_LOG_QUEUE - 1);
+    size_t first = n < CYTON_LOG_QUEUE - off ? n : CYTON_LOG_QUEUE - off;
+    memcpy(dst, &w->queue[off], first);
+    memcpy(dst + first, w->queue, n - first);
+}
+
+static int queue_record(cyton_log_t *w, int type, const uint8_t *data, int len, int64_t t_ns)
+{
+    if (!w || len < 0 || len > CYTON_LOG_MAX_PAYLOAD || (len > 0 && !data))
+        return Q8_ERR_ARG;
+
+    uint8_t hdr[CYTON_LOG_RECORD_BYTES] = { 0 };
+    put_le(&hdr[0], (uint64_t)t_ns, 8);
+    put_le(&hdr[8], (uint64_t)len, 4);
+    put_le(&hdr[12], (uint64_t)type, 2);
+
+    pthread_mutex_lock(&w->lock);
+    uint64_t need = CYTON_LOG_RECORD_BYTES + (uint64_t)len;
+    if (CYTON_LOG_QUEUE - (w->tail - w->head) < need) {
+        w->stats.dropped++;
+        pthread_mutex_unlock(&w->lock);
+        return Q8_ERR_FULL;
+    }
+    ring_put(w, w->tail, hdr, sizeof(hdr));
+    ring_put(w, w->tail + sizeof(hdr), data, (size_t)len);
+    w->tail += need;
+    pthread_mutex_unlock(&w->lock);
+    return Q8_OK;
+}
+
+int cyton_log_append(cyton_log_t *w, const uint8_t *data, int len, int64_t t_ns)
+{
+    return queue_record(w, CYTON_LOG_DATA, data, len, t_ns);
+}
+
+int cyton_log_mark(cyton_log_t *w, const char *text, int64_t t_ns)
+{
+    if (!text)
+        return Q8_ERR_ARG;
+    return queue_record(w, CYTON_LOG_MARK, (const uint8_t *)text, (int)strlen(text), t_ns);
+}
+
+static int write_all(int fd, struct iovec *iov, int n)
+{
+    while (n > 0) {
+        ssize_t done = writev(fd, iov, n);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        while (n > 0 && (size_t)done >= iov->iov_len) {
+            done -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + done;
+            iov->iov_len -= (size_t)done;
+        }
+    }
+    return 0;
+}
+
+static int open_segment(cyton_log_t *w, int segment)
+{
+    char path[PATH_MAX];
+    segment_path(path, sizeof(path), w->dir, segment);
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    uint8_t hdr[CYTON_LOG_HEADER_BYTES] = { 0 };
+    memcpy(hdr, MAGIC, sizeof(MAGIC));
+    put_le(&hdr[8], CYTON_LOG_VERSION, 4);
+    put_le(&hdr[12], (uint64_t)segment, 4);
+    put_le(&hdr[16], (uint64_t)w->baud, 4);
+    put_le(&hdr[24], (uint64_t)now_ns(), 8);
+    struct iovec iov = { hdr, sizeof(hdr) };
+    if (write_all(fd, &iov, 1) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    if (w->fd >= 0) {
+        fdatasync(w->fd);
+        close(w->fd);
+    }
+    w->fd = fd;
+    w->segment = segment;
+    w->seg_bytes = CYTON_LOG_HEADER_BYTES;
+    return 0;
+}
+
+// Write queued bytes [h, t) (whole records); returns records / bytes / marks done
+static void write_range(cyton_log_t *w, uint64_t h, uint64_t t, cyton_log_stats_t *done)
+{
+    while (h < t) {
+        // Take whole records up to the end of the current segment
+        uint64_t end = h;
+        uint64_t records = 0, bytes = 0, marks = 0;
+        while (end < t) {
+            uint8_t hdr[CYTON_LOG_RECORD_BYTES];
+            ring_get(w, end, hdr, sizeof(hdr));
+            uint64_t len = get_le(&hdr[8], 4);
+            uint64_t size = CYTON_LOG_RECORD_BYTES + len;
+            int64_t seg_after = w->seg_bytes + (int64_t)(end - h + size);
+            if (seg_after > w->segment_bytes && (end > h || w->seg_bytes > CYTON_LOG_HEADER_BYTES))
+                break;
+            if (get_le(&hdr[12], 2) == CYTON_LOG_MARK) {
+                marks++;
+            } else {
+                records++;
+                bytes += len;
+            }
+            end += size;
+        }
+        if (end == h) {
+            if (open_segment(w, w->segment + 1) != 0) {
+                done->error = errno;
+                done->dropped += 1;
+                // Skip one record so the queue keeps moving
+                uint8_t hdr[CYTON_LOG_RECORD_BYTES];
+                ring_get(w, h, hdr, sizeof(hdr));
+                h += CYTON_LOG_RECORD_BYTES + get_le(&hdr[8], 4);
+            } else {
+                done->segments++;
+            }
+            continue;
+        }
+
+        size_t off = h & (CYTON_LOG_QUEUE - 1);
+        size_t n = (size_t)(end - h);
+        size_t first = n < CYTON_LOG_QUEUE - off ? n : CYTON_LOG_QUEUE - off;
+        struct iovec iov[2] = { { &w->queue[off], first }, { w->queue, n - first } };
+        if (w->fd < 0 || write_all(w->fd, iov, n > first ? 2 : 1) != 0) {
+            done->error = w->fd < 0 ? EBADF : errno;
+            done->dropped += records + marks;
+        } else {
+            done->records += records;
+            done->bytes += bytes;
+            done->marks += marks;
+        }
+        w->seg_bytes += (int64_t)n;
+        h = end;
+    }
+}
+
+static void *writer_thread(void *arg)
+{
+    cyton_log_t *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        if (w->head == w->tail) {
+            if (w->stop)
+                break;
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_nsec += WRITER_PERIOD_MS * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&w->wake, &w->lock, &ts);
+            continue;
+        }
+
+        uint64_t h = w->head, t = w->tail;
+        pthread_mutex_unlock(&w->lock);
+
+        cyton_log_stats_t done = { 0 };
+        write_range(w, h, t, &done);
+
+        pthread_mutex_lock(&w->lock);
+        w->head = t;
+        w->stats.records += done.records;
+        w->stats.bytes += done.bytes;
+        w->stats.marks += done.marks;
+        w->stats.dropped += done.dropped;
+        w->stats.segments += done.segments;
+        if (done.error)
+            w->stats.error = done.error;
+        pthread_cond_broadcast(&w->drained);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+cyton_log_t *cyton_log_open(const char *dir, int baud, int64_t segment_bytes)
+{
+    if (!dir || strlen(dir) >= sizeof(((cyton_log_t *)0)->dir) || baud < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    cyton_log_t *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    strcpy(w->dir, dir);
+    w->baud = baud;
+    w->segment_bytes = segment_bytes > CYTON_LOG_HEADER_BYTES ? segment_bytes : CYTON_LOG_SEGMENT_BYTES;
+    w->fd = -1;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, &ca);
+    pthread_cond_init(&w->drained, NULL);
+    pthread_condattr_destroy(&ca);
+
+    int err;
+    w->queue = malloc(CYTON_LOG_QUEUE);
+    if (!w->queue) {
+        err = ENOMEM;
+        goto fail;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        err = errno;
+        goto fail;
+    }
+    if (open_segment(w, 0) != 0) {
+        err = errno;
+        goto fail;
+    }
+    w->stats.segments = 1;
+    if ((err = pthread_create(&w->thread, NULL, writer_thread, w)) != 0)
+        goto fail;
+    return w;
+
+fail:
+    if (w->fd >= 0)
+        close(w->fd);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    pthread_cond_destroy(&w->drained);
+    free(w->queue);
+    free(w);
+    errno = err;
+    return NULL;
+}
+
+void cyton_log_close(cyton_log_t *w)
+{
+    if (!w)
+        return;
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    if (w->fd >= 0) {
+        fdatasync(w->fd);
+        close(w->fd);
+    }
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    pthread_cond_destroy(&w->drained);
+    free(w->queue);
+    free(w);
+}
+
+int cyton_log_flush(cyton_log_t *w)
+{
+    if (!w)
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&w->lock);
+    uint64_t target = w->tail;
+    pthread_cond_signal(&w->wake);
+    while (w->head < target)
+        pthread_cond_wait(&w->drained, &w->lock);
+    int err = w->stats.error;
+    pthread_mutex_unlock(&w->lock);
+    if (err) {
+        errno = err;
+        return Q8_ERR_IO;
+    }
+    return Q8_OK;
+}
+
+int cyton_log_get_stats(cyton_log_t *w, cyton_log_stats_t *out)
+{
+    if (!w || !out)
+        return Q8_ERR_ARG;
+    pthread_mutex_lock(&w->lock);
+    *out = w->stats;
+    pthread_mutex_unlock(&w->lock);
+    return Q8_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Reading
+// ----------------------------------------------------------------------------
+
+// Open segment `segment` and check its header; NULL if it does not exist
+static FILE *open_read(cyton_log_reader_t *rd, int segment, uint8_t *hdr)
+{
+    char path[PATH_MAX];
+    segment_path(path, sizeof(path), rd->dir, segment);
+    FILE *f = fopen(path, "rbe");
+    if (!f)
+        return NULL;
+    if (fread(hdr, 1, CYTON_LOG_HEADER_BYTES, f) != CYTON_LOG_HEADER_BYTES ||
+        memcmp(hdr, MAGIC, sizeof(MAGIC)) != 0 || get_le(&hdr[8], 4) != CYTON_LOG_VERSION) {
+        fclose(f);
+        errno = EPROTO;
+        return NULL;
+    }
+    return f;
+}
+
+cyton_log_reader_t *cyton_log_reader_open(const char *dir)
+{
+    if (!dir || strlen(dir) >= sizeof(((cyton_log_reader_t *)0)->dir)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    cyton_log_reader_t *rd = calloc(1, sizeof(*rd));
+    if (!rd)
+        return NULL;
+    strcpy(rd->dir, dir);
+
+    uint8_t hdr[CYTON_LOG_HEADER_BYTES];
+    rd->f = open_read(rd, 0, hdr);
+    if (!rd->f) {
+        int err = errno;
+        free(rd);
+        errno = err;
+        return NULL;
+    }
+    rd->info.baud = (int)get_le(&hdr[16], 4);
+    rd->info.t_created_ns = (int64_t)get_le(&hdr[24], 8);
+
+    char path[PATH_MAX];
+    struct stat st;
+    do {
+        segment_path(path, sizeof(path), dir, ++rd->info.segments);
+    } while (stat(path, &st) == 0);
+    return rd;
+}
+
+void cyton_log_reader_close(cyton_log_reader_t *rd)
+{
+    if (!rd)
+        return;
+    if (rd->f)
+        fclose(rd->f);
+    free(rd);
+}
+
+int cyton_log_read(cyton_log_reader_t *rd, cyton_log_record_t *rec, uint8_t *buf, int cap)
+{
+    if (!rd || !rec || cap < 0 || (cap > 0 && !buf))
+        return Q8_ERR_ARG;
+
+    for (;;) {
+        if (!rd->f) {
+            if (rd->segment + 1 >= rd->info.segments)
+                return 0;
+            uint8_t hdr[CYTON_LOG_HEADER_BYTES];
+            rd->f = open_read(rd, rd->segment + 1, hdr);
+            if (!rd->f)
+                return Q8_ERR_IO;
+            rd->segment++;
+        }
+
+        uint8_t hdr[CYTON_LOG_RECORD_BYTES];
+        size_t got = fread(hdr, 1, sizeof(hdr), rd->f);
+        uint64_t len = got == sizeof(hdr) ? get_le(&hdr[8], 4) : 0;
+        if (got == sizeof(hdr) && len > CYTON_LOG_MAX_PAYLOAD)
+            got = 0;                      // corrupt length: treat as cut short
+        if (got == sizeof(hdr) && len > (uint64_t)cap) {
+            fseek(rd->f, -(long)sizeof(hdr), SEEK_CUR);
+            return Q8_ERR_ARG;
+        }
+        if (got == sizeof(hdr) && fread(buf, 1, (size_t)len, rd->f) == len) {
+            rec->t_ns = (int64_t)get_le(&hdr[0], 8);
+            rec->len = (int)len;
+            rec->type = (int)get_le(&hdr[12], 2);
+            rec->segment = rd->segment;
+            return 1;
+        }
+
+        // End of this segment (or a record cut short by a crash)
+        if (got != 0 || !feof(rd->f))
+            rd->info.truncated++;
+        fclose(rd->f);
+        rd->f = NULL;
+    }
+}
+
+int cyton_log_reader_info(const cyton_log_reader_t *rd, cyton_log_info_t *out)
+{
+    if (!rd || !out)
+        return Q8_ERR_ARG;
+    *out = rd->info;
+    return Q8_OK;
+}
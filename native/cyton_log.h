@@ -0,0 +1,101 @@
+/*******************************************************************************
+* cyton_log - segmented binary log of the raw Cyton byte stream
+*
+* Records every chunk exactly as it came off the serial port (resync bytes
+* and all) with its CLOCK_MONOTONIC arrival time, plus text markers (gesture
+* prompts, ...), so a session can be replayed through the whole pipeline.
+*
+* On disk: DIR/segment-000000.cytlog, segment-000001.cytlog, ... A new
+* segment starts when the current one would exceed segment_bytes. Every
+* segment has a 32-byte header (magic "Q8CYTLOG", version, segment index,
+* baud, creation time) followed by records:
+*
+*   t_ns (i64)  arrival time of the chunk / time of the marker
+*   len (u32)   payload bytes
+*   type (u16)  CYTON_LOG_DATA or CYTON_LOG_MARK
+*   reserved (u16)
+*   payload
+*
+* all little endian. A record cut short by a crash ends its segment.
+*
+* Writing never blocks the caller on disk: append and mark copy the record
+* into an in-memory queue and a writer thread moves it to the file. When
+* the queue is full the record is dropped and counted.
+*******************************************************************************/
+
+#ifndef CYTON_LOG_H
+#define CYTON_LOG_H
+
+#include "q8native.h"
+
+#define CYTON_LOG_VERSION        1
+#define CYTON_LOG_HEADER_BYTES   32
+#define CYTON_LOG_RECORD_BYTES   16        // record header
+#define CYTON_LOG_MAX_PAYLOAD    65536
+#define CYTON_LOG_QUEUE          (1 << 20) // bytes queued for the writer thread
+#define CYTON_LOG_SEGMENT_BYTES  (64LL << 20)
+
+enum { CYTON_LOG_DATA = 0, CYTON_LOG_MARK = 1 };
+
+typedef struct {
+    uint64_t records;          // data records written to disk
+    uint64_t bytes;            // stream bytes in them
+    uint64_t marks;
+    uint64_t dropped;          // records lost because the queue was full
+    uint64_t segments;
+    int      error;            // errno of the last failed file operation (0 if none)
+} cyton_log_stats_t;
+
+typedef struct {
+    int64_t  t_ns;
+    int      len;
+    int      type;             // CYTON_LOG_*
+    int      segment;
+} cyton_log_record_t;
+
+typedef struct {
+    int      baud;
+    int      segments;
+    int64_t  t_created_ns;     // of the first segment
+    uint64_t truncated;        // records cut short (so far, while reading)
+} cyton_log_info_t;
+
+typedef struct cyton_log cyton_log_t;
+typedef struct cyton_log_reader cyton_log_reader_t;
+
+// ----------------------------------------------------------------------------
+// Writing
+// ----------------------------------------------------------------------------
+
+// Start a log in dir (created if missing; fails with EEXIST if it already
+// holds a log). segment_bytes <= 0: CYTON_LOG_SEGMENT_BYTES. NULL with errno
+// set on failure.
+cyton_log_t *cyton_log_open(const char *dir, int baud, int64_t segment_bytes);
+
+// Write everything queued, then close
+void cyton_log_close(cyton_log_t *w);
+
+// Queue a chunk of stream bytes / a text marker. Safe from any thread,
+// never waits for the disk. Q8_ERR_FULL when the queue is full.
+int cyton_log_append(cyton_log_t *w, const uint8_t *data, int len, int64_t t_ns);
+int cyton_log_mark(cyton_log_t *w, const char *text, int64_t t_ns);
+
+// Wait until everything queued so far is written to the file
+int cyton_log_flush(cyton_log_t *w);
+
+int cyton_log_get_stats(cyton_log_t *w, cyton_log_stats_t *out);
+
+// ----------------------------------------------------------------------------
+// Reading
+// ----------------------------------------------------------------------------
+cyton_log_reader_t *cyton_log_reader_open(const char *dir);
+void cyton_log_reader_close(cyton_log_reader_t *rd);
+
+// Next record, across segments in order: payload to buf (at most cap
+// bytes). Returns 1, 0 at the end of the log, or Q8_ERR_ARG (buf too
+// small) / Q8_ERR_IO.
+int cyton_log_read(cyton_log_reader_t *rd, cyton_log_record_t *rec, uint8_t *buf, int cap);
+
+int cyton_log_reader_info(const cyton_log_reader_t *rd, cyton_log_info_t *out);
+
+#endif // CYTON_LOG_H
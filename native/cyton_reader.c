@@ -0,0 +1,512 @@
+/*******************************************************************************
+* cyton_reader - dedicated acquisition thread for the OpenBCI Cyton dongle
+*
+* Ring protocol: the reader thread is the only writer. Each slot has a
+* sequence word (seqlock): the writer marks slot (seq & mask) odd, fills
+* it, stores 2 * seq + 2 (release) and then publishes it by storing
+* head = seq + 1 (release). A consumer loads the slot's word (acquire),
+* copies the frame, fences (acquire) and reloads the word: the copy is
+* frame `seq` intact iff both loads read 2 * seq + 2. Anything else means
+* the slot was overwritten or is being written; the consumer retries from
+* the oldest frame the writer cannot be touching. Waiting consumers sleep
+* on a futex that the writer only wakes when someone waits.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cyton_reader.h"
+#include "q8_trace.h"
+
+_Static_assert(sizeof(cyton_frame_t) == 96, "cyton_frame_t layout is shared with q8native.py");
+
+#define READ_BUF       4096
+#define MAX_PER_READ   (READ_BUF / CYTON_FRAME_BYTES + 1)
+#define MIN_CAPACITY   256
+
+struct cyton_reader {
+    int fd;
+    int wake[2];                 // pipe used to stop the thread
+    int baud;
+    struct termios saved_tio;
+    int have_tio;
+    int saved_flags;
+
+    cyton_frame_t *ring;
+    _Atomic uint64_t *slot_seq;  // per slot: 2 * seq + 2 when complete, odd while written
+    uint64_t capacity;
+    uint64_t mask;
+    _Atomic uint64_t head;       // frames published
+    _Atomic uint32_t futex_word; // low 32 bits of head
+    _Atomic int waiters;
+
+    // Per consumer, each touched only by the consumer's own thread
+    uint64_t cursor[CYTON_MAX_CONSUMERS];
+    uint64_t dropped[CYTON_MAX_CONSUMERS];
+    _Atomic int n_consumers;
+
+    // Written by the reader thread, read relaxed by anyone
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t resync_bytes;
+    _Atomic uint64_t max_batch;
+    _Atomic int error;
+
+    pthread_t thread;
+    int running;
+
+    // Reassembly buffer (reader thread only)
+    uint8_t buf[READ_BUF];
+    int buf_len;
+
+    int trace_read;              // q8_trace name: read() return -> published
+    _Atomic(cyton_log_t *) log;  // raw stream tap (NULL: off)
+};
+
+int64_t cyton_monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static speed_t baud_to_speed(int baud)
+{
+    switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      return 0;
+    }
+}
+
+cyton_reader_t *cyton_reader_create(int fd, int baud, int capacity)
+{
+    if (fd < 0 || capacity < 1 || capacity > (1 << 24))
+        return NULL;
+    if (baud != 0 && baud_to_speed(baud) == 0)
+        return NULL;
+
+    cyton_reader_t *r = calloc(1, sizeof(*r));
+    if (!r)
+        return NULL;
+    r->fd = fd;
+    r->baud = baud;
+    r->wake[0] = r->wake[1] = -1;
+
+    uint64_t cap = MIN_CAPACITY;
+    while (cap < (uint64_t)capacity)
+        cap <<= 1;
+    r->capacity = cap;
+    r->mask = cap - 1;
+    r->ring = calloc(cap, sizeof(cyton_frame_t));
+    r->slot_seq = calloc(cap, sizeof(*r->slot_seq));
+    if (!r->ring || !r->slot_seq) {
+        free(r->ring);
+        free(r->slot_seq);
+        free(r);
+        return NULL;
+    }
+    r->trace_read = q8_trace_name("cyton_read");
+    return r;
+}
+
+void cyton_reader_destroy(cyton_reader_t *r)
+{
+    if (!r)
+        return;
+    cyton_reader_stop(r);
+    free(r->ring);
+    free(r->slot_seq);
+    free(r);
+}
+
+// Raw mode, one frame per read(): VMIN = 33 bytes, VTIME = 100 ms between bytes
+static int configure_tty(cyton_reader_t *r)
+{
+    r->saved_flags = fcntl(r->fd, F_GETFL);
+    if (r->saved_flags < 0)
+        return Q8_ERR_IO;
+    if (fcntl(r->fd, F_SETFL, r->saved_flags & ~O_NONBLOCK) < 0)
+        return Q8_ERR_IO;
+
+    if (tcgetattr(r->fd, &r->saved_tio) != 0) {
+        if (errno == ENOTTY || errno == EINVAL)
+            return Q8_OK;            // pipe or file (tests): plain blocking reads
+        return Q8_ERR_IO;
+    }
+    r->have_tio = 1;
+
+    struct termios tio = r->saved_tio;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = CYTON_FRAME_BYTES;
+    tio.c_cc[VTIME] = 1;
+    if (r->baud)
+        cfsetspeed(&tio, baud_to_speed(r->baud));
+    if (tcsetattr(r->fd, TCSANOW, &tio) != 0)
+        return Q8_ERR_IO;
+    return Q8_OK;
+}
+
+static void restore_tty(cyton_reader_t *r)
+{
+    if (r->have_tio)
+        tcsetattr(r->fd, TCSANOW, &r->saved_tio);
+    r->have_tio = 0;
+    if (r->saved_flags >= 0)
+        fcntl(r->fd, F_SETFL, r->saved_flags);
+}
+
+static void decode(cyton_frame_t *f, const uint8_t *p)
+{
+    memset(f, 0, sizeof(*f));
+    memcpy(f->raw, p, CYTON_FRAME_BYTES);
+    f->sample = p[1];
+    for (int c = 0; c < CYTON_CHANNELS; ++c) {
+        const uint8_t *b = &p[2 + 3 * c];
+        int32_t v = ((int32_t)b[0] << 16) | ((int32_t)b[1] << 8) | b[2];
+        if (v & 0x800000)
+            v -= 0x1000000;
+        f->channels[c] = v;
+    }
+    for (int a = 0; a < CYTON_AUX_AXES; ++a)
+        f->accel[a] = (int16_t)(((uint16_t)p[26 + 2 * a] << 8) | p[27 + 2 * a]);
+}
+
+static void publish(cyton_reader_t *r, const cyton_frame_t *frames, int n)
+{
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        _Atomic uint64_t *word = &r->slot_seq[head & r->mask];
+        cyton_frame_t *slot = &r->ring[head & r->mask];
+        atomic_store_explicit(word, 2 * head + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        *slot = frames[i];
+        slot->seq = head;
+        atomic_store_explicit(word, 2 * head + 2, memory_order_release);
+        atomic_store_explicit(&r->head, ++head, memory_order_release);
+    }
+    // seq_cst on both sides: the waiter bumps `waiters` before the kernel
+    // compares futex_word, so one of them always sees the other
+    atomic_store(&r->futex_word, (uint32_t)head);
+    if (atomic_load(&r->waiters) > 0)
+        syscall(SYS_futex, &r->futex_word, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+int cyton_extract_frames(uint8_t *buf, int *len, cyton_frame_t *out, int max_frames,
+                         int64_t t_ns, uint64_t *skipped)
+{
+    if (!buf || !len || !out || max_frames < 0)
+        return Q8_ERR_ARG;
+
+    int n = 0, i = 0;
+    uint64_t skip = 0;
+
+    while (*len - i >= CYTON_FRAME_BYTES && n < max_frames) {
+        const uint8_t *p = &buf[i];
+        if (p[0] != CYTON_START_BYTE || (p[CYTON_FRAME_BYTES - 1] & 0xF0) != CYTON_END_BYTE) {
+            i++;
+            skip++;
+            continue;
+        }
+        decode(&out[n], p);
+        out[n].t_ns = t_ns;
+        n++;
+        i += CYTON_FRAME_BYTES;
+    }
+
+    if (i > 0) {
+        memmove(buf, &buf[i], *len - i);
+        *len -= i;
+    }
+    for (int k = 0; k < n; ++k)
+        out[k].batch = (uint8_t)(n > 255 ? 255 : n);
+    if (skipped)
+        *skipped += skip;
+    return n;
+}
+
+static void *reader_thread(void *arg)
+{
+    cyton_reader_t *r = arg;
+    cyton_frame_t frames[MAX_PER_READ];
+    q8_trace_thread_name("cyton_reader");
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = r->fd, .events = POLLIN },
+            { .fd = r->wake[0], .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            atomic_store(&r->error, errno);
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (fds[0].revents & POLLNVAL) {
+            atomic_store(&r->error, EBADF);
+            break;
+        }
+
+        // Blocks until a whole frame is in (VMIN) or the line goes quiet (VTIME)
+        ssize_t got = read(r->fd, &r->buf[r->buf_len], READ_BUF - r->buf_len);
+        int64_t t_ns = cyton_monotonic_ns();
+        if (got < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            atomic_store(&r->error, errno);
+            break;
+        }
+        if (got == 0) {
+            if (fds[0].revents & POLLHUP) {
+                atomic_store(&r->error, EPIPE);
+                break;
+            }
+            continue;
+        }
+
+        cyton_log_t *log = atomic_load_explicit(&r->log, memory_order_acquire);
+        if (log)
+            cyton_log_append(log, &r->buf[r->buf_len], (int)got, t_ns);
+
+        r->buf_len += (int)got;
+        atomic_fetch_add_explicit(&r->bytes, (uint64_t)got, memory_order_relaxed);
+        atomic_fetch_add_explicit(&r->reads, 1, memory_order_relaxed);
+
+        uint64_t skipped = 0;
+        int n = cyton_extract_frames(r->buf, &r->buf_len, frames, MAX_PER_READ, t_ns, &skipped);
+        if (skipped)
+            atomic_fetch_add_explicit(&r->resync_bytes, skipped, memory_order_relaxed);
+        if (n > 0) {
+            publish(r, frames, n);
+            if ((uint64_t)n > atomic_load_explicit(&r->max_batch, memory_order_relaxed))
+                atomic_store_explicit(&r->max_batch, (uint64_t)n, memory_order_relaxed);
+            if (q8_trace_enabled())
+                q8_trace_span(r->trace_read, t_ns, cyton_monotonic_ns(),
+                              atomic_load_explicit(&r->head, memory_order_relaxed) - 1);
+        }
+
+        // Line noise without a start byte: keep the buffer from filling up
+        if (r->buf_len == READ_BUF) {
+            atomic_fetch_add_explicit(&r->resync_bytes, READ_BUF - CYTON_FRAME_BYTES, memory_order_relaxed);
+            memmove(r->buf, &r->buf[READ_BUF - CYTON_FRAME_BYTES], CYTON_FRAME_BYTES);
+            r->buf_len = CYTON_FRAME_BYTES;
+        }
+    }
+    return NULL;
+}
+
+int cyton_reader_start(cyton_reader_t *r, int rt_priority)
+{
+    if (!r)
+        return Q8_ERR_ARG;
+    if (r->running)
+        return Q8_OK;
+
+    r->saved_flags = -1;
+    if (configure_tty(r) != Q8_OK) {
+        int err = errno;
+        restore_tty(r);
+        errno = err;
+        return Q8_ERR_IO;
+    }
+    if (pipe(r->wake) != 0) {
+        restore_tty(r);
+        return Q8_ERR_IO;
+    }
+
+    atomic_store(&r->error, 0);
+    r->buf_len = 0;
+
+    int rc = -1;
+    if (rt_priority > 0) {
+        pthread_attr_t attr;
+        struct sched_param sp = { .sched_priority = rt_priority };
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &sp);
+        rc = pthread_create(&r->thread, &attr, reader_thread, r);
+        pthread_attr_destroy(&attr);
+    }
+    if (rc != 0)
+        rc = pthread_create(&r->thread, NULL, reader_thread, r);   // not permitted: normal priority
+    if (rc != 0) {
+        close(r->wake[0]);
+        close(r->wake[1]);
+        r->wake[0] = r->wake[1] = -1;
+        restore_tty(r);
+        errno = rc;
+        return Q8_ERR_IO;
+    }
+    r->running = 1;
+    return Q8_OK;
+}
+
+int cyton_reader_stop(cyton_reader_t *r)
+{
+    if (!r)
+        return Q8_ERR_ARG;
+    if (!r->running)
+        return Q8_OK;
+
+    const char c = 'q';
+    ssize_t w = write(r->wake[1], &c, 1);
+    (void)w;
+    pthread_join(r->thread, NULL);
+    close(r->wake[0]);
+    close(r->wake[1]);
+    r->wake[0] = r->wake[1] = -1;
+    restore_tty(r);
+    r->running = 0;
+
+    // Release anyone still waiting
+    atomic_fetch_add(&r->futex_word, 1);
+    syscall(SYS_futex, &r->futex_word, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+    return Q8_OK;
+}
+
+int cyton_reader_add_consumer(cyton_reader_t *r)
+{
+    if (!r)
+        return Q8_ERR_ARG;
+    int id = atomic_fetch_add(&r->n_consumers, 1);
+    if (id >= CYTON_MAX_CONSUMERS) {
+        atomic_fetch_sub(&r->n_consumers, 1);
+        return Q8_ERR_FULL;
+    }
+    r->cursor[id] = atomic_load_explicit(&r->head, memory_order_acquire);
+    r->dropped[id] = 0;
+    return id;
+}
+
+static int valid_consumer(const cyton_reader_t *r, int consumer)
+{
+    return r && consumer >= 0 && consumer < atomic_load(&r->n_consumers);
+}
+
+int cyton_reader_read(cyton_reader_t *r, int consumer, cyton_frame_t *out, int max_frames)
+{
+    if (!valid_consumer(r, consumer) || !out || max_frames < 0)
+        return Q8_ERR_ARG;
+
+    uint64_t cur = r->cursor[consumer];
+    int n = 0;
+
+    while (n < max_frames) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (cur >= head)
+            break;
+        if (head - cur >= r->capacity) {
+            // Overrun: jump to the oldest slot the writer cannot be touching
+            uint64_t oldest = head - r->capacity + 1;
+            r->dropped[consumer] += oldest - cur;
+            cur = oldest;
+        }
+
+        _Atomic uint64_t *word = &r->slot_seq[cur & r->mask];
+        uint64_t before = atomic_load_explicit(word, memory_order_acquire);
+        out[n] = r->ring[cur & r->mask];
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t after = atomic_load_explicit(word, memory_order_relaxed);
+        if (before != 2 * cur + 2 || after != before)
+            continue;               // overwritten while copying; retry from the new oldest
+
+        n++;
+        cur++;
+    }
+
+    r->cursor[consumer] = cur;
+    return n;
+}
+
+int cyton_reader_pending(cyton_reader_t *r, int consumer)
+{
+    if (!valid_consumer(r, consumer))
+        return Q8_ERR_ARG;
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t pending = head - r->cursor[consumer];
+    if (pending > r->capacity)
+        pending = r->capacity;
+    return (int)pending;
+}
+
+int cyton_reader_skip(cyton_reader_t *r, int consumer)
+{
+    if (!valid_consumer(r, consumer))
+        return Q8_ERR_ARG;
+    r->cursor[consumer] = atomic_load_explicit(&r->head, memory_order_acquire);
+    return Q8_OK;
+}
+
+int cyton_reader_wait(cyton_reader_t *r, int consumer, int timeout_ms)
+{
+    if (!valid_consumer(r, consumer))
+        return Q8_ERR_ARG;
+
+    uint32_t seen = atomic_load_explicit(&r->futex_word, memory_order_acquire);
+    if (cyton_reader_pending(r, consumer) > 0)
+        return 1;
+    if (!r->running)
+        return 0;
+
+    struct timespec ts, *tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+
+    atomic_fetch_add(&r->waiters, 1);
+    syscall(SYS_futex, &r->futex_word, FUTEX_WAIT_PRIVATE, seen, tsp, NULL, 0);
+    atomic_fetch_sub(&r->waiters, 1);
+
+    return cyton_reader_pending(r, consumer) > 0;
+}
+
+int cyton_reader_record(cyton_reader_t *r, cyton_log_t *log)
+{
+    if (!r)
+        return Q8_ERR_ARG;
+    atomic_store_explicit(&r->log, log, memory_order_release);
+    return Q8_OK;
+}
+
+int cyton_reader_get_stats(cyton_reader_t *r, int consumer, cyton_reader_stats_t *out)
+{
+    if (!r || !out)
+        return Q8_ERR_ARG;
+    out->frames = atomic_load_explicit(&r->head, memory_order_acquire);
+    out->bytes = atomic_load_explicit(&r->bytes, memory_order_relaxed);
+    out->reads = atomic_load_explicit(&r->reads, memory_order_relaxed);
+    out->resync_bytes = atomic_load_explicit(&r->resync_bytes, memory_order_relaxed);
+    out->max_batch = atomic_load_explicit(&r->max_batch, memory_order_relaxed);
+    out->dropped = valid_consumer(r, consumer) ? r->dropped[consumer] : 0;
+    return Q8_OK;
+}
+
+int cyton_reader_error(const cyton_reader_t *r)
+{
+    return r ? atomic_load((_Atomic int *)&r->error) : EINVAL;
+}
@@ -0,0 +1,98 @@
+/*******************************************************************************
+* cyton_reader - dedicated acquisition thread for the OpenBCI Cyton dongle
+*
+* The reader thread blocks on the serial fd (VMIN = one 33-byte frame,
+* VTIME = 100 ms), reassembles frames, decodes the 8 channels and the
+* accelerometer axes in one pass and stamps each frame with CLOCK_MONOTONIC
+* when the read that completed it returned.
+* Frames go into a single-producer broadcast ring. Every consumer (e.g. the
+* classifier and a recorder) has its own cursor, so they read at their own
+* pace without locks and without taking frames from each other.
+*
+* A consumer that falls more than `capacity` frames behind skips ahead to
+* the oldest frame still in the ring; the skipped frames are counted as
+* dropped for that consumer only.
+*******************************************************************************/
+
+#ifndef CYTON_READER_H
+#define CYTON_READER_H
+
+#include "q8native.h"
+#include "cyton_log.h"
+
+#define CYTON_FRAME_BYTES     33
+#define CYTON_START_BYTE      0xA0
+#define CYTON_END_BYTE        0xC0
+#define CYTON_CHANNELS        8
+#define CYTON_AUX_AXES        3
+#define CYTON_MAX_CONSUMERS   8
+
+typedef struct {
+    uint64_t seq;                      // frame number since start
+    int64_t  t_ns;                     // CLOCK_MONOTONIC when the frame arrived
+    int32_t  channels[CYTON_CHANNELS]; // signed 24-bit counts
+    int16_t  accel[CYTON_AUX_AXES];    // aux bytes 26-31 (big endian), 0 between readings
+    uint8_t  raw[CYTON_FRAME_BYTES];   // packet as received
+    uint8_t  sample;                   // Cyton sample counter (byte 1)
+    uint8_t  batch;                    // frames completed by the same read()
+    uint8_t  _pad[7];
+} cyton_frame_t;
+
+typedef struct {
+    uint64_t frames;       // frames published
+    uint64_t bytes;        // bytes read
+    uint64_t reads;        // read() calls that returned data
+    uint64_t resync_bytes; // bytes discarded while looking for a frame
+    uint64_t max_batch;    // most frames completed by one read()
+    uint64_t dropped;      // per consumer: frames overwritten before read
+} cyton_reader_stats_t;
+
+typedef struct cyton_reader cyton_reader_t;
+
+// Set fd to raw mode with VMIN/VTIME for one frame. baud = 0 keeps the
+// current speed. The previous settings are restored by cyton_reader_stop.
+// capacity is rounded up to a power of two.
+cyton_reader_t *cyton_reader_create(int fd, int baud, int capacity);
+void cyton_reader_destroy(cyton_reader_t *r);
+
+// rt_priority > 0 asks for SCHED_FIFO (ignored if not permitted)
+int cyton_reader_start(cyton_reader_t *r, int rt_priority);
+int cyton_reader_stop(cyton_reader_t *r);
+
+// Register a consumer; it sees frames published from now on. Returns its id.
+int cyton_reader_add_consumer(cyton_reader_t *r);
+
+// Copy up to max_frames unread frames. Never blocks. Returns the count.
+int cyton_reader_read(cyton_reader_t *r, int consumer, cyton_frame_t *out, int max_frames);
+
+// Frames published but not yet read by this consumer
+int cyton_reader_pending(cyton_reader_t *r, int consumer);
+
+// Skip everything already published (start of a recording)
+int cyton_reader_skip(cyton_reader_t *r, int consumer);
+
+// Block until a frame is available or timeout_ms passes (< 0: forever).
+// Returns 1 if frames are pending, 0 on timeout.
+int cyton_reader_wait(cyton_reader_t *r, int consumer, int timeout_ms);
+
+// Copy every chunk read from the port, with its arrival time, to log
+// (NULL: stop). The reader thread may still be appending to the previous log
+// until its current read completes: stop the reader before closing a log.
+int cyton_reader_record(cyton_reader_t *r, cyton_log_t *log);
+
+// Reader totals; dropped is for the given consumer (-1: none)
+int cyton_reader_get_stats(cyton_reader_t *r, int consumer, cyton_reader_stats_t *out);
+
+// Latest error from the thread (errno value, 0 if none)
+int cyton_reader_error(const cyton_reader_t *r);
+
+int64_t cyton_monotonic_ns(void);
+
+// Decode every complete frame at the front of buf (at most max_frames),
+// stamping them with t_ns, and shift the remainder down. *len is updated;
+// bytes dropped while resyncing are added to *skipped (may be NULL).
+// Shared with q8_reactor, which does its own reads. Returns the count.
+int cyton_extract_frames(uint8_t *buf, int *len, cyton_frame_t *out, int max_frames,
+                         int64_t t_ns, uint64_t *skipped);
+
+#endif // CYTON_READER_H
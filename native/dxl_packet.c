@@ -0,0 +1,38 @@
+/*******************************************************************************
+* dxl_packet - Dynamixel Protocol 1.0 instruction packets
+*******************************************************************************/
+
+#include <string.h>
+
+#include "dxl_packet.h"
+
+int dxl_sync_write_packet(uint8_t *out, int cap, uint8_t addr, uint8_t data_len,
+                          const uint8_t *ids, const uint8_t *data, int n_ids)
+{
+    if (!out || !ids || !data || data_len < 1 || n_ids < 1)
+        return Q8_ERR_ARG;
+    int total = DXL_SYNC_WRITE_BYTES(data_len, n_ids);
+    if (total > cap || total > DXL_MAX_PACKET)
+        return Q8_ERR_ARG;
+
+    out[0] = 0xFF;
+    out[1] = 0xFF;
+    out[2] = DXL_BROADCAST_ID;
+    out[3] = (uint8_t)(total - 4);      // instruction + params + checksum
+    out[4] = DXL_INST_SYNC_WRITE;
+    out[5] = addr;
+    out[6] = data_len;
+
+    uint8_t *p = &out[7];
+    for (int i = 0; i < n_ids; ++i) {
+        *p++ = ids[i];
+        memcpy(p, &data[i * data_len], data_len);
+        p += data_len;
+    }
+
+    unsigned sum = 0;
+    for (int i = 2; i < total - 1; ++i)
+        sum += out[i];
+    out[total - 1] = (uint8_t)~sum;
+    return total;
+}
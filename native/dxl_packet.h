@@ -0,0 +1,29 @@
+/*******************************************************************************
+* dxl_packet - Dynamixel Protocol 1.0 instruction packets
+*
+* Only what the control loop sends every tick: SYNC_WRITE of the same
+* register range to several servos, e.g. goal position (address 30, 2 bytes)
+* on all 8 RX-24F joints in one 48-byte packet.
+*
+*   FF FF FE LEN 83 addr data_len [id d0 .. dn-1] x n_ids checksum
+*******************************************************************************/
+
+#ifndef DXL_PACKET_H
+#define DXL_PACKET_H
+
+#include "q8native.h"
+
+#define DXL_BROADCAST_ID     0xFE
+#define DXL_INST_SYNC_WRITE  0x83
+#define DXL_MAX_PACKET       256     // LEN is one byte
+
+// Bytes needed for a sync write of data_len bytes to n_ids servos
+#define DXL_SYNC_WRITE_BYTES(data_len, n_ids) (8 + (n_ids) * (1 + (data_len)))
+
+// Build a sync write into out. data holds n_ids * data_len bytes, servo by
+// servo, little endian as the control table expects.
+// Returns the packet length, or Q8_ERR_ARG if it does not fit in cap.
+int dxl_sync_write_packet(uint8_t *out, int cap, uint8_t addr, uint8_t data_len,
+                          const uint8_t *ids, const uint8_t *data, int n_ids);
+
+#endif // DXL_PACKET_H
@@ -0,0 +1,683 @@
+/*******************************************************************************
+* emg_analytics - class separability of a training corpus in one pass
+*******************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "emg_analytics.h"
+#include "emg_corpus.h"
+
+#define DEFAULT_CHUNK_BYTES (8 << 20)
+
+typedef struct {
+    char name[EMG_CORPUS_MAX_LABEL];
+    uint64_t n;
+    double *mean;           // [F]
+    double *m2;             // [F][F] co-moments (upper triangle until merged)
+} class_acc_t;
+
+typedef struct {
+    class_acc_t cls[EMG_ANALYTICS_MAX_CLASSES];
+    int n_classes;
+    uint64_t windows;
+    uint64_t skipped;
+    uint64_t malformed;
+    int64_t bytes;
+    int error;
+} acc_t;
+
+typedef struct {
+    int file;
+    int64_t begin;
+    int64_t end;
+} work_t;
+
+struct emg_analytics {
+    emg_analytics_config_t cfg;
+
+    char **paths;
+    char **labels;
+    int n_files;
+
+    work_t *items;
+    size_t n_items;
+    atomic_size_t next_item;
+
+    int n_channels;
+    int n_features;
+    int *channel_of;        // [F]
+
+    acc_t total;            // merged, classes sorted by name
+    double *fisher;         // [F]
+    double *channel_fisher; // [n_channels]
+    double *bhattacharyya;  // [K][K]
+    double *mahalanobis;    // [K][K]
+    emg_analytics_stats_t st;
+};
+
+typedef struct {
+    emg_analytics_t *a;
+    acc_t acc;
+    pthread_t tid;
+} worker_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------------------------------------------------------------------------
+* Per-class accumulators
+* ------------------------------------------------------------------------- */
+
+static void acc_free(acc_t *acc)
+{
+    for (int c = 0; c < acc->n_classes; ++c) {
+        free(acc->cls[c].mean);
+        free(acc->cls[c].m2);
+    }
+    memset(acc, 0, sizeof(*acc));
+}
+
+// Index of the class called name, added if new; -1 if the table is full or
+// out of memory
+static int acc_class(acc_t *acc, const char *name, int F)
+{
+    for (int c = 0; c < acc->n_classes; ++c)
+        if (strcmp(acc->cls[c].name, name) == 0)
+            return c;
+    if (acc->n_classes == EMG_ANALYTICS_MAX_CLASSES)
+        return -1;
+
+    class_acc_t *cl = &acc->cls[acc->n_classes];
+    cl->mean = calloc(F, sizeof(double));
+    cl->m2 = calloc((size_t)F * F, sizeof(double));
+    if (!cl->mean || !cl->m2) {
+        free(cl->mean);
+        free(cl->m2);
+        cl->mean = cl->m2 = NULL;
+        acc->error = Q8_ERR_NOMEM;
+        return -1;
+    }
+    memcpy(cl->name, name, sizeof(cl->name));
+    cl->n = 0;
+    return acc->n_classes++;
+}
+
+// Welford: M2 += (n-1)/n d d' with d = x - mean before the update
+static void acc_add(class_acc_t *cl, const double *x, int F, double *d)
+{
+    cl->n++;
+    const double inv = 1.0 / cl->n;
+    const double scale = (cl->n - 1) * inv;
+    for (int k = 0; k < F; ++k) {
+        d[k] = x[k] - cl->mean[k];
+        cl->mean[k] += d[k] * inv;
+    }
+    for (int j = 0; j < F; ++j) {
+        const double s = scale * d[j];
+        double *row = cl->m2 + (size_t)j * F;
+        for (int k = j; k < F; ++k)
+            row[k] += s * d[k];
+    }
+}
+
+// Chan et al.: the union of two sets of windows of the same class
+static void acc_merge(class_acc_t *into, const class_acc_t *from, int F, double *d)
+{
+    if (from->n == 0)
+        return;
+    const double na = (double)into->n, nb = (double)from->n, n = na + nb;
+    const double f = na * nb / n;
+    for (int k = 0; k < F; ++k)
+        d[k] = from->mean[k] - into->mean[k];
+    for (int j = 0; j < F; ++j) {
+        const double *src = from->m2 + (size_t)j * F;
+        double *row = into->m2 + (size_t)j * F;
+        for (int k = j; k < F; ++k)
+            row[k] += src[k] + f * d[j] * d[k];
+    }
+    for (int k = 0; k < F; ++k)
+        into->mean[k] += d[k] * nb / n;
+    into->n += from->n;
+}
+
+static int class_cmp(const void *x, const void *y)
+{
+    return strcmp(((const class_acc_t *)x)->name, ((const class_acc_t *)y)->name);
+}
+
+/* ---------------------------------------------------------------------------
+* Workers
+* ------------------------------------------------------------------------- */
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    emg_analytics_t *a = w->a;
+    const int F = a->n_features;
+    emg_featureset_t *fs = emg_featureset_create(a->cfg.feature_set, a->n_channels);
+    double *x = malloc(2 * (size_t)F * sizeof(double));
+    if (!fs || !x) {
+        w->acc.error = Q8_ERR_NOMEM;
+        goto done;
+    }
+
+    for (;;) {
+        const size_t i = atomic_fetch_add(&a->next_item, 1);
+        if (i >= a->n_items)
+            break;
+        const work_t *it = &a->items[i];
+        emg_corpus_t *r = emg_corpus_open(a->paths[it->file], it->begin, it->end, a->labels[it->file]);
+        if (!r) {
+            w->acc.error = Q8_ERR_IO;
+            continue;
+        }
+
+        emg_corpus_window_t win;
+        while (emg_corpus_next(r, &win) == 1) {
+            int c;
+            if (win.n_channels != a->n_channels
+                || emg_featureset_extract(fs, win.data, win.n_samples, win.aux, win.n_aux, x) != Q8_OK
+                || (c = acc_class(&w->acc, win.label, F)) < 0) {
+                w->acc.skipped++;
+                continue;
+            }
+            acc_add(&w->acc.cls[c], x, F, x + F);
+            w->acc.windows++;
+        }
+
+        emg_corpus_stats_t cs;
+        emg_corpus_get_stats(r, &cs);
+        w->acc.malformed += cs.malformed;
+        w->acc.bytes += cs.bytes;
+        emg_corpus_close(r);
+    }
+
+done:
+    free(x);
+    emg_featureset_destroy(fs);
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+* Linear algebra (small dense symmetric matrices)
+* ------------------------------------------------------------------------- */
+
+// S' = (1 - lambda) S + lambda tr(S)/n I
+static void shrink(double *S, int n, double lambda)
+{
+    double tr = 0.0;
+    for (int k = 0; k < n; ++k)
+        tr += S[k * n + k];
+    tr /= n;
+    for (int i = 0; i < n * n; ++i)
+        S[i] *= 1.0 - lambda;
+    for (int k = 0; k < n; ++k)
+        S[k * n + k] += lambda * tr;
+}
+
+// In-place lower Cholesky factor; -1 if S is not positive definite
+static int cholesky(double *S, int n)
+{
+    for (int j = 0; j < n; ++j) {
+        double *rj = S + (size_t)j * n;
+        double diag = rj[j];
+        for (int k = 0; k < j; ++k)
+            diag -= rj[k] * rj[k];
+        if (!(diag > 0.0) || !isfinite(diag))
+            return -1;
+        rj[j] = sqrt(diag);
+        for (int i = j + 1; i < n; ++i) {
+            double *ri = S + (size_t)i * n;
+            double v = ri[j];
+            for (int k = 0; k < j; ++k)
+                v -= ri[k] * rj[k];
+            ri[j] = v / rj[j];
+        }
+    }
+    return 0;
+}
+
+// d' S^-1 d = |L^-1 d|^2 (tmp: n doubles)
+static double quad_form(const double *L, int n, const double *d, double *tmp)
+{
+    double q = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const double *ri = L + (size_t)i * n;
+        double v = d[i];
+        for (int k = 0; k < i; ++k)
+            v -= ri[k] * tmp[k];
+        tmp[i] = v / ri[i];
+        q += tmp[i] * tmp[i];
+    }
+    return q;
+}
+
+static double log_det(const double *L, int n)
+{
+    double s = 0.0;
+    for (int k = 0; k < n; ++k)
+        s += log(L[(size_t)k * n + k]);
+    return 2.0 * s;
+}
+
+/* ---------------------------------------------------------------------------
+* Separability from the merged statistics
+* ------------------------------------------------------------------------- */
+
+static int compute(emg_analytics_t *a)
+{
+    const int F = a->n_features, K = a->total.n_classes, C = a->n_channels;
+    const class_acc_t *cls = a->total.cls;
+    const double lambda = a->cfg.shrinkage;
+    int rc = Q8_ERR_NOMEM;
+
+    double *mu = calloc(F, sizeof(double));
+    double *sd = calloc(F, sizeof(double));
+    double *d = calloc(F, sizeof(double));
+    double *tmp = calloc(F, sizeof(double));
+    double *sw = calloc((size_t)F * F, sizeof(double));
+    double *work = calloc((size_t)F * F, sizeof(double));
+    double *cov = calloc((size_t)K * F * F, sizeof(double));   // per class, standardized + shrunk
+    double *logdet = calloc(K, sizeof(double));
+    int *idx = calloc(F, sizeof(int));
+    if (!mu || !sd || !d || !tmp || !sw || !work || !cov || !logdet || !idx)
+        goto out;
+
+    // Grand mean and total spread per feature
+    uint64_t N = 0;
+    for (int c = 0; c < K; ++c)
+        N += cls[c].n;
+    for (int c = 0; c < K; ++c)
+        for (int k = 0; k < F; ++k)
+            mu[k] += cls[c].mean[k] * ((double)cls[c].n / N);
+
+    for (int k = 0; k < F; ++k) {
+        double between = 0.0, within = 0.0;
+        for (int c = 0; c < K; ++c) {
+            const double dk = cls[c].mean[k] - mu[k];
+            between += cls[c].n * dk * dk;
+            within += cls[c].m2[(size_t)k * F + k];
+        }
+        a->fisher[k] = within > 0.0 ? between / within : (between > 0.0 ? INFINITY : 0.0);
+        const double total_sd = sqrt((between + within) / N);
+        sd[k] = total_sd > 0.0 ? total_sd : 1.0;
+    }
+
+    // Pooled within-class covariance, standardized
+    const double dof = N > (uint64_t)K ? (double)(N - K) : (double)N;
+    for (int j = 0; j < F; ++j)
+        for (int k = 0; k < F; ++k) {
+            double s = 0.0;
+            for (int c = 0; c < K; ++c)
+                s += cls[c].m2[(size_t)j * F + k];
+            sw[(size_t)j * F + k] = s / dof / (sd[j] * sd[k]);
+        }
+
+    // Per channel: tr(Sw^-1 Sb) over its features
+    for (int ch = 0; ch < C; ++ch) {
+        int m = 0;
+        for (int k = 0; k < F; ++k)
+            if (a->channel_of[k] == ch)
+                idx[m++] = k;
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < m; ++j)
+                work[i * m + j] = sw[(size_t)idx[i] * F + idx[j]];
+        if (m > 0)
+            shrink(work, m, lambda);
+        if (m == 0 || cholesky(work, m) != 0) {
+            a->channel_fisher[ch] = NAN;
+            continue;
+        }
+        double J = 0.0;
+        for (int c = 0; c < K; ++c) {
+            for (int i = 0; i < m; ++i)
+                d[i] = (cls[c].mean[idx[i]] - mu[idx[i]]) / sd[idx[i]];
+            J += (double)cls[c].n / N * quad_form(work, m, d, tmp);
+        }
+        a->channel_fisher[ch] = J;
+    }
+
+    // Class covariances and their log-determinants
+    for (int c = 0; c < K; ++c) {
+        double *S = cov + (size_t)c * F * F;
+        const double n1 = cls[c].n > 1 ? (double)(cls[c].n - 1) : 1.0;
+        for (int j = 0; j < F; ++j)
+            for (int k = 0; k < F; ++k)
+                S[(size_t)j * F + k] = cls[c].m2[(size_t)j * F + k] / n1 / (sd[j] * sd[k]);
+        shrink(S, F, lambda);
+        memcpy(work, S, (size_t)F * F * sizeof(double));
+        logdet[c] = cls[c].n > 1 && cholesky(work, F) == 0 ? log_det(work, F) : NAN;
+    }
+
+    // Pairs
+    memcpy(work, sw, (size_t)F * F * sizeof(double));
+    shrink(work, F, lambda);
+    const int sw_ok = cholesky(work, F) == 0;
+    for (int i = 0; i < K; ++i) {
+        a->mahalanobis[i * K + i] = 0.0;
+        for (int j = i + 1; j < K; ++j) {
+            for (int k = 0; k < F; ++k)
+                d[k] = (cls[i].mean[k] - cls[j].mean[k]) / sd[k];
+            const double dm = sw_ok && cls[i].n > 1 && cls[j].n > 1 ? sqrt(quad_form(work, F, d, tmp)) : NAN;
+            a->mahalanobis[i * K + j] = a->mahalanobis[j * K + i] = dm;
+        }
+    }
+
+    for (int i = 0; i < K; ++i) {
+        a->bhattacharyya[i * K + i] = 0.0;
+        for (int j = i + 1; j < K; ++j) {
+            double db = NAN;
+            if (isfinite(logdet[i]) && isfinite(logdet[j])) {
+                const double *Si = cov + (size_t)i * F * F, *Sj = cov + (size_t)j * F * F;
+                for (size_t e = 0; e < (size_t)F * F; ++e)
+                    work[e] = 0.5 * (Si[e] + Sj[e]);
+                if (cholesky(work, F) == 0) {
+                    for (int k = 0; k < F; ++k)
+                        d[k] = (cls[i].mean[k] - cls[j].mean[k]) / sd[k];
+                    db = 0.125 * quad_form(work, F, d, tmp)
+                       + 0.5 * (log_det(work, F) - 0.5 * (logdet[i] + logdet[j]));
+                }
+            }
+            a->bhattacharyya[i * K + j] = a->bhattacharyya[j * K + i] = db;
+        }
+    }
+    rc = Q8_OK;
+
+out:
+    free(mu);
+    free(sd);
+    free(d);
+    free(tmp);
+    free(sw);
+    free(work);
+    free(cov);
+    free(logdet);
+    free(idx);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------
+* API
+* ------------------------------------------------------------------------- */
+
+emg_analytics_t *emg_analytics_create(const emg_analytics_config_t *cfg)
+{
+    if (!cfg || cfg->feature_set < 0 || cfg->feature_set >= EMG_FS_COUNT || cfg->n_threads < 0
+        || !(cfg->shrinkage >= 0.0 && cfg->shrinkage < 1.0) || cfg->chunk_bytes < 0)
+        return NULL;
+
+    emg_analytics_t *a = calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+    a->cfg = *cfg;
+    if (a->cfg.chunk_bytes == 0)
+        a->cfg.chunk_bytes = DEFAULT_CHUNK_BYTES;
+    return a;
+}
+
+static void free_results(emg_analytics_t *a)
+{
+    acc_free(&a->total);
+    free(a->items);
+    free(a->channel_of);
+    free(a->fisher);
+    free(a->channel_fisher);
+    free(a->bhattacharyya);
+    free(a->mahalanobis);
+    a->items = NULL;
+    a->n_items = 0;
+    a->channel_of = NULL;
+    a->fisher = a->channel_fisher = a->bhattacharyya = a->mahalanobis = NULL;
+}
+
+void emg_analytics_destroy(emg_analytics_t *a)
+{
+    if (!a)
+        return;
+    free_results(a);
+    for (int i = 0; i < a->n_files; ++i) {
+        free(a->paths[i]);
+        free(a->labels[i]);
+    }
+    free(a->paths);
+    free(a->labels);
+    free(a);
+}
+
+int emg_analytics_add_file(emg_analytics_t *a, const char *path, const char *label)
+{
+    if (!a || !path)
+        return Q8_ERR_ARG;
+
+    char **paths = realloc(a->paths, (a->n_files + 1) * sizeof(char *));
+    if (!paths)
+        return Q8_ERR_NOMEM;
+    a->paths = paths;
+    char **labels = realloc(a->labels, (a->n_files + 1) * sizeof(char *));
+    if (!labels)
+        return Q8_ERR_NOMEM;
+    a->labels = labels;
+
+    a->paths[a->n_files] = strdup(path);
+    a->labels[a->n_files] = label ? strdup(label) : NULL;
+    if (!a->paths[a->n_files] || (label && !a->labels[a->n_files])) {
+        free(a->paths[a->n_files]);
+        free(a->labels[a->n_files]);
+        return Q8_ERR_NOMEM;
+    }
+    a->n_files++;
+    return Q8_OK;
+}
+
+// Channel count of the corpus: that of its first readable window
+static int probe_channels(const emg_analytics_t *a)
+{
+    for (int i = 0; i < a->n_files; ++i) {
+        emg_corpus_t *r = emg_corpus_open(a->paths[i], 0, -1, a->labels[i]);
+        if (!r)
+            continue;
+        emg_corpus_window_t w;
+        const int n = emg_corpus_next(r, &w) == 1 ? w.n_channels : 0;
+        emg_corpus_close(r);
+        if (n > 0)
+            return n;
+    }
+    return 0;
+}
+
+int emg_analytics_run(emg_analytics_t *a)
+{
+    if (!a)
+        return Q8_ERR_ARG;
+    const double t0 = now_s();
+    free_results(a);
+    memset(&a->st, 0, sizeof(a->st));
+    a->st.n_files = a->n_files;
+
+    // Byte ranges of chunk_bytes over every file
+    size_t cap = 0;
+    for (int i = 0; i < a->n_files; ++i) {
+        const int64_t size = emg_corpus_file_size(a->paths[i]);
+        if (size < 0)
+            return Q8_ERR_IO;
+        for (int64_t begin = 0; begin < size; begin += a->cfg.chunk_bytes) {
+            if (a->n_items == cap) {
+                cap = cap ? 2 * cap : 64;
+                work_t *items = realloc(a->items, cap * sizeof(work_t));
+                if (!items)
+                    return Q8_ERR_NOMEM;
+                a->items = items;
+            }
+            const int64_t end = begin + a->cfg.chunk_bytes;
+            a->items[a->n_items++] = (work_t){ i, begin, end < size ? end : -1 };
+        }
+    }
+
+    a->n_channels = probe_channels(a);
+    if (a->n_channels < 1 || a->n_channels > Q8_MAX_CHANNELS)
+        return Q8_ERR_IO;
+    emg_featureset_t *fs = emg_featureset_create(a->cfg.feature_set, a->n_channels);
+    if (!fs)
+        return Q8_ERR_NOMEM;
+    a->n_features = emg_featureset_num_features(fs);
+    a->channel_of = malloc(a->n_features * sizeof(int));
+    if (a->channel_of)
+        for (int k = 0; k < a->n_features; ++k)
+            a->channel_of[k] = emg_featureset_channel_of(fs, k);
+    emg_featureset_destroy(fs);
+    if (!a->channel_of)
+        return Q8_ERR_NOMEM;
+
+    // Workers
+    int n_threads = a->cfg.n_threads;
+    if (n_threads == 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if ((size_t)n_threads > a->n_items)
+        n_threads = a->n_items > 0 ? (int)a->n_items : 1;
+
+    worker_t *workers = calloc(n_threads, sizeof(worker_t));
+    if (!workers)
+        return Q8_ERR_NOMEM;
+    atomic_store(&a->next_item, 0);
+    int started = 0;
+    while (started < n_threads) {
+        workers[started].a = a;
+        if (pthread_create(&workers[started].tid, NULL, worker_main, &workers[started]) != 0)
+            break;
+        started++;
+    }
+    if (started > 0) {
+        for (int t = 0; t < started; ++t)
+            pthread_join(workers[t].tid, NULL);
+    } else {
+        // No threads to be had: do the work here
+        workers[0].a = a;
+        worker_main(&workers[0]);
+        started = 1;
+    }
+
+    // Merge
+    const int F = a->n_features;
+    int rc = Q8_OK;
+    double *d = malloc(F * sizeof(double));
+    if (!d)
+        rc = Q8_ERR_NOMEM;
+    for (int t = 0; t < started; ++t) {
+        acc_t *acc = &workers[t].acc;
+        a->st.windows += acc->windows;
+        a->st.skipped += acc->skipped;
+        a->st.malformed += acc->malformed;
+        a->st.bytes += acc->bytes;
+        if (acc->error && rc == Q8_OK)
+            rc = acc->error;
+        for (int c = 0; c < acc->n_classes && rc == Q8_OK; ++c) {
+            const int into = acc_class(&a->total, acc->cls[c].name, F);
+            if (into < 0) {
+                // More classes over all threads than the table holds
+                a->st.windows -= acc->cls[c].n;
+                a->st.skipped += acc->cls[c].n;
+                rc = a->total.error;
+                continue;
+            }
+            acc_merge(&a->total.cls[into], &acc->cls[c], F, d);
+        }
+        acc_free(acc);
+    }
+    free(d);
+    free(workers);
+    if (rc != Q8_OK)
+        return rc;
+
+    const int K = a->total.n_classes;
+    a->st.n_threads = n_threads;
+    a->st.n_channels = a->n_channels;
+    a->st.n_features = F;
+    a->st.n_classes = K;
+    if (K == 0)
+        return Q8_ERR_IO;
+    qsort(a->total.cls, K, sizeof(class_acc_t), class_cmp);
+    for (int c = 0; c < K; ++c) {
+        double *m2 = a->total.cls[c].m2;
+        for (int j = 0; j < F; ++j)
+            for (int k = 0; k < j; ++k)
+                m2[(size_t)j * F + k] = m2[(size_t)k * F + j];
+    }
+
+    a->fisher = malloc(F * sizeof(double));
+    a->channel_fisher = malloc(a->n_channels * sizeof(double));
+    a->bhattacharyya = malloc((size_t)K * K * sizeof(double));
+    a->mahalanobis = malloc((size_t)K * K * sizeof(double));
+    if (!a->fisher || !a->channel_fisher || !a->bhattacharyya || !a->mahalanobis)
+        return Q8_ERR_NOMEM;
+    rc = compute(a);
+    a->st.seconds = now_s() - t0;
+    return rc;
+}
+
+const char *emg_analytics_class_name(const emg_analytics_t *a, int c)
+{
+    if (!a || c < 0 || c >= a->total.n_classes || !a->fisher)
+        return NULL;
+    return a->total.cls[c].name;
+}
+
+int emg_analytics_get_class(const emg_analytics_t *a, int c, uint64_t *count, double *mean, double *cov)
+{
+    if (!a || c < 0 || c >= a->total.n_classes || !a->fisher)
+        return Q8_ERR_ARG;
+    const class_acc_t *cl = &a->total.cls[c];
+    const int F = a->n_features;
+    if (count)
+        *count = cl->n;
+    if (mean)
+        memcpy(mean, cl->mean, F * sizeof(double));
+    if (cov) {
+        const double n1 = cl->n > 1 ? (double)(cl->n - 1) : 1.0;
+        for (size_t e = 0; e < (size_t)F * F; ++e)
+            cov[e] = cl->m2[e] / n1;
+    }
+    return Q8_OK;
+}
+
+int emg_analytics_fisher(const emg_analytics_t *a, double *fisher, double *channel_fisher)
+{
+    if (!a || !a->fisher)
+        return Q8_ERR_ARG;
+    if (fisher)
+        memcpy(fisher, a->fisher, a->n_features * sizeof(double));
+    if (channel_fisher)
+        memcpy(channel_fisher, a->channel_fisher, a->n_channels * sizeof(double));
+    return Q8_OK;
+}
+
+int emg_analytics_pairs(const emg_analytics_t *a, double *bhattacharyya, double *mahalanobis)
+{
+    if (!a || !a->fisher)
+        return Q8_ERR_ARG;
+    const size_t KK = (size_t)a->total.n_classes * a->total.n_classes;
+    if (bhattacharyya)
+        memcpy(bhattacharyya, a->bhattacharyya, KK * sizeof(double));
+    if (mahalanobis)
+        memcpy(mahalanobis, a->mahalanobis, KK * sizeof(double));
+    return Q8_OK;
+}
+
+int emg_analytics_get_stats(const emg_analytics_t *a, emg_analytics_stats_t *out)
+{
+    if (!a || !out)
+        return Q8_ERR_ARG;
+    *out = a->st;
+    return Q8_OK;
+}
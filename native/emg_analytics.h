@@ -0,0 +1,89 @@
+/*******************************************************************************
+* emg_analytics - class separability of a training corpus in one pass
+*
+* Streams every window of a set of training_data .jsonl files through an
+* emg_featureset and keeps, per gesture, the window count, feature mean and
+* co-moment matrix (Welford). Files are split into byte ranges of
+* chunk_bytes that n_threads workers pull from a shared counter; each worker
+* reads its ranges through emg_corpus (one line in memory at a time) into its
+* own class tables, merged at the end with Chan's formula. Memory is
+* O(threads * classes * features^2) however large the corpus is.
+*
+* From the merged statistics:
+*
+*     fisher[k]          sum_c n_c (mu_ck - mu_k)^2 / sum_c M2_c,kk - between-
+*                        over within-class spread of feature k (inf when the
+*                        classes do not vary inside but differ between)
+*     channel_fisher[ch] tr(Sw^-1 Sb) over the channel's features - Sw the
+*                        pooled within-class, Sb the between-class covariance
+*     bhattacharyya[i,j] 1/8 d' S^-1 d + 1/2 ln(det S / sqrt(det S_i det S_j)),
+*                        S = (S_i + S_j) / 2: Gaussian overlap of the two
+*                        classes, exp(-DB) bounds their Bayes error
+*     mahalanobis[i,j]   sqrt(d' Sw^-1 d), d = mu_i - mu_j
+*
+* Matrices are taken in units of each feature's total standard deviation
+* (raw VAR features reach 1e12) and shrunk toward a scaled identity,
+* S' = (1 - shrinkage) S + shrinkage tr(S)/n I, so a handful of windows or
+* a constant feature still gives a usable inverse. Pairs with a class of
+* fewer than 2 windows, or whose matrix is not positive definite, are NaN.
+*
+* Windows whose channel count differs from the first window's, with fewer
+* than 2 samples, or without aux for EMG_FS_FUSED are skipped.
+*******************************************************************************/
+
+#ifndef EMG_ANALYTICS_H
+#define EMG_ANALYTICS_H
+
+#include "q8native.h"
+#include "emg_featureset.h"
+
+#define EMG_ANALYTICS_MAX_CLASSES 64
+
+typedef struct {
+    int     feature_set;      // EMG_FS_*
+    int     n_threads;        // 0: one per online CPU
+    double  shrinkage;        // [0, 1)
+    int64_t chunk_bytes;      // work item size (0: 8 MB)
+} emg_analytics_config_t;
+
+typedef struct {
+    uint64_t windows;         // windows in the statistics
+    uint64_t skipped;         // windows left out (see above)
+    uint64_t malformed;       // lines emg_corpus could not parse
+    int64_t  bytes;           // corpus bytes read
+    int      n_files;
+    int      n_threads;       // workers the last run used
+    int      n_channels;
+    int      n_features;
+    int      n_classes;
+    double   seconds;         // wall time of the last run
+} emg_analytics_stats_t;
+
+typedef struct emg_analytics emg_analytics_t;
+
+emg_analytics_t *emg_analytics_create(const emg_analytics_config_t *cfg);
+void emg_analytics_destroy(emg_analytics_t *a);
+
+// label is the class of lines without a "gesture" (may be NULL)
+int emg_analytics_add_file(emg_analytics_t *a, const char *path, const char *label);
+
+// Stream all files and compute the statistics (again from scratch on a
+// second call). Q8_ERR_IO if a file cannot be read or no window was usable.
+int emg_analytics_run(emg_analytics_t *a);
+
+// Classes are sorted by name
+const char *emg_analytics_class_name(const emg_analytics_t *a, int c);
+
+// Window count, feature mean [n_features] and covariance [n_features]^2
+// (unbiased, raw units) of class c; mean / cov may be NULL
+int emg_analytics_get_class(const emg_analytics_t *a, int c, uint64_t *count, double *mean, double *cov);
+
+// fisher [n_features], channel_fisher [n_channels]; either may be NULL
+int emg_analytics_fisher(const emg_analytics_t *a, double *fisher, double *channel_fisher);
+
+// [n_classes]^2, symmetric with a zero diagonal; either may be NULL
+int emg_analytics_pairs(const emg_analytics_t *a, double *bhattacharyya, double *mahalanobis);
+
+int emg_analytics_get_stats(const emg_analytics_t *a, emg_analytics_stats_t *out);
+
+#endif // EMG_ANALYTICS_H
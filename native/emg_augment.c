@@ -0,0 +1,192 @@
+/*******************************************************************************
+* emg_augment - training windows generated lazily from whole recordings
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_augment.h"
+#include "emg_featureset.h"
+
+struct emg_augment {
+    emg_augment_config_t cfg;
+    emg_featureset_t *fs;
+    uint64_t rng;
+
+    // Recording in progress
+    const double *data;
+    const int16_t *aux;
+    int n_samples;
+    int position;               // next window start (before shift)
+    int variant;                // 0: plain, 1 .. copies: augmented
+
+    double *window;             // scratch for emg_augment_features
+    int16_t *window_aux;
+    emg_augment_stats_t st;
+};
+
+// splitmix64: a full-period 64-bit generator, enough for jitter draws
+static uint64_t next_u64(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double uniform(uint64_t *s)
+{
+    return (next_u64(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Standard normal (Box-Muller)
+static double normal(uint64_t *s)
+{
+    const double u = 1.0 - uniform(s);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform(s));
+}
+
+emg_augment_t *emg_augment_create(const emg_augment_config_t *cfg)
+{
+    if (!cfg || cfg->n_channels < 1 || cfg->n_channels > Q8_MAX_CHANNELS || cfg->window < 2
+        || cfg->stride < 1 || cfg->copies < 0 || cfg->shift < 0
+        || !(cfg->scale >= 0.0 && cfg->scale < 1.0) || !(cfg->gain_jitter >= 0.0))
+        return NULL;
+
+    emg_augment_t *a = calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+    a->cfg = *cfg;
+    a->rng = cfg->seed;
+    if (cfg->feature_set >= 0) {
+        a->fs = emg_featureset_create(cfg->feature_set, cfg->n_channels);
+        a->window = malloc((size_t)cfg->window * cfg->n_channels * sizeof(double));
+        a->window_aux = malloc((size_t)cfg->window * 3 * sizeof(int16_t));
+        if (!a->fs || !a->window || !a->window_aux) {
+            emg_augment_destroy(a);
+            return NULL;
+        }
+    }
+    return a;
+}
+
+void emg_augment_destroy(emg_augment_t *a)
+{
+    if (!a)
+        return;
+    emg_featureset_destroy(a->fs);
+    free(a->window);
+    free(a->window_aux);
+    free(a);
+}
+
+int emg_augment_count(const emg_augment_t *a, int n_samples)
+{
+    if (!a || n_samples < a->cfg.window)
+        return 0;
+    const int positions = (n_samples - a->cfg.window) / a->cfg.stride + 1;
+    return positions * (1 + a->cfg.copies);
+}
+
+int emg_augment_num_features(const emg_augment_t *a)
+{
+    return a && a->fs ? emg_featureset_num_features(a->fs) : Q8_ERR_ARG;
+}
+
+int emg_augment_begin(emg_augment_t *a, const double *data, int n_samples, const int16_t *aux)
+{
+    if (!a || !data || n_samples < 0)
+        return Q8_ERR_ARG;
+    a->data = data;
+    a->aux = aux;
+    a->n_samples = n_samples;
+    a->position = 0;
+    a->variant = 0;
+    a->st.recordings++;
+    return Q8_OK;
+}
+
+int emg_augment_next(emg_augment_t *a, double *out, int16_t *aux_out, emg_augment_info_t *info)
+{
+    if (!a || !out)
+        return Q8_ERR_ARG;
+    const emg_augment_config_t *c = &a->cfg;
+    const int nch = c->n_channels;
+    if (!a->data || a->position + c->window > a->n_samples)
+        return 0;
+
+    int start = a->position;
+    double gain[Q8_MAX_CHANNELS];
+    for (int ch = 0; ch < nch; ++ch)
+        gain[ch] = 1.0;
+
+    if (a->variant > 0) {
+        if (c->shift > 0) {
+            start += (int)(next_u64(&a->rng) % (uint64_t)(2 * c->shift + 1)) - c->shift;
+            if (start < 0)
+                start = 0;
+            if (start > a->n_samples - c->window)
+                start = a->n_samples - c->window;
+        }
+        const double amp = 1.0 + c->scale * (2.0 * uniform(&a->rng) - 1.0);
+        for (int ch = 0; ch < nch; ++ch) {
+            const double g = 1.0 + c->gain_jitter * normal(&a->rng);
+            gain[ch] = amp * (g > 0.0 ? g : 0.0);
+        }
+    }
+
+    const double *src = a->data + (size_t)start * nch;
+    if (a->variant == 0) {
+        memcpy(out, src, (size_t)c->window * nch * sizeof(double));
+    } else {
+        for (int i = 0; i < c->window; ++i)
+            for (int ch = 0; ch < nch; ++ch)
+                out[i * nch + ch] = src[i * nch + ch] * gain[ch];
+    }
+    if (aux_out && a->aux)
+        memcpy(aux_out, a->aux + (size_t)start * 3, (size_t)c->window * 3 * sizeof(int16_t));
+
+    if (info) {
+        info->start = start;
+        info->augmented = a->variant > 0;
+        memcpy(info->gain, gain, nch * sizeof(double));
+    }
+    a->st.windows++;
+    a->st.augmented += a->variant > 0;
+
+    if (++a->variant > c->copies) {
+        a->variant = 0;
+        a->position += c->stride;
+    }
+    return 1;
+}
+
+int emg_augment_features(emg_augment_t *a, double *out, int max_windows)
+{
+    if (!a || !a->fs || !out || max_windows < 0)
+        return Q8_ERR_ARG;
+    if (emg_featureset_needs_aux(a->fs) && !a->aux)
+        return Q8_ERR_ARG;
+
+    const int F = emg_featureset_num_features(a->fs);
+    int rows = 0;
+    while (rows < max_windows && emg_augment_next(a, a->window, a->window_aux, NULL) == 1) {
+        const int rc = emg_featureset_extract(a->fs, a->window, a->cfg.window,
+                                              a->aux ? a->window_aux : NULL, a->aux ? a->cfg.window : 0,
+                                              out + (size_t)rows * F);
+        if (rc != Q8_OK)
+            return rc;
+        rows++;
+    }
+    return rows;
+}
+
+int emg_augment_get_stats(const emg_augment_t *a, emg_augment_stats_t *out)
+{
+    if (!a || !out)
+        return Q8_ERR_ARG;
+    *out = a->st;
+    return Q8_OK;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************
+* emg_augment - training windows generated lazily from whole recordings
+*
+* A recording (everything captured while a gesture was held) is cut into
+* windows of `window` samples starting every `stride` samples. Each of these
+* positions gives the plain window and `copies` augmented variants, each
+* with its own draw of
+*
+*     time shift      start moved by up to +-shift samples (kept inside the
+*                     recording)
+*     amplitude       every channel scaled by one factor, uniform in
+*                     [1 - scale, 1 + scale]
+*     channel gain    each channel scaled again by 1 + N(0, gain_jitter^2)
+*                     (clamped at 0): electrode contact and placement
+*
+* Windows are produced one at a time into the caller's buffer and never
+* stored, and emg_augment_features() runs each straight through an
+* emg_featureset, so a training set can be many times the recordings without
+* being materialized. Gains multiply the counts as recorded: filter the
+* recording first (the filters are linear, so the order does not matter for
+* the gains). The accelerometer (aux) rows of a window are cut at the same
+* offsets and not augmented. The draws come from a seeded generator: the
+* same seed and recordings give the same windows.
+*******************************************************************************/
+
+#ifndef EMG_AUGMENT_H
+#define EMG_AUGMENT_H
+
+#include "q8native.h"
+
+typedef struct {
+    int      n_channels;
+    int      window;            // samples per window
+    int      stride;            // samples between window starts (>= 1)
+    int      copies;            // augmented variants per position (>= 0)
+    int      shift;             // max |time shift| (samples)
+    double   scale;             // amplitude range, [0, 1)
+    double   gain_jitter;       // channel gain standard deviation
+    int      feature_set;       // EMG_FS_* for emg_augment_features, -1: none
+    uint64_t seed;
+} emg_augment_config_t;
+
+typedef struct {
+    int    start;               // first sample of the window in the recording
+    int    augmented;           // 0 for the plain window
+    double gain[Q8_MAX_CHANNELS];
+} emg_augment_info_t;
+
+typedef struct {
+    uint64_t recordings;
+    uint64_t windows;           // produced since create
+    uint64_t augmented;         // of which augmented
+} emg_augment_stats_t;
+
+typedef struct emg_augment emg_augment_t;
+
+emg_augment_t *emg_augment_create(const emg_augment_config_t *cfg);
+void emg_augment_destroy(emg_augment_t *a);
+
+// Windows a recording of n_samples gives (0 if shorter than a window)
+int emg_augment_count(const emg_augment_t *a, int n_samples);
+
+// Feature vector length of cfg.feature_set (Q8_ERR_ARG without one)
+int emg_augment_num_features(const emg_augment_t *a);
+
+// Start on a recording: data [n_samples][n_channels], aux [n_samples][3] or
+// NULL (one row per sample, as collect_data_auto.py saves them). Both must
+// stay valid while its windows are taken.
+int emg_augment_begin(emg_augment_t *a, const double *data, int n_samples, const int16_t *aux);
+
+// Next window of the recording into out [window][n_channels] (and aux_out
+// [window][3] if not NULL and the recording has aux). Returns 1, or 0 when
+// the recording is exhausted. info may be NULL.
+int emg_augment_next(emg_augment_t *a, double *out, int16_t *aux_out, emg_augment_info_t *info);
+
+// All remaining windows of the recording through the feature set: up to
+// max_windows rows of out [max_windows][n_features]. Returns the rows
+// written.
+int emg_augment_features(emg_augment_t *a, double *out, int max_windows);
+
+int emg_augment_get_stats(const emg_augment_t *a, emg_augment_stats_t *out);
+
+#endif // EMG_AUGMENT_H
@@ -0,0 +1,227 @@
+/*******************************************************************************
+* emg_corpus - streaming reader for training_data windows (.jsonl)
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "emg_corpus.h"
+
+struct emg_corpus {
+    FILE *f;
+    int64_t pos;               // offset of the next line
+    int64_t end;               // < 0: to EOF
+    char default_label[EMG_CORPUS_MAX_LABEL];
+
+    char *line;
+    size_t line_cap;
+    double *data;
+    size_t data_cap;           // doubles
+    int16_t *aux;
+    size_t aux_cap;            // int16 values
+    double *aux_rows;          // aux as parsed, before the int16 conversion
+    size_t aux_rows_cap;
+    emg_corpus_stats_t st;
+};
+
+emg_corpus_t *emg_corpus_open(const char *path, int64_t begin, int64_t end, const char *label)
+{
+    if (!path || begin < 0 || (end >= 0 && end < begin))
+        return NULL;
+
+    emg_corpus_t *r = calloc(1, sizeof(*r));
+    if (!r)
+        return NULL;
+    r->f = fopen(path, "r");
+    if (!r->f) {
+        free(r);
+        return NULL;
+    }
+    r->end = end;
+    if (label)
+        snprintf(r->default_label, sizeof(r->default_label), "%s", label);
+
+    // Starting mid-file: the line that straddles begin belongs to the
+    // previous range (reading from begin - 1 skips it, or only the newline
+    // before begin)
+    if (begin > 0) {
+        if (fseeko(r->f, begin - 1, SEEK_SET) != 0) {
+            emg_corpus_close(r);
+            return NULL;
+        }
+        ssize_t n = getline(&r->line, &r->line_cap, r->f);
+        r->pos = begin - 1 + (n > 0 ? n : 0);
+    }
+    return r;
+}
+
+void emg_corpus_close(emg_corpus_t *r)
+{
+    if (!r)
+        return;
+    if (r->f)
+        fclose(r->f);
+    free(r->line);
+    free(r->data);
+    free(r->aux);
+    free(r->aux_rows);
+    free(r);
+}
+
+static const char *skip_space(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    return p;
+}
+
+// Value of "key": after the colon, or NULL
+static const char *find_key(const char *line, const char *key)
+{
+    const char *p = strstr(line, key);
+    if (!p)
+        return NULL;
+    p = skip_space(p + strlen(key));
+    return *p == ':' ? skip_space(p + 1) : NULL;
+}
+
+static int reserve(void **buf, size_t *cap, size_t need, size_t elem)
+{
+    if (need <= *cap)
+        return 0;
+    size_t cap2 = *cap ? *cap : 1024;
+    while (cap2 < need)
+        cap2 *= 2;
+    void *p = realloc(*buf, cap2 * elem);
+    if (!p)
+        return -1;
+    *buf = p;
+    *cap = cap2;
+    return 0;
+}
+
+// [[a, b, ...], [c, d, ...], ...] into out (grown as needed). All rows must
+// have the same width. Returns rows, or -1 if malformed.
+static int parse_rows(const char *p, double **out, size_t *cap, int *width)
+{
+    if (*p != '[')
+        return -1;
+    p = skip_space(p + 1);
+    int rows = 0, w = -1;
+    size_t n = 0;
+    while (*p == '[') {
+        p = skip_space(p + 1);
+        int cols = 0;
+        while (*p != ']') {
+            char *endp;
+            double v = strtod(p, &endp);
+            if (endp == p)
+                return -1;
+            if (reserve((void **)out, cap, n + 1, sizeof(double)) != 0)
+                return -1;
+            (*out)[n++] = v;
+            cols++;
+            p = skip_space(endp);
+            if (*p == ',')
+                p = skip_space(p + 1);
+            else if (*p != ']')
+                return -1;
+        }
+        if (w < 0)
+            w = cols;
+        else if (cols != w)
+            return -1;
+        rows++;
+        p = skip_space(p + 1);
+        if (*p == ',')
+            p = skip_space(p + 1);
+        else if (*p != ']')
+            return -1;
+    }
+    if (*p != ']' || w < 1)
+        return -1;
+    *width = w;
+    return rows;
+}
+
+static int parse_line(emg_corpus_t *r, const char *line, emg_corpus_window_t *w)
+{
+    const char *p = find_key(line, "\"data\"");
+    int width;
+    int rows = p ? parse_rows(p, &r->data, &r->data_cap, &width) : -1;
+    if (rows < 1)
+        return 0;
+    w->data = r->data;
+    w->n_samples = rows;
+    w->n_channels = width;
+
+    w->aux = NULL;
+    w->n_aux = 0;
+    p = find_key(line, "\"aux\"");
+    if (p) {
+        int aux_rows = parse_rows(p, &r->aux_rows, &r->aux_rows_cap, &width);
+        if (aux_rows < 1 || width != 3
+            || reserve((void **)&r->aux, &r->aux_cap, 3 * (size_t)aux_rows, sizeof(int16_t)) != 0)
+            return 0;
+        for (int i = 0; i < 3 * aux_rows; ++i)
+            r->aux[i] = (int16_t)r->aux_rows[i];
+        w->aux = r->aux;
+        w->n_aux = aux_rows;
+    }
+
+    p = find_key(line, "\"gesture\"");
+    if (p && *p == '"') {
+        const char *q = strchr(p + 1, '"');
+        if (!q || q - p - 1 >= EMG_CORPUS_MAX_LABEL)
+            return 0;
+        memcpy(w->label, p + 1, q - p - 1);
+        w->label[q - p - 1] = '\0';
+    } else {
+        memcpy(w->label, r->default_label, sizeof(w->label));
+    }
+    return 1;
+}
+
+int emg_corpus_next(emg_corpus_t *r, emg_corpus_window_t *w)
+{
+    if (!r || !w)
+        return Q8_ERR_ARG;
+
+    while (r->end < 0 || r->pos < r->end) {
+        ssize_t n = getline(&r->line, &r->line_cap, r->f);
+        if (n <= 0)
+            return 0;
+        const int64_t offset = r->pos;
+        r->pos += n;
+        r->st.lines++;
+        r->st.bytes += n;
+        if (skip_space(r->line)[0] == '\0')
+            continue;
+        if (!parse_line(r, r->line, w)) {
+            r->st.malformed++;
+            continue;
+        }
+        w->offset = offset;
+        r->st.windows++;
+        return 1;
+    }
+    return 0;
+}
+
+int emg_corpus_get_stats(const emg_corpus_t *r, emg_corpus_stats_t *out)
+{
+    if (!r || !out)
+        return Q8_ERR_ARG;
+    *out = r->st;
+    return Q8_OK;
+}
+
+int64_t emg_corpus_file_size(const char *path)
+{
+    struct stat sb;
+    if (!path || stat(path, &sb) != 0)
+        return Q8_ERR_IO;
+    return (int64_t)sb.st_size;
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+* emg_corpus - streaming reader for training_data windows (.jsonl)
+*
+* collect_data.py / collect_data_auto.py write one JSON object per line:
+*
+*     {"timestamp": ..., "gesture": "fist", "data": [[ch1, ch2, ...], ...],
+*      "aux": [[x, y, z], ...]}          (aux only in newer sessions)
+*
+* The reader holds one line at a time, so a corpus of any size streams in
+* constant memory. It only understands this layout: the "gesture" string
+* and the "data" / "aux" arrays of numbers are found by key, everything
+* else on the line is ignored. Malformed lines and rows of the wrong width
+* are counted and skipped.
+*
+* A reader can cover a byte range of its file, so several threads can split
+* one large file: a line belongs to the range its first byte falls in, and
+* ranges that tile the file visit every line exactly once.
+*******************************************************************************/
+
+#ifndef EMG_CORPUS_H
+#define EMG_CORPUS_H
+
+#include "q8native.h"
+
+#define EMG_CORPUS_MAX_LABEL 64
+
+typedef struct {
+    char label[EMG_CORPUS_MAX_LABEL]; // "gesture", or the reader's default label
+    const double  *data;              // [n_samples][n_channels]
+    int            n_samples;
+    int            n_channels;
+    const int16_t *aux;               // [n_aux][3], NULL if the line has none
+    int            n_aux;
+    int64_t        offset;            // byte offset of the line in the file
+} emg_corpus_window_t;
+
+typedef struct {
+    uint64_t lines;
+    uint64_t windows;
+    uint64_t malformed;
+    int64_t  bytes;                   // bytes of the lines read
+} emg_corpus_stats_t;
+
+typedef struct emg_corpus emg_corpus_t;
+
+// Lines starting in [begin, end) of path (end < 0: to the end of the file).
+// label is used for lines without a "gesture" (may be NULL).
+emg_corpus_t *emg_corpus_open(const char *path, int64_t begin, int64_t end, const char *label);
+void emg_corpus_close(emg_corpus_t *r);
+
+// Next window: 1, or 0 at the end of the range. The window's arrays stay
+// valid until the next call.
+int emg_corpus_next(emg_corpus_t *r, emg_corpus_window_t *w);
+
+int emg_corpus_get_stats(const emg_corpus_t *r, emg_corpus_stats_t *out);
+
+// Size of a file in bytes (Q8_ERR_IO if it cannot be read)
+int64_t emg_corpus_file_size(const char *path);
+
+#endif // EMG_CORPUS_H
@@ -0,0 +1,235 @@
+/*******************************************************************************
+* emg_decision - gesture post-processing between classifier and robot
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_decision.h"
+
+// Vote slot used for EMG_DEC_NONE
+#define NONE_SLOT(d) ((d)->n_classes)
+
+struct emg_decision {
+    emg_decision_config_t cfg;
+    int n_classes;
+
+    // Majority vote: ring of slots and per-slot counts
+    int votes[EMG_DEC_MAX_WINDOW];
+    int counts[EMG_DEC_MAX_CLASSES + 1];
+    int vote_pos;
+    int vote_n;
+
+    // Probability averaging: ring of vectors and their running sum
+    double *probs;           // [prob_window][n_classes]
+    double sum[EMG_DEC_MAX_CLASSES];
+    double avg[EMG_DEC_MAX_CLASSES];
+    int prob_pos;
+    int prob_n;
+    int prob_updates;        // since the sum was last rebuilt
+
+    int active;              // label after hysteresis / cooldown
+    int output;              // label returned by the last update
+    int have_probs;          // the last update came with probabilities
+    double confidence;
+    double last_onset_ms;    // last switch to a gesture
+    int have_onset;
+    int hold_label;
+    double hold_until_ms;
+};
+
+emg_decision_t *emg_decision_create(int n_classes, const emg_decision_config_t *cfg)
+{
+    if (!cfg || n_classes < 1 || n_classes > EMG_DEC_MAX_CLASSES)
+        return NULL;
+    if (cfg->vote_window < 1 || cfg->vote_window > EMG_DEC_MAX_WINDOW)
+        return NULL;
+    if (cfg->prob_window < 1 || cfg->prob_window > EMG_DEC_MAX_WINDOW)
+        return NULL;
+    if (cfg->exit_threshold > cfg->enter_threshold || cfg->hold_ms < 0.0 || cfg->cooldown_ms < 0.0)
+        return NULL;
+    if (cfg->stop_label < EMG_DEC_NONE || cfg->stop_label >= n_classes)
+        return NULL;
+
+    emg_decision_t *d = calloc(1, sizeof(*d));
+    if (!d)
+        return NULL;
+    d->cfg = *cfg;
+    d->n_classes = n_classes;
+    d->probs = calloc((size_t)cfg->prob_window * n_classes, sizeof(double));
+    if (!d->probs) {
+        free(d);
+        return NULL;
+    }
+    emg_decision_reset(d);
+    return d;
+}
+
+void emg_decision_destroy(emg_decision_t *d)
+{
+    if (!d)
+        return;
+    free(d->probs);
+    free(d);
+}
+
+void emg_decision_reset(emg_decision_t *d)
+{
+    if (!d)
+        return;
+    memset(d->votes, 0, sizeof(d->votes));
+    memset(d->counts, 0, sizeof(d->counts));
+    memset(d->sum, 0, sizeof(d->sum));
+    memset(d->avg, 0, sizeof(d->avg));
+    memset(d->probs, 0, (size_t)d->cfg.prob_window * d->n_classes * sizeof(double));
+    d->vote_pos = d->vote_n = 0;
+    d->prob_pos = d->prob_n = d->prob_updates = 0;
+    d->active = d->output = d->hold_label = EMG_DEC_NONE;
+    d->have_probs = 0;
+    d->confidence = 0.0;
+    d->last_onset_ms = d->hold_until_ms = 0.0;
+    d->have_onset = 0;
+}
+
+double emg_decision_confidence(const emg_decision_t *d)
+{
+    return d ? d->confidence : 0.0;
+}
+
+// Running mean of the last prob_window vectors. The sum is rebuilt from the
+// ring every few thousand updates so add/subtract rounding cannot build up.
+static void average_probs(emg_decision_t *d, const double *p)
+{
+    const int k = d->n_classes;
+    double *slot = &d->probs[(size_t)d->prob_pos * k];
+
+    if (d->prob_n == d->cfg.prob_window) {
+        for (int c = 0; c < k; ++c)
+            d->sum[c] -= slot[c];
+    } else {
+        d->prob_n++;
+    }
+    for (int c = 0; c < k; ++c) {
+        slot[c] = p[c];
+        d->sum[c] += p[c];
+    }
+    d->prob_pos = (d->prob_pos + 1) % d->cfg.prob_window;
+
+    if (++d->prob_updates >= 4096) {
+        memset(d->sum, 0, sizeof(d->sum));
+        for (int i = 0; i < d->prob_n; ++i)
+            for (int c = 0; c < k; ++c)
+                d->sum[c] += d->probs[(size_t)i * k + c];
+        d->prob_updates = 0;
+    }
+
+    double inv = 1.0 / d->prob_n;
+    for (int c = 0; c < k; ++c)
+        d->avg[c] = d->sum[c] * inv;
+}
+
+static int vote(emg_decision_t *d, int label)
+{
+    int slot = (label == EMG_DEC_NONE) ? NONE_SLOT(d) : label;
+
+    if (d->vote_n == d->cfg.vote_window)
+        d->counts[d->votes[d->vote_pos]]--;
+    else
+        d->vote_n++;
+    d->votes[d->vote_pos] = slot;
+    d->counts[slot]++;
+    d->vote_pos = (d->vote_pos + 1) % d->cfg.vote_window;
+
+    // Ties go to the current output, then to the newest label
+    int cur = (d->output == EMG_DEC_NONE) ? NONE_SLOT(d) : d->output;
+    int best = cur;
+    for (int s = 0; s <= NONE_SLOT(d); ++s) {
+        if (d->counts[s] > d->counts[best] || (d->counts[s] == d->counts[best] && s == slot && best != cur))
+            best = s;
+    }
+    return best == NONE_SLOT(d) ? EMG_DEC_NONE : best;
+}
+
+static double label_confidence(const emg_decision_t *d, int label, int have_probs)
+{
+    if (label == EMG_DEC_NONE)
+        return 0.0;
+    if (have_probs)
+        return d->avg[label];
+    return (double)d->counts[label] / d->vote_n;
+}
+
+int emg_decision_update(emg_decision_t *d, int label, const double *probs, double t_ms)
+{
+    if (!d)
+        return EMG_DEC_NONE;
+    if (label < EMG_DEC_NONE || label >= d->n_classes)
+        label = EMG_DEC_NONE;
+
+    // 1. Probability averaging
+    if (probs) {
+        average_probs(d, probs);
+        if (label != EMG_DEC_NONE) {
+            label = 0;
+            for (int c = 1; c < d->n_classes; ++c)
+                if (d->avg[c] > d->avg[label])
+                    label = c;
+        }
+    }
+
+    // 2. Majority vote
+    int candidate = vote(d, label);
+    double cand_conf = label_confidence(d, candidate, probs != NULL);
+
+    // 3. Hysteresis
+    int next = d->active;
+    if (candidate == d->active) {
+        if (candidate != EMG_DEC_NONE && cand_conf < d->cfg.exit_threshold)
+            next = EMG_DEC_NONE;
+    } else if (candidate == EMG_DEC_NONE || cand_conf >= d->cfg.enter_threshold) {
+        next = candidate;
+    } else if (d->active != EMG_DEC_NONE &&
+               label_confidence(d, d->active, probs != NULL) < d->cfg.exit_threshold) {
+        next = EMG_DEC_NONE;
+    }
+
+    // 4. Cooldown on gesture onsets (stop is exempt)
+    const int stop = d->cfg.stop_label;
+    if (next != d->active && next != EMG_DEC_NONE && next != stop && d->have_onset &&
+        t_ms - d->last_onset_ms < d->cfg.cooldown_ms)
+        next = d->active;
+
+    if (next != d->active && next != EMG_DEC_NONE) {
+        d->last_onset_ms = t_ms;
+        d->have_onset = 1;
+        if (next != stop) {
+            d->hold_label = next;
+            d->hold_until_ms = t_ms + d->cfg.hold_ms;
+        }
+    }
+    d->active = next;
+
+    // 5. Hold (a stop cancels it)
+    int out = next;
+    if (next == stop && stop != EMG_DEC_NONE)
+        d->hold_label = EMG_DEC_NONE;
+    else if (d->hold_label != EMG_DEC_NONE && t_ms < d->hold_until_ms)
+        out = d->hold_label;
+
+    d->output = out;
+    d->have_probs = probs != NULL;
+    d->confidence = label_confidence(d, out, d->have_probs);
+    return out;
+}
+
+int emg_decision_tick(emg_decision_t *d, double t_ms)
+{
+    if (!d)
+        return EMG_DEC_NONE;
+    if (d->output != d->active && d->output == d->hold_label && t_ms >= d->hold_until_ms) {
+        d->output = d->active;
+        d->confidence = label_confidence(d, d->active, d->have_probs);
+    }
+    return d->output;
+}
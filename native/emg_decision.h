@@ -0,0 +1,65 @@
+/*******************************************************************************
+* emg_decision - gesture post-processing between classifier and robot
+*
+* Each classifier decision (label, optional class probabilities, timestamp)
+* goes through, in order:
+*
+*   1. probability averaging  running mean over the last prob_window
+*                             probability vectors; its argmax replaces the
+*                             raw label
+*   2. majority voting        most frequent label over the last vote_window
+*                             decisions (ties keep the current output)
+*   3. hysteresis             switching to a new label needs confidence >=
+*                             enter_threshold; the current label is kept
+*                             while its confidence stays >= exit_threshold
+*   4. cooldown               a new non-stop gesture may start at most once
+*                             per cooldown_ms
+*   5. hold                   a new non-stop gesture is output for at least
+*                             hold_ms
+*
+* The stop label skips cooldown and hold, so stopping is never delayed by
+* them. Confidence is the averaged probability of the label when
+* probabilities are given, otherwise its vote share.
+*
+* Every update costs O(n_classes), independent of the window lengths.
+*******************************************************************************/
+
+#ifndef EMG_DECISION_H
+#define EMG_DECISION_H
+
+#include "q8native.h"
+
+#define EMG_DEC_MAX_CLASSES  32
+#define EMG_DEC_MAX_WINDOW   256
+#define EMG_DEC_NONE         -1     // no gesture
+
+typedef struct {
+    int    vote_window;       // 1 disables voting
+    int    prob_window;       // 1 disables averaging
+    double enter_threshold;   // 0 disables hysteresis
+    double exit_threshold;
+    double hold_ms;
+    double cooldown_ms;
+    int    stop_label;        // EMG_DEC_NONE if there is none
+} emg_decision_config_t;
+
+typedef struct emg_decision emg_decision_t;
+
+emg_decision_t *emg_decision_create(int n_classes, const emg_decision_config_t *cfg);
+void emg_decision_destroy(emg_decision_t *d);
+void emg_decision_reset(emg_decision_t *d);
+
+// label: classifier output in [0, n_classes) or EMG_DEC_NONE
+// probs: n_classes probabilities, or NULL
+// t_ms:  decision timestamp in ms (any monotonic origin)
+// Returns the label to act on, or EMG_DEC_NONE.
+int emg_decision_update(emg_decision_t *d, int label, const double *probs, double t_ms);
+
+// The label to act on at t_ms without a new decision: the last output, or
+// the current label once a hold has run out. Adds no vote or probabilities.
+int emg_decision_tick(emg_decision_t *d, double t_ms);
+
+// Confidence of the last returned label (0 for EMG_DEC_NONE)
+double emg_decision_confidence(const emg_decision_t *d);
+
+#endif // EMG_DECISION_H
@@ -0,0 +1,213 @@
+/*******************************************************************************
+* emg_envelope - multichannel amplitude envelope (RMS, MAV, linear envelope)
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_envelope.h"
+
+#define N_VEC (Q8_MAX_CHANNELS / Q8_LANES)
+
+#define INPUT_NONE  0
+#define INPUT_F64   1
+#define INPUT_I32   2
+
+struct emg_envelope {
+    // Float path: Kahan sum and compensation per channel
+    q8_vec_t sum[N_VEC];
+    q8_vec_t comp[N_VEC];
+    // Linear envelope state
+    q8_vec_t lp[N_VEC];
+    // Integer path: exact sums of x^2 or |x|
+    int64_t isum[Q8_MAX_CHANNELS];
+
+    double  *ring;       // [window][n_pad] rectified/squared history (float path)
+    int64_t *iring;      // [window][n_channels] (integer path)
+    int pos;             // next ring slot
+    int count;           // samples in the window so far (<= window)
+
+    int n_channels;
+    int n_vec;
+    int n_pad;
+    int window;
+    int mode;
+    int input;           // INPUT_*
+    double alpha;        // linear envelope smoothing factor
+};
+
+emg_envelope_t *emg_envelope_create(int n_channels, double fs, double window_ms, int mode)
+{
+    if (n_channels < 1 || n_channels > Q8_MAX_CHANNELS || fs <= 0.0 || window_ms <= 0.0)
+        return NULL;
+    if (mode != EMG_ENV_RMS && mode != EMG_ENV_MAV && mode != EMG_ENV_LINEAR)
+        return NULL;
+
+    emg_envelope_t *e = NULL;
+    if (posix_memalign((void **)&e, sizeof(q8_vec_t), sizeof(*e)) != 0)
+        return NULL;
+    memset(e, 0, sizeof(*e));
+
+    e->n_channels = n_channels;
+    e->n_pad = Q8_PAD_CHANNELS(n_channels);
+    e->n_vec = e->n_pad / Q8_LANES;
+    e->mode = mode;
+    e->window = (int)(fs * window_ms / 1000.0 + 1e-9);
+    if (e->window < 1)
+        e->window = 1;
+    e->alpha = 1.0 - exp(-1000.0 / (fs * window_ms));
+
+    if (mode != EMG_ENV_LINEAR) {
+        e->ring = calloc((size_t)e->window * e->n_pad, sizeof(double));
+        e->iring = calloc((size_t)e->window * n_channels, sizeof(int64_t));
+        if (!e->ring || !e->iring) {
+            emg_envelope_destroy(e);
+            return NULL;
+        }
+    }
+    return e;
+}
+
+void emg_envelope_destroy(emg_envelope_t *e)
+{
+    if (!e)
+        return;
+    free(e->ring);
+    free(e->iring);
+    free(e);
+}
+
+void emg_envelope_reset(emg_envelope_t *e)
+{
+    if (!e)
+        return;
+    memset(e->sum, 0, sizeof(e->sum));
+    memset(e->comp, 0, sizeof(e->comp));
+    memset(e->lp, 0, sizeof(e->lp));
+    memset(e->isum, 0, sizeof(e->isum));
+    if (e->ring)
+        memset(e->ring, 0, (size_t)e->window * e->n_pad * sizeof(double));
+    if (e->iring)
+        memset(e->iring, 0, (size_t)e->window * e->n_channels * sizeof(int64_t));
+    e->pos = 0;
+    e->count = 0;
+    e->input = INPUT_NONE;
+}
+
+int emg_envelope_window(const emg_envelope_t *e)
+{
+    return e ? e->window : 0;
+}
+
+static void select_input(emg_envelope_t *e, int input)
+{
+    if (e->input != input) {
+        emg_envelope_reset(e);
+        e->input = input;
+    }
+}
+
+// Kahan update of one vector of running sums: sum += v
+static inline void kahan_add(q8_vec_t *sum, q8_vec_t *comp, q8_vec_t v)
+{
+    q8_vec_t y = v - *comp;
+    q8_vec_t t = *sum + y;
+    *comp = (t - *sum) - y;
+    *sum = t;
+}
+
+static inline q8_vec_t rectify(q8_vec_t x, int mode)
+{
+    if (mode == EMG_ENV_RMS)
+        return x * x;
+    return q8_vabs(x);
+}
+
+void emg_envelope_process(emg_envelope_t *e, const double *in, double *out, int n_samples)
+{
+    if (!e || !in || !out)
+        return;
+    select_input(e, INPUT_F64);
+
+    const int nch = e->n_channels;
+    q8_vec_t x[N_VEC];
+    memset(x, 0, sizeof(x));
+
+    for (int n = 0; n < n_samples; ++n) {
+        memcpy(x, &in[n * nch], nch * sizeof(double));
+        double *row = &out[n * nch];
+
+        if (e->mode == EMG_ENV_LINEAR) {
+            for (int k = 0; k < e->n_vec; ++k) {
+                q8_vec_t r = rectify(x[k], EMG_ENV_MAV);
+                e->lp[k] += e->alpha * (r - e->lp[k]);
+            }
+            memcpy(row, e->lp, nch * sizeof(double));
+            continue;
+        }
+
+        q8_vec_t *slot = (q8_vec_t *)&e->ring[(size_t)e->pos * e->n_pad];
+        int full = (e->count == e->window);
+        for (int k = 0; k < e->n_vec; ++k) {
+            q8_vec_t r = rectify(x[k], e->mode);
+            if (full)
+                kahan_add(&e->sum[k], &e->comp[k], -slot[k]);
+            kahan_add(&e->sum[k], &e->comp[k], r);
+            slot[k] = r;
+        }
+        if (!full)
+            e->count++;
+        e->pos = (e->pos + 1) % e->window;
+
+        const double *sum = (const double *)e->sum;
+        double inv = 1.0 / e->count;
+        for (int c = 0; c < nch; ++c) {
+            double m = sum[c] * inv;
+            if (m < 0.0)
+                m = 0.0;    // cancellation can leave a tiny negative residue
+            row[c] = (e->mode == EMG_ENV_RMS) ? sqrt(m) : m;
+        }
+    }
+}
+
+void emg_envelope_process_i32(emg_envelope_t *e, const int32_t *in, double *out, int n_samples)
+{
+    if (!e || !in || !out)
+        return;
+
+    if (e->mode == EMG_ENV_LINEAR) {
+        // Nothing to gain from integer sums here; reuse the float path
+        double row[Q8_MAX_CHANNELS];
+        for (int n = 0; n < n_samples; ++n) {
+            for (int c = 0; c < e->n_channels; ++c)
+                row[c] = (double)in[n * e->n_channels + c];
+            emg_envelope_process(e, row, &out[n * e->n_channels], 1);
+        }
+        return;
+    }
+    select_input(e, INPUT_I32);
+
+    const int nch = e->n_channels;
+    for (int n = 0; n < n_samples; ++n) {
+        int64_t *slot = &e->iring[(size_t)e->pos * nch];
+        int full = (e->count == e->window);
+        for (int c = 0; c < nch; ++c) {
+            int64_t v = in[n * nch + c];
+            int64_t r = (e->mode == EMG_ENV_RMS) ? v * v : (v < 0 ? -v : v);
+            if (full)
+                e->isum[c] -= slot[c];
+            e->isum[c] += r;
+            slot[c] = r;
+        }
+        if (!full)
+            e->count++;
+        e->pos = (e->pos + 1) % e->window;
+
+        double inv = 1.0 / e->count;
+        for (int c = 0; c < nch; ++c) {
+            double m = (double)e->isum[c] * inv;
+            out[n * nch + c] = (e->mode == EMG_ENV_RMS) ? sqrt(m) : m;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+/*******************************************************************************
+* emg_envelope - multichannel amplitude envelope (RMS, MAV, linear envelope)
+*
+* RMS and MAV are moving averages over a fixed window updated in O(1) per
+* sample. Raw ADC counts (int32) keep exact int64 running sums; float input
+* uses Kahan-compensated sums, so neither drifts over long sessions.
+*
+* The linear envelope is the full-wave rectified signal through a one-pole
+* low-pass whose time constant is window_ms.
+*******************************************************************************/
+
+#ifndef EMG_ENVELOPE_H
+#define EMG_ENVELOPE_H
+
+#include "q8native.h"
+
+#define EMG_ENV_RMS     0
+#define EMG_ENV_MAV     1
+#define EMG_ENV_LINEAR  2
+
+typedef struct emg_envelope emg_envelope_t;
+
+emg_envelope_t *emg_envelope_create(int n_channels, double fs, double window_ms, int mode);
+void emg_envelope_destroy(emg_envelope_t *e);
+void emg_envelope_reset(emg_envelope_t *e);
+
+// Window length in samples
+int emg_envelope_window(const emg_envelope_t *e);
+
+// in/out are [n_samples][n_channels]. Switching between the float and the
+// int32 entry points resets the envelope.
+void emg_envelope_process(emg_envelope_t *e, const double *in, double *out, int n_samples);
+void emg_envelope_process_i32(emg_envelope_t *e, const int32_t *in, double *out, int n_samples);
+
+#endif // EMG_ENVELOPE_H
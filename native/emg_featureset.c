@@ -0,0 +1,212 @@
+/*******************************************************************************
+* emg_featureset - the window feature sets of emg_features.py, in C
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "emg_featureset.h"
+#include "emg_multiscale.h"
+#include "emg_spectral.h"
+#include "imu_orient.h"
+
+// emg_features.MULTISCALE_WINDOWS
+static const int MULTISCALE_WINDOWS[] = { 50, 100, 200 };
+#define N_MULTISCALE 3
+
+// emg_features.SPECTRAL_WINDOW / _FS / _BAND_EDGES
+#define SPECTRAL_WINDOW 200
+#define SPECTRAL_FS     250.0
+static const double SPECTRAL_BAND_EDGES[] = { 10.0, 30.0, 60.0, 90.0, 125.0 };
+#define N_SPECTRAL_BANDS 4
+
+// Per-channel features, in the order the sets pick them from
+enum { F_MAV, F_RMS, F_WL, F_ZC, F_SSC, F_VAR, F_IEMG, F_WA, F_COUNT };
+
+static const int SET_DEFAULT[] = { F_RMS, F_MAV, F_WL, F_ZC, F_VAR };
+static const int SET_MAV[] = { F_MAV, F_RMS, F_VAR };
+static const int SET_TIME_DOMAIN[] = { F_MAV, F_RMS, F_WL, F_ZC, F_SSC, F_VAR, F_IEMG, F_WA };
+
+struct emg_featureset {
+    int set;
+    int n_channels;
+    int n_features;
+    const int *pick;          // per-channel features (DEFAULT / MAV / TIME_DOMAIN / FUSED / SPECTRAL)
+    int n_pick;
+    emg_multiscale_t *ms;     // MULTISCALE
+    emg_spectral_t *sp;       // SPECTRAL
+    imu_orient_t *orient;     // FUSED
+};
+
+emg_featureset_t *emg_featureset_create(int feature_set, int n_channels)
+{
+    if (feature_set < 0 || feature_set >= EMG_FS_COUNT || n_channels < 1 || n_channels > Q8_MAX_CHANNELS)
+        return NULL;
+
+    emg_featureset_t *fs = calloc(1, sizeof(*fs));
+    if (!fs)
+        return NULL;
+    fs->set = feature_set;
+    fs->n_channels = n_channels;
+
+    switch (feature_set) {
+    case EMG_FS_DEFAULT:
+        fs->pick = SET_DEFAULT;
+        fs->n_pick = 5;
+        break;
+    case EMG_FS_MAV:
+        fs->pick = SET_MAV;
+        fs->n_pick = 3;
+        break;
+    case EMG_FS_MULTISCALE:
+        fs->ms = emg_multiscale_create(n_channels, MULTISCALE_WINDOWS, N_MULTISCALE);
+        if (!fs->ms) {
+            free(fs);
+            return NULL;
+        }
+        fs->n_features = emg_multiscale_num_features(fs->ms);
+        return fs;
+    case EMG_FS_FUSED: {
+        // OrientationFilter's defaults (q8native.py)
+        const imu_orient_config_t cfg = { 250.0, IMU_CYTON_SCALE_G, 150.0, 0.3, 30.0, 25.0 };
+        fs->orient = imu_orient_create(&cfg);
+        if (!fs->orient) {
+            free(fs);
+            return NULL;
+        }
+        fs->pick = SET_TIME_DOMAIN;
+        fs->n_pick = 8;
+        break;
+    }
+    case EMG_FS_SPECTRAL:
+        fs->sp = emg_spectral_create(n_channels, SPECTRAL_WINDOW, SPECTRAL_FS,
+                                     SPECTRAL_BAND_EDGES, N_SPECTRAL_BANDS);
+        if (!fs->sp) {
+            free(fs);
+            return NULL;
+        }
+    // fall through
+    default:
+        fs->pick = SET_TIME_DOMAIN;
+        fs->n_pick = 8;
+        break;
+    }
+    fs->n_features = n_channels * fs->n_pick + (fs->orient ? 2 : 0) + emg_spectral_num_features(fs->sp);
+    return fs;
+}
+
+void emg_featureset_destroy(emg_featureset_t *fs)
+{
+    if (!fs)
+        return;
+    emg_multiscale_destroy(fs->ms);
+    emg_spectral_destroy(fs->sp);
+    imu_orient_destroy(fs->orient);
+    free(fs);
+}
+
+int emg_featureset_num_features(const emg_featureset_t *fs)
+{
+    return fs ? fs->n_features : Q8_ERR_ARG;
+}
+
+int emg_featureset_channel_of(const emg_featureset_t *fs, int k)
+{
+    if (!fs || k < 0 || k >= fs->n_features)
+        return -1;
+    if (fs->ms)
+        return k / EMG_MS_N_FEATURES % fs->n_channels;
+    const int n_td = fs->n_channels * fs->n_pick;
+    if (k < n_td)
+        return k / fs->n_pick;
+    if (fs->sp)
+        return (k - n_td) / (2 + N_SPECTRAL_BANDS);
+    return -1;
+}
+
+int emg_featureset_needs_aux(const emg_featureset_t *fs)
+{
+    return fs && fs->orient != NULL;
+}
+
+static inline int sign_of(double x)
+{
+    return (x > 0.0) - (x < 0.0);
+}
+
+// All F_COUNT features of channel ch
+static void channel_features(const double *data, int n, int stride, double *f)
+{
+    double sum = 0.0, sum_abs = 0.0, sum_sq = 0.0, wl = 0.0, max_abs = 0.0;
+    int zc = 0, ssc = 0;
+    for (int i = 0; i < n; ++i) {
+        const double x = data[i * stride];
+        sum += x;
+        sum_abs += fabs(x);
+        sum_sq += x * x;
+        if (fabs(x) > max_abs)
+            max_abs = fabs(x);
+        if (i > 0) {
+            const double prev = data[(i - 1) * stride];
+            wl += fabs(x - prev);
+            zc += sign_of(x) != sign_of(prev);
+            if (i > 1)
+                ssc += sign_of(x - prev) != sign_of(prev - data[(i - 2) * stride]);
+        }
+    }
+
+    // Variance about the mean in a second pass (raw counts are ~1e6)
+    const double mean = sum / n;
+    double var = 0.0;
+    const double wa_threshold = max_abs > 0.0 ? 0.01 * max_abs : 0.01;
+    int wa = 0;
+    for (int i = 0; i < n; ++i) {
+        const double d = data[i * stride] - mean;
+        var += d * d;
+        if (i > 0)
+            wa += fabs(data[i * stride] - data[(i - 1) * stride]) > wa_threshold;
+    }
+
+    f[F_MAV] = sum_abs / n;
+    f[F_RMS] = sqrt(sum_sq / n);
+    f[F_WL] = wl;
+    f[F_ZC] = zc;
+    f[F_SSC] = ssc;
+    f[F_VAR] = var / n;
+    f[F_IEMG] = sum_abs;
+    f[F_WA] = wa;
+}
+
+int emg_featureset_extract(emg_featureset_t *fs, const double *data, int n_samples,
+                           const int16_t *aux, int n_aux, double *out)
+{
+    if (!fs || !data || !out || n_samples < 2)
+        return Q8_ERR_ARG;
+    if (fs->orient && (!aux || n_aux < 1))
+        return Q8_ERR_ARG;
+
+    if (fs->ms)
+        return emg_multiscale_window(fs->ms, data, n_samples, out);
+
+    const int n_ch = fs->n_channels;
+    for (int ch = 0; ch < n_ch; ++ch) {
+        double f[F_COUNT];
+        channel_features(data + ch, n_samples, n_ch, f);
+        for (int k = 0; k < fs->n_pick; ++k)
+            out[ch * fs->n_pick + k] = f[fs->pick[k]];
+    }
+
+    if (fs->sp)
+        return emg_spectral_window(fs->sp, data, n_samples, out + n_ch * fs->n_pick);
+
+    if (fs->orient) {
+        // A fresh filter per window, as emg_features.window_orientation
+        imu_orient_state_t st;
+        imu_orient_reset(fs->orient);
+        imu_orient_push(fs->orient, aux, NULL, n_aux);
+        imu_orient_get(fs->orient, &st);
+        out[n_ch * fs->n_pick] = st.pitch_deg;
+        out[n_ch * fs->n_pick + 1] = st.roll_deg;
+    }
+    return Q8_OK;
+}
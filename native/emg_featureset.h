@@ -0,0 +1,56 @@
+/*******************************************************************************
+* emg_featureset - the window feature sets of emg_features.py, in C
+*
+* One stored window (n_samples x n_channels, as collect_data saves them) in,
+* the feature vector the matching feature_type would give out:
+*
+*     EMG_FS_DEFAULT      RMS, MAV, WL, ZC, VAR per channel
+*     EMG_FS_MAV          MAV, RMS, VAR per channel
+*     EMG_FS_TIME_DOMAIN  MAV, RMS, WL, ZC, SSC, VAR, IEMG, WA per channel
+*     EMG_FS_MULTISCALE   MAV, RMS, WL, ZC, SSC, VAR over the last 50, 100
+*                         and 200 samples ([scale][channel][feature], through
+*                         emg_multiscale)
+*     EMG_FS_FUSED        TIME_DOMAIN, then wrist pitch and roll (deg) from
+*                         imu_orient run over the window's aux
+*     EMG_FS_SPECTRAL     TIME_DOMAIN, then MNF, MDF and the relative power
+*                         of the 10-30, 30-60, 60-90 and 90-125 Hz bands per
+*                         channel over the last 200 samples (emg_spectral)
+*
+* ZC and SSC count changes of sign() between neighbours (0 is its own sign),
+* VAR is the population variance and WA counts |diff| above 1% of the
+* window's max |x|, all as numpy computes them. An extractor keeps scratch
+* state: one per thread.
+*******************************************************************************/
+
+#ifndef EMG_FEATURESET_H
+#define EMG_FEATURESET_H
+
+#include "q8native.h"
+
+#define EMG_FS_DEFAULT      0
+#define EMG_FS_MAV          1
+#define EMG_FS_TIME_DOMAIN  2
+#define EMG_FS_MULTISCALE   3
+#define EMG_FS_FUSED        4
+#define EMG_FS_SPECTRAL     5
+#define EMG_FS_COUNT        6
+
+typedef struct emg_featureset emg_featureset_t;
+
+emg_featureset_t *emg_featureset_create(int feature_set, int n_channels);
+void emg_featureset_destroy(emg_featureset_t *fs);
+
+int emg_featureset_num_features(const emg_featureset_t *fs);
+
+// Channel feature k is computed from (-1: pitch / roll, or k out of range)
+int emg_featureset_channel_of(const emg_featureset_t *fs, int k);
+
+// Whether the set needs the window's accelerometer counts (aux)
+int emg_featureset_needs_aux(const emg_featureset_t *fs);
+
+// data: [n_samples][n_channels]; aux: [n_aux][3] counts or NULL.
+// Returns Q8_ERR_ARG for n_samples < 2, or a missing aux when needed.
+int emg_featureset_extract(emg_featureset_t *fs, const double *data, int n_samples,
+                           const int16_t *aux, int n_aux, double *out);
+
+#endif // EMG_FEATURESET_H
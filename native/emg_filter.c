@@ -0,0 +1,260 @@
+/*******************************************************************************
+* emg_filter - multichannel biquad cascade (second-order sections)
+*******************************************************************************/
+
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_filter.h"
+
+#define N_VEC (Q8_MAX_CHANNELS / Q8_LANES)
+
+typedef struct {
+    double b0, b1, b2, a1, a2;    // normalized so a0 == 1
+} biquad_t;
+
+struct emg_filter {
+    // Direct form II transposed state, one vector per group of 4 channels
+    q8_vec_t z1[EMG_FILTER_MAX_SECTIONS][N_VEC];
+    q8_vec_t z2[EMG_FILTER_MAX_SECTIONS][N_VEC];
+    biquad_t sec[EMG_FILTER_MAX_SECTIONS];
+    int n_sections;
+    int n_channels;
+    int n_vec;                    // padded channels / Q8_LANES
+    double fs;
+};
+
+emg_filter_t *emg_filter_create(int n_channels, double fs)
+{
+    if (n_channels < 1 || n_channels > Q8_MAX_CHANNELS || fs <= 0.0)
+        return NULL;
+
+    emg_filter_t *f = NULL;
+    if (posix_memalign((void **)&f, sizeof(q8_vec_t), sizeof(*f)) != 0)
+        return NULL;
+    memset(f, 0, sizeof(*f));
+
+    f->n_channels = n_channels;
+    f->n_vec = Q8_PAD_CHANNELS(n_channels) / Q8_LANES;
+    f->fs = fs;
+    return f;
+}
+
+void emg_filter_destroy(emg_filter_t *f)
+{
+    free(f);
+}
+
+static int push_section(emg_filter_t *f, double b0, double b1, double b2,
+                        double a0, double a1, double a2)
+{
+    if (f->n_sections >= EMG_FILTER_MAX_SECTIONS)
+        return Q8_ERR_FULL;
+    if (a0 == 0.0)
+        return Q8_ERR_ARG;
+
+    biquad_t *q = &f->sec[f->n_sections++];
+    q->b0 = b0 / a0;
+    q->b1 = b1 / a0;
+    q->b2 = b2 / a0;
+    q->a1 = a1 / a0;
+    q->a2 = a2 / a0;
+    return Q8_OK;
+}
+
+// |H(e^jw)| of one section
+static double section_gain(const biquad_t *q, double w)
+{
+    double complex z1 = cexp(-I * w);
+    double complex z2 = z1 * z1;
+    double complex num = q->b0 + q->b1 * z1 + q->b2 * z2;
+    double complex den = 1.0 + q->a1 * z1 + q->a2 * z2;
+    return cabs(num / den);
+}
+
+int emg_filter_add_bandpass(emg_filter_t *f, double low_hz, double high_hz, int order)
+{
+    if (!f || order < 1 || low_hz <= 0.0 || high_hz <= low_hz || high_hz >= f->fs / 2.0)
+        return Q8_ERR_ARG;
+    if (f->n_sections + order > EMG_FILTER_MAX_SECTIONS)
+        return Q8_ERR_FULL;
+
+    // Pre-warped analog band edges for the bilinear transform
+    double fs2 = 2.0 * f->fs;
+    double w1 = fs2 * tan(M_PI * low_hz / f->fs);
+    double w2 = fs2 * tan(M_PI * high_hz / f->fs);
+    double bw = w2 - w1;
+    double w0sq = w1 * w2;
+
+    // Each Butterworth prototype pole becomes two band-pass poles
+    double complex zp[2 * EMG_FILTER_MAX_SECTIONS];
+    int n_poles = 0;
+    for (int k = 0; k < order; ++k) {
+        double complex p = cexp(I * M_PI * (2.0 * k + order + 1) / (2.0 * order));
+        double complex a = p * bw / 2.0;
+        double complex d = csqrt(a * a - w0sq);
+        double complex s[2] = { a + d, a - d };
+        for (int j = 0; j < 2; ++j)
+            zp[n_poles++] = (fs2 + s[j]) / (fs2 - s[j]);
+    }
+
+    // Conjugate pairs -> one section each; leftover real poles are paired up.
+    // Every section gets one zero at DC and one at Nyquist.
+    int first = f->n_sections;
+    double real_poles[2 * EMG_FILTER_MAX_SECTIONS];
+    int n_real = 0;
+    for (int i = 0; i < n_poles; ++i) {
+        double re = creal(zp[i]), im = cimag(zp[i]);
+        if (fabs(im) <= 1e-12) {
+            real_poles[n_real++] = re;
+        } else if (im > 0.0) {
+            push_section(f, 1.0, 0.0, -1.0, 1.0, -2.0 * re, re * re + im * im);
+        }
+    }
+    for (int i = 0; i + 1 < n_real; i += 2) {
+        double r1 = real_poles[i], r2 = real_poles[i + 1];
+        push_section(f, 1.0, 0.0, -1.0, 1.0, -(r1 + r2), r1 * r2);
+    }
+
+    // Unity gain at the (digital) centre frequency, spread over the sections
+    double wc = 2.0 * atan(sqrt(w0sq) / fs2);
+    for (int s = first; s < f->n_sections; ++s) {
+        double g = section_gain(&f->sec[s], wc);
+        f->sec[s].b0 /= g;
+        f->sec[s].b1 /= g;
+        f->sec[s].b2 /= g;
+    }
+    return Q8_OK;
+}
+
+int emg_filter_add_notch(emg_filter_t *f, double f0_hz, double q)
+{
+    if (!f || f0_hz <= 0.0 || f0_hz >= f->fs / 2.0 || q <= 0.0)
+        return Q8_ERR_ARG;
+
+    double w0 = 2.0 * M_PI * f0_hz / f->fs;
+    double alpha = sin(w0) / (2.0 * q);
+    double c = cos(w0);
+    return push_section(f, 1.0, -2.0 * c, 1.0, 1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+int emg_filter_add_dc_block(emg_filter_t *f, double cutoff_hz)
+{
+    if (!f || cutoff_hz <= 0.0 || cutoff_hz >= f->fs / 2.0)
+        return Q8_ERR_ARG;
+
+    // y[n] = g * (x[n] - x[n-1]) + r * y[n-1], unity gain at Nyquist
+    double r = exp(-2.0 * M_PI * cutoff_hz / f->fs);
+    double g = (1.0 + r) / 2.0;
+    return push_section(f, g, -g, 0.0, 1.0, -r, 0.0);
+}
+
+int emg_filter_add_section(emg_filter_t *f, const double sos[6])
+{
+    if (!f || !sos)
+        return Q8_ERR_ARG;
+    return push_section(f, sos[0], sos[1], sos[2], sos[3], sos[4], sos[5]);
+}
+
+int emg_filter_num_sections(const emg_filter_t *f)
+{
+    return f ? f->n_sections : 0;
+}
+
+int emg_filter_get_sos(const emg_filter_t *f, double *sos_out, int max_sections)
+{
+    if (!f || !sos_out)
+        return Q8_ERR_ARG;
+
+    int n = f->n_sections < max_sections ? f->n_sections : max_sections;
+    for (int s = 0; s < n; ++s) {
+        const biquad_t *q = &f->sec[s];
+        double *row = &sos_out[6 * s];
+        row[0] = q->b0; row[1] = q->b1; row[2] = q->b2;
+        row[3] = 1.0;   row[4] = q->a1; row[5] = q->a2;
+    }
+    return n;
+}
+
+void emg_filter_reset(emg_filter_t *f)
+{
+    if (!f)
+        return;
+    memset(f->z1, 0, sizeof(f->z1));
+    memset(f->z2, 0, sizeof(f->z2));
+}
+
+void emg_filter_prime(emg_filter_t *f, const double *x0)
+{
+    if (!f || !x0)
+        return;
+
+    double u[N_VEC * Q8_LANES] = {0};
+    memcpy(u, x0, f->n_channels * sizeof(double));
+
+    for (int s = 0; s < f->n_sections; ++s) {
+        const biquad_t *q = &f->sec[s];
+        double dc = (q->b0 + q->b1 + q->b2) / (1.0 + q->a1 + q->a2);
+        double *z1 = (double *)f->z1[s];
+        double *z2 = (double *)f->z2[s];
+        for (int c = 0; c < f->n_channels; ++c) {
+            double y = dc * u[c];
+            z2[c] = q->b2 * u[c] - q->a2 * y;
+            z1[c] = q->b1 * u[c] - q->a1 * y + z2[c];
+            u[c] = y;
+        }
+    }
+}
+
+// Run one (padded) sample vector through the whole cascade
+static inline void cascade_step(emg_filter_t *f, q8_vec_t *v)
+{
+    for (int s = 0; s < f->n_sections; ++s) {
+        const biquad_t *q = &f->sec[s];
+        q8_vec_t *z1 = f->z1[s];
+        q8_vec_t *z2 = f->z2[s];
+        for (int k = 0; k < f->n_vec; ++k) {
+            q8_vec_t x = v[k];
+            q8_vec_t y = q->b0 * x + z1[k];
+            z1[k] = q->b1 * x - q->a1 * y + z2[k];
+            z2[k] = q->b2 * x - q->a2 * y;
+            v[k] = y;
+        }
+    }
+}
+
+void emg_filter_process(emg_filter_t *f, const double *in, double *out, int n_samples)
+{
+    if (!f || !in || !out)
+        return;
+
+    const int nch = f->n_channels;
+    q8_vec_t v[N_VEC];
+    memset(v, 0, sizeof(v));
+
+    for (int n = 0; n < n_samples; ++n) {
+        memcpy(v, &in[n * nch], nch * sizeof(double));
+        cascade_step(f, v);
+        memcpy(&out[n * nch], v, nch * sizeof(double));
+    }
+}
+
+void emg_filter_process_i32(emg_filter_t *f, const int32_t *in, double *out, int n_samples)
+{
+    if (!f || !in || !out)
+        return;
+
+    const int nch = f->n_channels;
+    q8_vec_t v[N_VEC];
+    memset(v, 0, sizeof(v));
+
+    for (int n = 0; n < n_samples; ++n) {
+        double *lane = (double *)v;
+        for (int c = 0; c < nch; ++c)
+            lane[c] = (double)in[n * nch + c];
+        cascade_step(f, v);
+        memcpy(&out[n * nch], v, nch * sizeof(double));
+    }
+}
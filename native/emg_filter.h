@@ -0,0 +1,51 @@
+/*******************************************************************************
+* emg_filter - multichannel biquad cascade (second-order sections)
+*
+* All channels of a sample are filtered together: the coefficients of a
+* section are shared and the per-channel state lives in SIMD vectors.
+* State persists across calls so a stream can be fed in arbitrary chunks.
+*
+* Sample buffers are interleaved, row-major [n_samples][n_channels], which is
+* the layout of the (window, channel) numpy arrays used in gesture_recognition.
+*******************************************************************************/
+
+#ifndef EMG_FILTER_H
+#define EMG_FILTER_H
+
+#include "q8native.h"
+
+#define EMG_FILTER_MAX_SECTIONS 16
+
+typedef struct emg_filter emg_filter_t;
+
+emg_filter_t *emg_filter_create(int n_channels, double fs);
+void emg_filter_destroy(emg_filter_t *f);
+
+// Butterworth band-pass of the given order per band edge (order N gives N
+// sections, same response as scipy butter(N, [low, high], 'band'))
+int emg_filter_add_bandpass(emg_filter_t *f, double low_hz, double high_hz, int order);
+
+// Second-order notch at f0_hz (mains hum); q = f0 / bandwidth
+int emg_filter_add_notch(emg_filter_t *f, double f0_hz, double q);
+
+// First-order DC blocker with the given -3 dB corner
+int emg_filter_add_dc_block(emg_filter_t *f, double cutoff_hz);
+
+// Raw section, scipy sos layout: b0 b1 b2 a0 a1 a2
+int emg_filter_add_section(emg_filter_t *f, const double sos[6]);
+
+int emg_filter_num_sections(const emg_filter_t *f);
+int emg_filter_get_sos(const emg_filter_t *f, double *sos_out, int max_sections);
+
+// Zero all state
+void emg_filter_reset(emg_filter_t *f);
+
+// Set state to the steady state for a constant input x0[n_channels]. Priming
+// with the first sample avoids the large start-up transient caused by the
+// Cyton's DC offset.
+void emg_filter_prime(emg_filter_t *f, const double *x0);
+
+void emg_filter_process(emg_filter_t *f, const double *in, double *out, int n_samples);
+void emg_filter_process_i32(emg_filter_t *f, const int32_t *in, double *out, int n_samples);
+
+#endif // EMG_FILTER_H
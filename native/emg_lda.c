@@ -0,0 +1,305 @@
+/*******************************************************************************
+* emg_lda - linear discriminant analysis that learns one window at a time
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emg_lda.h"
+
+struct emg_lda {
+    emg_lda_config_t cfg;
+    double *weight;           // [K]
+    double *mean;             // [K][F]
+    double *scatter;          // [F][F] pooled within-class
+    double *d;                // [F] scratch
+    double *work;             // [F][F] scratch for the factor
+
+    // Discriminant in use, and the one a refit builds
+    double *coef, *next_coef;             // [K][F]
+    double *intercept, *next_intercept;   // [K], -inf for classes not fitted
+
+    emg_lda_stats_t st;
+};
+
+emg_lda_t *emg_lda_create(const emg_lda_config_t *cfg)
+{
+    if (!cfg || cfg->n_features < 1 || cfg->n_features > EMG_LDA_MAX_FEATURES
+        || cfg->n_classes < 2 || cfg->n_classes > EMG_LDA_MAX_CLASSES
+        || !(cfg->shrinkage >= 0.0 && cfg->shrinkage < 1.0))
+        return NULL;
+
+    emg_lda_t *l = calloc(1, sizeof(*l));
+    if (!l)
+        return NULL;
+    l->cfg = *cfg;
+
+    const size_t F = cfg->n_features, K = cfg->n_classes;
+    l->weight = calloc(K, sizeof(double));
+    l->mean = calloc(K * F, sizeof(double));
+    l->scatter = calloc(F * F, sizeof(double));
+    l->d = calloc(F, sizeof(double));
+    l->work = calloc(F * F, sizeof(double));
+    l->coef = calloc(K * F, sizeof(double));
+    l->next_coef = calloc(K * F, sizeof(double));
+    l->intercept = calloc(K, sizeof(double));
+    l->next_intercept = calloc(K, sizeof(double));
+    if (!l->weight || !l->mean || !l->scatter || !l->d || !l->work
+        || !l->coef || !l->next_coef || !l->intercept || !l->next_intercept) {
+        emg_lda_destroy(l);
+        return NULL;
+    }
+    return l;
+}
+
+void emg_lda_destroy(emg_lda_t *l)
+{
+    if (!l)
+        return;
+    free(l->weight);
+    free(l->mean);
+    free(l->scatter);
+    free(l->d);
+    free(l->work);
+    free(l->coef);
+    free(l->next_coef);
+    free(l->intercept);
+    free(l->next_intercept);
+    free(l);
+}
+
+void emg_lda_reset(emg_lda_t *l)
+{
+    if (!l)
+        return;
+    const size_t F = l->cfg.n_features, K = l->cfg.n_classes;
+    memset(l->weight, 0, K * sizeof(double));
+    memset(l->mean, 0, K * F * sizeof(double));
+    memset(l->scatter, 0, F * F * sizeof(double));
+    memset(&l->st, 0, sizeof(l->st));
+}
+
+int emg_lda_seed_class(emg_lda_t *l, int c, double weight, const double *mean)
+{
+    if (!l || c < 0 || c >= l->cfg.n_classes || !(weight > 0.0) || !mean)
+        return Q8_ERR_ARG;
+    l->weight[c] = weight;
+    memcpy(&l->mean[(size_t)c * l->cfg.n_features], mean, l->cfg.n_features * sizeof(double));
+    return Q8_OK;
+}
+
+int emg_lda_seed_cov(emg_lda_t *l, double dof, const double *cov)
+{
+    if (!l || !(dof > 0.0) || !cov)
+        return Q8_ERR_ARG;
+    const int F = l->cfg.n_features;
+    for (int i = 0; i < F * F; ++i)
+        l->scatter[i] += dof * cov[i];
+    l->st.dof += dof;
+    return Q8_OK;
+}
+
+int emg_lda_add(emg_lda_t *l, const double *x, const int *labels, int n)
+{
+    if (!l || (n > 0 && (!x || !labels)) || n < 0)
+        return Q8_ERR_ARG;
+    const int F = l->cfg.n_features;
+
+    for (int i = 0; i < n; ++i) {
+        const int c = labels[i];
+        const double *xi = x + (size_t)i * F;
+        if (c < 0 || c >= l->cfg.n_classes)
+            return Q8_ERR_ARG;
+
+        double *mu = &l->mean[(size_t)c * F];
+        l->weight[c] += 1.0;
+        const double r = 1.0 / l->weight[c];
+        for (int k = 0; k < F; ++k) {
+            l->d[k] = xi[k] - mu[k];
+            mu[k] += l->d[k] * r;
+        }
+        // Symmetric rank-one update, (n - 1) / n d d'
+        const double g = 1.0 - r;
+        for (int a = 0; a < F; ++a) {
+            const double da = g * l->d[a];
+            double *row = &l->scatter[(size_t)a * F];
+            for (int b = 0; b < F; ++b)
+                row[b] += da * l->d[b];
+        }
+        l->st.dof += 1.0;
+        l->st.windows++;
+    }
+    return Q8_OK;
+}
+
+// In-place lower Cholesky factor; -1 if S is not positive definite
+static int cholesky(double *S, int n)
+{
+    for (int j = 0; j < n; ++j) {
+        double *rj = S + (size_t)j * n;
+        double diag = rj[j];
+        for (int k = 0; k < j; ++k)
+            diag -= rj[k] * rj[k];
+        if (!(diag > 0.0) || !isfinite(diag))
+            return -1;
+        rj[j] = sqrt(diag);
+        for (int i = j + 1; i < n; ++i) {
+            double *ri = S + (size_t)i * n;
+            double v = ri[j];
+            for (int k = 0; k < j; ++k)
+                v -= ri[k] * rj[k];
+            ri[j] = v / rj[j];
+        }
+    }
+    return 0;
+}
+
+// x = S^-1 b from the factor L (L L' x = b), in place
+static void chol_solve(const double *L, int n, double *x)
+{
+    for (int i = 0; i < n; ++i) {
+        const double *ri = L + (size_t)i * n;
+        double v = x[i];
+        for (int k = 0; k < i; ++k)
+            v -= ri[k] * x[k];
+        x[i] = v / ri[i];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double v = x[i];
+        for (int k = i + 1; k < n; ++k)
+            v -= L[(size_t)k * n + i] * x[k];
+        x[i] = v / L[(size_t)i * n + i];
+    }
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+int emg_lda_refit(emg_lda_t *l)
+{
+    if (!l)
+        return Q8_ERR_ARG;
+    const double t0 = now_us();
+    const int F = l->cfg.n_features, K = l->cfg.n_classes;
+    const double lambda = l->cfg.shrinkage;
+
+    int n_fit = 0;
+    for (int c = 0; c < K; ++c)
+        n_fit += l->weight[c] > 0.0;
+    if (n_fit < 1 || !(l->st.dof > 0.0))
+        return Q8_ERR_ARG;
+
+    // Sigma = S / dof, shrunk toward tr(Sigma)/F I
+    double tr = 0.0;
+    for (int k = 0; k < F; ++k)
+        tr += l->scatter[(size_t)k * F + k];
+    tr /= F * l->st.dof;
+    for (int i = 0; i < F * F; ++i)
+        l->work[i] = (1.0 - lambda) * l->scatter[i] / l->st.dof;
+    for (int k = 0; k < F; ++k)
+        l->work[(size_t)k * F + k] += lambda * tr;
+    if (cholesky(l->work, F) != 0)
+        return Q8_ERR_ARG;
+
+    const double log_prior = -log((double)n_fit);
+    for (int c = 0; c < K; ++c) {
+        double *w = &l->next_coef[(size_t)c * F];
+        if (!(l->weight[c] > 0.0)) {
+            memset(w, 0, F * sizeof(double));
+            l->next_intercept[c] = -INFINITY;
+            continue;
+        }
+        const double *mu = &l->mean[(size_t)c * F];
+        memcpy(w, mu, F * sizeof(double));
+        chol_solve(l->work, F, w);
+        double q = 0.0;
+        for (int k = 0; k < F; ++k)
+            q += mu[k] * w[k];
+        l->next_intercept[c] = -0.5 * q + log_prior;
+    }
+
+    // Swap in the new discriminant
+    double *tmp = l->coef;
+    l->coef = l->next_coef;
+    l->next_coef = tmp;
+    tmp = l->intercept;
+    l->intercept = l->next_intercept;
+    l->next_intercept = tmp;
+
+    l->st.fitted = 1;
+    l->st.n_fitted = n_fit;
+    l->st.refits++;
+    l->st.refit_us = now_us() - t0;
+    return Q8_OK;
+}
+
+int emg_lda_predict(const emg_lda_t *l, const double *x, int n, int *labels, double *proba)
+{
+    if (!l || (n > 0 && !x) || n < 0 || !l->st.fitted)
+        return Q8_ERR_ARG;
+    const int F = l->cfg.n_features, K = l->cfg.n_classes;
+    double score[EMG_LDA_MAX_CLASSES];
+
+    for (int i = 0; i < n; ++i) {
+        const double *xi = x + (size_t)i * F;
+        int best = -1;
+        for (int c = 0; c < K; ++c) {
+            score[c] = l->intercept[c];
+            if (isinf(score[c]))
+                continue;
+            const double *w = &l->coef[(size_t)c * F];
+            for (int k = 0; k < F; ++k)
+                score[c] += w[k] * xi[k];
+            if (best < 0 || score[c] > score[best])
+                best = c;
+        }
+        if (labels)
+            labels[i] = best;
+        if (proba) {
+            double *p = proba + (size_t)i * K;
+            double sum = 0.0;
+            for (int c = 0; c < K; ++c) {
+                p[c] = isinf(score[c]) ? 0.0 : exp(score[c] - score[best]);
+                sum += p[c];
+            }
+            for (int c = 0; c < K; ++c)
+                p[c] /= sum;
+        }
+    }
+    return Q8_OK;
+}
+
+int emg_lda_get_class(const emg_lda_t *l, int c, double *weight, double *mean)
+{
+    if (!l || c < 0 || c >= l->cfg.n_classes)
+        return Q8_ERR_ARG;
+    if (weight)
+        *weight = l->weight[c];
+    if (mean)
+        memcpy(mean, &l->mean[(size_t)c * l->cfg.n_features], l->cfg.n_features * sizeof(double));
+    return Q8_OK;
+}
+
+int emg_lda_get_cov(const emg_lda_t *l, double *cov)
+{
+    if (!l || !cov || !(l->st.dof > 0.0))
+        return Q8_ERR_ARG;
+    const int F = l->cfg.n_features;
+    for (int i = 0; i < F * F; ++i)
+        cov[i] = l->scatter[i] / l->st.dof;
+    return Q8_OK;
+}
+
+int emg_lda_get_stats(const emg_lda_t *l, emg_lda_stats_t *out)
+{
+    if (!l || !out)
+        return Q8_ERR_ARG;
+    *out = l->st;
+    return Q8_OK;
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+* emg_lda - linear discriminant analysis that learns one window at a time
+*
+* Keeps, per class, a weight n_c and feature mean mu_c, and the pooled
+* within-class scatter S. A labelled window x of class c is folded in with
+* Welford's rank-one update
+*
+*     n_c += 1;  d = x - mu_c;  mu_c += d / n_c;  S += (n_c - 1) / n_c d d'
+*
+* so adding a window costs O(features^2) and nothing is stored per window.
+* refit() turns the statistics into the discriminant: the pooled covariance
+* Sigma = S / dof, shrunk toward a scaled identity (as emg_analytics), is
+* Cholesky-factored and
+*
+*     w_c = Sigma^-1 mu_c,   b_c = -1/2 mu_c' w_c + ln(1 / K)
+*
+* for the K classes that have a mean (equal priors). That is O(features^3 +
+* K features^2), microseconds for the feature sets of emg_features.py, and
+* predictions keep using the previous fit until a refit succeeds.
+*
+* dof is the number of windows behind S (N, not N - K): Sigma is the
+* maximum-likelihood pooled covariance, as sklearn's covariance_ with
+* empirical priors. Seeds follow the same convention, so a covariance
+* estimated from N windows is seeded at dof N.
+*
+* To adapt a trained model instead of starting from nothing, seed each
+* class with its old mean at a weight (windows it counts as) and the scatter
+* with its old pooled covariance at the total of those weights: new windows
+* then move the means and covariance away from the old model as fast as the
+* weights allow.
+*******************************************************************************/
+
+#ifndef EMG_LDA_H
+#define EMG_LDA_H
+
+#include "q8native.h"
+
+#define EMG_LDA_MAX_FEATURES 512
+#define EMG_LDA_MAX_CLASSES  64
+
+typedef struct {
+    int    n_features;
+    int    n_classes;
+    double shrinkage;         // [0, 1)
+} emg_lda_config_t;
+
+typedef struct {
+    uint64_t windows;         // added since create / reset (not seeds)
+    uint64_t refits;
+    double   dof;             // windows behind S, seeds included
+    double   refit_us;        // duration of the last refit
+    int      fitted;          // a discriminant is available
+    int      n_fitted;        // classes in it
+} emg_lda_stats_t;
+
+typedef struct emg_lda emg_lda_t;
+
+emg_lda_t *emg_lda_create(const emg_lda_config_t *cfg);
+void emg_lda_destroy(emg_lda_t *l);
+
+// Forget all statistics and the fit
+void emg_lda_reset(emg_lda_t *l);
+
+// Class c starts from mean at weight (> 0) windows
+int emg_lda_seed_class(emg_lda_t *l, int c, double weight, const double *mean);
+
+// S += dof * cov ([n_features]^2): cov estimated from dof windows
+int emg_lda_seed_cov(emg_lda_t *l, double dof, const double *cov);
+
+// x: [n][n_features], labels: [n] classes
+int emg_lda_add(emg_lda_t *l, const double *x, const int *labels, int n);
+
+// Q8_ERR_ARG (previous fit kept) without a class mean or a positive
+// definite covariance
+int emg_lda_refit(emg_lda_t *l);
+
+// labels: [n] (may be NULL), proba: [n][n_classes] softmax of the scores,
+// 0 for classes not in the fit (may be NULL). Q8_ERR_ARG before a refit.
+int emg_lda_predict(const emg_lda_t *l, const double *x, int n, int *labels, double *proba);
+
+// Weight and mean [n_features] of class c (mean may be NULL)
+int emg_lda_get_class(const emg_lda_t *l, int c, double *weight, double *mean);
+
+// Pooled covariance S / dof before shrinkage, [n_features]^2
+int emg_lda_get_cov(const emg_lda_t *l, double *cov);
+
+int emg_lda_get_stats(const emg_lda_t *l, emg_lda_stats_t *out);
+
+#endif // EMG_LDA_H
@@ -0,0 +1,232 @@
+/*******************************************************************************
+* emg_multiscale - time-domain features over several window lengths at once
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_multiscale.h"
+
+#define N_VEC (Q8_MAX_CHANNELS / Q8_LANES)
+
+// Prefix quantities kept per channel. The variance uses sums of x - ref
+// (ref = first sample after reset) so a large DC offset on raw counts does
+// not cancel away its precision; RMS needs the uncentred squares.
+#define Q_S1C   0   // sum (x - ref)
+#define Q_S2C   1   // sum (x - ref)^2
+#define Q_S2    2   // sum x^2
+#define Q_SA    3   // sum |x|
+#define Q_WL    4   // sum |x[i] - x[i-1]|
+#define Q_ZC    5   // sign changes of x
+#define Q_SSC   6   // sign changes of the first difference
+#define N_Q     7
+
+struct emg_multiscale {
+    q8_vec_t prev[N_VEC];    // previous sample
+    q8_vec_t prev_d[N_VEC];  // previous first difference
+    q8_vec_t ref[N_VEC];     // variance reference
+    q8_vec_t *ring;          // [hist][N_Q][n_vec] prefix rows, row t % hist = P[t]
+    int64_t t;               // samples pushed since reset
+
+    int hist;                // longest window + 1
+    int row_len;             // vectors per row (N_Q * n_vec)
+    int n_channels;
+    int n_vec;
+    int n_pad;
+    int n_scales;
+    int windows[EMG_MS_MAX_SCALES];
+};
+
+emg_multiscale_t *emg_multiscale_create(int n_channels, const int *windows, int n_scales)
+{
+    if (n_channels < 1 || n_channels > Q8_MAX_CHANNELS || !windows)
+        return NULL;
+    if (n_scales < 1 || n_scales > EMG_MS_MAX_SCALES)
+        return NULL;
+
+    int longest = 0;
+    for (int s = 0; s < n_scales; ++s) {
+        if (windows[s] < 2)
+            return NULL;
+        if (windows[s] > longest)
+            longest = windows[s];
+    }
+
+    emg_multiscale_t *m = NULL;
+    if (posix_memalign((void **)&m, sizeof(q8_vec_t), sizeof(*m)) != 0)
+        return NULL;
+    memset(m, 0, sizeof(*m));
+
+    m->n_channels = n_channels;
+    m->n_pad = Q8_PAD_CHANNELS(n_channels);
+    m->n_vec = m->n_pad / Q8_LANES;
+    m->n_scales = n_scales;
+    memcpy(m->windows, windows, n_scales * sizeof(int));
+    m->hist = longest + 1;
+    m->row_len = N_Q * m->n_vec;
+
+    size_t bytes = (size_t)m->hist * m->row_len * sizeof(q8_vec_t);
+    if (posix_memalign((void **)&m->ring, sizeof(q8_vec_t), bytes) != 0) {
+        m->ring = NULL;
+        emg_multiscale_destroy(m);
+        return NULL;
+    }
+    emg_multiscale_reset(m);
+    return m;
+}
+
+void emg_multiscale_destroy(emg_multiscale_t *m)
+{
+    if (!m)
+        return;
+    free(m->ring);
+    free(m);
+}
+
+void emg_multiscale_reset(emg_multiscale_t *m)
+{
+    if (!m)
+        return;
+    memset(m->prev, 0, sizeof(m->prev));
+    memset(m->prev_d, 0, sizeof(m->prev_d));
+    memset(m->ref, 0, sizeof(m->ref));
+    memset(m->ring, 0, (size_t)m->hist * m->row_len * sizeof(q8_vec_t));
+    m->t = 0;
+}
+
+int emg_multiscale_num_features(const emg_multiscale_t *m)
+{
+    return m ? m->n_scales * m->n_channels * EMG_MS_N_FEATURES : 0;
+}
+
+int emg_multiscale_count(const emg_multiscale_t *m)
+{
+    if (!m)
+        return 0;
+    return m->t > INT32_MAX ? INT32_MAX : (int)m->t;
+}
+
+static inline q8_vec_t *prefix_row(const emg_multiscale_t *m, int64_t t)
+{
+    return &m->ring[(size_t)(t % m->hist) * m->row_len];
+}
+
+// Lane-wise sign as -1 / 0 / +1
+static inline q8_ivec_t vsign(q8_vec_t x)
+{
+    const q8_vec_t zero = {0};
+    return (x < zero) - (x > zero);
+}
+
+// 1.0 in lanes where the signs differ, 0.0 elsewhere
+static inline q8_vec_t sign_change(q8_vec_t a, q8_vec_t b)
+{
+    q8_ivec_t changed = (vsign(a) != vsign(b));
+    return __builtin_convertvector(-changed, q8_vec_t);
+}
+
+// Subtract the newest row from every row. Differences are unchanged but the
+// magnitudes restart from zero, bounding the rounding error of later sums.
+static void rebase(emg_multiscale_t *m)
+{
+    q8_vec_t base[N_Q * N_VEC];
+    memcpy(base, prefix_row(m, m->t), m->row_len * sizeof(q8_vec_t));
+    for (int r = 0; r < m->hist; ++r) {
+        q8_vec_t *row = &m->ring[(size_t)r * m->row_len];
+        for (int k = 0; k < m->row_len; ++k)
+            row[k] -= base[k];
+    }
+}
+
+void emg_multiscale_push(emg_multiscale_t *m, const double *in, int n_samples)
+{
+    if (!m || !in)
+        return;
+
+    const int nch = m->n_channels;
+    const int nv = m->n_vec;
+    q8_vec_t x[N_VEC];
+    memset(x, 0, sizeof(x));
+
+    for (int n = 0; n < n_samples; ++n) {
+        memcpy(x, &in[n * nch], nch * sizeof(double));
+        if (m->t == 0)
+            memcpy(m->ref, x, sizeof(x));
+
+        const q8_vec_t *p = prefix_row(m, m->t);
+        m->t++;
+        q8_vec_t *r = prefix_row(m, m->t);
+
+        for (int k = 0; k < nv; ++k) {
+            q8_vec_t xc = x[k] - m->ref[k];
+            r[Q_S1C * nv + k] = p[Q_S1C * nv + k] + xc;
+            r[Q_S2C * nv + k] = p[Q_S2C * nv + k] + xc * xc;
+            r[Q_S2 * nv + k]  = p[Q_S2 * nv + k] + x[k] * x[k];
+            r[Q_SA * nv + k]  = p[Q_SA * nv + k] + q8_vabs(x[k]);
+
+            q8_vec_t wl = {0}, zc = {0}, ssc = {0};
+            if (m->t >= 2) {
+                q8_vec_t d = x[k] - m->prev[k];
+                wl = q8_vabs(d);
+                zc = sign_change(x[k], m->prev[k]);
+                if (m->t >= 3)
+                    ssc = sign_change(d, m->prev_d[k]);
+                m->prev_d[k] = d;
+            }
+            r[Q_WL * nv + k]  = p[Q_WL * nv + k] + wl;
+            r[Q_ZC * nv + k]  = p[Q_ZC * nv + k] + zc;
+            r[Q_SSC * nv + k] = p[Q_SSC * nv + k] + ssc;
+            m->prev[k] = x[k];
+        }
+
+        if (m->t % m->hist == 0)
+            rebase(m);
+    }
+}
+
+int emg_multiscale_features(const emg_multiscale_t *m, double *out)
+{
+    if (!m || !out || m->t == 0)
+        return Q8_ERR_ARG;
+
+    const int nch = m->n_channels;
+    const int nv = m->n_vec;
+    const double *a = (const double *)prefix_row(m, m->t);
+
+    for (int s = 0; s < m->n_scales; ++s) {
+        int64_t len = m->windows[s] < m->t ? m->windows[s] : m->t;
+        int64_t t1 = m->t - len + 1;                       // first pair inside the window
+        int64_t t2 = m->t - len + 2 < m->t ? m->t - len + 2 : m->t;
+        const double *b0 = (const double *)prefix_row(m, m->t - len);
+        const double *b1 = (const double *)prefix_row(m, t1);
+        const double *b2 = (const double *)prefix_row(m, t2);
+        double inv = 1.0 / (double)len;
+
+#define DIFF(b, q, c) (a[(q) * nv * Q8_LANES + (c)] - (b)[(q) * nv * Q8_LANES + (c)])
+        for (int c = 0; c < nch; ++c) {
+            double *f = &out[(s * nch + c) * EMG_MS_N_FEATURES];
+            double ms = DIFF(b0, Q_S2, c) * inv;
+            double mean = DIFF(b0, Q_S1C, c) * inv;
+            double var = DIFF(b0, Q_S2C, c) * inv - mean * mean;
+
+            f[0] = DIFF(b0, Q_SA, c) * inv;                 // MAV
+            f[1] = sqrt(ms > 0.0 ? ms : 0.0);               // RMS
+            f[2] = DIFF(b1, Q_WL, c);                       // WL
+            f[3] = DIFF(b1, Q_ZC, c);                       // ZC
+            f[4] = DIFF(b2, Q_SSC, c);                      // SSC
+            f[5] = var > 0.0 ? var : 0.0;                   // VAR
+        }
+#undef DIFF
+    }
+    return Q8_OK;
+}
+
+int emg_multiscale_window(emg_multiscale_t *m, const double *in, int n_samples, double *out)
+{
+    if (!m || !in || !out || n_samples < 1)
+        return Q8_ERR_ARG;
+    emg_multiscale_reset(m);
+    emg_multiscale_push(m, in, n_samples);
+    return emg_multiscale_features(m, out);
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+* emg_multiscale - time-domain features over several window lengths at once
+*
+* Each incoming sample extends per-channel prefix sums (sum x, sum x^2,
+* sum |x|, waveform length) and prefix counts (zero crossings, slope sign
+* changes). The features of any window ending at the newest sample are then
+* differences of two prefix rows, so every scale costs O(1) per channel no
+* matter how long it is.
+*
+* Features per scale and channel, in this order (EMG_MS_N_FEATURES):
+*     MAV, RMS, WL, ZC, SSC, VAR
+* Output layout is [scale][channel][feature]. They match the numpy
+* definitions in emg_features.py on the last `window` samples.
+*
+* Prefix rows are rebased whenever the history ring wraps, so the sums stay
+* small and differences keep full precision over long sessions.
+*******************************************************************************/
+
+#ifndef EMG_MULTISCALE_H
+#define EMG_MULTISCALE_H
+
+#include "q8native.h"
+
+#define EMG_MS_MAX_SCALES   8
+#define EMG_MS_N_FEATURES   6
+
+typedef struct emg_multiscale emg_multiscale_t;
+
+// windows: n_scales window lengths in samples (any order, each >= 2)
+emg_multiscale_t *emg_multiscale_create(int n_channels, const int *windows, int n_scales);
+void emg_multiscale_destroy(emg_multiscale_t *m);
+void emg_multiscale_reset(emg_multiscale_t *m);
+
+// Length of the feature vector: n_scales * n_channels * EMG_MS_N_FEATURES
+int emg_multiscale_num_features(const emg_multiscale_t *m);
+
+// Samples pushed since the last reset (saturates at INT32_MAX)
+int emg_multiscale_count(const emg_multiscale_t *m);
+
+// in is [n_samples][n_channels]
+void emg_multiscale_push(emg_multiscale_t *m, const double *in, int n_samples);
+
+// Features of the windows ending at the newest sample. Scales longer than
+// the samples pushed so far use all of them. Returns Q8_ERR_ARG before the
+// first sample.
+int emg_multiscale_features(const emg_multiscale_t *m, double *out);
+
+// reset + push + features for one stored window (training)
+int emg_multiscale_window(emg_multiscale_t *m, const double *in, int n_samples, double *out);
+
+#endif // EMG_MULTISCALE_H
@@ -0,0 +1,220 @@
+/*******************************************************************************
+* emg_quality - streaming per-channel signal quality (electrode health)
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_quality.h"
+
+static const double LINE_HZ[EMG_QUALITY_N_LINE] = { 50.0, 60.0 };
+
+struct emg_quality {
+    emg_quality_config_t cfg;
+    double coeff[EMG_QUALITY_N_LINE];      // Goertzel 2 cos(w)
+    double diff_gain[EMG_QUALITY_N_LINE];  // |1 - e^-jw| of the first difference
+    double *hann;                           // [block]
+    double drift_alpha;
+
+    // Block in progress, per channel
+    int n;                                  // samples so far
+    double offset[Q8_MAX_CHANNELS];         // previous block's mean
+    double sum[Q8_MAX_CHANNELS];
+    double sum_sq[Q8_MAX_CHANNELS];
+    double s1[EMG_QUALITY_N_LINE][Q8_MAX_CHANNELS];
+    double s2[EMG_QUALITY_N_LINE][Q8_MAX_CHANNELS];
+    int railed[Q8_MAX_CHANNELS];
+    double prev[Q8_MAX_CHANNELS];           // last sample
+
+    int have_baseline;
+    uint32_t history[EMG_QUALITY_HISTORY][Q8_MAX_CHANNELS];
+    emg_quality_state_t st;
+};
+
+emg_quality_t *emg_quality_create(const emg_quality_config_t *cfg)
+{
+    if (!cfg || cfg->n_channels < 1 || cfg->n_channels > Q8_MAX_CHANNELS || !(cfg->fs > 0.0)
+        || cfg->block < 2 || !(cfg->rail_counts > 0.0) || cfg->drift_tau_s < 0.0)
+        return NULL;
+
+    emg_quality_t *q = calloc(1, sizeof(*q));
+    if (!q)
+        return NULL;
+    q->cfg = *cfg;
+    q->hann = malloc(cfg->block * sizeof(double));
+    if (!q->hann) {
+        free(q);
+        return NULL;
+    }
+    // Periodic Hann: zero response two bins off, so 50 and 60 Hz stay apart
+    for (int i = 0; i < cfg->block; ++i)
+        q->hann[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / cfg->block);
+    for (int f = 0; f < EMG_QUALITY_N_LINE; ++f) {
+        const double w = 2.0 * M_PI * LINE_HZ[f] / cfg->fs;
+        q->coeff[f] = 2.0 * cos(w);
+        q->diff_gain[f] = 2.0 * sin(0.5 * w);
+    }
+    const double block_s = cfg->block / cfg->fs;
+    q->drift_alpha = cfg->drift_tau_s > 0.0 ? 1.0 - exp(-block_s / cfg->drift_tau_s) : 1.0;
+    return q;
+}
+
+void emg_quality_destroy(emg_quality_t *q)
+{
+    if (!q)
+        return;
+    free(q->hann);
+    free(q);
+}
+
+void emg_quality_reset(emg_quality_t *q)
+{
+    if (!q)
+        return;
+    q->n = 0;
+    q->have_baseline = 0;
+    memset(q->sum, 0, sizeof(q->sum));
+    memset(q->sum_sq, 0, sizeof(q->sum_sq));
+    memset(q->s1, 0, sizeof(q->s1));
+    memset(q->s2, 0, sizeof(q->s2));
+    memset(q->railed, 0, sizeof(q->railed));
+    memset(q->history, 0, sizeof(q->history));
+    memset(&q->st, 0, sizeof(q->st));
+}
+
+// Judge the block that just filled up and start the next one
+static void end_block(emg_quality_t *q)
+{
+    const int n_ch = q->cfg.n_channels;
+    const double N = q->n;
+    const double block_s = N / q->cfg.fs;
+    emg_quality_state_t *st = &q->st;
+    uint32_t *hist = q->history[st->blocks & (EMG_QUALITY_HISTORY - 1)];
+
+    for (int ch = 0; ch < n_ch; ++ch) {
+        const double mean = q->sum[ch] / N;
+        const double var = q->sum_sq[ch] / N - mean * mean;
+        const double baseline = q->offset[ch] + mean;
+        uint32_t flags = 0;
+
+        st->rms[ch] = var > 0.0 ? sqrt(var) : 0.0;
+        if (st->rms[ch] < q->cfg.flat_rms_min)
+            flags |= EMG_Q_FLAT;
+
+        // |X(f)|^2 from the Goertzel state. A sinusoid of RMS r, differenced
+        // (gain g) and Hann-windowed (coherent gain 1/2), gives
+        // |X| = r g N / (2 sqrt(2))
+        for (int f = 0; f < EMG_QUALITY_N_LINE; ++f) {
+            const double s1 = q->s1[f][ch], s2 = q->s2[f][ch];
+            const double power = s1 * s1 + s2 * s2 - q->coeff[f] * s1 * s2;
+            st->line_rms[ch][f] = power > 0.0 ? 2.0 * sqrt(2.0 * power) / (q->diff_gain[f] * N) : 0.0;
+            if (st->line_rms[ch][f] > q->cfg.line_rms_max)
+                flags |= EMG_Q_LINE;
+            q->s1[f][ch] = q->s2[f][ch] = 0.0;
+        }
+
+        if (q->have_baseline) {
+            const double slope = (baseline - st->baseline[ch]) / block_s;
+            st->drift[ch] += q->drift_alpha * (slope - st->drift[ch]);
+            if (fabs(st->drift[ch]) > q->cfg.drift_max)
+                flags |= EMG_Q_DRIFT;
+        }
+        st->baseline[ch] = baseline;
+
+        st->saturated[ch] = q->railed[ch] / N;
+        if (q->railed[ch])
+            flags |= EMG_Q_SATURATED;
+
+        st->flags[ch] = flags;
+        hist[ch] = flags;
+        if (flags)
+            st->bad_blocks[ch]++;
+
+        q->offset[ch] = baseline;
+        q->sum[ch] = q->sum_sq[ch] = 0.0;
+        q->railed[ch] = 0;
+    }
+    q->have_baseline = 1;
+    q->n = 0;
+    st->blocks++;
+}
+
+int emg_quality_push(emg_quality_t *q, const double *in, int n_samples)
+{
+    if (!q || (!in && n_samples > 0) || n_samples < 0)
+        return Q8_ERR_ARG;
+
+    const int n_ch = q->cfg.n_channels;
+    const double rail = q->cfg.rail_counts;
+    const uint64_t blocks0 = q->st.blocks;
+
+    for (int i = 0; i < n_samples; ++i) {
+        const double *x = in + (size_t)i * n_ch;
+        if (q->st.samples++ == 0)
+            for (int ch = 0; ch < n_ch; ++ch)
+                q->offset[ch] = q->prev[ch] = x[ch];
+
+        const double w = q->hann[q->n];
+        for (int ch = 0; ch < n_ch; ++ch) {
+            const double d = x[ch] - q->offset[ch];
+            q->sum[ch] += d;
+            q->sum_sq[ch] += d * d;
+            q->railed[ch] += fabs(x[ch]) >= rail;
+            // Line noise on the windowed first difference: baseline wander
+            // is attenuated and a ramp becomes a constant, which leaves the
+            // line bins untouched
+            const double e = w * (x[ch] - q->prev[ch]);
+            q->prev[ch] = x[ch];
+            for (int f = 0; f < EMG_QUALITY_N_LINE; ++f) {
+                const double s = e + q->coeff[f] * q->s1[f][ch] - q->s2[f][ch];
+                q->s2[f][ch] = q->s1[f][ch];
+                q->s1[f][ch] = s;
+            }
+        }
+        if (++q->n == q->cfg.block)
+            end_block(q);
+    }
+    return (int)(q->st.blocks - blocks0);
+}
+
+uint32_t emg_quality_window_flags(const emg_quality_t *q, int n_samples, uint32_t *per_channel)
+{
+    if (!q)
+        return 0;
+    const int n_ch = q->cfg.n_channels;
+    uint32_t ch_flags[Q8_MAX_CHANNELS] = { 0 };
+
+    // The block in progress: only saturation is known yet
+    for (int ch = 0; ch < n_ch; ++ch)
+        if (q->railed[ch])
+            ch_flags[ch] |= EMG_Q_SATURATED;
+
+    // Complete blocks reaching into the window
+    uint64_t back = 0;
+    if (n_samples > q->n)
+        back = (n_samples - q->n + q->cfg.block - 1) / q->cfg.block;
+    if (back > q->st.blocks)
+        back = q->st.blocks;
+    if (back > EMG_QUALITY_HISTORY)
+        back = EMG_QUALITY_HISTORY;
+    for (uint64_t b = q->st.blocks - back; b < q->st.blocks; ++b)
+        for (int ch = 0; ch < n_ch; ++ch)
+            ch_flags[ch] |= q->history[b & (EMG_QUALITY_HISTORY - 1)][ch];
+
+    uint32_t all = 0;
+    for (int ch = 0; ch < n_ch; ++ch) {
+        all |= ch_flags[ch];
+        if (per_channel)
+            per_channel[ch] = ch_flags[ch];
+    }
+    return all;
+}
+
+int emg_quality_get(const emg_quality_t *q, emg_quality_state_t *out)
+{
+    if (!q || !out)
+        return Q8_ERR_ARG;
+    *out = q->st;
+    return Q8_OK;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************
+* emg_quality - streaming per-channel signal quality (electrode health)
+*
+* Runs on the raw ADC counts as they are acquired, O(1) per sample and
+* channel, and judges every channel once per block of `block` samples:
+*
+*     EMG_Q_SATURATED  a sample reached the rails (|x| >= rail_counts, the
+*                      24-bit ADC tops out at +-2^23): electrode off or
+*                      amplifier overdriven
+*     EMG_Q_LINE       the 50 or 60 Hz component is above line_rms_max:
+*                      poor contact picks up mains. Goertzel over the
+*                      Hann-windowed first difference of the block, so
+*                      the slow baseline wander of raw counts does not leak
+*                      into the line bins
+*     EMG_Q_FLAT       RMS about the block mean below flat_rms_min: stuck or
+*                      disconnected input
+*     EMG_Q_DRIFT      the block mean moves faster than drift_max counts/s
+*                      (slope smoothed over drift_tau_s): electrode settling
+*                      or moving
+*
+* Sums are taken relative to the previous block's mean, so the large DC
+* offset of raw counts costs no precision. Pick block as a whole number of
+* cycles of both line frequencies (a multiple of 25 samples at 250 Hz) so
+* each falls on a bin; longer blocks also let less broadband EMG into them.
+*
+* The flags of the last EMG_QUALITY_HISTORY blocks are kept, so a caller can
+* ask whether the window it is about to classify or save overlapped a bad
+* block (saturation is also reported for the block still in progress).
+*******************************************************************************/
+
+#ifndef EMG_QUALITY_H
+#define EMG_QUALITY_H
+
+#include "q8native.h"
+
+#define EMG_Q_SATURATED     0x1
+#define EMG_Q_LINE          0x2
+#define EMG_Q_FLAT          0x4
+#define EMG_Q_DRIFT         0x8
+
+#define EMG_QUALITY_HISTORY 64     // blocks of flags kept (a power of 2)
+#define EMG_QUALITY_N_LINE  2      // 50 Hz, 60 Hz
+
+typedef struct {
+    int    n_channels;
+    double fs;                     // sample rate (Hz)
+    int    block;                  // samples per judgement
+    double rail_counts;            // saturation level (counts)
+    double line_rms_max;           // counts RMS
+    double flat_rms_min;           // counts RMS
+    double drift_max;              // counts/s
+    double drift_tau_s;
+} emg_quality_config_t;
+
+typedef struct {
+    // Of the last complete block, per channel
+    double   rms[Q8_MAX_CHANNELS];                       // about the block mean
+    double   line_rms[Q8_MAX_CHANNELS][EMG_QUALITY_N_LINE];
+    double   baseline[Q8_MAX_CHANNELS];                  // block mean
+    double   drift[Q8_MAX_CHANNELS];                     // smoothed slope (counts/s)
+    double   saturated[Q8_MAX_CHANNELS];                 // fraction of samples at the rails
+    uint32_t flags[Q8_MAX_CHANNELS];
+    uint64_t bad_blocks[Q8_MAX_CHANNELS];                // blocks with any flag
+    uint64_t samples;
+    uint64_t blocks;
+} emg_quality_state_t;
+
+typedef struct emg_quality emg_quality_t;
+
+emg_quality_t *emg_quality_create(const emg_quality_config_t *cfg);
+void emg_quality_destroy(emg_quality_t *q);
+void emg_quality_reset(emg_quality_t *q);
+
+// in: [n_samples][n_channels] raw counts. Returns the blocks completed.
+int emg_quality_push(emg_quality_t *q, const double *in, int n_samples);
+
+// Flags of the blocks that overlap the last n_samples (and the one in
+// progress), OR-ed over channels; per channel into per_channel if not NULL
+uint32_t emg_quality_window_flags(const emg_quality_t *q, int n_samples, uint32_t *per_channel);
+
+int emg_quality_get(const emg_quality_t *q, emg_quality_state_t *out);
+
+#endif // EMG_QUALITY_H
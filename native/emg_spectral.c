@@ -0,0 +1,255 @@
+/*******************************************************************************
+* emg_spectral - frequency-domain EMG features from a sliding DFT
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emg_spectral.h"
+
+#define N_VEC (Q8_MAX_CHANNELS / Q8_LANES)
+
+struct emg_spectral {
+    q8_vec_t ref[N_VEC];     // first sample after reset
+    q8_vec_t *hist;          // [window][n_vec] x - ref, slot t % window = sample t
+    q8_vec_t *re;            // [n_bins][n_vec] bins 0 .. window/2 + 1
+    q8_vec_t *im;
+    q8_vec_t *tw_re;         // [n_bins] e^(j 2 pi k / window), broadcast
+    q8_vec_t *tw_im;
+    double *cos_tab;         // [window] cos / sin(2 pi j / window), for resync
+    double *sin_tab;
+    int64_t t;               // samples pushed since reset
+
+    int window;
+    int n_bins;
+    int n_channels;
+    int n_vec;
+    double fs;
+    int n_bands;
+    int *band_of;            // [n_bins] band of bin k, -1 outside all bands
+};
+
+emg_spectral_t *emg_spectral_create(int n_channels, int window, double fs,
+                                    const double *band_edges, int n_bands)
+{
+    if (n_channels < 1 || n_channels > Q8_MAX_CHANNELS || window < 4 || !(fs > 0.0))
+        return NULL;
+    if (n_bands < 1 || n_bands > EMG_SP_MAX_BANDS || !band_edges)
+        return NULL;
+    for (int b = 0; b < n_bands; ++b)
+        if (!(band_edges[b] < band_edges[b + 1]))
+            return NULL;
+
+    emg_spectral_t *s = NULL;
+    if (posix_memalign((void **)&s, sizeof(q8_vec_t), sizeof(*s)) != 0)
+        return NULL;
+    memset(s, 0, sizeof(*s));
+
+    s->window = window;
+    s->n_bins = window / 2 + 2;
+    s->n_channels = n_channels;
+    s->n_vec = Q8_PAD_CHANNELS(n_channels) / Q8_LANES;
+    s->fs = fs;
+    s->n_bands = n_bands;
+
+    const size_t bins = (size_t)s->n_bins * s->n_vec * sizeof(q8_vec_t);
+    if (posix_memalign((void **)&s->hist, sizeof(q8_vec_t), (size_t)window * s->n_vec * sizeof(q8_vec_t)) != 0
+        || posix_memalign((void **)&s->re, sizeof(q8_vec_t), bins) != 0
+        || posix_memalign((void **)&s->im, sizeof(q8_vec_t), bins) != 0
+        || posix_memalign((void **)&s->tw_re, sizeof(q8_vec_t), s->n_bins * sizeof(q8_vec_t)) != 0
+        || posix_memalign((void **)&s->tw_im, sizeof(q8_vec_t), s->n_bins * sizeof(q8_vec_t)) != 0
+        || !(s->cos_tab = malloc(window * sizeof(double)))
+        || !(s->sin_tab = malloc(window * sizeof(double)))
+        || !(s->band_of = malloc(s->n_bins * sizeof(int)))) {
+        emg_spectral_destroy(s);
+        return NULL;
+    }
+
+    for (int j = 0; j < window; ++j) {
+        s->cos_tab[j] = cos(2.0 * M_PI * j / window);
+        s->sin_tab[j] = sin(2.0 * M_PI * j / window);
+    }
+    for (int k = 0; k < s->n_bins; ++k) {
+        const int j = k % window;
+        s->tw_re[k] = (q8_vec_t){0} + s->cos_tab[j];
+        s->tw_im[k] = (q8_vec_t){0} + s->sin_tab[j];
+
+        // Same comparisons as emg_features.py on f_k = k fs / window
+        const double f = k * fs / window;
+        s->band_of[k] = -1;
+        for (int b = 0; b < n_bands; ++b)
+            if (band_edges[b] <= f && (f < band_edges[b + 1] || (b == n_bands - 1 && f <= band_edges[b + 1])))
+                s->band_of[k] = b;
+    }
+    emg_spectral_reset(s);
+    return s;
+}
+
+void emg_spectral_destroy(emg_spectral_t *s)
+{
+    if (!s)
+        return;
+    free(s->hist);
+    free(s->re);
+    free(s->im);
+    free(s->tw_re);
+    free(s->tw_im);
+    free(s->cos_tab);
+    free(s->sin_tab);
+    free(s->band_of);
+    free(s);
+}
+
+void emg_spectral_reset(emg_spectral_t *s)
+{
+    if (!s)
+        return;
+    const size_t bins = (size_t)s->n_bins * s->n_vec * sizeof(q8_vec_t);
+    memset(s->ref, 0, sizeof(s->ref));
+    memset(s->hist, 0, (size_t)s->window * s->n_vec * sizeof(q8_vec_t));
+    memset(s->re, 0, bins);
+    memset(s->im, 0, bins);
+    s->t = 0;
+}
+
+int emg_spectral_num_features(const emg_spectral_t *s)
+{
+    return s ? s->n_channels * (2 + s->n_bands) : 0;
+}
+
+int emg_spectral_count(const emg_spectral_t *s)
+{
+    if (!s)
+        return 0;
+    return s->t > INT32_MAX ? INT32_MAX : (int)s->t;
+}
+
+// The bins straight from the history, X_k = sum_m h_m e^(-j 2 pi k m / N)
+// with m = 0 the oldest sample
+static void resync(emg_spectral_t *s)
+{
+    const int N = s->window;
+    const int nv = s->n_vec;
+    const int oldest = (int)(s->t % N);
+
+    for (int k = 0; k < s->n_bins; ++k) {
+        for (int v = 0; v < nv; ++v) {
+            q8_vec_t re = {0}, im = {0};
+            int j = 0;                                  // k m mod N
+            for (int m = 0; m < N; ++m) {
+                const q8_vec_t h = s->hist[(size_t)((oldest + m) % N) * nv + v];
+                re += h * s->cos_tab[j];
+                im -= h * s->sin_tab[j];
+                j = (j + k) % N;
+            }
+            s->re[(size_t)k * nv + v] = re;
+            s->im[(size_t)k * nv + v] = im;
+        }
+    }
+}
+
+void emg_spectral_push(emg_spectral_t *s, const double *in, int n_samples)
+{
+    if (!s || !in)
+        return;
+
+    const int nch = s->n_channels;
+    const int nv = s->n_vec;
+    q8_vec_t x[N_VEC];
+    memset(x, 0, sizeof(x));
+
+    for (int n = 0; n < n_samples; ++n) {
+        memcpy(x, &in[n * nch], nch * sizeof(double));
+        if (s->t == 0)
+            memcpy(s->ref, x, sizeof(x));
+
+        q8_vec_t *slot = &s->hist[(size_t)(s->t % s->window) * nv];
+        q8_vec_t d[N_VEC];
+        for (int v = 0; v < nv; ++v) {
+            const q8_vec_t h = x[v] - s->ref[v];
+            d[v] = h - slot[v];
+            slot[v] = h;
+        }
+        for (int k = 0; k < s->n_bins; ++k) {
+            const q8_vec_t c = s->tw_re[k], sn = s->tw_im[k];
+            q8_vec_t *re = &s->re[(size_t)k * nv], *im = &s->im[(size_t)k * nv];
+            for (int v = 0; v < nv; ++v) {
+                const q8_vec_t a = re[v] + d[v];
+                re[v] = a * c - im[v] * sn;
+                im[v] = a * sn + im[v] * c;
+            }
+        }
+        s->t++;
+
+        if (s->t % ((int64_t)s->window * EMG_SP_RESYNC) == 0)
+            resync(s);
+    }
+}
+
+int emg_spectral_features(const emg_spectral_t *s, double *out)
+{
+    if (!s || !out || s->t == 0)
+        return Q8_ERR_ARG;
+
+    const int nch = s->n_channels;
+    const int nv4 = s->n_vec * Q8_LANES;
+    const int K = s->window / 2;
+    const double df = s->fs / s->window;
+    const int n_feat = 2 + s->n_bands;
+    const double *re = (const double *)s->re;
+    const double *im = (const double *)s->im;
+    double power[K + 1];
+
+    for (int c = 0; c < nch; ++c) {
+        double *f = &out[c * n_feat];
+        double total = 0.0, moment = 0.0;
+        double band[EMG_SP_MAX_BANDS] = { 0 };
+
+        // Mean removed (X_0 = 0) and Hann-windowed on the bins
+#define BIN(a, k) ((k) > 0 ? (a)[(size_t)(k) * nv4 + c] : 0.0)
+        for (int k = 1; k <= K; ++k) {
+            const double yr = 0.5 * BIN(re, k) - 0.25 * (BIN(re, k - 1) + BIN(re, k + 1));
+            const double yi = 0.5 * BIN(im, k) - 0.25 * (BIN(im, k - 1) + BIN(im, k + 1));
+            const double p = s->band_of[k] >= 0 ? yr * yr + yi * yi : 0.0;
+            power[k] = p;
+            total += p;
+            moment += k * s->fs / s->window * p;
+            if (s->band_of[k] >= 0)
+                band[s->band_of[k]] += p;
+        }
+#undef BIN
+
+        memset(f, 0, n_feat * sizeof(double));
+        if (!(total > 0.0))
+            continue;
+
+        f[0] = moment / total;                          // MNF
+        const double half = 0.5 * total;
+        double cum = 0.0;
+        for (int k = 1; k <= K; ++k) {
+            cum += power[k];
+            if (cum >= half) {                          // MDF
+                f[1] = k * s->fs / s->window + 0.5 * df - df * (cum - half) / power[k];
+                break;
+            }
+        }
+        for (int b = 0; b < s->n_bands; ++b)
+            f[2 + b] = band[b] / total;
+    }
+    return Q8_OK;
+}
+
+int emg_spectral_window(emg_spectral_t *s, const double *in, int n_samples, double *out)
+{
+    if (!s || !in || !out || n_samples < 1)
+        return Q8_ERR_ARG;
+    emg_spectral_reset(s);
+    if (n_samples > s->window) {
+        // Only the last window samples are in the spectrum
+        in += (size_t)(n_samples - s->window) * s->n_channels;
+        n_samples = s->window;
+    }
+    emg_spectral_push(s, in, n_samples);
+    return emg_spectral_features(s, out);
+}
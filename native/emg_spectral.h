@@ -0,0 +1,66 @@
+/*******************************************************************************
+* emg_spectral - frequency-domain EMG features from a sliding DFT
+*
+* Keeps the DFT of the last `window` samples of every channel up to date one
+* sample at a time: with the oldest sample x_old leaving and x_new entering,
+* each bin k is updated as
+*
+*     X_k <- (X_k + x_new - x_old) e^(j 2 pi k / window)
+*
+* which is O(window / 2) per sample and channel instead of an FFT per
+* decision. Features are read from the bins at any time:
+*
+*     MNF   mean frequency, sum f_k P_k / sum P_k
+*     MDF   median frequency, where the cumulative power reaches half (the
+*           power of bin k taken as spread evenly over f_k +- df / 2)
+*     BP_b  fraction of the power between band_edges[b] and band_edges[b+1]
+*           (Hz, the last band includes its upper edge), one per band
+*
+* per channel, layout [channel][feature]. P_k = |Y_k|^2 for k = 1 .. window/2
+* is the periodogram of the window with its mean removed and a periodic Hann
+* window applied, both done on the bins (Y_k = X_k / 2 - (X_k-1 + X_k+1) / 4
+* with X_0 = 0), so slow baseline wander does not leak across the spectrum.
+* Only bins inside the bands count, for MNF and MDF as well: motion and
+* baseline wander below the first edge would otherwise dominate raw counts.
+* A channel without power in the bands gives zeros.
+*
+* Until `window` samples have been pushed the window is padded at the front
+* with the first sample, as if the signal had held that value before. Inputs
+* are taken relative to the first sample so the DC offset of raw counts does
+* not enter the bins, and the bins are recomputed from the sample history
+* every EMG_SP_RESYNC windows to stop rounding from accumulating.
+*******************************************************************************/
+
+#ifndef EMG_SPECTRAL_H
+#define EMG_SPECTRAL_H
+
+#include "q8native.h"
+
+#define EMG_SP_MAX_BANDS    8
+#define EMG_SP_RESYNC       64     // windows between exact recomputations
+
+typedef struct emg_spectral emg_spectral_t;
+
+// band_edges: n_bands + 1 (>= 2) increasing frequencies (Hz); window >= 4
+emg_spectral_t *emg_spectral_create(int n_channels, int window, double fs,
+                                    const double *band_edges, int n_bands);
+void emg_spectral_destroy(emg_spectral_t *s);
+void emg_spectral_reset(emg_spectral_t *s);
+
+// Length of the feature vector: n_channels * (2 + n_bands)
+int emg_spectral_num_features(const emg_spectral_t *s);
+
+// Samples pushed since the last reset (saturates at INT32_MAX)
+int emg_spectral_count(const emg_spectral_t *s);
+
+// in is [n_samples][n_channels]
+void emg_spectral_push(emg_spectral_t *s, const double *in, int n_samples);
+
+// Features of the window ending at the newest sample. Returns Q8_ERR_ARG
+// before the first sample.
+int emg_spectral_features(const emg_spectral_t *s, double *out);
+
+// reset + push (the last `window` samples) + features for one stored window
+int emg_spectral_window(emg_spectral_t *s, const double *in, int n_samples, double *out);
+
+#endif // EMG_SPECTRAL_H
@@ -0,0 +1,611 @@
+/*******************************************************************************
+* gesture_link - gesture messages from the wristband host to the robot
+*
+* Plain non-blocking datagram sockets. Neither side connects: the publisher
+* sends to the configured address and answers pings at whatever address
+* they came from; the subscriber pings the address of the last gesture it
+* received. A Unix publisher autobinds an abstract name so it can be
+* answered. The wire format is packed byte by byte (little endian), so it
+* does not depend on struct layout or host byte order.
+*
+* Receive times are the kernel's arrival stamps (SO_TIMESTAMPNS, moved from
+* CLOCK_REALTIME onto CLOCK_MONOTONIC), not the time the loop got round to
+* reading: a publisher that answers pings between decisions would
+* otherwise add its loop delay to every round trip and half of it to the
+* offset.
+*
+* Local times come from q8_clock, so in virtual time (simulations) the link
+* stamps with the simulated clock and arrivals are the time of the read.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gesture_link.h"
+#include "q8_clock.h"
+#include "q8_trace.h"
+
+#define MAX_DRAIN   64      // datagrams handled per service / poll call
+
+_Static_assert(sizeof(gl_gesture_t) == 56, "gl_gesture_t layout is shared with q8native.py");
+
+typedef struct {
+    struct sockaddr_storage sa;
+    socklen_t len;
+} gl_addr_t;
+
+typedef struct {
+    uint8_t  type;
+    uint32_t seq;
+    int64_t  t_a, t_b, t_c;   // see gesture_link.h for each message type
+    uint8_t  gesture;
+    uint8_t  confidence;
+} gl_wire_t;
+
+struct gesture_pub {
+    int fd;
+    gl_addr_t dest;
+    uint32_t seq;
+    gl_pub_stats_t stats;
+};
+
+struct gesture_sub {
+    int fd;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];   // bound file, unlinked on destroy
+    int ping_ms;
+
+    // Publisher we last heard from
+    gl_addr_t peer;
+    int have_peer;
+    uint32_t last_seq;
+    int have_seq;
+
+    // Clock sync: (offset, rtt) of the latest pongs
+    uint32_t ping_seq;
+    int64_t next_ping_ns;
+    int64_t sync_offset[GL_SYNC_WINDOW];
+    int64_t sync_rtt[GL_SYNC_WINDOW];
+    int n_sync, sync_idx;
+
+    int trace_link;              // q8_trace name: sent -> arrived, local clock
+    gl_sub_stats_t stats;
+};
+
+static int64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t now_ns(void)
+{
+    return q8_clock_now_ns();
+}
+
+// ----------------------------------------------------------------------------
+// Wire format
+// ----------------------------------------------------------------------------
+static void put_le(uint8_t *p, uint64_t v, int n)
+{
+    for (int i = 0; i < n; ++i)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static void pack(const gl_wire_t *m, uint8_t *p)
+{
+    memset(p, 0, GL_MSG_BYTES);
+    put_le(&p[0], GL_MAGIC, 2);
+    p[2] = GL_VERSION;
+    p[3] = m->type;
+    put_le(&p[4], m->seq, 4);
+    put_le(&p[8], (uint64_t)m->t_a, 8);
+    put_le(&p[16], (uint64_t)m->t_b, 8);
+    put_le(&p[24], (uint64_t)m->t_c, 8);
+    p[32] = m->gesture;
+    p[33] = m->confidence;
+}
+
+static int unpack(const uint8_t *p, ssize_t n, gl_wire_t *m)
+{
+    if (n != GL_MSG_BYTES || get_le(&p[0], 2) != GL_MAGIC || p[2] != GL_VERSION)
+        return Q8_ERR_ARG;
+    m->type = p[3];
+    m->seq = (uint32_t)get_le(&p[4], 4);
+    m->t_a = (int64_t)get_le(&p[8], 8);
+    m->t_b = (int64_t)get_le(&p[16], 8);
+    m->t_c = (int64_t)get_le(&p[24], 8);
+    m->gesture = p[32];
+    m->confidence = p[33];
+    return Q8_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Addresses and sockets
+// ----------------------------------------------------------------------------
+
+// "udp:HOST:PORT" or "unix:PATH" / "unix:@abstract". An empty UDP host is
+// INADDR_ANY when binding, localhost when sending.
+static int parse_addr(const char *spec, int bind_side, gl_addr_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+        const char *path = spec + 5;
+        struct sockaddr_un *un = (struct sockaddr_un *)&out->sa;
+        size_t n = strlen(path);
+        if (n == 0 || n >= sizeof(un->sun_path))
+            return Q8_ERR_ARG;
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, path, n);
+        if (path[0] == '@') {
+            un->sun_path[0] = '\0';
+            out->len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + n);
+        } else {
+            out->len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + n + 1);
+        }
+        return Q8_OK;
+    }
+
+    if (strncmp(spec, "udp:", 4) != 0)
+        return Q8_ERR_ARG;
+    const char *host = spec + 4;
+    const char *colon = strrchr(host, ':');
+    if (!colon)
+        return Q8_ERR_ARG;
+    char *end;
+    long port = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || port < 1 || port > 65535)
+        return Q8_ERR_ARG;
+
+    struct sockaddr_in *in = (struct sockaddr_in *)&out->sa;
+    in->sin_family = AF_INET;
+    in->sin_port = htons((uint16_t)port);
+    out->len = sizeof(*in);
+
+    size_t host_len = (size_t)(colon - host);
+    if (host_len == 0) {
+        in->sin_addr.s_addr = htonl(bind_side ? INADDR_ANY : INADDR_LOOPBACK);
+        return Q8_OK;
+    }
+
+    char name[256];
+    if (host_len >= sizeof(name))
+        return Q8_ERR_ARG;
+    memcpy(name, host, host_len);
+    name[host_len] = '\0';
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(name, NULL, &hints, &res) != 0 || !res)
+        return Q8_ERR_ARG;
+    in->sin_addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return Q8_OK;
+}
+
+static int open_socket(const gl_addr_t *a)
+{
+    int family = a->sa.ss_family;
+    int fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+
+    // Best effort: ahead of bulk traffic in the qdisc and on the wire
+    int prio = 6;
+    setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &prio, sizeof(prio));
+    if (family == AF_INET) {
+        int tos = IPTOS_LOWDELAY;
+        setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    }
+    return fd;
+}
+
+// One datagram, non-blocking. *t_arrival is when the kernel received it
+// (q8_clock), or now if the stamp is missing.
+static ssize_t recv_msg(int fd, uint8_t *buf, size_t cap, gl_addr_t *from, int64_t *t_arrival)
+{
+    union {
+        char buf[CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } ctrl;
+    struct iovec iov = { buf, cap };
+    struct msghdr msg = {
+        .msg_name = &from->sa, .msg_namelen = sizeof(from->sa),
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctrl.buf, .msg_controllen = sizeof(ctrl.buf),
+    };
+    ssize_t n = recvmsg(fd, &msg, MSG_DONTWAIT);
+    if (n < 0)
+        return n;
+    from->len = msg.msg_namelen;
+
+    int64_t mono = now_ns();
+    *t_arrival = mono;
+    // A kernel stamp says nothing about virtual time
+    if (q8_clock_is_virtual())
+        return n;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            int64_t age = clock_ns(CLOCK_REALTIME) - ((int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+            if (age > 0)
+                *t_arrival = mono - age;
+        }
+    }
+    return n;
+}
+
+static int send_msg(int fd, const gl_wire_t *m, const gl_addr_t *to)
+{
+    uint8_t buf[GL_MSG_BYTES];
+    pack(m, buf);
+    ssize_t n = sendto(fd, buf, sizeof(buf), MSG_NOSIGNAL, (const struct sockaddr *)&to->sa, to->len);
+    return n == (ssize_t)sizeof(buf) ? Q8_OK : Q8_ERR_IO;
+}
+
+// ----------------------------------------------------------------------------
+// Publisher
+// ----------------------------------------------------------------------------
+gesture_pub_t *gesture_pub_create(const char *addr)
+{
+    if (!addr) {
+        errno = EINVAL;
+        return NULL;
+    }
+    gesture_pub_t *p = calloc(1, sizeof(*p));
+    if (!p)
+        return NULL;
+    p->fd = -1;
+
+    if (parse_addr(addr, 0, &p->dest) != Q8_OK) {
+        errno = EINVAL;
+        goto fail;
+    }
+    p->fd = open_socket(&p->dest);
+    if (p->fd < 0)
+        goto fail;
+    if (p->dest.sa.ss_family == AF_UNIX) {
+        // Autobind to an abstract name so the subscriber's pongs reach us
+        sa_family_t family = AF_UNIX;
+        if (bind(p->fd, (struct sockaddr *)&family, sizeof(family)) != 0)
+            goto fail;
+    }
+    return p;
+
+fail:;
+    int err = errno;
+    gesture_pub_destroy(p);
+    errno = err;
+    return NULL;
+}
+
+void gesture_pub_destroy(gesture_pub_t *p)
+{
+    if (!p)
+        return;
+    if (p->fd >= 0)
+        close(p->fd);
+    free(p);
+}
+
+int gesture_pub_service(gesture_pub_t *p)
+{
+    if (!p)
+        return Q8_ERR_ARG;
+
+    int answered = 0;
+    for (int i = 0; i < MAX_DRAIN; ++i) {
+        uint8_t buf[GL_MSG_BYTES + 1];
+        gl_addr_t from;
+        int64_t t_recv;
+        ssize_t n = recv_msg(p->fd, buf, sizeof(buf), &from, &t_recv);
+        if (n < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED)
+                continue;
+            break;
+        }
+
+        gl_wire_t m;
+        if (unpack(buf, n, &m) != Q8_OK || m.type != GL_MSG_PING) {
+            p->stats.bad++;
+            continue;
+        }
+        gl_wire_t pong = { .type = GL_MSG_PONG, .seq = m.seq, .t_a = m.t_a, .t_b = t_recv };
+        pong.t_c = now_ns();
+        if (send_msg(p->fd, &pong, &from) == Q8_OK) {
+            p->stats.pings++;
+            answered++;
+        }
+    }
+    return answered;
+}
+
+int gesture_pub_send(gesture_pub_t *p, int gesture, float confidence, int64_t t_capture_ns,
+                     uint64_t trace_id)
+{
+    if (!p || gesture < 0 || gesture >= GL_GESTURE_COUNT)
+        return Q8_ERR_ARG;
+    gesture_pub_service(p);
+
+    if (confidence < 0.0f)
+        confidence = 0.0f;
+    if (confidence > 1.0f)
+        confidence = 1.0f;
+    gl_wire_t m = {
+        .type = GL_MSG_GESTURE,
+        .seq = p->seq++,
+        .t_a = t_capture_ns,
+        .t_c = (int64_t)trace_id,
+        .gesture = (uint8_t)gesture,
+        .confidence = (uint8_t)(confidence * 255.0f + 0.5f),
+    };
+    m.t_b = now_ns();
+    if (send_msg(p->fd, &m, &p->dest) != Q8_OK) {
+        // No subscriber yet (ENOENT / ECONNREFUSED) or a full socket buffer
+        p->stats.send_errors++;
+        return Q8_ERR_IO;
+    }
+    p->stats.sent++;
+    return Q8_OK;
+}
+
+int gesture_pub_get_stats(const gesture_pub_t *p, gl_pub_stats_t *out)
+{
+    if (!p || !out)
+        return Q8_ERR_ARG;
+    *out = p->stats;
+    return Q8_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Subscriber
+// ----------------------------------------------------------------------------
+gesture_sub_t *gesture_sub_create(const char *addr, int ping_ms)
+{
+    if (!addr || ping_ms < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    gesture_sub_t *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->fd = -1;
+    s->ping_ms = ping_ms;
+    s->trace_link = q8_trace_name("link");
+
+    gl_addr_t local;
+    if (parse_addr(addr, 1, &local) != Q8_OK) {
+        errno = EINVAL;
+        goto fail;
+    }
+    s->fd = open_socket(&local);
+    if (s->fd < 0)
+        goto fail;
+
+    if (local.sa.ss_family == AF_UNIX) {
+        struct sockaddr_un *un = (struct sockaddr_un *)&local.sa;
+        if (un->sun_path[0] != '\0') {
+            // Replace a socket left behind by a previous run
+            struct stat st;
+            if (stat(un->sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+                unlink(un->sun_path);
+        }
+        if (bind(s->fd, (struct sockaddr *)&local.sa, local.len) != 0)
+            goto fail;
+        if (un->sun_path[0] != '\0')
+            strcpy(s->path, un->sun_path);
+    } else {
+        int one = 1;
+        setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(s->fd, (struct sockaddr *)&local.sa, local.len) != 0)
+            goto fail;
+    }
+    return s;
+
+fail:;
+    int err = errno;
+    gesture_sub_destroy(s);
+    errno = err;
+    return NULL;
+}
+
+void gesture_sub_destroy(gesture_sub_t *s)
+{
+    if (!s)
+        return;
+    if (s->fd >= 0)
+        close(s->fd);
+    if (s->path[0])
+        unlink(s->path);
+    free(s);
+}
+
+static void reset_sync(gesture_sub_t *s)
+{
+    s->n_sync = s->sync_idx = 0;
+    s->stats.synced = 0;
+    s->stats.offset_ns = s->stats.rtt_ns = 0;
+    s->next_ping_ns = 0;
+}
+
+// A different publisher (other host, restarted process) has its own clock
+// and sequence
+static void set_peer(gesture_sub_t *s, const gl_addr_t *from)
+{
+    if (s->have_peer && s->peer.len == from->len && memcmp(&s->peer.sa, &from->sa, from->len) == 0)
+        return;
+    if (s->have_peer)
+        s->stats.restarts++;
+    s->peer = *from;
+    s->have_peer = 1;
+    s->have_seq = 0;
+    reset_sync(s);
+}
+
+static void on_pong(gesture_sub_t *s, const gl_wire_t *m, int64_t t4)
+{
+    // t1 ping sent (local), t2 ping received / t3 pong sent (publisher)
+    int64_t t1 = m->t_a, t2 = m->t_b, t3 = m->t_c;
+    int64_t rtt = (t4 - t1) - (t3 - t2);
+    if ((int32_t)(m->seq - s->ping_seq) > 0 || rtt < 0 || t1 > t4) {
+        s->stats.bad++;
+        return;
+    }
+    s->stats.pongs++;
+
+    s->sync_offset[s->sync_idx] = ((t2 - t1) + (t3 - t4)) / 2;
+    s->sync_rtt[s->sync_idx] = rtt;
+    s->sync_idx = (s->sync_idx + 1) % GL_SYNC_WINDOW;
+    if (s->n_sync < GL_SYNC_WINDOW)
+        s->n_sync++;
+
+    // The fastest round trip had the least queueing on either leg
+    int best = 0;
+    for (int i = 1; i < s->n_sync; ++i)
+        if (s->sync_rtt[i] < s->sync_rtt[best])
+            best = i;
+    s->stats.offset_ns = s->sync_offset[best];
+    s->stats.rtt_ns = s->sync_rtt[best];
+    s->stats.synced = 1;
+}
+
+static void maybe_ping(gesture_sub_t *s)
+{
+    if (!s->ping_ms || !s->have_peer)
+        return;
+    int64_t t = now_ns();
+    if (t < s->next_ping_ns)
+        return;
+    gl_wire_t m = { .type = GL_MSG_PING, .seq = ++s->ping_seq, .t_a = t };
+    if (send_msg(s->fd, &m, &s->peer) == Q8_OK)
+        s->stats.pings++;
+    s->next_ping_ns = t + (int64_t)s->ping_ms * 1000000LL;
+}
+
+int gesture_sub_poll(gesture_sub_t *s, gl_gesture_t *out, int max, int timeout_ms)
+{
+    if (!s || (!out && max > 0) || max < 0)
+        return Q8_ERR_ARG;
+
+    maybe_ping(s);
+    if (timeout_ms != 0) {
+        struct pollfd pfd = { .fd = s->fd, .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR)
+            return Q8_ERR_IO;
+    }
+
+    int n = 0;
+    for (int i = 0; i < MAX_DRAIN && n < max; ++i) {
+        uint8_t buf[GL_MSG_BYTES + 1];
+        gl_addr_t from;
+        int64_t t_recv;
+        ssize_t len = recv_msg(s->fd, buf, sizeof(buf), &from, &t_recv);
+        if (len < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return Q8_ERR_IO;
+        }
+
+        gl_wire_t m;
+        if (unpack(buf, len, &m) != Q8_OK) {
+            s->stats.bad++;
+            continue;
+        }
+        if (m.type == GL_MSG_PONG) {
+            on_pong(s, &m, t_recv);
+            continue;
+        }
+        if (m.type != GL_MSG_GESTURE || m.gesture >= GL_GESTURE_COUNT) {
+            s->stats.bad++;
+            continue;
+        }
+
+        set_peer(s, &from);
+        if (s->have_seq) {
+            int32_t d = (int32_t)(m.seq - s->last_seq);
+            if (d <= 0 && -(int64_t)d < GL_SEQ_RESTART) {
+                s->stats.stale++;
+                continue;
+            }
+            if (d <= 0) {
+                // Same address, sequence started over
+                s->stats.restarts++;
+                reset_sync(s);
+            } else {
+                s->stats.lost += (uint64_t)(d - 1);
+            }
+        }
+        s->last_seq = m.seq;
+        s->have_seq = 1;
+
+        gl_gesture_t *g = &out[n++];
+        memset(g, 0, sizeof(*g));
+        g->seq = m.seq;
+        g->gesture = m.gesture;
+        g->confidence = m.confidence / 255.0f;
+        g->t_capture_ns = m.t_a;
+        g->t_send_ns = m.t_b;
+        g->t_recv_ns = t_recv;
+        g->latency_ns = s->stats.synced ? t_recv - gesture_sub_to_local(s, m.t_a) : 0;
+        g->trace_id = (uint64_t)m.t_c;
+        s->stats.received++;
+
+        // Without pings both ends are assumed to share the clock
+        if (g->trace_id && (s->stats.synced || s->ping_ms == 0))
+            q8_trace_span(s->trace_link, gesture_sub_to_local(s, m.t_b), t_recv, g->trace_id);
+    }
+
+    // A restart or a new publisher wants a ping right away
+    maybe_ping(s);
+    return n;
+}
+
+int64_t gesture_sub_to_local(const gesture_sub_t *s, int64_t t_remote_ns)
+{
+    if (!s || !s->stats.synced)
+        return t_remote_ns;
+    return t_remote_ns - s->stats.offset_ns;
+}
+
+int gesture_sub_get_stats(const gesture_sub_t *s, gl_sub_stats_t *out)
+{
+    if (!s || !out)
+        return Q8_ERR_ARG;
+    *out = s->stats;
+    return Q8_OK;
+}
+
+int gesture_sub_fd(const gesture_sub_t *s)
+{
+    return s ? s->fd : Q8_ERR_ARG;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+* gesture_link - gesture messages from the wristband host to the robot
+*
+* The classifier (publisher) sends one datagram per decision to the robot
+* controller (subscriber) over UDP, or a Unix datagram socket on the same
+* host. Messages are fixed 40-byte little-endian records:
+*
+*   GESTURE  seq, gesture code, confidence, capture time (newest sample of
+*            the decision window) and send time, both on the publisher's
+*            q8_clock (CLOCK_MONOTONIC outside simulations), and the
+*            decision's q8_trace id
+*   PING     subscriber -> publisher, carries the subscriber's send time
+*   PONG     publisher -> subscriber, echoes it with the publisher's
+*            receive and reply times
+*
+* Every decision is sent, not only changes, so a lost datagram costs one
+* decision period. The subscriber drops duplicates and late (reordered)
+* messages by seq and counts gaps as lost.
+*
+* Clock offset: the subscriber pings the publisher it last heard from every
+* ping_ms. Each PONG gives an offset and a round-trip time (NTP style); the
+* estimate is the offset of the fastest round trip among the last
+* GL_SYNC_WINDOW, since queueing delay only ever adds to a sample's error.
+* gesture_sub_to_local() then maps publisher timestamps onto the local
+* clock, so capture-to-actuation latency can be measured across hosts.
+*
+* Addresses: "udp:HOST:PORT" (HOST may be empty: any for the subscriber,
+* localhost for the publisher) or "unix:PATH" ("unix:@name" is abstract).
+*******************************************************************************/
+
+#ifndef GESTURE_LINK_H
+#define GESTURE_LINK_H
+
+#include "q8native.h"
+
+#define GL_MAGIC          0x3851      // "Q8" on the wire
+#define GL_VERSION        1
+#define GL_MSG_BYTES      40
+#define GL_DEFAULT_PORT   5860
+#define GL_SYNC_WINDOW    16          // pongs kept for the min-RTT estimate
+#define GL_SEQ_RESTART    1024        // seq this far back: publisher restarted
+
+enum { GL_MSG_GESTURE = 1, GL_MSG_PING = 2, GL_MSG_PONG = 3 };
+
+// Gesture codes (the robot's gesture names; 0 = no confident gesture)
+enum {
+    GL_GESTURE_NONE = 0,
+    GL_GESTURE_STOP,
+    GL_GESTURE_FORWARD,
+    GL_GESTURE_BACKWARD,
+    GL_GESTURE_TURN_LEFT,
+    GL_GESTURE_TURN_RIGHT,
+    GL_GESTURE_JUMP,
+    GL_GESTURE_JUMP_FORWARD,
+    GL_GESTURE_JUMP_BACKWARD,
+    GL_GESTURE_JUMP_LEFT,
+    GL_GESTURE_JUMP_RIGHT,
+    GL_GESTURE_COUNT
+};
+
+typedef struct {
+    uint32_t seq;
+    int32_t  gesture;          // GL_GESTURE_*
+    float    confidence;       // 0..1 (sent with 8-bit resolution)
+    uint32_t _pad;
+    int64_t  t_capture_ns;     // publisher clock
+    int64_t  t_send_ns;        // publisher clock
+    int64_t  t_recv_ns;        // local clock, when the datagram arrived
+    int64_t  latency_ns;       // t_recv_ns - capture on the local clock (0 until synced)
+    uint64_t trace_id;         // q8_trace id of the decision (0: none)
+} gl_gesture_t;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t send_errors;      // datagrams the kernel refused (no subscriber yet, ...)
+    uint64_t pings;            // pings answered
+    uint64_t bad;              // datagrams that were not ours
+} gl_pub_stats_t;
+
+typedef struct {
+    uint64_t received;         // gestures returned by poll
+    uint64_t lost;             // seq gaps
+    uint64_t stale;            // duplicates / arrived after a newer seq
+    uint64_t bad;
+    uint64_t pings;
+    uint64_t pongs;
+    uint64_t restarts;         // new publisher address, or its seq went back
+    int      synced;           // an offset estimate is available
+    int64_t  offset_ns;        // publisher clock - local clock
+    int64_t  rtt_ns;           // round trip of the sample the offset comes from
+} gl_sub_stats_t;
+
+typedef struct gesture_pub gesture_pub_t;
+typedef struct gesture_sub gesture_sub_t;
+
+// Publisher sending to addr. NULL with errno set on failure.
+gesture_pub_t *gesture_pub_create(const char *addr);
+void gesture_pub_destroy(gesture_pub_t *p);
+
+// Send one decision; answers pending pings first. Never blocks.
+int gesture_pub_send(gesture_pub_t *p, int gesture, float confidence, int64_t t_capture_ns,
+                     uint64_t trace_id);
+
+// Answer pending pings without sending (call from the loop between
+// decisions so round trips stay short). Returns the number answered.
+int gesture_pub_service(gesture_pub_t *p);
+
+int gesture_pub_get_stats(const gesture_pub_t *p, gl_pub_stats_t *out);
+
+// Subscriber bound to addr; pings the publisher every ping_ms (0: never)
+gesture_sub_t *gesture_sub_create(const char *addr, int ping_ms);
+void gesture_sub_destroy(gesture_sub_t *s);
+
+// Wait up to timeout_ms (< 0: forever, 0: don't) for a datagram, then read
+// everything queued: pongs update the offset estimate, new gestures go to
+// out (oldest first, at most max). Sends a ping when one is due. Gestures
+// with a trace id record a q8_trace "link" span (send -> arrival) once the
+// clock is synced.
+// Returns the number of gestures or Q8_ERR_IO.
+int gesture_sub_poll(gesture_sub_t *s, gl_gesture_t *out, int max, int timeout_ms);
+
+// Publisher timestamp on the local clock (unchanged until synced)
+int64_t gesture_sub_to_local(const gesture_sub_t *s, int64_t t_remote_ns);
+
+int gesture_sub_get_stats(const gesture_sub_t *s, gl_sub_stats_t *out);
+
+// The subscriber's socket, for poll()/select() in another loop
+int gesture_sub_fd(const gesture_sub_t *s);
+
+#endif // GESTURE_LINK_H
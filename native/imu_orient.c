@@ -0,0 +1,143 @@
+/*******************************************************************************
+* imu_orient - wrist tilt from the Cyton accelerometer (aux bytes)
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "imu_orient.h"
+
+#define RAD_TO_DEG (180.0 / M_PI)
+
+struct imu_orient {
+    imu_orient_config_t cfg;
+    imu_orient_state_t st;
+    int have_reading;
+    uint64_t frames_since;   // frames since the last reading
+};
+
+imu_orient_t *imu_orient_create(const imu_orient_config_t *cfg)
+{
+    if (!cfg || cfg->fs <= 0.0 || cfg->scale_g <= 0.0 || cfg->tau_ms < 0.0 || cfg->motion_g < 0.0)
+        return NULL;
+    if (cfg->enter_deg <= 0.0 || cfg->exit_deg > cfg->enter_deg)
+        return NULL;
+
+    imu_orient_t *o = calloc(1, sizeof(*o));
+    if (!o)
+        return NULL;
+    o->cfg = *cfg;
+    imu_orient_reset(o);
+    return o;
+}
+
+void imu_orient_destroy(imu_orient_t *o)
+{
+    free(o);
+}
+
+void imu_orient_reset(imu_orient_t *o)
+{
+    if (!o)
+        return;
+    memset(&o->st, 0, sizeof(o->st));
+    o->st.direction = IMU_LEVEL;
+    o->have_reading = 0;
+    o->frames_since = 0;
+}
+
+// Signed angle that a direction is tilted by (positive when tilted its way)
+static double direction_angle(int dir, double pitch, double roll)
+{
+    switch (dir) {
+    case IMU_ROLL_POS:  return roll;
+    case IMU_ROLL_NEG:  return -roll;
+    case IMU_PITCH_POS: return pitch;
+    case IMU_PITCH_NEG: return -pitch;
+    default:            return 0.0;
+    }
+}
+
+// Larger of |pitch| and |roll|, with its sign (same rule as IMUInterface)
+static int dominant_direction(double pitch, double roll)
+{
+    if (fabs(pitch) > fabs(roll))
+        return pitch > 0.0 ? IMU_PITCH_POS : IMU_PITCH_NEG;
+    return roll > 0.0 ? IMU_ROLL_POS : IMU_ROLL_NEG;
+}
+
+static void update_direction(imu_orient_t *o)
+{
+    const double p = o->st.pitch_deg, r = o->st.roll_deg;
+    const int cur = o->st.direction;
+    const int cand = dominant_direction(p, r);
+    const double cand_angle = direction_angle(cand, p, r);
+
+    if (cur != IMU_LEVEL && direction_angle(cur, p, r) >= o->cfg.exit_deg) {
+        // Still tilted: only switch to a stronger direction past enter
+        if (cand != cur && cand_angle >= o->cfg.enter_deg && cand_angle > direction_angle(cur, p, r))
+            o->st.direction = cand;
+        return;
+    }
+    o->st.direction = cand_angle >= o->cfg.enter_deg ? cand : IMU_LEVEL;
+}
+
+static void add_reading(imu_orient_t *o, const int16_t *raw, int64_t t_ns)
+{
+    const double s = o->cfg.scale_g;
+    const double a[3] = { raw[0] * s, raw[1] * s, raw[2] * s };
+    double *f = o->st.accel_g;
+
+    // Readings taken while the wrist accelerates say little about tilt
+    double w = 1.0;
+    if (o->cfg.motion_g > 0.0) {
+        double dev = (sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) - 1.0) / o->cfg.motion_g;
+        w = 1.0 / (1.0 + dev * dev);
+    }
+
+    if (!o->have_reading) {
+        memcpy(f, a, sizeof(a));
+        o->have_reading = 1;
+    } else {
+        double dt_ms = 1000.0 * (double)o->frames_since / o->cfg.fs;
+        double alpha = o->cfg.tau_ms > 0.0 ? 1.0 - exp(-dt_ms / o->cfg.tau_ms) : 1.0;
+        alpha *= w;
+        for (int k = 0; k < 3; ++k)
+            f[k] += alpha * (a[k] - f[k]);
+    }
+
+    o->st.roll_deg = atan2(f[1], f[2]) * RAD_TO_DEG;
+    o->st.pitch_deg = atan2(-f[0], sqrt(f[1] * f[1] + f[2] * f[2])) * RAD_TO_DEG;
+    o->st.weight = w;
+    o->st.t_ns = t_ns;
+    o->st.readings++;
+    o->frames_since = 0;
+    update_direction(o);
+}
+
+int imu_orient_push(imu_orient_t *o, const int16_t *aux, const int64_t *t_ns, int n_frames)
+{
+    if (!o || !aux || n_frames < 0)
+        return Q8_ERR_ARG;
+
+    int readings = 0;
+    for (int i = 0; i < n_frames; ++i) {
+        const int16_t *raw = &aux[3 * i];
+        o->frames_since++;
+        o->st.frames++;
+        if (raw[0] == 0 && raw[1] == 0 && raw[2] == 0)
+            continue;               // no new accelerometer sample in this frame
+        add_reading(o, raw, t_ns ? t_ns[i] : 0);
+        readings++;
+    }
+    return readings;
+}
+
+int imu_orient_get(const imu_orient_t *o, imu_orient_state_t *out)
+{
+    if (!o || !out)
+        return Q8_ERR_ARG;
+    *out = o->st;
+    return Q8_OK;
+}
@@ -0,0 +1,67 @@
+/*******************************************************************************
+* imu_orient - wrist tilt from the Cyton accelerometer (aux bytes)
+*
+* Every frame's aux triple is pushed, not just the newest one. The LIS3DH
+* updates far slower than the 250 Hz frame rate and frames without a new
+* sample carry zeros; those only advance the clock, so a new reading's dt
+* is the number of frames since the last one / fs, whatever the batching.
+*
+* Each reading (in g) goes through a one-pole low-pass with time constant
+* tau_ms. There is no gyro, so instead of blending in an integrated rate
+* the filter is complementary in the other direction: a reading whose
+* magnitude is far from 1 g (the wrist is accelerating, not just tilted)
+* gets less weight, 1 / (1 + ((|a| - 1) / motion_g)^2). Pitch and roll are
+* taken from the filtered vector, so there is no angle wrap to smooth over.
+*
+* Direction uses hysteresis: a direction is entered when its angle reaches
+* enter_deg and kept until it drops below exit_deg (or another direction
+* is stronger and past enter_deg).
+*******************************************************************************/
+
+#ifndef IMU_ORIENT_H
+#define IMU_ORIENT_H
+
+#include "q8native.h"
+
+#define IMU_LEVEL        0
+#define IMU_ROLL_POS     1     // forward
+#define IMU_ROLL_NEG     2     // backward
+#define IMU_PITCH_POS    3     // turn left
+#define IMU_PITCH_NEG    4     // turn right
+
+// OpenBCI scale factor for the Cyton accelerometer (+-4 g range)
+#define IMU_CYTON_SCALE_G  (0.002 / 16.0)
+
+typedef struct {
+    double fs;            // frame rate (250 Hz)
+    double scale_g;       // g per count
+    double tau_ms;        // low-pass time constant (0: no smoothing)
+    double motion_g;      // |a| - 1 g deviation that halves a reading's weight (0: off)
+    double enter_deg;
+    double exit_deg;      // <= enter_deg
+} imu_orient_config_t;
+
+typedef struct {
+    int64_t  t_ns;        // timestamp of the frame with the newest reading
+    double   pitch_deg;
+    double   roll_deg;
+    double   accel_g[3];  // filtered
+    double   weight;      // weight of the newest reading
+    int      direction;   // IMU_LEVEL .. IMU_PITCH_NEG
+    uint64_t readings;    // accelerometer readings used
+    uint64_t frames;      // frames pushed
+} imu_orient_state_t;
+
+typedef struct imu_orient imu_orient_t;
+
+imu_orient_t *imu_orient_create(const imu_orient_config_t *cfg);
+void imu_orient_destroy(imu_orient_t *o);
+void imu_orient_reset(imu_orient_t *o);
+
+// aux: [n_frames][3] raw counts (x, y, z); t_ns: per-frame timestamps or NULL.
+// Returns the number of new readings among them.
+int imu_orient_push(imu_orient_t *o, const int16_t *aux, const int64_t *t_ns, int n_frames);
+
+int imu_orient_get(const imu_orient_t *o, imu_orient_state_t *out);
+
+#endif // IMU_ORIENT_H
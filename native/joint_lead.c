@@ -0,0 +1,188 @@
+/*******************************************************************************
+* joint_lead - latency-compensating lead on commanded joint trajectories
+*******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "joint_lead.h"
+
+#define HISTORY_MASK (JOINT_LEAD_HISTORY - 1)
+
+struct joint_lead {
+    joint_lead_config_t cfg;
+    int n_delays;
+    double model_ms[JOINT_LEAD_MAX_JOINTS];
+
+    // Sent goals, oldest overwritten first
+    int64_t hist_t[JOINT_LEAD_HISTORY];
+    double hist_goal[JOINT_LEAD_HISTORY][JOINT_LEAD_MAX_JOINTS];
+    uint64_t n_hist;
+
+    // Running mean squared error of each candidate delay
+    double cost[JOINT_LEAD_MAX_JOINTS][JOINT_LEAD_MAX_DELAYS];
+    joint_lead_state_t st;
+};
+
+joint_lead_t *joint_lead_create(const joint_lead_config_t *cfg)
+{
+    if (!cfg || cfg->n_joints < 1 || cfg->n_joints > JOINT_LEAD_MAX_JOINTS || cfg->dt_s <= 0.0)
+        return NULL;
+    if (cfg->max_lag_ms <= 0.0 || cfg->step_ms <= 0.0 || cfg->max_lag_ms / cfg->step_ms >= JOINT_LEAD_MAX_DELAYS)
+        return NULL;
+    if (cfg->kv_s < 0.0 || cfg->window < 1.0 || cfg->min_speed_dps < 0.0 || cfg->min_observations < 0)
+        return NULL;
+
+    joint_lead_t *jl = calloc(1, sizeof(*jl));
+    if (!jl)
+        return NULL;
+    jl->cfg = *cfg;
+    jl->n_delays = (int)floor(cfg->max_lag_ms / cfg->step_ms) + 1;
+    joint_lead_reset(jl);
+    return jl;
+}
+
+void joint_lead_destroy(joint_lead_t *jl)
+{
+    free(jl);
+}
+
+void joint_lead_reset(joint_lead_t *jl)
+{
+    if (!jl)
+        return;
+    jl->n_hist = 0;
+    memset(jl->cost, 0, sizeof(jl->cost));
+    memset(&jl->st, 0, sizeof(jl->st));
+    for (int j = 0; j < jl->cfg.n_joints; ++j) {
+        jl->st.lag_ms[j] = jl->model_ms[j];
+        jl->st.estimate_ms[j] = -1.0;
+    }
+}
+
+int joint_lead_set_lag(joint_lead_t *jl, int joint, double lag_ms)
+{
+    if (!jl || joint < 0 || joint >= jl->cfg.n_joints || !(lag_ms >= 0.0))
+        return Q8_ERR_ARG;
+    jl->model_ms[joint] = fmin(lag_ms, jl->cfg.max_lag_ms);
+    if (jl->st.observations[joint] < (uint64_t)jl->cfg.min_observations)
+        jl->st.lag_ms[joint] = jl->model_ms[joint];
+    return Q8_OK;
+}
+
+int joint_lead_command(joint_lead_t *jl, int64_t t_ns, const double *plan, int n_ahead, double *out)
+{
+    if (!jl || !plan || !out || n_ahead < 2)
+        return Q8_ERR_ARG;
+
+    const int n = jl->cfg.n_joints;
+    const double dt = jl->cfg.dt_s;
+    double *sent = jl->hist_goal[jl->n_hist & HISTORY_MASK];
+
+    for (int j = 0; j < n; ++j) {
+        // Planned goal lag_ms from now, held at the end of the plan
+        double s = jl->st.lag_ms[j] / (1000.0 * dt);
+        int i = (int)s;
+        double f = s - i;
+        if (i >= n_ahead - 1) {
+            i = n_ahead - 2;
+            f = 1.0;
+        }
+        const double g0 = plan[i * n + j], g1 = plan[(i + 1) * n + j];
+        out[j] = g0 + f * (g1 - g0) + jl->cfg.kv_s * (g1 - g0) / dt;
+        sent[j] = out[j];
+    }
+    jl->hist_t[jl->n_hist & HISTORY_MASK] = t_ns;
+    jl->n_hist++;
+    jl->st.commands++;
+    return Q8_OK;
+}
+
+// Goal sent to joint j as seen at time t: linear between sends, held after
+// the last one. Returns 0 if t is older than the history.
+static int sent_at(const joint_lead_t *jl, int j, int64_t t, double *goal)
+{
+    const uint64_t oldest = jl->n_hist > JOINT_LEAD_HISTORY ? jl->n_hist - JOINT_LEAD_HISTORY : 0;
+    uint64_t i = jl->n_hist - 1;
+    if (t >= jl->hist_t[i & HISTORY_MASK]) {
+        *goal = jl->hist_goal[i & HISTORY_MASK][j];
+        return 1;
+    }
+    while (i > oldest && jl->hist_t[(i - 1) & HISTORY_MASK] > t)
+        i--;
+    if (i == oldest)
+        return 0;
+
+    const int64_t ta = jl->hist_t[(i - 1) & HISTORY_MASK], tb = jl->hist_t[i & HISTORY_MASK];
+    const double ga = jl->hist_goal[(i - 1) & HISTORY_MASK][j], gb = jl->hist_goal[i & HISTORY_MASK][j];
+    *goal = tb > ta ? ga + (gb - ga) * (double)(t - ta) / (double)(tb - ta) : gb;
+    return 1;
+}
+
+static void update_estimate(joint_lead_t *jl, int j)
+{
+    const double *c = jl->cost[j];
+    int k = 0;
+    for (int d = 1; d < jl->n_delays; ++d)
+        if (c[d] < c[k])
+            k = d;
+
+    double offset = 0.0;
+    if (k > 0 && k < jl->n_delays - 1) {
+        double curv = c[k - 1] - 2.0 * c[k] + c[k + 1];
+        if (curv > 0.0)
+            offset = 0.5 * (c[k - 1] - c[k + 1]) / curv;
+    }
+    jl->st.estimate_ms[j] = (k + offset) * jl->cfg.step_ms;
+    jl->st.rms_deg[j] = sqrt(c[k]);
+    if (jl->st.observations[j] >= (uint64_t)jl->cfg.min_observations)
+        jl->st.lag_ms[j] = jl->st.estimate_ms[j];
+}
+
+int joint_lead_observe(joint_lead_t *jl, int joint, int64_t t_ns, double present_deg)
+{
+    if (!jl || joint < 0 || joint >= jl->cfg.n_joints)
+        return Q8_ERR_ARG;
+    if (jl->n_hist < 2) {
+        jl->st.skipped++;
+        return 0;
+    }
+
+    // Only while the goal moves: the speed over the last tick
+    const uint64_t last = jl->n_hist - 1;
+    const double span_s = (jl->hist_t[last & HISTORY_MASK] - jl->hist_t[(last - 1) & HISTORY_MASK]) * 1e-9;
+    const double step = jl->hist_goal[last & HISTORY_MASK][joint] - jl->hist_goal[(last - 1) & HISTORY_MASK][joint];
+    if (span_s <= 0.0 || fabs(step) / span_s < jl->cfg.min_speed_dps) {
+        jl->st.skipped++;
+        return 0;
+    }
+
+    // Every candidate needs its goal in the history
+    double err[JOINT_LEAD_MAX_DELAYS];
+    for (int d = 0; d < jl->n_delays; ++d) {
+        double goal;
+        int64_t delay_ns = (int64_t)(d * jl->cfg.step_ms * 1e6);
+        if (!sent_at(jl, joint, t_ns - delay_ns, &goal)) {
+            jl->st.skipped++;
+            return 0;
+        }
+        err[d] = present_deg - goal;
+    }
+
+    const uint64_t n = ++jl->st.observations[joint];
+    const double w = 1.0 / fmin((double)n, jl->cfg.window);
+    double *c = jl->cost[joint];
+    for (int d = 0; d < jl->n_delays; ++d)
+        c[d] += w * (err[d] * err[d] - c[d]);
+    update_estimate(jl, joint);
+    return 1;
+}
+
+int joint_lead_get(const joint_lead_t *jl, joint_lead_state_t *out)
+{
+    if (!jl || !out)
+        return Q8_ERR_ARG;
+    *out = jl->st;
+    return Q8_OK;
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************
+* joint_lead - latency-compensating lead on commanded joint trajectories
+*
+* Every joint trails its goals by some lag (the sync write, the servo's dead
+* time and its response). The compensator sends each joint its trajectory
+* shifted earlier by that lag:
+*
+*     out = goal(t + lag) + kv_s * goal'(t + lag)
+*
+* where goal(t + k dt) comes from the planned goals for the next ticks (the
+* gait trajectories are known ahead) with linear interpolation between
+* them, and goal' is their slope. kv_s adds lead in proportion to the
+* joint's speed, for servos whose lag grows with it; 0 disables it.
+*
+* The lag starts at a modelled value (joint_lead_set_lag, e.g. the servo's
+* fitted dead time plus time constant) and is estimated online from
+* present-position reads: each read is compared with the goals *sent* at
+* t - d for every candidate delay d on a grid of step_ms up to max_lag_ms,
+* and the candidate with the smallest running mean squared error (refined
+* by a parabola through its neighbours) becomes the joint's lag once
+* min_observations reads were taken while the goal was moving at least
+* min_speed_dps. Reads while the joint stands still say nothing about lag
+* and are skipped.
+*******************************************************************************/
+
+#ifndef JOINT_LEAD_H
+#define JOINT_LEAD_H
+
+#include "q8native.h"
+
+#define JOINT_LEAD_MAX_JOINTS   8
+#define JOINT_LEAD_MAX_DELAYS   128    // candidate grid size
+#define JOINT_LEAD_HISTORY      256    // sent goals kept (a power of 2)
+
+typedef struct {
+    int    n_joints;         // <= JOINT_LEAD_MAX_JOINTS
+    double dt_s;             // spacing of the planned goals (control tick)
+    double max_lag_ms;       // longest lag estimated and applied
+    double step_ms;          // candidate delay spacing (max_lag_ms / step_ms < MAX_DELAYS)
+    double kv_s;             // velocity lead gain (s)
+    double window;           // reads averaged by the estimate (running mean, then EMA)
+    double min_speed_dps;    // goal speed below which reads are skipped
+    int    min_observations; // reads before the estimate replaces the modelled lag
+} joint_lead_config_t;
+
+typedef struct {
+    double   lag_ms[JOINT_LEAD_MAX_JOINTS];       // lag in use
+    double   estimate_ms[JOINT_LEAD_MAX_JOINTS];  // online estimate (-1: none yet)
+    double   rms_deg[JOINT_LEAD_MAX_JOINTS];      // residual at the estimate
+    uint64_t observations[JOINT_LEAD_MAX_JOINTS]; // reads used
+    uint64_t skipped;        // reads skipped (standing still / outside the history)
+    uint64_t commands;
+} joint_lead_state_t;
+
+typedef struct joint_lead joint_lead_t;
+
+joint_lead_t *joint_lead_create(const joint_lead_config_t *cfg);
+void joint_lead_destroy(joint_lead_t *jl);
+
+// Forget sent goals and estimates; modelled lags stay
+void joint_lead_reset(joint_lead_t *jl);
+
+// Modelled lag of one joint, used until the estimate is ready
+int joint_lead_set_lag(joint_lead_t *jl, int joint, double lag_ms);
+
+// plan: [n_ahead][n_joints] goals (deg) for this tick and the next ones,
+// n_ahead >= 2. Writes the compensated goals to out (what gets sent at
+// t_ns) and remembers them for the estimate.
+int joint_lead_command(joint_lead_t *jl, int64_t t_ns, const double *plan, int n_ahead, double *out);
+
+// Present position of one joint (deg, same frame as the goals) read at t_ns.
+// Returns 1 if the read was used, 0 if skipped.
+int joint_lead_observe(joint_lead_t *jl, int joint, int64_t t_ns, double present_deg);
+
+int joint_lead_get(const joint_lead_t *jl, joint_lead_state_t *out);
+
+#endif // JOINT_LEAD_H
@@ -0,0 +1,105 @@
+/*******************************************************************************
+* q8_clock - process clock, real or virtual
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "q8_clock.h"
+
+static _Atomic int     g_virtual;
+static _Atomic int64_t g_now_ns;        // virtual time
+static _Atomic uint64_t g_sleeps;
+static _Atomic int64_t g_slept_ns;
+static _Atomic int64_t g_advanced_ns;
+
+static int64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t q8_clock_now_ns(void)
+{
+    if (atomic_load_explicit(&g_virtual, memory_order_acquire))
+        return atomic_load_explicit(&g_now_ns, memory_order_acquire);
+    return monotonic_ns();
+}
+
+int q8_clock_set_virtual(int on, int64_t start_ns)
+{
+    if (on && start_ns < 0)
+        return Q8_ERR_ARG;
+    atomic_store(&g_now_ns, on ? start_ns : 0);
+    atomic_store(&g_sleeps, 0);
+    atomic_store(&g_slept_ns, 0);
+    atomic_store(&g_advanced_ns, 0);
+    atomic_store_explicit(&g_virtual, on ? 1 : 0, memory_order_release);
+    return Q8_OK;
+}
+
+int q8_clock_is_virtual(void)
+{
+    return atomic_load_explicit(&g_virtual, memory_order_acquire);
+}
+
+int q8_clock_sleep_until(int64_t t_ns)
+{
+    if (atomic_load_explicit(&g_virtual, memory_order_acquire)) {
+        // Jump to the deadline unless another thread already moved past it
+        int64_t now = atomic_load(&g_now_ns);
+        while (now < t_ns && !atomic_compare_exchange_weak(&g_now_ns, &now, t_ns))
+            ;
+        if (now < t_ns) {
+            atomic_fetch_add_explicit(&g_sleeps, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&g_slept_ns, t_ns - now, memory_order_relaxed);
+        }
+        return Q8_OK;
+    }
+
+    int64_t now = monotonic_ns();
+    if (t_ns <= now)
+        return Q8_OK;
+    struct timespec ts = { .tv_sec = t_ns / 1000000000LL, .tv_nsec = t_ns % 1000000000LL };
+    int rc;
+    while ((rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR)
+        ;
+    if (rc != 0) {
+        errno = rc;
+        return Q8_ERR_IO;
+    }
+    atomic_fetch_add_explicit(&g_sleeps, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_slept_ns, t_ns - now, memory_order_relaxed);
+    return Q8_OK;
+}
+
+int q8_clock_sleep_ns(int64_t ns)
+{
+    if (ns <= 0)
+        return Q8_OK;
+    return q8_clock_sleep_until(q8_clock_now_ns() + ns);
+}
+
+int q8_clock_advance(int64_t ns)
+{
+    if (ns < 0 || !atomic_load_explicit(&g_virtual, memory_order_acquire))
+        return Q8_ERR_ARG;
+    atomic_fetch_add(&g_now_ns, ns);
+    atomic_fetch_add_explicit(&g_advanced_ns, ns, memory_order_relaxed);
+    return Q8_OK;
+}
+
+int q8_clock_get_stats(q8_clock_stats_t *out)
+{
+    if (!out)
+        return Q8_ERR_ARG;
+    out->sleeps = atomic_load_explicit(&g_sleeps, memory_order_relaxed);
+    out->slept_ns = atomic_load_explicit(&g_slept_ns, memory_order_relaxed);
+    out->advanced_ns = atomic_load_explicit(&g_advanced_ns, memory_order_relaxed);
+    out->virtual_time = q8_clock_is_virtual();
+    return Q8_OK;
+}
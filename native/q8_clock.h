@@ -0,0 +1,51 @@
+/*******************************************************************************
+* q8_clock - process clock, real or virtual
+*
+* The time the control stack runs on. In real time it is CLOCK_MONOTONIC and
+* sleeps are clock_nanosleep on absolute deadlines. In virtual time it is a
+* counter that only moves when someone sleeps or advances it: a sleep
+* returns at once with the clock at its deadline, so a loop that paces
+* itself with q8_clock_sleep_until() sees exactly the timestamps an ideal
+* real-time run would see, as fast as the CPU allows.
+*
+* Virtual time is meant for one thread driving a simulation: with several
+* sleeping threads it jumps to whichever deadline is asked for first, so
+* their interleaving is no longer reproducible.
+*
+* The gesture link stamps sends, arrivals and clock-sync pings with this
+* clock. The io_uring reactor and the Cyton reader / emulator threads stay
+* on CLOCK_MONOTONIC (kernel timeouts, real devices).
+*******************************************************************************/
+
+#ifndef Q8_CLOCK_H
+#define Q8_CLOCK_H
+
+#include "q8native.h"
+
+typedef struct {
+    uint64_t sleeps;          // sleep calls that waited (or jumped)
+    int64_t  slept_ns;        // total time slept; in virtual time, time skipped
+    int64_t  advanced_ns;     // moved by q8_clock_advance()
+    int      virtual_time;
+} q8_clock_stats_t;
+
+// Now, in ns (CLOCK_MONOTONIC, or the virtual counter)
+int64_t q8_clock_now_ns(void);
+
+// Switch to virtual time starting at start_ns (on = 1) or back to real time
+// (on = 0). Resets the stats.
+int q8_clock_set_virtual(int on, int64_t start_ns);
+int q8_clock_is_virtual(void);
+
+// Sleep until the clock reads t_ns / for ns. Virtual time jumps forward
+// (never backward); real time retries on EINTR.
+int q8_clock_sleep_until(int64_t t_ns);
+int q8_clock_sleep_ns(int64_t ns);
+
+// Move virtual time forward by ns (Q8_ERR_ARG in real time or ns < 0).
+// Returns Q8_OK.
+int q8_clock_advance(int64_t ns);
+
+int q8_clock_get_stats(q8_clock_stats_t *out);
+
+#endif // Q8_CLOCK_H
@@ -0,0 +1,535 @@
+/*******************************************************************************
+* q8_reactor - single-threaded io_uring event loop for the Cyton and servos
+*
+* Raw io_uring syscalls (no liburing): the rings are mapped once at create
+* and only this thread touches them. SQEs are prepared as soon as there is
+* work (a read to re-arm, a write to send, a timer to set) and published to
+* the kernel by the single io_uring_enter in q8_reactor_poll, which also
+* waits for completions.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "dxl_packet.h"
+#include "q8_reactor.h"
+#include "q8_trace.h"
+
+#define RING_ENTRIES   8
+#define RX_BUF         4096
+#define MAX_PER_READ   (RX_BUF / CYTON_FRAME_BYTES + 1)
+
+// Registered buffer indices
+#define BUF_RX         0
+#define BUF_TX0        1
+
+// user_data tags; the tick timer also carries a generation in the upper bits
+#define TAG_READ       1
+#define TAG_WRITE      2
+#define TAG_TICK       3
+#define TAG_IGNORE     4
+#define TAG_MASK       0xFF
+
+struct q8_reactor {
+    int ring_fd;
+    unsigned sq_entries;
+
+    // Mapped rings
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Registered file indices (-1 if the device is not used)
+    int cyton_idx;
+    int dxl_idx;
+
+    // Registered buffers: rx, tx[0], tx[1]
+    uint8_t *mem;
+    uint8_t *rx;
+    uint8_t *tx[2];
+
+    // Cyton
+    int rx_len;
+    int read_inflight;
+    int read_error;
+    cyton_frame_t queue[Q8_REACTOR_QUEUE];
+    uint64_t q_head, q_tail;
+
+    // Dynamixel: tx[tx_cur] is in flight, tx[!tx_cur] waits if tx_waiting
+    int tx_cur;
+    int tx_len[2];
+    int tx_off;
+    int tx_inflight;
+    int tx_waiting;
+    uint64_t tx_trace_id[2];
+    int64_t tx_queued_ns[2];
+
+    // Control clock
+    int64_t period_ns;
+    int64_t next_tick_ns;
+    struct __kernel_timespec tick_ts;
+    uint64_t tick_gen;
+    int tick_inflight;
+
+    q8_reactor_events_t *ev;     // events of the poll in progress
+    q8_reactor_stats_t stats;
+
+    // q8_trace names: read reaped -> frames queued, sync write queued -> sent
+    int trace_read;
+    int trace_write;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              const void *arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int map_rings(q8_reactor_t *r, const struct io_uring_params *p)
+{
+    r->sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    r->cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size)
+            r->sq_size = r->cq_size;
+        r->cq_size = r->sq_size;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->ring_fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        r->sq_ptr = NULL;
+        return Q8_ERR_IO;
+    }
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->ring_fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            r->cq_ptr = NULL;
+            return Q8_ERR_IO;
+        }
+    }
+    r->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->ring_fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        return Q8_ERR_IO;
+    }
+
+    uint8_t *sq = r->sq_ptr, *cq = r->cq_ptr;
+    r->sq_head = (unsigned *)(sq + p->sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p->sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p->sq_off.array);
+    r->cq_head = (unsigned *)(cq + p->cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p->cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+    r->sq_entries = p->sq_entries;
+    return Q8_OK;
+}
+
+q8_reactor_t *q8_reactor_create(int cyton_fd, int dxl_fd)
+{
+    q8_reactor_t *r = calloc(1, sizeof(*r));
+    if (!r)
+        return NULL;
+    r->ring_fd = -1;
+    r->cyton_idx = r->dxl_idx = -1;
+    r->trace_read = q8_trace_name("reactor_read");
+    r->trace_write = q8_trace_name("sync_write");
+
+    // Task work only runs when we enter the kernel anyway; fall back on
+    // kernels that predate the flag
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_COOP_TASKRUN;
+    r->ring_fd = sys_io_uring_setup(RING_ENTRIES, &p);
+    if (r->ring_fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        r->ring_fd = sys_io_uring_setup(RING_ENTRIES, &p);
+    }
+    if (r->ring_fd < 0)
+        goto fail;
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        errno = ENOSYS;
+        goto fail;
+    }
+    if (map_rings(r, &p) != Q8_OK)
+        goto fail;
+
+    if (posix_memalign((void **)&r->mem, 4096, RX_BUF + 2 * DXL_MAX_PACKET) != 0) {
+        errno = ENOMEM;
+        goto fail;
+    }
+    r->rx = r->mem;
+    r->tx[0] = r->mem + RX_BUF;
+    r->tx[1] = r->tx[0] + DXL_MAX_PACKET;
+    struct iovec iov[3] = {
+        { r->rx, RX_BUF },
+        { r->tx[0], DXL_MAX_PACKET },
+        { r->tx[1], DXL_MAX_PACKET },
+    };
+    if (sys_io_uring_register(r->ring_fd, IORING_REGISTER_BUFFERS, iov, 3) < 0)
+        goto fail;
+
+    int fds[2], n_fds = 0;
+    if (cyton_fd >= 0) {
+        r->cyton_idx = n_fds;
+        fds[n_fds++] = cyton_fd;
+    }
+    if (dxl_fd >= 0) {
+        r->dxl_idx = n_fds;
+        fds[n_fds++] = dxl_fd;
+    }
+    if (n_fds > 0 && sys_io_uring_register(r->ring_fd, IORING_REGISTER_FILES, fds, n_fds) < 0)
+        goto fail;
+    return r;
+
+fail:;
+    int err = errno;
+    q8_reactor_destroy(r);
+    errno = err;
+    return NULL;
+}
+
+void q8_reactor_destroy(q8_reactor_t *r)
+{
+    if (!r)
+        return;
+    // Closing the ring cancels whatever is still in flight
+    if (r->ring_fd >= 0)
+        close(r->ring_fd);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ptr && r->cq_ptr != r->sq_ptr)
+        munmap(r->cq_ptr, r->cq_size);
+    if (r->sq_ptr)
+        munmap(r->sq_ptr, r->sq_size);
+    free(r->mem);
+    free(r);
+}
+
+// Next free SQE, published to the kernel right away (submitted by poll)
+static struct io_uring_sqe *get_sqe(q8_reactor_t *r, uint8_t opcode, uint64_t user_data)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= r->sq_entries)
+        return NULL;
+
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = user_data;
+    r->sq_array[idx] = idx;
+    return sqe;
+}
+
+static void commit_sqe(q8_reactor_t *r)
+{
+    __atomic_store_n(r->sq_tail, *r->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static int arm_read(q8_reactor_t *r)
+{
+    struct io_uring_sqe *sqe = get_sqe(r, IORING_OP_READ_FIXED, TAG_READ);
+    if (!sqe)
+        return Q8_ERR_FULL;
+    sqe->fd = r->cyton_idx;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = (uint64_t)(uintptr_t)(r->rx + r->rx_len);
+    sqe->len = RX_BUF - r->rx_len;
+    sqe->off = (uint64_t)-1;              // stream: current position
+    sqe->buf_index = BUF_RX;
+    commit_sqe(r);
+    r->read_inflight = 1;
+    return Q8_OK;
+}
+
+static int arm_write(q8_reactor_t *r)
+{
+    struct io_uring_sqe *sqe = get_sqe(r, IORING_OP_WRITE_FIXED, TAG_WRITE);
+    if (!sqe)
+        return Q8_ERR_FULL;
+    sqe->fd = r->dxl_idx;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = (uint64_t)(uintptr_t)(r->tx[r->tx_cur] + r->tx_off);
+    sqe->len = r->tx_len[r->tx_cur] - r->tx_off;
+    sqe->off = (uint64_t)-1;
+    sqe->buf_index = BUF_TX0 + r->tx_cur;
+    commit_sqe(r);
+    r->tx_inflight = 1;
+    return Q8_OK;
+}
+
+static int arm_tick(q8_reactor_t *r)
+{
+    struct io_uring_sqe *sqe = get_sqe(r, IORING_OP_TIMEOUT, TAG_TICK | (r->tick_gen << 8));
+    if (!sqe)
+        return Q8_ERR_FULL;
+    r->tick_ts.tv_sec = r->next_tick_ns / 1000000000LL;
+    r->tick_ts.tv_nsec = r->next_tick_ns % 1000000000LL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&r->tick_ts;
+    sqe->len = 1;
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;   // CLOCK_MONOTONIC
+    commit_sqe(r);
+    r->tick_inflight = 1;
+    return Q8_OK;
+}
+
+int q8_reactor_set_tick(q8_reactor_t *r, int64_t period_ns)
+{
+    if (!r || period_ns < 0)
+        return Q8_ERR_ARG;
+
+    if (r->tick_inflight) {
+        struct io_uring_sqe *sqe = get_sqe(r, IORING_OP_TIMEOUT_REMOVE, TAG_IGNORE);
+        if (!sqe)
+            return Q8_ERR_FULL;
+        sqe->fd = -1;
+        sqe->addr = TAG_TICK | (r->tick_gen << 8);
+        commit_sqe(r);
+    }
+    // A completion from the old timer no longer matches and is ignored
+    r->tick_gen++;
+    r->tick_inflight = 0;
+    r->period_ns = period_ns;
+    r->next_tick_ns = cyton_monotonic_ns() + period_ns;
+    return Q8_OK;
+}
+
+int q8_reactor_sync_write(q8_reactor_t *r, uint8_t addr, uint8_t data_len,
+                          const uint8_t *ids, const uint8_t *data, int n_ids, uint64_t trace_id)
+{
+    if (!r || r->dxl_idx < 0)
+        return Q8_ERR_ARG;
+
+    int slot = r->tx_inflight ? !r->tx_cur : r->tx_cur;
+    int len = dxl_sync_write_packet(r->tx[slot], DXL_MAX_PACKET, addr, data_len, ids, data, n_ids);
+    if (len < 0)
+        return len;
+    r->tx_len[slot] = len;
+    r->tx_trace_id[slot] = trace_id;
+    r->tx_queued_ns[slot] = q8_trace_enabled() ? cyton_monotonic_ns() : 0;
+
+    if (r->tx_inflight) {
+        if (r->tx_waiting)
+            r->stats.coalesced++;
+        r->tx_waiting = 1;
+        return Q8_OK;
+    }
+    r->tx_off = 0;
+    return arm_write(r);
+}
+
+static void queue_frames(q8_reactor_t *r, const cyton_frame_t *frames, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        if (r->q_tail - r->q_head == Q8_REACTOR_QUEUE) {
+            r->q_head++;                  // keep the newest
+            r->stats.dropped_frames++;
+        }
+        cyton_frame_t *slot = &r->queue[r->q_tail % Q8_REACTOR_QUEUE];
+        *slot = frames[i];
+        slot->seq = r->stats.frames++;
+        r->q_tail++;
+    }
+}
+
+static void on_read(q8_reactor_t *r, int res, int64_t t_ns)
+{
+    r->read_inflight = 0;
+    if (res == -EINTR || res == -EAGAIN || res == -ECANCELED) {
+        arm_read(r);
+        return;
+    }
+    if (res <= 0) {
+        r->read_error = res == 0 ? EPIPE : -res;
+        r->ev->error = r->read_error;
+        return;
+    }
+
+    r->rx_len += res;
+    r->stats.bytes += (uint64_t)res;
+    r->stats.reads++;
+
+    cyton_frame_t frames[MAX_PER_READ];
+    int n = cyton_extract_frames(r->rx, &r->rx_len, frames, MAX_PER_READ, t_ns, &r->stats.resync_bytes);
+    queue_frames(r, frames, n);
+    if (n > 0 && q8_trace_enabled())
+        q8_trace_span(r->trace_read, t_ns, cyton_monotonic_ns(), r->stats.frames - 1);
+
+    // Line noise without a start byte: keep the buffer from filling up
+    if (r->rx_len == RX_BUF) {
+        r->stats.resync_bytes += RX_BUF - CYTON_FRAME_BYTES;
+        memmove(r->rx, &r->rx[RX_BUF - CYTON_FRAME_BYTES], CYTON_FRAME_BYTES);
+        r->rx_len = CYTON_FRAME_BYTES;
+    }
+    arm_read(r);
+}
+
+static void on_write(q8_reactor_t *r, int res, int64_t t_ns)
+{
+    r->tx_inflight = 0;
+    if (res == -EINTR || res == -EAGAIN) {
+        arm_write(r);
+        return;
+    }
+    if (res < 0) {
+        r->ev->error = -res;              // drop this packet; a waiting one still goes
+    } else {
+        r->tx_off += res;
+        if (r->tx_off < r->tx_len[r->tx_cur]) {
+            arm_write(r);                 // short write: send the rest
+            return;
+        }
+        r->stats.writes++;
+        r->stats.write_bytes += (uint64_t)r->tx_len[r->tx_cur];
+        r->ev->writes_done++;
+        if (r->tx_queued_ns[r->tx_cur])
+            q8_trace_span(r->trace_write, r->tx_queued_ns[r->tx_cur], t_ns, r->tx_trace_id[r->tx_cur]);
+    }
+
+    if (r->tx_waiting) {
+        r->tx_waiting = 0;
+        r->tx_cur = !r->tx_cur;
+        r->tx_off = 0;
+        arm_write(r);
+    }
+}
+
+static void on_tick(q8_reactor_t *r, uint64_t gen, int64_t now)
+{
+    if (gen != r->tick_gen)
+        return;                           // cancelled by set_tick
+    r->tick_inflight = 0;
+    if (r->period_ns <= 0)
+        return;
+
+    // Every deadline up to now has passed; report them as one batch
+    int64_t late = now - r->next_tick_ns;
+    if (late < 0)
+        late = 0;
+    int64_t k = 1 + late / r->period_ns;
+    r->ev->ticks += (int)k;
+    r->ev->tick_ns = r->next_tick_ns + (k - 1) * r->period_ns;
+    r->next_tick_ns += k * r->period_ns;
+
+    r->stats.ticks += (uint64_t)k;
+    r->stats.missed_ticks += (uint64_t)(k - 1);
+    r->stats.tick_late_sum_ns += late;
+    if (late > r->stats.tick_late_max_ns)
+        r->stats.tick_late_max_ns = late;
+}
+
+static void reap(q8_reactor_t *r)
+{
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return;
+    int64_t now = cyton_monotonic_ns();
+
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        uint64_t ud = cqe->user_data;
+        int res = cqe->res;
+        // Free the slot first: handlers may queue new SQEs
+        __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        switch (ud & TAG_MASK) {
+        case TAG_READ:  on_read(r, res, now); break;
+        case TAG_WRITE: on_write(r, res, now); break;
+        case TAG_TICK:  on_tick(r, ud >> 8, now); break;
+        default:        break;
+        }
+    }
+}
+
+int q8_reactor_poll(q8_reactor_t *r, cyton_frame_t *out, int max_frames,
+                    int64_t timeout_ns, q8_reactor_events_t *ev)
+{
+    q8_reactor_events_t local;
+    if (!r || max_frames < 0 || (max_frames > 0 && !out))
+        return Q8_ERR_ARG;
+    if (!ev)
+        ev = &local;
+    memset(ev, 0, sizeof(*ev));
+    r->ev = ev;
+
+    if (r->period_ns > 0 && !r->tick_inflight)
+        arm_tick(r);
+    if (r->cyton_idx >= 0 && !r->read_inflight && !r->read_error)
+        arm_read(r);
+
+    unsigned to_submit = *r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    int wait = timeout_ns != 0 && q8_reactor_pending(r) == 0;
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout_ns > 0) {
+        ts.tv_sec = timeout_ns / 1000000000LL;
+        ts.tv_nsec = timeout_ns % 1000000000LL;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+    int rc = sys_io_uring_enter(r->ring_fd, to_submit, wait ? 1 : 0,
+                                IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    r->stats.enters++;
+    if (rc < 0 && errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        r->ev = NULL;
+        return Q8_ERR_IO;
+    }
+
+    reap(r);
+    r->ev = NULL;
+
+    int n = 0;
+    while (n < max_frames && r->q_head != r->q_tail)
+        out[n++] = r->queue[r->q_head++ % Q8_REACTOR_QUEUE];
+    return n;
+}
+
+int q8_reactor_pending(const q8_reactor_t *r)
+{
+    return r ? (int)(r->q_tail - r->q_head) : 0;
+}
+
+int q8_reactor_get_stats(const q8_reactor_t *r, q8_reactor_stats_t *out)
+{
+    if (!r || !out)
+        return Q8_ERR_ARG;
+    *out = r->stats;
+    return Q8_OK;
+}
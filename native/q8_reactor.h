@@ -0,0 +1,84 @@
+/*******************************************************************************
+* q8_reactor - single-threaded io_uring event loop for the Cyton and servos
+*
+* One thread owns both serial lines and the control clock:
+*
+*   Cyton     a READ_FIXED is always in flight on the dongle fd; completed
+*             bytes are split into frames (cyton_extract_frames) and queued
+*   Dynamixel sync writes go out as WRITE_FIXED from one of two registered
+*             tx buffers. While one is in flight the next packet waits in the
+*             other; a newer packet replaces a waiting one (goal positions are
+*             absolute, so only the latest matters) and counts as coalesced
+*   ticks     an absolute IORING_OP_TIMEOUT on start + k * period, so the
+*             control clock does not drift with loop jitter; ticks that pass
+*             while the loop is busy are reported together and counted missed
+*
+* Both fds are registered files and all buffers are registered buffers, so
+* the loop makes one io_uring_enter per q8_reactor_poll: it submits the
+* queued reads / writes / timers and sleeps until something completes.
+* Serial settings (raw mode, baud) are left to whoever opened the fds.
+*
+* Needs Linux 5.11+ (IORING_FEAT_EXT_ARG); create fails with ENOSYS before.
+*******************************************************************************/
+
+#ifndef Q8_REACTOR_H
+#define Q8_REACTOR_H
+
+#include "q8native.h"
+#include "cyton_reader.h"
+
+#define Q8_REACTOR_QUEUE   1024     // decoded frames waiting for poll
+
+typedef struct {
+    int     ticks;          // control ticks due since the last poll (>1: overrun)
+    int64_t tick_ns;        // deadline of the latest of them (CLOCK_MONOTONIC)
+    int     writes_done;    // sync writes fully sent
+    int     error;          // errno of a failed read / write (0 if none)
+} q8_reactor_events_t;
+
+typedef struct {
+    uint64_t frames;           // Cyton frames decoded
+    uint64_t dropped_frames;   // lost because the queue was full
+    uint64_t bytes;            // Cyton bytes read
+    uint64_t reads;            // read completions with data
+    uint64_t resync_bytes;
+    uint64_t ticks;
+    uint64_t missed_ticks;     // deadlines that passed before the loop saw them
+    int64_t  tick_late_max_ns; // completion reaped after the deadline
+    int64_t  tick_late_sum_ns;
+    uint64_t writes;           // sync writes completed
+    uint64_t write_bytes;
+    uint64_t coalesced;        // sync writes replaced before being sent
+    uint64_t enters;           // io_uring_enter calls
+} q8_reactor_stats_t;
+
+typedef struct q8_reactor q8_reactor_t;
+
+// Either fd may be -1 if that device is not used
+q8_reactor_t *q8_reactor_create(int cyton_fd, int dxl_fd);
+void q8_reactor_destroy(q8_reactor_t *r);
+
+// Control tick period in ns (0 stops the clock). The first tick is one
+// period from now.
+int q8_reactor_set_tick(q8_reactor_t *r, int64_t period_ns);
+
+// Queue a sync write (see dxl_packet.h); it is submitted by the next poll.
+// trace_id: the decision it acts on, for the q8_trace "sync_write" span
+// (queued -> fully sent); 0 if none.
+int q8_reactor_sync_write(q8_reactor_t *r, uint8_t addr, uint8_t data_len,
+                          const uint8_t *ids, const uint8_t *data, int n_ids, uint64_t trace_id);
+
+// Submit queued work, wait up to timeout_ns (< 0: forever, 0: don't wait)
+// for a completion unless frames are already queued, and handle every
+// completion. Copies up to max_frames frames to out (stamped with the time
+// their read was reaped) and fills ev if not NULL.
+// Returns the number of frames, or Q8_ERR_IO.
+int q8_reactor_poll(q8_reactor_t *r, cyton_frame_t *out, int max_frames,
+                    int64_t timeout_ns, q8_reactor_events_t *ev);
+
+// Frames decoded but not yet returned by poll
+int q8_reactor_pending(const q8_reactor_t *r);
+
+int q8_reactor_get_stats(const q8_reactor_t *r, q8_reactor_stats_t *out);
+
+#endif // Q8_REACTOR_H
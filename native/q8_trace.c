@@ -0,0 +1,398 @@
+/*******************************************************************************
+* q8_trace - latency tracing across threads, exported as Chrome trace JSON
+*
+* Each ring has a single writer (its thread). The writer fences (release)
+* after the previous head store, stores the event, then publishes it by
+* advancing `head` with release order. The exporter reads `head` with
+* acquire order, copies at most the last capacity events, fences (acquire)
+* and rereads `head` (seqlock style): a copied event is intact iff the
+* writer had not reached its slot again, i.e. its sequence number is above
+* head - capacity. Older copies are discarded (the ring has dropped them), so
+* rings can be written while they are still recording. A restart does not
+* touch other threads' heads: it records where each ring stood (`base`)
+* and the export starts there.
+*
+* Rings are never freed, so events of threads that have exited are still
+* exported.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "q8_trace.h"
+
+#define MIN_EVENTS  1024
+
+enum { EV_SPAN = 0, EV_INSTANT = 1 };
+
+typedef struct {
+    int64_t  t0_ns;
+    int64_t  t1_ns;
+    uint64_t id;
+    uint32_t name;
+    uint32_t kind;
+} trace_event_t;
+
+_Static_assert(sizeof(trace_event_t) == 32, "events should stay one half cache line");
+
+typedef struct {
+    trace_event_t *ev;
+    uint64_t mask;
+    _Atomic uint64_t head;       // events ever recorded (writer only)
+    _Atomic uint64_t base;       // head at the last start
+    int tid;
+    char name[Q8_TRACE_NAME_LEN];
+} trace_ring_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int g_enabled;
+static int g_capacity = Q8_TRACE_DEFAULT_EVENTS;
+
+static trace_ring_t *g_rings[Q8_TRACE_MAX_THREADS];
+static atomic_int g_n_rings;
+static _Atomic uint64_t g_lost;
+
+static char g_names[Q8_TRACE_MAX_NAMES][Q8_TRACE_NAME_LEN];
+static int g_n_names;
+
+static __thread trace_ring_t *t_ring;
+static __thread int t_no_ring;
+static __thread char t_name[Q8_TRACE_NAME_LEN];
+
+// Names longer than Q8_TRACE_NAME_LEN - 1 are cut
+static void copy_name(char *dst, const char *src)
+{
+    snprintf(dst, Q8_TRACE_NAME_LEN, "%s", src);
+}
+
+// ----------------------------------------------------------------------------
+// Recording
+// ----------------------------------------------------------------------------
+static trace_ring_t *thread_ring(void)
+{
+    if (t_ring || t_no_ring)
+        return t_ring;
+
+    pthread_mutex_lock(&g_lock);
+    int n = atomic_load(&g_n_rings);
+    trace_ring_t *r = n < Q8_TRACE_MAX_THREADS ? calloc(1, sizeof(*r)) : NULL;
+    if (r) {
+        r->ev = calloc((size_t)g_capacity, sizeof(trace_event_t));
+        if (!r->ev) {
+            free(r);
+            r = NULL;
+        }
+    }
+    if (r) {
+        r->mask = (uint64_t)g_capacity - 1;
+        r->tid = (int)syscall(SYS_gettid);
+        if (t_name[0])
+            copy_name(r->name, t_name);
+        else
+            pthread_getname_np(pthread_self(), r->name, sizeof(r->name));
+        g_rings[n] = r;
+        atomic_store(&g_n_rings, n + 1);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    t_ring = r;
+    t_no_ring = r == NULL;
+    return r;
+}
+
+static void record(int name, uint32_t kind, int64_t t0_ns, int64_t t1_ns, uint64_t id)
+{
+    if (!atomic_load_explicit(&g_enabled, memory_order_relaxed) || name < 0)
+        return;
+    trace_ring_t *r = thread_ring();
+    if (!r) {
+        atomic_fetch_add_explicit(&g_lost, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    // The head store of the previous event is visible before this slot changes
+    atomic_thread_fence(memory_order_release);
+    trace_event_t *e = &r->ev[h & r->mask];
+    e->t0_ns = t0_ns;
+    e->t1_ns = t1_ns;
+    e->id = id;
+    e->name = (uint32_t)name;
+    e->kind = kind;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+void q8_trace_span(int name, int64_t t0_ns, int64_t t1_ns, uint64_t id)
+{
+    record(name, EV_SPAN, t0_ns, t1_ns, id);
+}
+
+void q8_trace_instant(int name, int64_t t_ns, uint64_t id)
+{
+    record(name, EV_INSTANT, t_ns, t_ns, id);
+}
+
+int q8_trace_start(int events_per_thread)
+{
+    if (events_per_thread < 0 || events_per_thread > (1 << 24))
+        return Q8_ERR_ARG;
+    int cap = MIN_EVENTS;
+    while (cap < (events_per_thread ? events_per_thread : Q8_TRACE_DEFAULT_EVENTS))
+        cap <<= 1;
+
+    pthread_mutex_lock(&g_lock);
+    g_capacity = cap;
+    int n = atomic_load(&g_n_rings);
+    for (int i = 0; i < n; ++i)
+        atomic_store(&g_rings[i]->base, atomic_load(&g_rings[i]->head));
+    atomic_store(&g_lost, 0);
+    atomic_store(&g_enabled, 1);
+    pthread_mutex_unlock(&g_lock);
+    return Q8_OK;
+}
+
+void q8_trace_stop(void)
+{
+    atomic_store(&g_enabled, 0);
+}
+
+int q8_trace_enabled(void)
+{
+    return atomic_load_explicit(&g_enabled, memory_order_relaxed);
+}
+
+int q8_trace_name(const char *name)
+{
+    if (!name || !name[0])
+        return Q8_ERR_ARG;
+    char key[Q8_TRACE_NAME_LEN];
+    copy_name(key, name);
+
+    pthread_mutex_lock(&g_lock);
+    int id = 0;
+    while (id < g_n_names && strcmp(g_names[id], key) != 0)
+        id++;
+    if (id == g_n_names) {
+        if (g_n_names == Q8_TRACE_MAX_NAMES)
+            id = Q8_ERR_FULL;
+        else
+            copy_name(g_names[g_n_names++], key);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return id;
+}
+
+void q8_trace_thread_name(const char *name)
+{
+    if (!name)
+        return;
+    copy_name(t_name, name);
+    if (t_ring) {
+        pthread_mutex_lock(&g_lock);
+        copy_name(t_ring->name, name);
+        pthread_mutex_unlock(&g_lock);
+    }
+}
+
+// Retained events of a ring: [*first, head)
+static uint64_t ring_range(trace_ring_t *r, uint64_t *first)
+{
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t base = atomic_load(&r->base);
+    uint64_t cap = r->mask + 1;
+    *first = head - base > cap ? head - cap : base;
+    return head;
+}
+
+int q8_trace_get_stats(q8_trace_stats_t *out)
+{
+    if (!out)
+        return Q8_ERR_ARG;
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&g_lock);
+    int n = atomic_load(&g_n_rings);
+    for (int i = 0; i < n; ++i) {
+        uint64_t first, head = ring_range(g_rings[i], &first);
+        uint64_t base = atomic_load(&g_rings[i]->base);
+        out->events += head - base;
+        out->dropped += first - base;
+    }
+    out->lost = atomic_load(&g_lost);
+    out->threads = n;
+    out->enabled = q8_trace_enabled();
+    pthread_mutex_unlock(&g_lock);
+    return Q8_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Chrome trace-event JSON
+// ----------------------------------------------------------------------------
+typedef struct {
+    uint64_t id;
+    int64_t  t_ns;
+    int      tid;
+} flow_point_t;
+
+static int cmp_flow(const void *a, const void *b)
+{
+    const flow_point_t *x = a, *y = b;
+    if (x->id != y->id)
+        return (x->id > y->id) - (x->id < y->id);
+    return (x->t_ns > y->t_ns) - (x->t_ns < y->t_ns);
+}
+
+static void put_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+// Microseconds with ns resolution, printed from the integer (no rounding)
+static void put_us(FILE *f, int64_t ns)
+{
+    if (ns < 0) {
+        fputc('-', f);
+        ns = -ns;
+    }
+    fprintf(f, "%lld.%03lld", (long long)(ns / 1000), (long long)(ns % 1000));
+}
+
+static void put_event_head(FILE *f, int *first, const char *name, const char *ph, int pid, int tid)
+{
+    fputs(*first ? "\n" : ",\n", f);
+    *first = 0;
+    fputs("{\"name\":", f);
+    put_string(f, name);
+    fprintf(f, ",\"cat\":\"q8\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d", ph, pid, tid);
+}
+
+int q8_trace_write(const char *path, const char *process_name, int64_t clock_offset_ns)
+{
+    if (!path)
+        return Q8_ERR_ARG;
+
+    pthread_mutex_lock(&g_lock);
+    int n_rings = atomic_load(&g_n_rings);
+    uint64_t first[Q8_TRACE_MAX_THREADS], head[Q8_TRACE_MAX_THREADS];
+    size_t total = 0;
+    for (int i = 0; i < n_rings; ++i) {
+        head[i] = ring_range(g_rings[i], &first[i]);
+        total += head[i] - first[i];
+    }
+
+    flow_point_t *flow = malloc((total ? total : 1) * sizeof(*flow));
+    trace_event_t *snap = malloc((total ? total : 1) * sizeof(*snap));
+    FILE *f = flow && snap ? fopen(path, "w") : NULL;
+    if (!f) {
+        int err = flow && snap ? errno : ENOMEM;
+        pthread_mutex_unlock(&g_lock);
+        free(flow);
+        free(snap);
+        errno = err;
+        return err == ENOMEM ? Q8_ERR_NOMEM : Q8_ERR_IO;
+    }
+
+    // Copy each ring, then drop the events its writer overwrote meanwhile
+    // (the slot of the event at head - capacity may be half written)
+    trace_event_t *ring_snap[Q8_TRACE_MAX_THREADS];
+    size_t off = 0;
+    for (int i = 0; i < n_rings; ++i) {
+        const trace_ring_t *r = g_rings[i];
+        ring_snap[i] = snap + off;
+        for (uint64_t k = first[i]; k < head[i]; ++k)
+            snap[off++] = r->ev[k & r->mask];
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t now = atomic_load_explicit(&g_rings[i]->head, memory_order_relaxed);
+        uint64_t cap = r->mask + 1;
+        if (now >= cap && now - cap + 1 > first[i]) {
+            uint64_t valid = now - cap + 1 < head[i] ? now - cap + 1 : head[i];
+            ring_snap[i] += valid - first[i];
+            first[i] = valid;
+        }
+    }
+
+    int pid = (int)getpid();
+    int first_ev = 1;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"clock_offset_ns\":%lld,\"process\":",
+            (long long)clock_offset_ns);
+    put_string(f, process_name ? process_name : "");
+    fputs("},\"traceEvents\":[", f);
+
+    if (process_name && process_name[0]) {
+        put_event_head(f, &first_ev, "process_name", "M", pid, 0);
+        fputs(",\"args\":{\"name\":", f);
+        put_string(f, process_name);
+        fputs("}}", f);
+    }
+
+    size_t n_flow = 0;
+    int written = 0;
+    for (int i = 0; i < n_rings; ++i) {
+        const trace_ring_t *r = g_rings[i];
+        if (r->name[0]) {
+            put_event_head(f, &first_ev, "thread_name", "M", pid, r->tid);
+            fputs(",\"args\":{\"name\":", f);
+            put_string(f, r->name);
+            fputs("}}", f);
+        }
+        for (uint64_t k = first[i]; k < head[i]; ++k) {
+            const trace_event_t *e = &ring_snap[i][k - first[i]];
+            const char *name = e->name < (uint32_t)g_n_names ? g_names[e->name] : "?";
+            put_event_head(f, &first_ev, name, e->kind == EV_SPAN ? "X" : "i", pid, r->tid);
+            fputs(",\"ts\":", f);
+            put_us(f, e->t0_ns + clock_offset_ns);
+            if (e->kind == EV_SPAN) {
+                fputs(",\"dur\":", f);
+                put_us(f, e->t1_ns > e->t0_ns ? e->t1_ns - e->t0_ns : 0);
+            } else {
+                fputs(",\"s\":\"t\"", f);
+            }
+            fprintf(f, ",\"args\":{\"id\":%llu}}", (unsigned long long)e->id);
+            written++;
+
+            if (e->id)
+                flow[n_flow++] = (flow_point_t){ e->id, e->t0_ns, r->tid };
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    // One arrow chain per trace id: start, steps, finish on the last event
+    qsort(flow, n_flow, sizeof(*flow), cmp_flow);
+    for (size_t a = 0, b; a < n_flow; a = b) {
+        for (b = a + 1; b < n_flow && flow[b].id == flow[a].id; ++b)
+            ;
+        if (b - a < 2)
+            continue;
+        for (size_t k = a; k < b; ++k) {
+            const char *ph = k == a ? "s" : k == b - 1 ? "f" : "t";
+            put_event_head(f, &first_ev, "decision", ph, pid, flow[k].tid);
+            fprintf(f, ",\"id\":%llu,\"ts\":", (unsigned long long)flow[k].id);
+            put_us(f, flow[k].t_ns + clock_offset_ns);
+            fputs(k == b - 1 ? ",\"bp\":\"e\"}" : "}", f);
+        }
+    }
+    fputs("\n]}\n", f);
+    free(flow);
+    free(snap);
+
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed)
+        return Q8_ERR_IO;
+    return written;
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************
+* q8_trace - latency tracing across threads, exported as Chrome trace JSON
+*
+* Spans (stage name, start, end, trace id) are recorded into a ring owned by
+* the calling thread: the ring is allocated and registered on the thread's
+* first event, every later event is one store and a release of the ring
+* head, without locks or syscalls. When a ring wraps, its oldest events are
+* overwritten (counted as dropped).
+*
+* The trace id ties the stages of one decision together: it is the seq of
+* the Cyton frame that completed the decision window, carried through the
+* classifier, the gesture link and the motion loop to the sync write that
+* acted on it. 0 means "not part of a chain" (frame 0 never completes a
+* window).
+*
+* q8_trace_write() exports what the rings hold as trace-event JSON
+* (chrome://tracing, ui.perfetto.dev): a complete event per span, instant
+* events, thread names, and flow arrows linking the events of each trace id
+* in time order. Timestamps are CLOCK_MONOTONIC plus clock_offset_ns, so a
+* process can write its trace on another host's clock (the robot uses the
+* gesture link's offset estimate) and trace_summary.py can merge the files.
+*
+* Recording is off until q8_trace_start(). q8_trace_write() may run while
+* threads still record: each ring is copied and checked against its head
+* afterwards, and events overwritten during the copy are left out.
+*******************************************************************************/
+
+#ifndef Q8_TRACE_H
+#define Q8_TRACE_H
+
+#include "q8native.h"
+
+#define Q8_TRACE_MAX_THREADS    64
+#define Q8_TRACE_MAX_NAMES      256
+#define Q8_TRACE_NAME_LEN       32
+#define Q8_TRACE_DEFAULT_EVENTS 65536   // per thread (32 bytes each)
+
+typedef struct {
+    uint64_t events;           // recorded since the last start
+    uint64_t dropped;          // overwritten by newer events
+    uint64_t lost;             // no ring: thread table full or allocation failed
+    int      threads;          // threads with a ring
+    int      enabled;
+} q8_trace_stats_t;
+
+// Start recording with rings of events_per_thread (rounded up to a power of
+// two; 0: default) for threads that record their first event from now on.
+// Events recorded before are discarded.
+int q8_trace_start(int events_per_thread);
+void q8_trace_stop(void);
+int q8_trace_enabled(void);
+
+// Id for a stage name (interned; the same name always gives the same id)
+int q8_trace_name(const char *name);
+
+// Name the calling thread in the exported trace (no ring is allocated)
+void q8_trace_thread_name(const char *name);
+
+// Record on the calling thread's ring; no-ops while stopped. Times are
+// CLOCK_MONOTONIC ns (cyton_monotonic_ns()).
+void q8_trace_span(int name, int64_t t0_ns, int64_t t1_ns, uint64_t id);
+void q8_trace_instant(int name, int64_t t_ns, uint64_t id);
+
+// Write every retained event to path. Returns the number of events or
+// Q8_ERR_IO / Q8_ERR_NOMEM.
+int q8_trace_write(const char *path, const char *process_name, int64_t clock_offset_ns);
+
+int q8_trace_get_stats(q8_trace_stats_t *out);
+
+#endif // Q8_TRACE_H
@@ -0,0 +1,35 @@
+/*******************************************************************************
+* q8native - shared definitions for the native EMG / control library
+*******************************************************************************/
+
+#ifndef Q8NATIVE_H
+#define Q8NATIVE_H
+
+#include <stdint.h>
+
+// Return codes used by every module (0 = success, negative = failure)
+#define Q8_OK           0
+#define Q8_ERR_ARG     -1   // bad argument (range, NULL pointer, ...)
+#define Q8_ERR_FULL    -2   // fixed-size table is full
+#define Q8_ERR_NOMEM   -3   // allocation failed
+#define Q8_ERR_IO      -4   // syscall / device failure (errno is preserved)
+
+// Cyton streams 8 channels; 16 with the Daisy module attached
+#define Q8_MAX_CHANNELS 16
+
+// Channel vectors are padded to a multiple of this so the per-sample inner
+// loops run as whole SIMD vectors (4 doubles = 2 NEON / 1 AVX register)
+#define Q8_LANES        4
+#define Q8_PAD_CHANNELS(n) (((n) + Q8_LANES - 1) / Q8_LANES * Q8_LANES)
+
+typedef double  q8_vec_t  __attribute__((vector_size(Q8_LANES * sizeof(double))));
+typedef int64_t q8_ivec_t __attribute__((vector_size(Q8_LANES * sizeof(int64_t))));
+
+// Lane-wise |x| (clears the sign bits)
+static inline q8_vec_t q8_vabs(q8_vec_t x)
+{
+    const q8_ivec_t mask = (q8_ivec_t){0} + INT64_MAX;
+    return (q8_vec_t)((q8_ivec_t)x & mask);
+}
+
+#endif // Q8NATIVE_H
@@ -0,0 +1,2357 @@
+"""
+Python bindings for libq8native.so
+
+Build the library first:
+    cd native
+    make
+
+Scripts outside this directory add it to sys.path, e.g.
+    sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..', 'native'))
+    from q8native import FilterBank
+
+Arrays are passed to C without copying when they are already C-contiguous
+with the expected dtype (float64 samples, shape (n_samples, n_channels)).
+"""
+
+import ctypes
+import os
+import time
+
+import numpy as np
+
+LIB_NAME = "libq8native.so"
+
+# Return codes (q8native.h)
+Q8_OK = 0
+Q8_ERR_ARG = -1
+Q8_ERR_FULL = -2
+Q8_ERR_NOMEM = -3
+Q8_ERR_IO = -4
+
+MAX_CHANNELS = 16
+
+# Cyton sample rate
+CYTON_FS = 250.0
+
+
+def _load_library():
+    path = os.environ.get(
+        "Q8NATIVE_LIB",
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), LIB_NAME)
+    )
+    try:
+        return ctypes.CDLL(path, use_errno=True)
+    except OSError as e:
+        raise ImportError(f"Could not load {path}: {e}\nBuild it with: make -C native")
+
+
+_lib = _load_library()
+
+_f64_p = np.ctypeslib.ndpointer(dtype=np.float64, flags="C_CONTIGUOUS")
+_i32_p = np.ctypeslib.ndpointer(dtype=np.int32, flags="C_CONTIGUOUS")
+
+
+def _check(rc, what):
+    """Raise on a negative q8native return code"""
+    if rc == Q8_ERR_ARG:
+        raise ValueError(f"{what}: invalid argument")
+    if rc == Q8_ERR_FULL:
+        raise RuntimeError(f"{what}: table full")
+    if rc == Q8_ERR_NOMEM:
+        raise MemoryError(f"{what}: out of memory")
+    if rc == Q8_ERR_IO:
+        raise OSError(ctypes.get_errno(), f"{what}: I/O error")
+    return rc
+
+
+def _as_samples(x, n_channels):
+    """View x as a C-contiguous (n_samples, n_channels) array, copying only if needed"""
+    x = np.asarray(x)
+    if x.ndim == 1:
+        x = x.reshape(-1, n_channels)
+    if x.ndim != 2 or x.shape[1] != n_channels:
+        raise ValueError(f"expected shape (n, {n_channels}), got {x.shape}")
+    if x.dtype != np.int32:
+        x = np.ascontiguousarray(x, dtype=np.float64)
+    else:
+        x = np.ascontiguousarray(x)
+    return x
+
+
+# ----------------------------
+# emg_filter
+# ----------------------------
+_lib.emg_filter_create.restype = ctypes.c_void_p
+_lib.emg_filter_create.argtypes = [ctypes.c_int, ctypes.c_double]
+_lib.emg_filter_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_filter_add_bandpass.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double, ctypes.c_int]
+_lib.emg_filter_add_notch.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double]
+_lib.emg_filter_add_dc_block.argtypes = [ctypes.c_void_p, ctypes.c_double]
+_lib.emg_filter_add_section.argtypes = [ctypes.c_void_p, _f64_p]
+_lib.emg_filter_num_sections.argtypes = [ctypes.c_void_p]
+_lib.emg_filter_get_sos.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int]
+_lib.emg_filter_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_filter_prime.argtypes = [ctypes.c_void_p, _f64_p]
+_lib.emg_filter_process.argtypes = [ctypes.c_void_p, _f64_p, _f64_p, ctypes.c_int]
+_lib.emg_filter_process_i32.argtypes = [ctypes.c_void_p, _i32_p, _f64_p, ctypes.c_int]
+
+
+class FilterBank:
+    """
+    Multichannel band-pass / notch / DC-removal filter (second-order sections).
+
+    Config keys (all optional), also stored as model_data['filter']:
+        low, high:   band-pass corners in Hz (default 20-100 for the 250 Hz Cyton)
+        order:       Butterworth order per band edge (default 4)
+        notch:       mains frequency, 50 or 60 (None/0 disables)
+        notch_q:     notch quality factor (default 30)
+        harmonics:   also notch multiples of the mains frequency below Nyquist
+        dc_block:    DC blocker corner in Hz (None/0 disables)
+
+    The filter keeps its state between process() calls, so feed it the
+    stream chunk by chunk. The first chunk primes the state to the steady
+    state of its first sample to avoid the DC-offset transient.
+    Priming does not settle the notch on mains already in the signal (about
+    1.5 s), so a stored window is filtered with the samples before it, not
+    on its own (emg_features.sample_window).
+    """
+
+    DEFAULTS = {
+        'low': 20.0,
+        'high': 100.0,
+        'order': 4,
+        'notch': 60.0,
+        'notch_q': 30.0,
+        'harmonics': False,
+        'dc_block': 1.0,
+    }
+
+    def __init__(self, n_channels, fs=CYTON_FS, config=None):
+        self.n_channels = n_channels
+        self.fs = fs
+        self.config = dict(self.DEFAULTS)
+        if config:
+            self.config.update(config)
+
+        self._h = _lib.emg_filter_create(n_channels, fs)
+        if not self._h:
+            raise ValueError(f"Cannot create filter for {n_channels} channels at {fs} Hz")
+
+        cfg = self.config
+        if cfg.get('dc_block'):
+            _check(_lib.emg_filter_add_dc_block(self._h, cfg['dc_block']), "dc_block")
+        if cfg.get('low') and cfg.get('high'):
+            _check(_lib.emg_filter_add_bandpass(self._h, cfg['low'], cfg['high'], int(cfg['order'])),
+                   "bandpass")
+        if cfg.get('notch'):
+            f0 = cfg['notch']
+            while f0 < fs / 2.0:
+                _check(_lib.emg_filter_add_notch(self._h, f0, cfg['notch_q']), "notch")
+                if not cfg.get('harmonics'):
+                    break
+                f0 += cfg['notch']
+
+        self._primed = False
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_filter_destroy(self._h)
+            self._h = None
+
+    @property
+    def sos(self):
+        """Section coefficients in scipy sos layout, shape (n_sections, 6)"""
+        n = _lib.emg_filter_num_sections(self._h)
+        out = np.zeros((max(n, 1), 6))
+        _lib.emg_filter_get_sos(self._h, out, n)
+        return out[:n]
+
+    def reset(self):
+        """Zero filter state; the next chunk primes it again"""
+        _lib.emg_filter_reset(self._h)
+        self._primed = False
+
+    def process(self, x, out=None):
+        """
+        Filter a chunk of shape (n_samples, n_channels).
+        int32 or float64 input is read in place; returns float64.
+        """
+        x = _as_samples(x, self.n_channels)
+        n = x.shape[0]
+        if out is None:
+            out = np.empty((n, self.n_channels), dtype=np.float64)
+        if n == 0:
+            return out
+
+        if not self._primed:
+            _lib.emg_filter_prime(self._h, np.ascontiguousarray(x[0], dtype=np.float64))
+            self._primed = True
+
+        if x.dtype == np.int32:
+            _lib.emg_filter_process_i32(self._h, x, out, n)
+        else:
+            _lib.emg_filter_process(self._h, x, out, n)
+        return out
+
+
+# ----------------------------
+# emg_envelope
+# ----------------------------
+_lib.emg_envelope_create.restype = ctypes.c_void_p
+_lib.emg_envelope_create.argtypes = [ctypes.c_int, ctypes.c_double, ctypes.c_double, ctypes.c_int]
+_lib.emg_envelope_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_envelope_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_envelope_window.argtypes = [ctypes.c_void_p]
+_lib.emg_envelope_process.argtypes = [ctypes.c_void_p, _f64_p, _f64_p, ctypes.c_int]
+_lib.emg_envelope_process_i32.argtypes = [ctypes.c_void_p, _i32_p, _f64_p, ctypes.c_int]
+
+ENVELOPE_MODES = {'rms': 0, 'mav': 1, 'linear': 2}
+
+
+class Envelope:
+    """
+    Multichannel amplitude envelope with O(1) work per sample.
+
+    mode:
+        'rms'     moving RMS over window_ms
+        'mav'     moving mean absolute value over window_ms
+        'linear'  rectified signal through a one-pole low-pass (time constant window_ms)
+
+    int32 input (raw Cyton counts) uses exact integer running sums; float64
+    input uses Kahan-compensated sums. Both are read in place and the result
+    is written into `out` when given.
+    """
+
+    def __init__(self, n_channels, fs=CYTON_FS, window_ms=50, mode='rms'):
+        if mode not in ENVELOPE_MODES:
+            raise ValueError(f"Unknown envelope mode '{mode}'. Must be one of: {sorted(ENVELOPE_MODES)}")
+        self.n_channels = n_channels
+        self.fs = fs
+        self.window_ms = window_ms
+        self.mode = mode
+        self._h = _lib.emg_envelope_create(n_channels, fs, window_ms, ENVELOPE_MODES[mode])
+        if not self._h:
+            raise ValueError(f"Cannot create envelope for {n_channels} channels, {window_ms} ms at {fs} Hz")
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_envelope_destroy(self._h)
+            self._h = None
+
+    @property
+    def window(self):
+        """Window length in samples"""
+        return _lib.emg_envelope_window(self._h)
+
+    def reset(self):
+        _lib.emg_envelope_reset(self._h)
+
+    def process(self, x, out=None):
+        """Envelope of a chunk of shape (n_samples, n_channels), returns float64"""
+        x = _as_samples(x, self.n_channels)
+        n = x.shape[0]
+        if out is None:
+            out = np.empty((n, self.n_channels), dtype=np.float64)
+        elif out.dtype != np.float64 or not out.flags['C_CONTIGUOUS'] or out.shape != x.shape:
+            raise ValueError("out must be a C-contiguous float64 array shaped like x")
+
+        if x.dtype == np.int32:
+            _lib.emg_envelope_process_i32(self._h, x, out, n)
+        else:
+            _lib.emg_envelope_process(self._h, x, out, n)
+        return out
+
+
+# ----------------------------
+# emg_multiscale
+# ----------------------------
+_lib.emg_multiscale_create.restype = ctypes.c_void_p
+_lib.emg_multiscale_create.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_int), ctypes.c_int]
+_lib.emg_multiscale_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_multiscale_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_multiscale_num_features.argtypes = [ctypes.c_void_p]
+_lib.emg_multiscale_count.argtypes = [ctypes.c_void_p]
+_lib.emg_multiscale_push.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int]
+_lib.emg_multiscale_features.argtypes = [ctypes.c_void_p, _f64_p]
+_lib.emg_multiscale_window.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int, _f64_p]
+
+MULTISCALE_FEATURES = ['MAV', 'RMS', 'WL', 'ZC', 'SSC', 'VAR']
+
+
+class MultiScaleFeatures:
+    """
+    Time-domain features over several window lengths from shared prefix sums.
+
+    push() the stream sample by sample (or in chunks); features() then
+    returns MAV, RMS, WL, ZC, SSC and VAR of the windows ending at the newest
+    sample for every scale, laid out [scale][channel][feature]. Each scale
+    costs O(1) per channel regardless of its length.
+
+    extract() computes the same vector for one stored window (training).
+    """
+
+    def __init__(self, n_channels, windows=(50, 100, 200)):
+        self.n_channels = n_channels
+        self.windows = [int(w) for w in windows]
+        arr = (ctypes.c_int * len(self.windows))(*self.windows)
+        self._h = _lib.emg_multiscale_create(n_channels, arr, len(self.windows))
+        if not self._h:
+            raise ValueError(f"Cannot create multi-scale features for {n_channels} channels, windows {windows}")
+        self.num_features = _lib.emg_multiscale_num_features(self._h)
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_multiscale_destroy(self._h)
+            self._h = None
+
+    @property
+    def count(self):
+        """Samples pushed since the last reset"""
+        return _lib.emg_multiscale_count(self._h)
+
+    def names(self):
+        return [f"Ch{ch+1}_{feat}_{w}"
+                for w in self.windows
+                for ch in range(self.n_channels)
+                for feat in MULTISCALE_FEATURES]
+
+    def reset(self):
+        _lib.emg_multiscale_reset(self._h)
+
+    def push(self, x):
+        """Append a chunk of shape (n_samples, n_channels)"""
+        x = _as_samples(x, self.n_channels)
+        if x.dtype != np.float64:
+            x = x.astype(np.float64)
+        if x.shape[0]:
+            _lib.emg_multiscale_push(self._h, x, x.shape[0])
+
+    def features(self, out=None):
+        """Feature vector for the windows ending at the newest sample"""
+        if out is None:
+            out = np.empty(self.num_features, dtype=np.float64)
+        elif out.dtype != np.float64 or not out.flags['C_CONTIGUOUS'] or out.size != self.num_features:
+            raise ValueError(f"out must be a C-contiguous float64 array of {self.num_features} values")
+        _check(_lib.emg_multiscale_features(self._h, out), "multiscale features")
+        return out
+
+    def extract(self, window, out=None):
+        """Feature vector of one stored window (resets the stream state)"""
+        x = _as_samples(window, self.n_channels)
+        if x.dtype != np.float64:
+            x = x.astype(np.float64)
+        if out is None:
+            out = np.empty(self.num_features, dtype=np.float64)
+        _check(_lib.emg_multiscale_window(self._h, x, x.shape[0], out), "multiscale window")
+        return out
+
+
+# ----------------------------
+# emg_spectral
+# ----------------------------
+_lib.emg_spectral_create.restype = ctypes.c_void_p
+_lib.emg_spectral_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_double,
+                                     ctypes.POINTER(ctypes.c_double), ctypes.c_int]
+_lib.emg_spectral_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_spectral_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_spectral_num_features.argtypes = [ctypes.c_void_p]
+_lib.emg_spectral_count.argtypes = [ctypes.c_void_p]
+_lib.emg_spectral_push.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int]
+_lib.emg_spectral_features.argtypes = [ctypes.c_void_p, _f64_p]
+_lib.emg_spectral_window.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int, _f64_p]
+
+SPECTRAL_BAND_EDGES = (10.0, 30.0, 60.0, 90.0, 125.0)
+
+
+class SpectralFeatures:
+    """
+    Frequency-domain features of the last `window` samples from a sliding DFT.
+
+    push() the stream sample by sample (or in chunks), each sample updating
+    the window/2 + 2 bins of every channel; features() then returns the mean
+    and median frequency (Hz) and the fraction of the power in each band of
+    band_edges, per channel ([channel][feature]), from the Hann-windowed
+    periodogram of the window with its mean removed.
+
+    extract() computes the same vector for one stored window (training).
+    """
+
+    def __init__(self, n_channels, window=200, fs=CYTON_FS, band_edges=SPECTRAL_BAND_EDGES):
+        self.n_channels = n_channels
+        self.window = int(window)
+        self.band_edges = [float(e) for e in band_edges]
+        edges = (ctypes.c_double * len(self.band_edges))(*self.band_edges)
+        self._h = _lib.emg_spectral_create(n_channels, self.window, fs, edges, len(self.band_edges) - 1)
+        if not self._h:
+            raise ValueError(f"Cannot create spectral features for {n_channels} channels, "
+                             f"window {window}, bands {band_edges}")
+        self.num_features = _lib.emg_spectral_num_features(self._h)
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_spectral_destroy(self._h)
+            self._h = None
+
+    @property
+    def count(self):
+        """Samples pushed since the last reset"""
+        return _lib.emg_spectral_count(self._h)
+
+    def names(self):
+        bands = [f"BP{lo:g}_{hi:g}" for lo, hi in zip(self.band_edges, self.band_edges[1:])]
+        return [f"Ch{ch+1}_{feat}" for ch in range(self.n_channels) for feat in ['MNF', 'MDF'] + bands]
+
+    def reset(self):
+        _lib.emg_spectral_reset(self._h)
+
+    def push(self, x):
+        """Append a chunk of shape (n_samples, n_channels)"""
+        x = _as_samples(x, self.n_channels)
+        if x.dtype != np.float64:
+            x = x.astype(np.float64)
+        if x.shape[0]:
+            _lib.emg_spectral_push(self._h, x, x.shape[0])
+
+    def features(self, out=None):
+        """Feature vector for the window ending at the newest sample"""
+        if out is None:
+            out = np.empty(self.num_features, dtype=np.float64)
+        elif out.dtype != np.float64 or not out.flags['C_CONTIGUOUS'] or out.size != self.num_features:
+            raise ValueError(f"out must be a C-contiguous float64 array of {self.num_features} values")
+        _check(_lib.emg_spectral_features(self._h, out), "spectral features")
+        return out
+
+    def extract(self, window, out=None):
+        """Feature vector of one stored window (resets the stream state)"""
+        x = _as_samples(window, self.n_channels)
+        if x.dtype != np.float64:
+            x = x.astype(np.float64)
+        if out is None:
+            out = np.empty(self.num_features, dtype=np.float64)
+        _check(_lib.emg_spectral_window(self._h, x, x.shape[0], out), "spectral window")
+        return out
+
+
+# ----------------------------
+# emg_decision
+# ----------------------------
+class _DecisionConfig(ctypes.Structure):
+    _fields_ = [
+        ("vote_window", ctypes.c_int),
+        ("prob_window", ctypes.c_int),
+        ("enter_threshold", ctypes.c_double),
+        ("exit_threshold", ctypes.c_double),
+        ("hold_ms", ctypes.c_double),
+        ("cooldown_ms", ctypes.c_double),
+        ("stop_label", ctypes.c_int),
+    ]
+
+
+_lib.emg_decision_create.restype = ctypes.c_void_p
+_lib.emg_decision_create.argtypes = [ctypes.c_int, ctypes.POINTER(_DecisionConfig)]
+_lib.emg_decision_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_decision_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_decision_update.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_double]
+_lib.emg_decision_tick.argtypes = [ctypes.c_void_p, ctypes.c_double]
+_lib.emg_decision_confidence.restype = ctypes.c_double
+_lib.emg_decision_confidence.argtypes = [ctypes.c_void_p]
+
+DECISION_NONE = -1
+
+
+class DecisionStage:
+    """
+    Gesture post-processing: probability averaging, majority voting,
+    hysteresis, cooldown and hold (see emg_decision.h for the order).
+
+    classes:      label strings; probabilities passed to update() must use
+                  the same order (e.g. model.classes_)
+    stop:         label that is never delayed by cooldown or hold
+    enter/exit:   hysteresis thresholds on the confidence (0 disables)
+
+    update() takes the raw label (or None), the probabilities (optional)
+    and a timestamp in seconds, and returns the label to act on or None.
+    A label that is not one of the classes raises ValueError. tick() gives
+    the label to act on between decisions (a hold may have run out).
+    """
+
+    def __init__(self, classes, vote_window=1, prob_window=1, enter=0.0, exit=0.0,
+                 hold_ms=0.0, cooldown_ms=0.0, stop='stop'):
+        self.classes = list(classes)
+        self._index = {label: i for i, label in enumerate(self.classes)}
+        cfg = _DecisionConfig(
+            vote_window=int(vote_window),
+            prob_window=int(prob_window),
+            enter_threshold=float(enter),
+            exit_threshold=float(exit),
+            hold_ms=float(hold_ms),
+            cooldown_ms=float(cooldown_ms),
+            stop_label=self._index.get(stop, DECISION_NONE),
+        )
+        self._h = _lib.emg_decision_create(len(self.classes), ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid decision stage settings for {len(self.classes)} classes "
+                             f"(windows 1-256, exit <= enter, non-negative times)")
+        self._probs = np.zeros(len(self.classes), dtype=np.float64)
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_decision_destroy(self._h)
+            self._h = None
+
+    def reset(self):
+        _lib.emg_decision_reset(self._h)
+
+    @property
+    def confidence(self):
+        """Confidence of the last returned label"""
+        return _lib.emg_decision_confidence(self._h)
+
+    def update(self, label, probabilities=None, t=None):
+        """Feed one classifier decision; t in seconds (default: time.monotonic())"""
+        if t is None:
+            t = time.monotonic()
+        if label is None:
+            idx = DECISION_NONE
+        elif label in self._index:
+            idx = self._index[label]
+        else:
+            raise ValueError(f"Unknown label {label!r} (classes: {', '.join(map(str, self.classes))})")
+        probs_p = None
+        if probabilities is not None:
+            self._probs[:] = probabilities
+            probs_p = self._probs.ctypes.data
+        out = _lib.emg_decision_update(self._h, idx, probs_p, 1000.0 * t)
+        return None if out == DECISION_NONE else self.classes[out]
+
+    def tick(self, t=None):
+        """The label to act on at t without a new decision (no vote is added)"""
+        if t is None:
+            t = time.monotonic()
+        out = _lib.emg_decision_tick(self._h, 1000.0 * t)
+        return None if out == DECISION_NONE else self.classes[out]
+
+
+# ----------------------------
+# cyton_reader
+# ----------------------------
+CYTON_FRAME = np.dtype([
+    ('seq', '<u8'),
+    ('t_ns', '<i8'),             # CLOCK_MONOTONIC at arrival (time.monotonic_ns() clock)
+    ('channels', '<i4', (8,)),
+    ('accel', '<i2', (3,)),      # aux bytes 26-31; zeros between accelerometer readings
+    ('raw', 'u1', (33,)),
+    ('sample', 'u1'),
+    ('batch', 'u1'),             # frames completed by the same read()
+    ('_pad', 'u1', (7,)),
+])
+assert CYTON_FRAME.itemsize == 96
+CYTON_FRAME_BYTES = 33
+
+
+class _ReaderStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in
+                ("frames", "bytes", "reads", "resync_bytes", "max_batch", "dropped")]
+
+
+_frame_p = np.ctypeslib.ndpointer(dtype=CYTON_FRAME, flags="C_CONTIGUOUS")
+_u8_p = np.ctypeslib.ndpointer(dtype=np.uint8, flags="C_CONTIGUOUS")
+
+_lib.cyton_reader_create.restype = ctypes.c_void_p
+_lib.cyton_reader_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int]
+_lib.cyton_reader_destroy.argtypes = [ctypes.c_void_p]
+_lib.cyton_reader_start.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.cyton_reader_stop.argtypes = [ctypes.c_void_p]
+_lib.cyton_reader_add_consumer.argtypes = [ctypes.c_void_p]
+_lib.cyton_reader_read.argtypes = [ctypes.c_void_p, ctypes.c_int, _frame_p, ctypes.c_int]
+_lib.cyton_reader_pending.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.cyton_reader_skip.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.cyton_reader_wait.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
+_lib.cyton_reader_get_stats.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(_ReaderStats)]
+_lib.cyton_reader_error.argtypes = [ctypes.c_void_p]
+_lib.cyton_reader_record.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+_lib.cyton_monotonic_ns.restype = ctypes.c_int64
+_lib.cyton_extract_frames.argtypes = [_u8_p, ctypes.POINTER(ctypes.c_int), _frame_p, ctypes.c_int,
+                                      ctypes.c_int64, ctypes.POINTER(ctypes.c_uint64)]
+
+
+class CytonReader:
+    """
+    Native acquisition thread for the Cyton serial stream.
+
+    fd is an open serial file descriptor, e.g. ser.fileno() of a pyserial
+    port that has already sent the 'b' start command. While the reader runs
+    it owns all reads on the fd (writes such as 's' are still fine). The
+    fd is put in blocking raw mode for one 33-byte frame per read and
+    restored by stop().
+
+        reader = CytonReader(ser.fileno())
+        classifier = reader.consumer()
+        recorder = reader.consumer()
+        reader.start()
+        frames = classifier.read()      # structured array, dtype CYTON_FRAME
+
+    Each consumer has its own cursor, so several threads can read every
+    frame independently.
+    """
+
+    def __init__(self, fd, baud=0, capacity=4096):
+        self._h = _lib.cyton_reader_create(int(fd), int(baud), int(capacity))
+        if not self._h:
+            raise ValueError(f"Cannot create Cyton reader (fd {fd}, baud {baud}, capacity {capacity})")
+        self.running = False
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.cyton_reader_destroy(self._h)
+            self._h = None
+
+    def start(self, rt_priority=0):
+        """Start the thread; rt_priority > 0 requests SCHED_FIFO when permitted"""
+        _check(_lib.cyton_reader_start(self._h, int(rt_priority)), "cyton_reader_start")
+        self.running = True
+
+    def stop(self):
+        if self._h and self.running:
+            _lib.cyton_reader_stop(self._h)
+            self.running = False
+
+    def consumer(self):
+        return CytonConsumer(self)
+
+    def record(self, recorder):
+        """
+        Copy every chunk read from the port to a CytonRecorder (None: stop).
+        Stop the reader before closing the recorder.
+        """
+        _lib.cyton_reader_record(self._h, recorder._h if recorder else None)
+        self._recorder = recorder
+
+    @property
+    def error(self):
+        """errno of the failure that ended the thread, 0 while healthy"""
+        return _lib.cyton_reader_error(self._h)
+
+    def stats(self, consumer_id=-1):
+        s = _ReaderStats()
+        _lib.cyton_reader_get_stats(self._h, consumer_id, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _ReaderStats._fields_}
+
+
+class CytonConsumer:
+    """One independent cursor into a CytonReader ring (use from one thread)"""
+
+    def __init__(self, reader, max_frames=512):
+        self.reader = reader
+        self.id = _check(_lib.cyton_reader_add_consumer(reader._h), "cyton_reader_add_consumer")
+        self._buf = np.zeros(max_frames, dtype=CYTON_FRAME)
+
+    def read(self, max_frames=None):
+        """Unread frames (oldest first); never blocks. Returns a copy."""
+        n_max = len(self._buf) if max_frames is None else min(max_frames, len(self._buf))
+        n = _check(_lib.cyton_reader_read(self.reader._h, self.id, self._buf, n_max), "cyton_reader_read")
+        return self._buf[:n].copy()
+
+    def wait(self, timeout=None):
+        """Block until a frame is available; True if frames are pending"""
+        ms = -1 if timeout is None else int(timeout * 1000)
+        return _lib.cyton_reader_wait(self.reader._h, self.id, ms) > 0
+
+    @property
+    def pending(self):
+        return _lib.cyton_reader_pending(self.reader._h, self.id)
+
+    def skip(self):
+        """Discard frames received so far"""
+        _lib.cyton_reader_skip(self.reader._h, self.id)
+
+    @property
+    def dropped(self):
+        return self.reader.stats(self.id)['dropped']
+
+
+class CytonDecoder:
+    """
+    The acquisition thread's frame decoder, for bytes read some other way
+    (pyserial polling, a recording). One pass over the bytes yields the EMG
+    channels and the accelerometer axes together:
+
+        decoder = CytonDecoder()
+        frames = decoder.decode(ser.read(ser.in_waiting))
+        pairs = frames['channels'][:, [0, 1, 4, 5]]
+        orientation.push_frames(frames)          # frames['accel']
+
+    A partial frame at the end is kept for the next call. Frames are stamped
+    with t_ns (default: now, on the monotonic_ns() clock).
+    """
+
+    def __init__(self, max_bytes=4096):
+        self._buf = np.zeros(max_bytes, dtype=np.uint8)
+        self._len = ctypes.c_int(0)
+        self._out = np.zeros(max_bytes // CYTON_FRAME_BYTES + 1, dtype=CYTON_FRAME)
+        self._skipped = ctypes.c_uint64(0)
+        self.frames = 0
+
+    @property
+    def resync_bytes(self):
+        """Bytes dropped while looking for a frame start"""
+        return self._skipped.value
+
+    def decode(self, data, t_ns=None):
+        """Frames completed by data (oldest first). Returns a new array."""
+        if t_ns is None:
+            t_ns = _lib.cyton_monotonic_ns()
+        data = np.frombuffer(data, dtype=np.uint8)
+        chunks = []
+        while True:
+            take = min(len(data), len(self._buf) - self._len.value)
+            self._buf[self._len.value:self._len.value + take] = data[:take]
+            self._len.value += take
+            data = data[take:]
+            n = _check(_lib.cyton_extract_frames(self._buf, ctypes.byref(self._len), self._out, len(self._out),
+                                                 t_ns, ctypes.byref(self._skipped)), "cyton_extract_frames")
+            if n:
+                chunks.append(self._out[:n].copy())
+            if not len(data):
+                break
+        frames = np.concatenate(chunks) if chunks else np.zeros(0, dtype=CYTON_FRAME)
+        frames['seq'] = np.arange(self.frames, self.frames + len(frames))
+        self.frames += len(frames)
+        return frames
+
+
+def monotonic_ns():
+    """The clock CytonReader stamps frames with (same as time.monotonic_ns())"""
+    return _lib.cyton_monotonic_ns()
+
+
+# ----------------------------
+# q8_reactor
+# ----------------------------
+class _ReactorEvents(ctypes.Structure):
+    _fields_ = [
+        ("ticks", ctypes.c_int),
+        ("tick_ns", ctypes.c_int64),
+        ("writes_done", ctypes.c_int),
+        ("error", ctypes.c_int),
+    ]
+
+
+class _ReactorStats(ctypes.Structure):
+    _fields_ = [
+        ("frames", ctypes.c_uint64),
+        ("dropped_frames", ctypes.c_uint64),
+        ("bytes", ctypes.c_uint64),
+        ("reads", ctypes.c_uint64),
+        ("resync_bytes", ctypes.c_uint64),
+        ("ticks", ctypes.c_uint64),
+        ("missed_ticks", ctypes.c_uint64),
+        ("tick_late_max_ns", ctypes.c_int64),
+        ("tick_late_sum_ns", ctypes.c_int64),
+        ("writes", ctypes.c_uint64),
+        ("write_bytes", ctypes.c_uint64),
+        ("coalesced", ctypes.c_uint64),
+        ("enters", ctypes.c_uint64),
+    ]
+
+
+_lib.q8_reactor_create.restype = ctypes.c_void_p
+_lib.q8_reactor_create.argtypes = [ctypes.c_int, ctypes.c_int]
+_lib.q8_reactor_destroy.argtypes = [ctypes.c_void_p]
+_lib.q8_reactor_set_tick.argtypes = [ctypes.c_void_p, ctypes.c_int64]
+_lib.q8_reactor_sync_write.argtypes = [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint8, _u8_p, _u8_p, ctypes.c_int,
+                                       ctypes.c_uint64]
+_lib.q8_reactor_poll.argtypes = [ctypes.c_void_p, _frame_p, ctypes.c_int, ctypes.c_int64,
+                                 ctypes.POINTER(_ReactorEvents)]
+_lib.q8_reactor_pending.argtypes = [ctypes.c_void_p]
+_lib.q8_reactor_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_ReactorStats)]
+
+
+class Reactor:
+    """
+    Single-threaded io_uring loop for the Cyton dongle and the Dynamixel bus.
+
+    Both fds come from ports that are already open and configured (pyserial
+    for the Cyton, dynamixel_sdk's PortHandler.ser for the servos); either
+    may be None. The reactor then does all reads on the Cyton fd and all
+    writes on the servo fd.
+
+        reactor = Reactor(cyton_fd=imu.ser.fileno(), dxl_fd=robot.fileno())
+        reactor.set_tick(50)
+        while True:
+            frames, ticks = reactor.poll()
+            ...                                  # frames: dtype CYTON_FRAME
+            if ticks:
+                reactor.sync_write(30, ids, positions)
+
+    Requires Linux 5.11 or newer.
+    """
+
+    def __init__(self, cyton_fd=None, dxl_fd=None, max_frames=512):
+        self._h = _lib.q8_reactor_create(-1 if cyton_fd is None else int(cyton_fd),
+                                         -1 if dxl_fd is None else int(dxl_fd))
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot create io_uring reactor: {os.strerror(err)}")
+        self._buf = np.zeros(max_frames, dtype=CYTON_FRAME)
+        self._ev = _ReactorEvents()
+        self.last_tick_ns = 0
+        self.writes_done = 0
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if getattr(self, '_h', None):
+            _lib.q8_reactor_destroy(self._h)
+            self._h = None
+
+    def set_tick(self, hz):
+        """Control tick rate (0 stops it); the first tick is one period away"""
+        period_ns = 0 if not hz else int(round(1e9 / hz))
+        _check(_lib.q8_reactor_set_tick(self._h, period_ns), "q8_reactor_set_tick")
+
+    def sync_write(self, addr, ids, values, width=2, trace_id=0):
+        """
+        Queue a Protocol 1.0 sync write of one `width`-byte value per servo.
+        trace_id: the Tracer id of the decision it acts on (0: none).
+        """
+        ids = np.ascontiguousarray(ids, dtype=np.uint8)
+        values = np.asarray(values, dtype=np.int64)
+        if len(ids) != len(values):
+            raise ValueError("ids and values must have the same length")
+        data = np.empty((len(ids), width), dtype=np.uint8)
+        for b in range(width):
+            data[:, b] = (values >> (8 * b)) & 0xFF
+        _check(_lib.q8_reactor_sync_write(self._h, int(addr), int(width), ids, data.ravel(), len(ids),
+                                          int(trace_id)), "q8_reactor_sync_write")
+
+    def poll(self, timeout=None):
+        """
+        Submit queued I/O and wait up to timeout seconds (None: forever) for
+        something to happen. Returns (frames, ticks): the Cyton frames
+        received (oldest first, a copy) and the number of control ticks due
+        (more than 1 means the loop fell behind).
+        """
+        timeout_ns = -1 if timeout is None else int(timeout * 1e9)
+        n = _check(_lib.q8_reactor_poll(self._h, self._buf, len(self._buf), timeout_ns,
+                                        ctypes.byref(self._ev)), "q8_reactor_poll")
+        if self._ev.error:
+            raise OSError(self._ev.error, f"Reactor I/O failed: {os.strerror(self._ev.error)}")
+        if self._ev.ticks:
+            self.last_tick_ns = self._ev.tick_ns
+        self.writes_done += self._ev.writes_done
+        return self._buf[:n].copy(), self._ev.ticks
+
+    @property
+    def pending(self):
+        return _lib.q8_reactor_pending(self._h)
+
+    def stats(self):
+        s = _ReactorStats()
+        _lib.q8_reactor_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _ReactorStats._fields_}
+
+
+# ----------------------------
+# imu_orient
+# ----------------------------
+IMU_DIRECTIONS = (None, 'roll+', 'roll-', 'pitch+', 'pitch-')
+IMU_CYTON_SCALE_G = 0.002 / 16.0
+
+
+class _OrientConfig(ctypes.Structure):
+    _fields_ = [
+        ("fs", ctypes.c_double),
+        ("scale_g", ctypes.c_double),
+        ("tau_ms", ctypes.c_double),
+        ("motion_g", ctypes.c_double),
+        ("enter_deg", ctypes.c_double),
+        ("exit_deg", ctypes.c_double),
+    ]
+
+
+class _OrientState(ctypes.Structure):
+    _fields_ = [
+        ("t_ns", ctypes.c_int64),
+        ("pitch_deg", ctypes.c_double),
+        ("roll_deg", ctypes.c_double),
+        ("accel_g", ctypes.c_double * 3),
+        ("weight", ctypes.c_double),
+        ("direction", ctypes.c_int),
+        ("readings", ctypes.c_uint64),
+        ("frames", ctypes.c_uint64),
+    ]
+
+
+_i16_p = np.ctypeslib.ndpointer(dtype=np.int16, flags="C_CONTIGUOUS")
+_i64_p = np.ctypeslib.ndpointer(dtype=np.int64, flags="C_CONTIGUOUS")
+
+_lib.imu_orient_create.restype = ctypes.c_void_p
+_lib.imu_orient_create.argtypes = [ctypes.POINTER(_OrientConfig)]
+_lib.imu_orient_destroy.argtypes = [ctypes.c_void_p]
+_lib.imu_orient_reset.argtypes = [ctypes.c_void_p]
+_lib.imu_orient_push.argtypes = [ctypes.c_void_p, _i16_p, ctypes.c_void_p, ctypes.c_int]
+_lib.imu_orient_get.argtypes = [ctypes.c_void_p, ctypes.POINTER(_OrientState)]
+
+
+class OrientationFilter:
+    """
+    Wrist pitch/roll from the Cyton accelerometer, updated from every frame.
+
+        orient = OrientationFilter(tau_ms=150, enter_deg=30, exit_deg=25)
+        orient.push(aux)                  # (n, 3) raw counts, one row per frame
+        orient.pitch, orient.roll, orient.direction
+
+    Rows of zeros are frames without a new accelerometer reading; push them
+    too, they keep the filter's clock right. direction is one of
+    IMU_DIRECTIONS ('roll+', 'roll-', 'pitch+', 'pitch-' or None for level)
+    with enter/exit hysteresis. motion_g down-weights readings taken while
+    the wrist accelerates (0 disables).
+    """
+
+    def __init__(self, tau_ms=150.0, enter_deg=30.0, exit_deg=25.0, motion_g=0.3,
+                 fs=CYTON_FS, scale_g=IMU_CYTON_SCALE_G):
+        cfg = _OrientConfig(fs, scale_g, tau_ms, motion_g, enter_deg, exit_deg)
+        self._h = _lib.imu_orient_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid orientation filter settings (tau {tau_ms} ms, "
+                             f"enter {enter_deg}, exit {exit_deg}, motion {motion_g} g)")
+        self._state = _OrientState()
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.imu_orient_destroy(self._h)
+            self._h = None
+
+    def reset(self):
+        _lib.imu_orient_reset(self._h)
+        _lib.imu_orient_get(self._h, ctypes.byref(self._state))
+
+    def push(self, aux, t_ns=None):
+        """Feed (n, 3) aux counts, optionally with per-frame timestamps. Returns new readings."""
+        aux = np.ascontiguousarray(np.asarray(aux).reshape(-1, 3), dtype=np.int16)
+        t_p = None
+        if t_ns is not None:
+            t_ns = np.ascontiguousarray(np.broadcast_to(np.asarray(t_ns, dtype=np.int64), (len(aux),)))
+            t_p = t_ns.ctypes.data
+        n = _check(_lib.imu_orient_push(self._h, aux, t_p, len(aux)), "imu_orient_push")
+        _lib.imu_orient_get(self._h, ctypes.byref(self._state))
+        return n
+
+    def push_frames(self, frames):
+        """Feed CYTON_FRAME records (CytonReader / Reactor / CytonDecoder)"""
+        if len(frames) == 0:
+            return 0
+        return self.push(frames['accel'], frames['t_ns'])
+
+    @property
+    def pitch(self):
+        return self._state.pitch_deg
+
+    @property
+    def roll(self):
+        return self._state.roll_deg
+
+    @property
+    def t_ns(self):
+        """Arrival time of the frame with the newest reading (0 if none / no timestamps)"""
+        return self._state.t_ns
+
+    @property
+    def direction(self):
+        return IMU_DIRECTIONS[self._state.direction]
+
+    @property
+    def weight(self):
+        return self._state.weight
+
+    @property
+    def readings(self):
+        return self._state.readings
+
+
+# ----------------------------
+# gesture_link
+# ----------------------------
+GL_DEFAULT_PORT = 5860
+
+# Gesture codes on the wire (gesture_link.h); None = no confident gesture
+GESTURE_CODES = (None, 'stop', 'forward', 'backward', 'turn_left', 'turn_right',
+                 'jump', 'jump_forward', 'jump_backward', 'jump_left', 'jump_right')
+
+GL_GESTURE = np.dtype([
+    ('seq', '<u4'),
+    ('gesture', '<i4'),          # index into GESTURE_CODES
+    ('confidence', '<f4'),
+    ('_pad', '<u4'),
+    ('t_capture_ns', '<i8'),     # publisher clock
+    ('t_send_ns', '<i8'),        # publisher clock
+    ('t_recv_ns', '<i8'),        # local clock, arrival
+    ('latency_ns', '<i8'),       # capture -> arrival on the local clock (0 until synced)
+    ('trace_id', '<u8'),         # Tracer id of the decision (0: none)
+])
+assert GL_GESTURE.itemsize == 56
+
+
+class _PubStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in ("sent", "send_errors", "pings", "bad")]
+
+
+class _SubStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in
+                ("received", "lost", "stale", "bad", "pings", "pongs", "restarts")] + [
+        ("synced", ctypes.c_int),
+        ("offset_ns", ctypes.c_int64),
+        ("rtt_ns", ctypes.c_int64),
+    ]
+
+
+_gesture_p = np.ctypeslib.ndpointer(dtype=GL_GESTURE, flags="C_CONTIGUOUS")
+
+_lib.gesture_pub_create.restype = ctypes.c_void_p
+_lib.gesture_pub_create.argtypes = [ctypes.c_char_p]
+_lib.gesture_pub_destroy.argtypes = [ctypes.c_void_p]
+_lib.gesture_pub_send.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_float, ctypes.c_int64, ctypes.c_uint64]
+_lib.gesture_pub_service.argtypes = [ctypes.c_void_p]
+_lib.gesture_pub_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_PubStats)]
+_lib.gesture_sub_create.restype = ctypes.c_void_p
+_lib.gesture_sub_create.argtypes = [ctypes.c_char_p, ctypes.c_int]
+_lib.gesture_sub_destroy.argtypes = [ctypes.c_void_p]
+_lib.gesture_sub_poll.argtypes = [ctypes.c_void_p, _gesture_p, ctypes.c_int, ctypes.c_int]
+_lib.gesture_sub_to_local.restype = ctypes.c_int64
+_lib.gesture_sub_to_local.argtypes = [ctypes.c_void_p, ctypes.c_int64]
+_lib.gesture_sub_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_SubStats)]
+_lib.gesture_sub_fd.argtypes = [ctypes.c_void_p]
+
+
+class GesturePublisher:
+    """
+    Wristband side of the gesture link: one datagram per decision.
+
+        link = GesturePublisher("udp:192.168.1.20:5860")   # or "unix:/tmp/q8.sock"
+        link.publish('forward', 0.93, t_capture_ns=frame['t_ns'])
+        link.service()                 # between decisions: answer clock pings
+
+    t_capture_ns is on the monotonic_ns() clock (CytonReader frame stamps).
+    publish() never blocks and returns False when the datagram could not be
+    sent (no subscriber yet, buffer full); the next decision is sent anyway.
+    """
+
+    def __init__(self, addr):
+        self.addr = addr
+        self._h = _lib.gesture_pub_create(addr.encode())
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot open gesture link {addr}: {os.strerror(err)}")
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if getattr(self, '_h', None):
+            _lib.gesture_pub_destroy(self._h)
+            self._h = None
+
+    def publish(self, gesture, confidence=1.0, t_capture_ns=None, trace_id=0):
+        """
+        gesture: a name in GESTURE_CODES (None: no confident gesture).
+        trace_id: Tracer id of the decision, passed on to the robot.
+        """
+        if gesture not in GESTURE_CODES:
+            raise ValueError(f"Unknown gesture {gesture!r}; one of {GESTURE_CODES[1:]}")
+        if t_capture_ns is None:
+            t_capture_ns = clock_ns()
+        rc = _lib.gesture_pub_send(self._h, GESTURE_CODES.index(gesture), float(confidence), int(t_capture_ns),
+                                   int(trace_id))
+        if rc == Q8_ERR_IO:
+            return False
+        _check(rc, "gesture_pub_send")
+        return True
+
+    def service(self):
+        """Answer pending clock pings; returns how many"""
+        return _check(_lib.gesture_pub_service(self._h), "gesture_pub_service")
+
+    def stats(self):
+        s = _PubStats()
+        _lib.gesture_pub_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _PubStats._fields_}
+
+
+class GestureSubscriber:
+    """
+    Robot side of the gesture link. Binds addr and pings the publisher every
+    ping_ms to estimate its clock offset.
+
+        link = GestureSubscriber(f"udp::{GL_DEFAULT_PORT}")
+        for m in link.poll():                    # dtype GL_GESTURE, oldest first
+            gesture = GESTURE_CODES[m['gesture']]
+        ...
+        # after acting on it
+        latency_ns = time.monotonic_ns() - link.to_local_ns(m['t_capture_ns'])
+    """
+
+    def __init__(self, addr=f"udp::{GL_DEFAULT_PORT}", ping_ms=200, max_messages=64):
+        self.addr = addr
+        self._h = _lib.gesture_sub_create(addr.encode(), int(ping_ms))
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot bind gesture link {addr}: {os.strerror(err)}")
+        self._buf = np.zeros(max_messages, dtype=GL_GESTURE)
+        self._stats = _SubStats()
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if getattr(self, '_h', None):
+            _lib.gesture_sub_destroy(self._h)
+            self._h = None
+
+    def fileno(self):
+        return _lib.gesture_sub_fd(self._h)
+
+    def poll(self, timeout=0.0):
+        """New gestures (copy); waits up to timeout seconds (None: forever)"""
+        ms = -1 if timeout is None else int(timeout * 1000)
+        n = _check(_lib.gesture_sub_poll(self._h, self._buf, len(self._buf), ms), "gesture_sub_poll")
+        return self._buf[:n].copy()
+
+    def to_local_ns(self, t_remote_ns):
+        """Publisher timestamp on this host's monotonic_ns() clock"""
+        return _lib.gesture_sub_to_local(self._h, int(t_remote_ns))
+
+    def stats(self):
+        _lib.gesture_sub_get_stats(self._h, ctypes.byref(self._stats))
+        return {name: getattr(self._stats, name) for name, _ in _SubStats._fields_}
+
+    @property
+    def synced(self):
+        return bool(self.stats()['synced'])
+
+    @property
+    def offset_ns(self):
+        """Publisher clock minus local clock"""
+        return self.stats()['offset_ns']
+
+
+# ----------------------------
+# q8_trace
+# ----------------------------
+class _TraceStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in ("events", "dropped", "lost")] + [
+        ("threads", ctypes.c_int),
+        ("enabled", ctypes.c_int),
+    ]
+
+
+_lib.q8_trace_start.argtypes = [ctypes.c_int]
+_lib.q8_trace_stop.argtypes = []
+_lib.q8_trace_enabled.argtypes = []
+_lib.q8_trace_name.argtypes = [ctypes.c_char_p]
+_lib.q8_trace_thread_name.argtypes = [ctypes.c_char_p]
+_lib.q8_trace_span.argtypes = [ctypes.c_int, ctypes.c_int64, ctypes.c_int64, ctypes.c_uint64]
+_lib.q8_trace_instant.argtypes = [ctypes.c_int, ctypes.c_int64, ctypes.c_uint64]
+_lib.q8_trace_write.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int64]
+_lib.q8_trace_get_stats.argtypes = [ctypes.POINTER(_TraceStats)]
+
+
+class Tracer:
+    """
+    Latency spans for trace_summary.py and chrome://tracing / Perfetto.
+
+    The native recorder is process-wide; spans from Python go to the ring of
+    the calling thread, next to the ones the native modules record
+    (cyton_read, reactor_read, sync_write, link). Times are monotonic_ns()
+    (time.perf_counter() is the same clock on Linux: seconds * 1e9), or
+    Clock time in a simulation.
+
+        trace = Tracer.from_env()            # Q8_TRACE=/tmp/wrist.json, else None
+        if trace:
+            trace.span('features', t0_ns, t1_ns, trace_id=frame_seq)
+        ...
+        trace.write(process_name="classifier")
+
+    trace_id ties the stages of one decision together: the seq of the Cyton
+    frame that completed its window (0: not part of a chain).
+    """
+
+    def __init__(self, path=None, events_per_thread=0):
+        self.path = path
+        self._names = {}
+        _check(_lib.q8_trace_start(int(events_per_thread)), "q8_trace_start")
+
+    @classmethod
+    def from_env(cls, var='Q8_TRACE'):
+        """A started Tracer writing to $Q8_TRACE, or None when it is not set"""
+        path = os.environ.get(var)
+        return cls(path) if path else None
+
+    def _name(self, name):
+        nid = self._names.get(name)
+        if nid is None:
+            nid = _check(_lib.q8_trace_name(name.encode()), "q8_trace_name")
+            self._names[name] = nid
+        return nid
+
+    def span(self, name, t0_ns, t1_ns=None, trace_id=0):
+        """One stage, from t0_ns to t1_ns (default: now)"""
+        if t1_ns is None:
+            t1_ns = clock_ns()
+        _lib.q8_trace_span(self._name(name), int(t0_ns), int(t1_ns), int(trace_id))
+
+    def instant(self, name, t_ns=None, trace_id=0):
+        if t_ns is None:
+            t_ns = clock_ns()
+        _lib.q8_trace_instant(self._name(name), int(t_ns), int(trace_id))
+
+    def thread_name(self, name):
+        """Label the calling thread in the exported trace"""
+        _lib.q8_trace_thread_name(name.encode())
+
+    def stop(self):
+        _lib.q8_trace_stop()
+
+    def write(self, path=None, process_name="", clock_offset_ns=0, stop=True):
+        """
+        Stop recording and write the Chrome trace JSON. clock_offset_ns is
+        added to every timestamp (the robot passes its gesture link offset
+        so its trace lines up with the wristband host's). Returns the
+        number of events written. stop=False writes a snapshot and keeps
+        recording (events overwritten while copying are left out).
+        """
+        path = path or self.path
+        if not path:
+            raise ValueError("No trace path given (set Q8_TRACE)")
+        if stop:
+            self.stop()
+        return _check(_lib.q8_trace_write(path.encode(), process_name.encode(), int(clock_offset_ns)),
+                      f"q8_trace_write {path}")
+
+    def stats(self):
+        s = _TraceStats()
+        _lib.q8_trace_get_stats(ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _TraceStats._fields_}
+
+
+# ----------------------------
+# cyton_log
+# ----------------------------
+CYTON_LOG_DATA = 0
+CYTON_LOG_MARK = 1
+CYTON_LOG_MAX_PAYLOAD = 65536
+
+
+class _LogStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in ("records", "bytes", "marks", "dropped", "segments")] + [
+        ("error", ctypes.c_int),
+    ]
+
+
+class _LogRecord(ctypes.Structure):
+    _fields_ = [
+        ("t_ns", ctypes.c_int64),
+        ("len", ctypes.c_int),
+        ("type", ctypes.c_int),
+        ("segment", ctypes.c_int),
+    ]
+
+
+class _LogInfo(ctypes.Structure):
+    _fields_ = [
+        ("baud", ctypes.c_int),
+        ("segments", ctypes.c_int),
+        ("t_created_ns", ctypes.c_int64),
+        ("truncated", ctypes.c_uint64),
+    ]
+
+
+_lib.cyton_log_open.restype = ctypes.c_void_p
+_lib.cyton_log_open.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int64]
+_lib.cyton_log_close.argtypes = [ctypes.c_void_p]
+_lib.cyton_log_append.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int64]
+_lib.cyton_log_mark.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int64]
+_lib.cyton_log_flush.argtypes = [ctypes.c_void_p]
+_lib.cyton_log_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LogStats)]
+_lib.cyton_log_reader_open.restype = ctypes.c_void_p
+_lib.cyton_log_reader_open.argtypes = [ctypes.c_char_p]
+_lib.cyton_log_reader_close.argtypes = [ctypes.c_void_p]
+_lib.cyton_log_read.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LogRecord), ctypes.c_char_p, ctypes.c_int]
+_lib.cyton_log_reader_info.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LogInfo)]
+
+
+class CytonRecorder:
+    """
+    Raw Cyton session log: every chunk read from the port, exactly as read,
+    with its arrival time (monotonic_ns()), plus text markers. Replay it
+    with CytonLog / replay.py.
+
+        recorder = CytonRecorder("/data/session-01")      # Q8_RECORD=dir
+        reader.record(recorder)                            # CytonReader tap
+        recorder.write(ser.read(n), t_ns)                  # or by hand
+        recorder.mark("prompt fist")
+        ...
+        reader.stop()
+        recorder.close()
+
+    Writes go to a queue that a native thread empties to disk, so they never
+    wait for the file; when the queue is full the chunk is dropped and
+    counted in stats()['dropped'].
+    """
+
+    def __init__(self, directory, baud=115200, segment_mb=64):
+        self.directory = directory
+        self._h = _lib.cyton_log_open(os.fsencode(directory), int(baud), int(segment_mb * (1 << 20)))
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot start Cyton log in {directory}: {os.strerror(err)}")
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        """Write everything queued and close the log"""
+        if getattr(self, '_h', None):
+            _lib.cyton_log_close(self._h)
+            self._h = None
+
+    def write(self, data, t_ns=None):
+        """Queue a chunk of stream bytes; False if it was dropped"""
+        if not data:
+            return True
+        if t_ns is None:
+            t_ns = time.monotonic_ns()
+        data = bytes(data)
+        rc = _lib.cyton_log_append(self._h, data, len(data), int(t_ns))
+        if rc == Q8_ERR_FULL:
+            return False
+        _check(rc, "cyton_log_append")
+        return True
+
+    def mark(self, text, t_ns=None):
+        """Queue a text marker (a prompt, a label change, ...); False if dropped"""
+        if t_ns is None:
+            t_ns = time.monotonic_ns()
+        rc = _lib.cyton_log_mark(self._h, text.encode(), int(t_ns))
+        if rc == Q8_ERR_FULL:
+            return False
+        _check(rc, "cyton_log_mark")
+        return True
+
+    def flush(self):
+        """Block until everything queued so far is on disk"""
+        _check(_lib.cyton_log_flush(self._h), f"cyton_log_flush {self.directory}")
+
+    def stats(self):
+        s = _LogStats()
+        _lib.cyton_log_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _LogStats._fields_}
+
+
+class CytonLog:
+    """
+    Read a CytonRecorder log back, in recorded order:
+
+        for t_ns, kind, payload in CytonLog("/data/session-01"):
+            if kind == CYTON_LOG_DATA:
+                frames = decoder.decode(payload, t_ns)
+            else:
+                print(payload.decode())                    # marker text
+
+    A record cut short by a crash ends its segment (counted in truncated).
+    """
+
+    def __init__(self, directory):
+        self.directory = directory
+        self._h = _lib.cyton_log_reader_open(os.fsencode(directory))
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot read Cyton log {directory}: {os.strerror(err)}")
+        self._buf = ctypes.create_string_buffer(CYTON_LOG_MAX_PAYLOAD)
+        self._rec = _LogRecord()
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if getattr(self, '_h', None):
+            _lib.cyton_log_reader_close(self._h)
+            self._h = None
+
+    def _info(self):
+        info = _LogInfo()
+        _lib.cyton_log_reader_info(self._h, ctypes.byref(info))
+        return info
+
+    @property
+    def baud(self):
+        return self._info().baud
+
+    @property
+    def segments(self):
+        return self._info().segments
+
+    @property
+    def t_created_ns(self):
+        return self._info().t_created_ns
+
+    @property
+    def truncated(self):
+        return self._info().truncated
+
+    def __iter__(self):
+        while True:
+            rc = _lib.cyton_log_read(self._h, ctypes.byref(self._rec), self._buf, len(self._buf))
+            if rc == 0:
+                return
+            _check(rc, f"cyton_log_read {self.directory}")
+            yield self._rec.t_ns, self._rec.type, self._buf.raw[:self._rec.len]
+
+
+# ----------------------------
+# cyton_emu
+# ----------------------------
+class _EmuConfig(ctypes.Structure):
+    _fields_ = [
+        ("rate_hz", ctypes.c_double),
+        ("burst", ctypes.c_int),
+        ("loss", ctypes.c_double),
+        ("loss_burst", ctypes.c_double),
+        ("corrupt", ctypes.c_double),
+        ("noise_uv", ctypes.c_double),
+        ("mains_uv", ctypes.c_double),
+        ("mains_hz", ctypes.c_double),
+        ("seed", ctypes.c_uint64),
+    ]
+
+
+class _EmuStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint64) for name in
+                ("packets", "sent", "lost", "corrupted", "overflow", "commands")] + [
+        ("max_late_ns", ctypes.c_int64),
+        ("streaming", ctypes.c_int),
+        ("gesture", ctypes.c_int),
+    ]
+
+
+_lib.cyton_emu_create.restype = ctypes.c_void_p
+_lib.cyton_emu_create.argtypes = [ctypes.POINTER(_EmuConfig)]
+_lib.cyton_emu_destroy.argtypes = [ctypes.c_void_p]
+_lib.cyton_emu_path.restype = ctypes.c_char_p
+_lib.cyton_emu_path.argtypes = [ctypes.c_void_p]
+_lib.cyton_emu_start.argtypes = [ctypes.c_void_p]
+_lib.cyton_emu_stop.argtypes = [ctypes.c_void_p]
+_lib.cyton_emu_gesture_name.restype = ctypes.c_char_p
+_lib.cyton_emu_gesture_name.argtypes = [ctypes.c_int]
+_lib.cyton_emu_set_gesture.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.cyton_emu_set_tilt.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double]
+_lib.cyton_emu_set_loss.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double]
+_lib.cyton_emu_generate.argtypes = [ctypes.c_void_p, _u8_p, ctypes.c_int]
+_lib.cyton_emu_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_EmuStats)]
+
+
+def _emu_gestures():
+    names = []
+    while _lib.cyton_emu_gesture_name(len(names)):
+        names.append(_lib.cyton_emu_gesture_name(len(names)).decode())
+    return tuple(names)
+
+
+# Gestures the emulator's signal model knows
+CYTON_EMU_GESTURES = _emu_gestures()
+
+
+class CytonEmulator:
+    """
+    A Cyton board on a pseudo-terminal, for benchmarks without hardware.
+    The scripts find it through OPENBCI_PORT:
+
+        with CytonEmulator(rate_hz=250, loss=0.01) as emu:
+            os.environ['OPENBCI_PORT'] = emu.path
+            emu.gesture = 'forward'
+            ...                          # run classify_realtime.py etc.
+            print(emu.stats())
+
+    It answers 'b' / 's' like the board and streams 33-byte packets with a
+    synthetic EMG signal per gesture (CYTON_EMU_GESTURES) and accelerometer
+    readings for the gesture's wrist tilt. loss drops packets in bursts of
+    loss_burst (the sample counter skips), corrupt breaks stop bytes.
+    generate() gives the same packets without the pty (while stopped).
+    """
+
+    def __init__(self, rate_hz=250.0, burst=1, loss=0.0, loss_burst=1.0, corrupt=0.0,
+                 noise_uv=1.0, mains_uv=2.0, mains_hz=60.0, seed=0, start=True):
+        cfg = _EmuConfig(float(rate_hz), int(burst), float(loss), float(loss_burst), float(corrupt),
+                         float(noise_uv), float(mains_uv), float(mains_hz), int(seed))
+        self._h = _lib.cyton_emu_create(ctypes.byref(cfg))
+        if not self._h:
+            err = ctypes.get_errno()
+            raise OSError(err, f"Cannot create Cyton emulator: {os.strerror(err)}")
+        self.path = _lib.cyton_emu_path(self._h).decode()
+        if start:
+            self.start()
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        if getattr(self, '_h', None):
+            _lib.cyton_emu_destroy(self._h)
+            self._h = None
+
+    def start(self):
+        _check(_lib.cyton_emu_start(self._h), "cyton_emu_start")
+
+    def stop(self):
+        _check(_lib.cyton_emu_stop(self._h), "cyton_emu_stop")
+
+    @property
+    def gesture(self):
+        return CYTON_EMU_GESTURES[self.stats()['gesture']]
+
+    @gesture.setter
+    def gesture(self, name):
+        if name not in CYTON_EMU_GESTURES:
+            raise ValueError(f"Unknown gesture {name!r}; one of {CYTON_EMU_GESTURES}")
+        _check(_lib.cyton_emu_set_gesture(self._h, CYTON_EMU_GESTURES.index(name)), "cyton_emu_set_gesture")
+
+    def set_tilt(self, pitch_deg, roll_deg):
+        """Wrist tilt until the next gesture change"""
+        _check(_lib.cyton_emu_set_tilt(self._h, float(pitch_deg), float(roll_deg)), "cyton_emu_set_tilt")
+
+    def set_loss(self, loss, loss_burst=1.0):
+        _check(_lib.cyton_emu_set_loss(self._h, float(loss), float(loss_burst)), "cyton_emu_set_loss")
+
+    def generate(self, n_packets):
+        """n packets as they would reach the port, as bytes (emulator stopped)"""
+        out = np.zeros(n_packets * CYTON_FRAME_BYTES, dtype=np.uint8)
+        _check(_lib.cyton_emu_generate(self._h, out, int(n_packets)), "cyton_emu_generate (stop it first)")
+        return out.tobytes()
+
+    def stats(self):
+        s = _EmuStats()
+        _lib.cyton_emu_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _EmuStats._fields_}
+
+
+# ----------------------------
+# q8_clock
+# ----------------------------
+class _ClockStats(ctypes.Structure):
+    _fields_ = [
+        ("sleeps", ctypes.c_uint64),
+        ("slept_ns", ctypes.c_int64),
+        ("advanced_ns", ctypes.c_int64),
+        ("virtual_time", ctypes.c_int),
+    ]
+
+
+_lib.q8_clock_now_ns.restype = ctypes.c_int64
+_lib.q8_clock_now_ns.argtypes = []
+_lib.q8_clock_set_virtual.argtypes = [ctypes.c_int, ctypes.c_int64]
+_lib.q8_clock_is_virtual.argtypes = []
+_lib.q8_clock_sleep_until.argtypes = [ctypes.c_int64]
+_lib.q8_clock_advance.argtypes = [ctypes.c_int64]
+_lib.q8_clock_get_stats.argtypes = [ctypes.POINTER(_ClockStats)]
+
+
+def clock_ns():
+    """The process clock (q8_clock): monotonic_ns(), or virtual time while a virtual Clock is open"""
+    return _lib.q8_clock_now_ns()
+
+
+class Clock:
+    """
+    The clock the control stack runs on: MotionRunner, EMGInterface and
+    SimRobot (raspi_controller), the classifier's decision clock, and the
+    gesture link and Tracer defaults (native).
+
+        clock = Clock(virtual=True)          # the whole process, until close()
+        runner = MotionRunner(robot, leg, hz=50, clock=clock)
+        runner.loop_forever(source, seconds=600)   # ten simulated minutes
+
+    In real time it is time.monotonic_ns() and sleeps are real. In virtual
+    time it only moves when something sleeps (or advance() is called): a
+    sleep returns at once with the clock at its deadline, so a loop that
+    paces itself with sleep_until_ns() sees the timestamps of an ideal
+    real-time run. One thread should drive a virtual clock (see q8_clock.h).
+
+    Calling the clock returns now() in seconds, so it can stand in for
+    time.perf_counter / time.monotonic.
+    """
+
+    def __init__(self, virtual=False, start_s=0.0):
+        self.virtual = bool(virtual)
+        if self.virtual:
+            _check(_lib.q8_clock_set_virtual(1, int(round(start_s * 1e9))), "q8_clock_set_virtual")
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        """Back to real time (a virtual clock only)"""
+        if self.virtual:
+            _lib.q8_clock_set_virtual(0, 0)
+            self.virtual = False
+
+    def now_ns(self):
+        return _lib.q8_clock_now_ns()
+
+    def now(self):
+        return _lib.q8_clock_now_ns() / 1e9
+
+    __call__ = now
+
+    def sleep_until_ns(self, t_ns):
+        _check(_lib.q8_clock_sleep_until(int(t_ns)), "q8_clock_sleep_until")
+
+    def sleep(self, seconds):
+        if seconds > 0:
+            self.sleep_until_ns(_lib.q8_clock_now_ns() + int(round(seconds * 1e9)))
+
+    def advance(self, seconds):
+        """Move virtual time forward (e.g. to let time pass in a test)"""
+        _check(_lib.q8_clock_advance(int(round(seconds * 1e9))), "q8_clock_advance (virtual time only)")
+
+    def stats(self):
+        s = _ClockStats()
+        _lib.q8_clock_get_stats(ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _ClockStats._fields_}
+
+
+# ----------------------------
+# joint_lead
+# ----------------------------
+LEAD_MAX_JOINTS = 8
+
+
+class _LeadConfig(ctypes.Structure):
+    _fields_ = [
+        ("n_joints", ctypes.c_int),
+        ("dt_s", ctypes.c_double),
+        ("max_lag_ms", ctypes.c_double),
+        ("step_ms", ctypes.c_double),
+        ("kv_s", ctypes.c_double),
+        ("window", ctypes.c_double),
+        ("min_speed_dps", ctypes.c_double),
+        ("min_observations", ctypes.c_int),
+    ]
+
+
+class _LeadState(ctypes.Structure):
+    _fields_ = [
+        ("lag_ms", ctypes.c_double * LEAD_MAX_JOINTS),
+        ("estimate_ms", ctypes.c_double * LEAD_MAX_JOINTS),
+        ("rms_deg", ctypes.c_double * LEAD_MAX_JOINTS),
+        ("observations", ctypes.c_uint64 * LEAD_MAX_JOINTS),
+        ("skipped", ctypes.c_uint64),
+        ("commands", ctypes.c_uint64),
+    ]
+
+
+_lib.joint_lead_create.restype = ctypes.c_void_p
+_lib.joint_lead_create.argtypes = [ctypes.POINTER(_LeadConfig)]
+_lib.joint_lead_destroy.argtypes = [ctypes.c_void_p]
+_lib.joint_lead_reset.argtypes = [ctypes.c_void_p]
+_lib.joint_lead_set_lag.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_double]
+_lib.joint_lead_command.argtypes = [ctypes.c_void_p, ctypes.c_int64, _f64_p, ctypes.c_int, _f64_p]
+_lib.joint_lead_observe.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int64, ctypes.c_double]
+_lib.joint_lead_get.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LeadState)]
+
+
+class LeadCompensator:
+    """
+    Sends each joint its planned trajectory shifted earlier by the joint's
+    lag, estimated online from present-position reads (joint_lead.h).
+
+        lead = LeadCompensator(dt=1/50, max_lag_ms=150)
+        lead.set_lag(j, 20.0)                     # modelled, until estimated
+        out = lead.command(t_ns, plan)            # plan: (n_ahead, 8) goals from now on
+        lead.observe(j, t_read_ns, present_deg)   # a joint's present position
+
+    plan needs horizon(dt) rows to cover max_lag_ms. kv_s adds lead in
+    proportion to goal speed (0: pure time shift).
+    """
+
+    def __init__(self, dt, n_joints=8, max_lag_ms=150.0, step_ms=2.0, kv_s=0.0,
+                 window=200, min_speed_dps=20.0, min_observations=50):
+        cfg = _LeadConfig(n_joints, dt, max_lag_ms, step_ms, kv_s, window, min_speed_dps, min_observations)
+        self._h = _lib.joint_lead_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid lead settings ({n_joints} joints, dt {dt} s, max lag {max_lag_ms} ms, "
+                             f"step {step_ms} ms, kv {kv_s} s, window {window})")
+        self.n_joints = n_joints
+        self.dt = dt
+        self.max_lag_ms = max_lag_ms
+        self._out = np.zeros(n_joints)
+        self._state = _LeadState()
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.joint_lead_destroy(self._h)
+            self._h = None
+
+    @property
+    def horizon(self):
+        """Rows of plan that command() needs (this tick and the ones max_lag_ms ahead)"""
+        return int(np.ceil(self.max_lag_ms / (1000.0 * self.dt))) + 2
+
+    def reset(self):
+        _lib.joint_lead_reset(self._h)
+
+    def set_lag(self, joint, lag_ms):
+        _check(_lib.joint_lead_set_lag(self._h, joint, lag_ms), "joint_lead_set_lag")
+
+    def command(self, t_ns, plan):
+        """Compensated goals (deg) to send at t_ns"""
+        plan = np.ascontiguousarray(plan, dtype=np.float64)
+        if plan.ndim != 2 or plan.shape[1] != self.n_joints:
+            raise ValueError(f"expected plan shape (n_ahead, {self.n_joints}), got {plan.shape}")
+        _check(_lib.joint_lead_command(self._h, int(t_ns), plan, len(plan), self._out), "joint_lead_command")
+        return self._out.copy()
+
+    def observe(self, joint, t_ns, present_deg):
+        """Present position read at t_ns; True if it went into the estimate"""
+        return _check(_lib.joint_lead_observe(self._h, joint, int(t_ns), present_deg), "joint_lead_observe") == 1
+
+    def stats(self):
+        _lib.joint_lead_get(self._h, ctypes.byref(self._state))
+        s = self._state
+        n = self.n_joints
+        return {
+            'lag_ms': list(s.lag_ms[:n]),
+            'estimate_ms': list(s.estimate_ms[:n]),
+            'rms_deg': list(s.rms_deg[:n]),
+            'observations': list(s.observations[:n]),
+            'skipped': s.skipped,
+            'commands': s.commands,
+        }
+
+    @property
+    def lags_ms(self):
+        return self.stats()['lag_ms']
+
+
+# ----------------------------
+# emg_corpus
+# ----------------------------
+EMG_CORPUS_MAX_LABEL = 64
+
+
+class _CorpusWindow(ctypes.Structure):
+    _fields_ = [
+        ("label", ctypes.c_char * EMG_CORPUS_MAX_LABEL),
+        ("data", ctypes.POINTER(ctypes.c_double)),
+        ("n_samples", ctypes.c_int),
+        ("n_channels", ctypes.c_int),
+        ("aux", ctypes.POINTER(ctypes.c_int16)),
+        ("n_aux", ctypes.c_int),
+        ("offset", ctypes.c_int64),
+    ]
+
+
+class _CorpusStats(ctypes.Structure):
+    _fields_ = [
+        ("lines", ctypes.c_uint64),
+        ("windows", ctypes.c_uint64),
+        ("malformed", ctypes.c_uint64),
+        ("bytes", ctypes.c_int64),
+    ]
+
+
+_lib.emg_corpus_open.restype = ctypes.c_void_p
+_lib.emg_corpus_open.argtypes = [ctypes.c_char_p, ctypes.c_int64, ctypes.c_int64, ctypes.c_char_p]
+_lib.emg_corpus_close.argtypes = [ctypes.c_void_p]
+_lib.emg_corpus_next.argtypes = [ctypes.c_void_p, ctypes.POINTER(_CorpusWindow)]
+_lib.emg_corpus_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_CorpusStats)]
+
+
+class CorpusReader:
+    """
+    Streams the windows of a training_data .jsonl file in constant memory
+    (emg_corpus.h):
+
+        for gesture, data, aux in CorpusReader(path):
+            ...                # data: (n_samples, n_channels), aux: (n, 3) or None
+
+    begin / end select the lines starting in that byte range. Malformed lines
+    are skipped and counted in stats().
+    """
+
+    def __init__(self, path, begin=0, end=-1, label=None):
+        self._h = _lib.emg_corpus_open(os.fsencode(path), begin, end,
+                                       label.encode() if label is not None else None)
+        if not self._h:
+            raise OSError(ctypes.get_errno(), f"Could not open {path}")
+        self.path = path
+        self._w = _CorpusWindow()
+        self._stats = _CorpusStats()
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_corpus_close(self._h)
+            self._h = None
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        if _check(_lib.emg_corpus_next(self._h, ctypes.byref(self._w)), "emg_corpus_next") == 0:
+            raise StopIteration
+        w = self._w
+        data = np.ctypeslib.as_array(w.data, shape=(w.n_samples, w.n_channels)).copy()
+        aux = np.ctypeslib.as_array(w.aux, shape=(w.n_aux, 3)).copy() if w.aux else None
+        return w.label.decode(), data, aux
+
+    def stats(self):
+        _lib.emg_corpus_get_stats(self._h, ctypes.byref(self._stats))
+        s = self._stats
+        return {'lines': s.lines, 'windows': s.windows, 'malformed': s.malformed, 'bytes': s.bytes}
+
+
+# ----------------------------
+# emg_analytics
+# ----------------------------
+# emg_featureset.h, by emg_features.py feature_type
+FEATURE_SETS = {'default': 0, 'MAV': 1, 'time_domain': 2, 'multiscale': 3, 'fused': 4, 'spectral': 5}
+ANALYTICS_MAX_CLASSES = 64
+
+
+class _AnalyticsConfig(ctypes.Structure):
+    _fields_ = [
+        ("feature_set", ctypes.c_int),
+        ("n_threads", ctypes.c_int),
+        ("shrinkage", ctypes.c_double),
+        ("chunk_bytes", ctypes.c_int64),
+    ]
+
+
+class _AnalyticsStats(ctypes.Structure):
+    _fields_ = [
+        ("windows", ctypes.c_uint64),
+        ("skipped", ctypes.c_uint64),
+        ("malformed", ctypes.c_uint64),
+        ("bytes", ctypes.c_int64),
+        ("n_files", ctypes.c_int),
+        ("n_threads", ctypes.c_int),
+        ("n_channels", ctypes.c_int),
+        ("n_features", ctypes.c_int),
+        ("n_classes", ctypes.c_int),
+        ("seconds", ctypes.c_double),
+    ]
+
+
+_lib.emg_analytics_create.restype = ctypes.c_void_p
+_lib.emg_analytics_create.argtypes = [ctypes.POINTER(_AnalyticsConfig)]
+_lib.emg_analytics_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_analytics_add_file.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+_lib.emg_analytics_run.argtypes = [ctypes.c_void_p]
+_lib.emg_analytics_class_name.restype = ctypes.c_char_p
+_lib.emg_analytics_class_name.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.emg_analytics_get_class.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_uint64),
+                                         _f64_p, _f64_p]
+_lib.emg_analytics_fisher.argtypes = [ctypes.c_void_p, _f64_p, _f64_p]
+_lib.emg_analytics_pairs.argtypes = [ctypes.c_void_p, _f64_p, _f64_p]
+_lib.emg_analytics_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_AnalyticsStats)]
+
+
+class CorpusAnalytics:
+    """
+    Class separability of a training corpus, streamed once over all cores
+    (emg_analytics.h):
+
+        ca = CorpusAnalytics('time_domain')
+        for path in glob('training_data/*/*.jsonl'):
+            ca.add(path)
+        ca.run()
+        ca.classes, ca.fisher, ca.channel_fisher, ca.bhattacharyya, ca.mahalanobis
+        count, mean, cov = ca.class_stats(0)
+
+    feature_type is an emg_features.py name. threads=0 uses every CPU;
+    shrinkage pulls the covariances toward a scaled identity.
+    """
+
+    def __init__(self, feature_type='time_domain', threads=0, shrinkage=0.1, chunk_bytes=0):
+        if feature_type not in FEATURE_SETS:
+            raise ValueError(f"Unknown feature_type {feature_type!r} (one of {', '.join(FEATURE_SETS)})")
+        cfg = _AnalyticsConfig(FEATURE_SETS[feature_type], threads, shrinkage, chunk_bytes)
+        self._h = _lib.emg_analytics_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid analytics settings (threads {threads}, shrinkage {shrinkage}, "
+                             f"chunk {chunk_bytes} bytes)")
+        self.feature_type = feature_type
+        self._stats = _AnalyticsStats()
+        self.classes = []
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_analytics_destroy(self._h)
+            self._h = None
+
+    def add(self, path, label=None):
+        """A .jsonl file; label is the class of lines without a "gesture" """
+        _check(_lib.emg_analytics_add_file(self._h, os.fsencode(path),
+                                           label.encode() if label is not None else None),
+               "emg_analytics_add_file")
+
+    def run(self):
+        _check(_lib.emg_analytics_run(self._h), "emg_analytics_run")
+        s = self.stats()
+        k, f, c = s['n_classes'], s['n_features'], s['n_channels']
+        self.classes = [_lib.emg_analytics_class_name(self._h, i).decode() for i in range(k)]
+        self.fisher = np.zeros(f)
+        self.channel_fisher = np.zeros(c)
+        _check(_lib.emg_analytics_fisher(self._h, self.fisher, self.channel_fisher), "emg_analytics_fisher")
+        self.bhattacharyya = np.zeros((k, k))
+        self.mahalanobis = np.zeros((k, k))
+        _check(_lib.emg_analytics_pairs(self._h, self.bhattacharyya, self.mahalanobis), "emg_analytics_pairs")
+        return self
+
+    def class_stats(self, c):
+        """(window count, mean, covariance) of class c, in raw feature units"""
+        f = self.stats()['n_features']
+        count = ctypes.c_uint64()
+        mean = np.zeros(f)
+        cov = np.zeros((f, f))
+        _check(_lib.emg_analytics_get_class(self._h, c, ctypes.byref(count), mean, cov), "emg_analytics_get_class")
+        return count.value, mean, cov
+
+    def stats(self):
+        _lib.emg_analytics_get_stats(self._h, ctypes.byref(self._stats))
+        s = self._stats
+        return {name: getattr(s, name) for name, _ in _AnalyticsStats._fields_}
+
+
+# ----------------------------
+# emg_quality
+# ----------------------------
+# Cyton channel counts to microvolts (4.5 V reference, gain 24, 24-bit ADC)
+CYTON_UV_PER_COUNT = 4.5e6 / 24 / (2 ** 23 - 1)
+CYTON_FULL_SCALE = 2 ** 23
+
+QUALITY_SATURATED = 0x1
+QUALITY_LINE = 0x2
+QUALITY_FLAT = 0x4
+QUALITY_DRIFT = 0x8
+QUALITY_FLAGS = {QUALITY_SATURATED: 'saturated', QUALITY_LINE: 'line', QUALITY_FLAT: 'flat',
+                 QUALITY_DRIFT: 'drift'}
+QUALITY_LINE_HZ = (50, 60)
+
+
+class _QualityConfig(ctypes.Structure):
+    _fields_ = [
+        ("n_channels", ctypes.c_int),
+        ("fs", ctypes.c_double),
+        ("block", ctypes.c_int),
+        ("rail_counts", ctypes.c_double),
+        ("line_rms_max", ctypes.c_double),
+        ("flat_rms_min", ctypes.c_double),
+        ("drift_max", ctypes.c_double),
+        ("drift_tau_s", ctypes.c_double),
+    ]
+
+
+class _QualityState(ctypes.Structure):
+    _fields_ = [
+        ("rms", ctypes.c_double * MAX_CHANNELS),
+        ("line_rms", (ctypes.c_double * len(QUALITY_LINE_HZ)) * MAX_CHANNELS),
+        ("baseline", ctypes.c_double * MAX_CHANNELS),
+        ("drift", ctypes.c_double * MAX_CHANNELS),
+        ("saturated", ctypes.c_double * MAX_CHANNELS),
+        ("flags", ctypes.c_uint32 * MAX_CHANNELS),
+        ("bad_blocks", ctypes.c_uint64 * MAX_CHANNELS),
+        ("samples", ctypes.c_uint64),
+        ("blocks", ctypes.c_uint64),
+    ]
+
+
+_lib.emg_quality_create.restype = ctypes.c_void_p
+_lib.emg_quality_create.argtypes = [ctypes.POINTER(_QualityConfig)]
+_lib.emg_quality_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_quality_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_quality_push.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int]
+_lib.emg_quality_window_flags.restype = ctypes.c_uint32
+_lib.emg_quality_window_flags.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_uint32)]
+_lib.emg_quality_get.argtypes = [ctypes.c_void_p, ctypes.POINTER(_QualityState)]
+
+
+def quality_names(flags):
+    """Names of the QUALITY_* bits set in flags"""
+    return [name for bit, name in QUALITY_FLAGS.items() if flags & bit]
+
+
+class QualityMonitor:
+    """
+    Per-channel electrode health from the raw counts as they arrive
+    (emg_quality.h): saturation at the ADC rails, 50/60 Hz line noise,
+    flatline and baseline drift, judged every block of samples.
+
+        qm = QualityMonitor(n_channels=4)
+        qm.push(raw)                          # (n, 4) raw counts, any batch size
+        if qm.window_flags(200) & QUALITY_SATURATED: ...
+        qm.channels()                         # per-channel values and flag names
+
+    Thresholds are in microvolts (Cyton gain 24); rail is the fraction of
+    full scale counted as saturated.
+    """
+
+    def __init__(self, n_channels=4, fs=CYTON_FS, block=125, rail=0.95, line_uv=50.0, flat_uv=0.5,
+                 drift_uv_per_s=1000.0, drift_tau_s=2.0):
+        cfg = _QualityConfig(n_channels, fs, block, rail * CYTON_FULL_SCALE, line_uv / CYTON_UV_PER_COUNT,
+                             flat_uv / CYTON_UV_PER_COUNT, drift_uv_per_s / CYTON_UV_PER_COUNT, drift_tau_s)
+        self._h = _lib.emg_quality_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid quality monitor settings ({n_channels} channels, fs {fs}, block {block})")
+        self.n_channels = n_channels
+        self.block = block
+        self._state = _QualityState()
+        self._per_channel = (ctypes.c_uint32 * n_channels)()
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_quality_destroy(self._h)
+            self._h = None
+
+    def reset(self):
+        _lib.emg_quality_reset(self._h)
+
+    def push(self, x):
+        """Raw counts, shape (n_samples, n_channels); returns the blocks completed"""
+        x = np.ascontiguousarray(np.asarray(x).reshape(-1, self.n_channels), dtype=np.float64)
+        return _check(_lib.emg_quality_push(self._h, x, len(x)), "emg_quality_push")
+
+    def window_flags(self, n_samples, per_channel=False):
+        """QUALITY_* flags of the last n_samples (a list per channel with per_channel=True)"""
+        flags = _lib.emg_quality_window_flags(self._h, n_samples, self._per_channel)
+        return list(self._per_channel) if per_channel else flags
+
+    def stats(self):
+        _lib.emg_quality_get(self._h, ctypes.byref(self._state))
+        s = self._state
+        n = self.n_channels
+        return {
+            'rms': list(s.rms[:n]),
+            'line_rms': [list(s.line_rms[ch]) for ch in range(n)],
+            'baseline': list(s.baseline[:n]),
+            'drift': list(s.drift[:n]),
+            'saturated': list(s.saturated[:n]),
+            'flags': list(s.flags[:n]),
+            'bad_blocks': list(s.bad_blocks[:n]),
+            'samples': s.samples,
+            'blocks': s.blocks,
+        }
+
+    def channels(self):
+        """The last block per channel in microvolts, with its flag names"""
+        s = self.stats()
+        return [{
+            'rms_uv': s['rms'][ch] * CYTON_UV_PER_COUNT,
+            'line_uv': max(s['line_rms'][ch]) * CYTON_UV_PER_COUNT,
+            'drift_uv_per_s': s['drift'][ch] * CYTON_UV_PER_COUNT,
+            'saturated': s['saturated'][ch],
+            'flags': quality_names(s['flags'][ch]),
+            'bad_blocks': s['bad_blocks'][ch],
+        } for ch in range(self.n_channels)]
+
+
+# ----------------------------
+# emg_lda
+# ----------------------------
+class _LdaConfig(ctypes.Structure):
+    _fields_ = [
+        ("n_features", ctypes.c_int),
+        ("n_classes", ctypes.c_int),
+        ("shrinkage", ctypes.c_double),
+    ]
+
+
+class _LdaStats(ctypes.Structure):
+    _fields_ = [
+        ("windows", ctypes.c_uint64),
+        ("refits", ctypes.c_uint64),
+        ("dof", ctypes.c_double),
+        ("refit_us", ctypes.c_double),
+        ("fitted", ctypes.c_int),
+        ("n_fitted", ctypes.c_int),
+    ]
+
+
+_lib.emg_lda_create.restype = ctypes.c_void_p
+_lib.emg_lda_create.argtypes = [ctypes.POINTER(_LdaConfig)]
+_lib.emg_lda_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_lda_reset.argtypes = [ctypes.c_void_p]
+_lib.emg_lda_seed_class.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_double, _f64_p]
+_lib.emg_lda_seed_cov.argtypes = [ctypes.c_void_p, ctypes.c_double, _f64_p]
+_lib.emg_lda_add.argtypes = [ctypes.c_void_p, _f64_p, _i32_p, ctypes.c_int]
+_lib.emg_lda_refit.argtypes = [ctypes.c_void_p]
+_lib.emg_lda_predict.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int, _i32_p, _f64_p]
+_lib.emg_lda_get_class.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_double), _f64_p]
+_lib.emg_lda_get_cov.argtypes = [ctypes.c_void_p, _f64_p]
+_lib.emg_lda_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_LdaStats)]
+
+
+class OnlineLDA:
+    """
+    LDA whose class means and pooled covariance are updated one labelled
+    window at a time (rank-one, Welford) and refit in microseconds.
+
+    Stands in for a fitted sklearn LinearDiscriminantAnalysis in the
+    classifiers: classes_, predict() and predict_proba() over (already
+    scaled) feature vectors. from_model() starts from a trained LDA, each
+    class mean counting as `weight` windows and its covariance (when the
+    model stored one) as weight * n_classes, so a short calibration moves the
+    model toward the session instead of replacing it. Priors are equal. The
+    pooled covariance divides the scatter by the number of windows N, as
+    sklearn's covariance_ does, and seeds count the same way.
+
+    Picklable: the statistics are saved and the discriminant refit on load.
+    """
+
+    def __init__(self, n_features, classes, shrinkage=0.05):
+        self.n_features = int(n_features)
+        self.classes_ = np.asarray(classes)
+        self.shrinkage = float(shrinkage)
+        self._index = {c: i for i, c in enumerate(self.classes_.tolist())}
+        cfg = _LdaConfig(self.n_features, len(self.classes_), self.shrinkage)
+        self._h = _lib.emg_lda_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Cannot create an online LDA for {n_features} features, "
+                             f"{len(self.classes_)} classes, shrinkage {shrinkage}")
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_lda_destroy(self._h)
+            self._h = None
+
+    @classmethod
+    def from_model(cls, model, weight=20.0, shrinkage=0.05):
+        """Seeded with a fitted LinearDiscriminantAnalysis (means_, covariance_ if stored)"""
+        means = np.asarray(model.means_, dtype=np.float64)
+        lda = cls(means.shape[1], model.classes_, shrinkage=shrinkage)
+        for c, mean in enumerate(means):
+            _check(_lib.emg_lda_seed_class(lda._h, c, weight, np.ascontiguousarray(mean)), "lda seed")
+        cov = getattr(model, 'covariance_', None)
+        if cov is not None:
+            _check(_lib.emg_lda_seed_cov(lda._h, weight * len(means),
+                                         np.ascontiguousarray(cov, dtype=np.float64)), "lda seed cov")
+            lda.refit()
+        return lda
+
+    def reset(self):
+        _lib.emg_lda_reset(self._h)
+
+    def _features(self, X):
+        X = np.ascontiguousarray(np.atleast_2d(X), dtype=np.float64)
+        if X.shape[1] != self.n_features:
+            raise ValueError(f"Expected {self.n_features} features, got {X.shape[1]}")
+        return X
+
+    def partial_fit(self, X, y):
+        """Fold labelled feature vectors into the statistics (refit() to use them)"""
+        X = self._features(X)
+        labels = np.array([self._index[label] for label in np.atleast_1d(y)], dtype=np.int32)
+        if len(labels) != X.shape[0]:
+            raise ValueError("X and y differ in length")
+        _check(_lib.emg_lda_add(self._h, X, labels, X.shape[0]), "lda add")
+        return self
+
+    def refit(self):
+        """Rebuild the discriminant from the statistics; False if not possible yet"""
+        return _lib.emg_lda_refit(self._h) == Q8_OK
+
+    def predict_proba(self, X):
+        X = self._features(X)
+        proba = np.empty((X.shape[0], len(self.classes_)), dtype=np.float64)
+        labels = np.empty(X.shape[0], dtype=np.int32)
+        _check(_lib.emg_lda_predict(self._h, X, X.shape[0], labels, proba), "lda predict")
+        return proba
+
+    def predict(self, X):
+        return self.classes_[np.argmax(self.predict_proba(X), axis=1)]
+
+    def class_stats(self, c):
+        """(weight, mean) of class index c"""
+        weight = ctypes.c_double()
+        mean = np.empty(self.n_features, dtype=np.float64)
+        _check(_lib.emg_lda_get_class(self._h, c, ctypes.byref(weight), mean), "lda class")
+        return weight.value, mean
+
+    @property
+    def covariance_(self):
+        cov = np.empty((self.n_features, self.n_features), dtype=np.float64)
+        _check(_lib.emg_lda_get_cov(self._h, cov), "lda covariance")
+        return cov
+
+    @property
+    def means_(self):
+        return np.array([self.class_stats(c)[1] for c in range(len(self.classes_))])
+
+    def stats(self):
+        s = _LdaStats()
+        _lib.emg_lda_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _LdaStats._fields_}
+
+    def __getstate__(self):
+        s = self.stats()
+        return {
+            'n_features': self.n_features,
+            'classes': self.classes_.tolist(),
+            'shrinkage': self.shrinkage,
+            'weights': [self.class_stats(c)[0] for c in range(len(self.classes_))],
+            'means': self.means_,
+            'dof': s['dof'],
+            'covariance': self.covariance_ if s['dof'] > 0 else None,
+        }
+
+    def __setstate__(self, state):
+        self.__init__(state['n_features'], state['classes'], state['shrinkage'])
+        for c, (weight, mean) in enumerate(zip(state['weights'], state['means'])):
+            if weight > 0:
+                _check(_lib.emg_lda_seed_class(self._h, c, weight, np.ascontiguousarray(mean)), "lda seed")
+        if state['covariance'] is not None:
+            _check(_lib.emg_lda_seed_cov(self._h, state['dof'], np.ascontiguousarray(state['covariance'])),
+                   "lda seed cov")
+            self.refit()
+
+
+# ----------------------------
+# emg_augment
+# ----------------------------
+class _AugmentConfig(ctypes.Structure):
+    _fields_ = [
+        ("n_channels", ctypes.c_int),
+        ("window", ctypes.c_int),
+        ("stride", ctypes.c_int),
+        ("copies", ctypes.c_int),
+        ("shift", ctypes.c_int),
+        ("scale", ctypes.c_double),
+        ("gain_jitter", ctypes.c_double),
+        ("feature_set", ctypes.c_int),
+        ("seed", ctypes.c_uint64),
+    ]
+
+
+class _AugmentInfo(ctypes.Structure):
+    _fields_ = [
+        ("start", ctypes.c_int),
+        ("augmented", ctypes.c_int),
+        ("gain", ctypes.c_double * MAX_CHANNELS),
+    ]
+
+
+class _AugmentStats(ctypes.Structure):
+    _fields_ = [
+        ("recordings", ctypes.c_uint64),
+        ("windows", ctypes.c_uint64),
+        ("augmented", ctypes.c_uint64),
+    ]
+
+
+_lib.emg_augment_create.restype = ctypes.c_void_p
+_lib.emg_augment_create.argtypes = [ctypes.POINTER(_AugmentConfig)]
+_lib.emg_augment_destroy.argtypes = [ctypes.c_void_p]
+_lib.emg_augment_count.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.emg_augment_num_features.argtypes = [ctypes.c_void_p]
+_lib.emg_augment_begin.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int, ctypes.c_void_p]
+_lib.emg_augment_next.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_void_p, ctypes.POINTER(_AugmentInfo)]
+_lib.emg_augment_features.argtypes = [ctypes.c_void_p, _f64_p, ctypes.c_int]
+_lib.emg_augment_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_AugmentStats)]
+
+
+class Augmenter:
+    """
+    Training windows cut from whole recordings at every `stride` samples,
+    each position giving the plain window and `copies` variants with a time
+    shift (up to +-shift samples), an amplitude scale (uniform within
+    +-scale) and per-channel gain jitter (standard deviation gain_jitter),
+    drawn from a generator seeded with `seed` (emg_augment.h):
+
+        aug = Augmenter(window=200, stride=25, copies=2, feature_type='time_domain')
+        X = aug.features(recording, aux)            # [aug.count(len(recording))][F]
+        for window, window_aux, info in aug.windows(recording, aux):
+            ...
+
+    Windows are generated one at a time and never stored; features() runs
+    them through the native feature set of feature_type (an emg_features.py
+    name) without returning to Python in between.
+    """
+
+    def __init__(self, n_channels=4, window=200, stride=25, copies=2, shift=10, scale=0.2,
+                 gain_jitter=0.1, feature_type=None, seed=0):
+        if feature_type is not None and feature_type not in FEATURE_SETS:
+            raise ValueError(f"Unknown feature_type {feature_type!r} (one of {', '.join(FEATURE_SETS)})")
+        cfg = _AugmentConfig(n_channels, window, stride, copies, shift, scale, gain_jitter,
+                             FEATURE_SETS[feature_type] if feature_type is not None else -1, seed)
+        self._h = _lib.emg_augment_create(ctypes.byref(cfg))
+        if not self._h:
+            raise ValueError(f"Invalid augmentation settings (window {window}, stride {stride}, copies {copies}, "
+                             f"shift {shift}, scale {scale}, gain jitter {gain_jitter})")
+        self.n_channels = n_channels
+        self.window = window
+        self.feature_type = feature_type
+        self._recording = None
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.emg_augment_destroy(self._h)
+            self._h = None
+
+    def count(self, n_samples):
+        """Windows a recording of n_samples gives"""
+        return _lib.emg_augment_count(self._h, int(n_samples))
+
+    @property
+    def num_features(self):
+        return _check(_lib.emg_augment_num_features(self._h), "emg_augment_num_features")
+
+    def _begin(self, recording, aux):
+        data = np.ascontiguousarray(recording, dtype=np.float64)
+        if data.ndim != 2 or data.shape[1] != self.n_channels:
+            raise ValueError(f"Expected a [samples][{self.n_channels}] recording, got shape {data.shape}")
+        if aux is not None:
+            aux = np.ascontiguousarray(np.asarray(aux).reshape(-1, 3), dtype=np.int16)
+            if len(aux) != len(data):
+                raise ValueError(f"aux has {len(aux)} rows for {len(data)} samples")
+        # Both are read by the generator until the next recording
+        self._recording = (data, aux)
+        _check(_lib.emg_augment_begin(self._h, data, len(data),
+                                      aux.ctypes.data if aux is not None else None), "emg_augment_begin")
+        return data, aux
+
+    def windows(self, recording, aux=None):
+        """Yields (window [window][n_channels], aux [window][3] or None, info) lazily"""
+        _, aux = self._begin(recording, aux)
+        info = _AugmentInfo()
+        while True:
+            out = np.empty((self.window, self.n_channels), dtype=np.float64)
+            out_aux = np.empty((self.window, 3), dtype=np.int16) if aux is not None else None
+            if not _lib.emg_augment_next(self._h, out, out_aux.ctypes.data if out_aux is not None else None,
+                                         ctypes.byref(info)):
+                return
+            yield out, out_aux, {
+                'start': info.start,
+                'augmented': bool(info.augmented),
+                'gain': list(info.gain[:self.n_channels]),
+            }
+
+    def features(self, recording, aux=None):
+        """Feature vectors of every window of the recording, [count][num_features]"""
+        data, aux = self._begin(recording, aux)
+        out = np.empty((self.count(len(data)), self.num_features), dtype=np.float64)
+        rows = _check(_lib.emg_augment_features(self._h, out, len(out)), "emg_augment_features")
+        return out[:rows]
+
+    def stats(self):
+        s = _AugmentStats()
+        _lib.emg_augment_get_stats(self._h, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in _AugmentStats._fields_}
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+Latency budget from q8_trace files (Q8_TRACE=path.json)
+
+Every span carries the trace id of the decision it belongs to: the seq of
+the Cyton frame that completed the decision window. Spans with the same id
+form one chain, from the window through feature extraction, inference,
+smoothing, the gesture link and the motion loop to the sync write.
+
+For each stage (in pipeline order, from the chains that contain it) this
+prints count, mean / p50 / p99 / max duration and its share of the
+end-to-end time of the chains that reach the last stage, plus the time in
+those chains that no span covers (queueing between stages).
+
+Files from several processes are combined; each was written on the clock
+its process chose (the robot writes on the wristband host's clock using the
+gesture link's offset estimate), so they line up without adjustment.
+
+    python3 trace_summary.py /tmp/wrist.json /tmp/robot.json
+    python3 trace_summary.py /tmp/wrist.json /tmp/robot.json --merge /tmp/all.json
+
+--merge writes one trace for chrome://tracing or ui.perfetto.dev, with
+flow arrows following each decision across processes.
+"""
+
+import argparse
+import json
+import sys
+from collections import defaultdict
+
+import numpy as np
+
+
+def load(paths):
+    """Events of all files, with distinct pids per file"""
+    events = []
+    used = set()
+    for path in paths:
+        with open(path) as f:
+            trace = json.load(f)
+        file_events = trace['traceEvents'] if isinstance(trace, dict) else trace
+        pids = {e.get('pid') for e in file_events}
+        remap = {}
+        for pid in pids:
+            new = pid
+            while new in used:
+                new += 100000
+            remap[pid] = new
+            used.add(new)
+        for e in file_events:
+            e['pid'] = remap.get(e.get('pid'), e.get('pid'))
+            events.append(e)
+    return events
+
+
+def chains(events):
+    """trace id -> list of (stage, start_us, dur_us)"""
+    out = defaultdict(list)
+    for e in events:
+        if e.get('ph') != 'X':
+            continue
+        tid = e.get('args', {}).get('id', 0)
+        if tid:
+            out[tid].append((e['name'], float(e['ts']), float(e.get('dur', 0.0))))
+    return out
+
+
+def covered_us(spans):
+    """Length of the union of the spans' intervals"""
+    total, end = 0.0, None
+    for _, t0, dur in sorted(spans, key=lambda s: s[1]):
+        t1 = t0 + dur
+        if end is None or t0 > end:
+            total += dur
+            end = t1
+        elif t1 > end:
+            total += t1 - end
+            end = t1
+    return total
+
+
+def stage_order(by_id):
+    """
+    Stages in pipeline order: A comes before B if, in most chains that have
+    both, A starts first. Taken in topological order of that relation (ties
+    by median start offset), since some stages only appear in some chains.
+    """
+    first = defaultdict(int)
+    offsets = defaultdict(list)
+    for spans in by_id.values():
+        start = {}
+        for name, t0, _ in spans:
+            start[name] = min(t0, start.get(name, t0))
+        t_chain = min(start.values())
+        for a in start:
+            offsets[a].append(start[a] - t_chain)
+            for b in start:
+                if a != b and start[a] < start[b]:
+                    first[a, b] += 1
+
+    remaining = set(offsets)
+    order = []
+    while remaining:
+        def blockers(n):
+            return sum(1 for m in remaining if first[m, n] > first[n, m])
+        name = min(remaining, key=lambda n: (blockers(n), np.median(offsets[n]), n))
+        order.append(name)
+        remaining.remove(name)
+    return order
+
+
+def summarize(events, out=sys.stdout):
+    by_id = {tid: spans for tid, spans in chains(events).items() if len({s[0] for s in spans}) > 1}
+    if not by_id:
+        print("No chains: need spans of at least two stages with the same trace id", file=out)
+        return
+
+    order = stage_order(by_id)
+    last = order[-1]
+    complete = {tid: spans for tid, spans in by_id.items() if any(s[0] == last for s in spans)}
+
+    e2e = []
+    gaps = []
+    share = defaultdict(float)
+    for spans in complete.values():
+        start = min(t0 for _, t0, _ in spans)
+        end = max(t0 + dur for _, t0, dur in spans)
+        e2e.append(end - start)
+        gaps.append(end - start - covered_us(spans))
+        for name, _, dur in spans:
+            share[name] += dur
+    total = sum(e2e)
+
+    durations = defaultdict(list)
+    for spans in by_id.values():
+        for name, _, dur in spans:
+            durations[name].append(dur)
+
+    print(f"{len(by_id)} decisions traced, {len(complete)} reach '{last}'\n", file=out)
+    print(f"  {'stage':16} {'count':>7} {'mean':>9} {'p50':>9} {'p99':>9} {'max':>9} {'share':>7}", file=out)
+
+    def row(name, values, part):
+        v = np.asarray(values) / 1000.0
+        pct = f"{100.0 * part / total:6.1f}%" if total else "      -"
+        print(f"  {name:16} {len(v):7d} {v.mean():9.3f} {np.percentile(v, 50):9.3f} "
+              f"{np.percentile(v, 99):9.3f} {v.max():9.3f} {pct}", file=out)
+
+    for name in order:
+        row(name, durations[name], share[name])
+    if complete:
+        row("(between stages)", gaps, sum(gaps))
+        print("", file=out)
+        row("end to end", e2e, total)
+    print("\n  times in ms; share: of the end-to-end time of the chains that reach the last stage", file=out)
+
+
+def merge(events, path):
+    """One trace with flow arrows regenerated across all processes"""
+    out = [e for e in events if e.get('ph') not in ('s', 't', 'f')]
+    points = defaultdict(list)
+    for e in out:
+        tid = e.get('args', {}).get('id', 0) if e.get('ph') in ('X', 'i') else 0
+        if tid:
+            points[tid].append((float(e['ts']), e['pid'], e['tid']))
+    for tid, pts in points.items():
+        if len(pts) < 2:
+            continue
+        pts.sort()
+        for k, (ts, pid, thread) in enumerate(pts):
+            ph = 's' if k == 0 else 'f' if k == len(pts) - 1 else 't'
+            flow = {"name": "decision", "cat": "q8", "ph": ph, "id": tid, "ts": ts, "pid": pid, "tid": thread}
+            if ph == 'f':
+                flow["bp"] = "e"
+            out.append(flow)
+    with open(path, 'w') as f:
+        json.dump({"displayTimeUnit": "ms", "traceEvents": out}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-stage latency budget from q8_trace files")
+    parser.add_argument('traces', nargs='+', help="trace JSON files (Q8_TRACE output)")
+    parser.add_argument('--merge', metavar='PATH', help="also write the combined trace here")
+    args = parser.parse_args()
+
+    events = load(args.traces)
+    summarize(events)
+    if args.merge:
+        merge(events, args.merge)
+        print(f"\nMerged trace: {args.merge}")
+
+
+if __name__ == "__main__":
+    main()
@@ -3,7 +3,22 @@ from __future__ import annotations
 
 from dataclasses import dataclass
 from typing import Optional, Any, Dict
-import time
+from collections import deque
+import os
+import sys
+
+import numpy as np
+
+from q8gait.clock import SYSTEM_CLOCK
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'native'))
+try:
+    from q8native import DecisionStage, GestureSubscriber, GESTURE_CODES, GL_DEFAULT_PORT
+except ImportError:
+    DecisionStage = None
+    GestureSubscriber = None
+    GESTURE_CODES = None
+    GL_DEFAULT_PORT = 5860
 
 
 # These are the only gesture strings the rest of your robot code should depend on.
@@ -33,7 +48,27 @@ class EMGConfig:
         If a gesture is detected, how long to keep outputting it (reduces flicker).
 
     cooldown_ms:
-        Minimum time between emitting non-stop gestures (prevents rapid jitter).
+        Minimum time between starting non-stop gestures (prevents rapid jitter).
+
+    vote_window:
+        Majority vote over this many classifier outputs (1 = off).
+
+    prob_window:
+        Average class probabilities over this many outputs (1 = off). Only
+        used when _classify() also returns probabilities.
+
+    enter_threshold / exit_threshold:
+        Hysteresis on the confidence: a new gesture needs enter_threshold,
+        the current one is kept down to exit_threshold (0 = off).
+
+    link:
+        Where the wristband classifier (classify_realtime.py with
+        Q8_GESTURE_LINK set) sends its decisions: "udp::PORT" to listen on
+        all interfaces, "unix:PATH" when both run on this host.
+
+    ping_ms:
+        Clock-sync ping period towards the wristband host (0 = off; then
+        latencies assume both hosts share a clock).
 
     debug:
         If True, stores last raw/frame/features for inspection.
@@ -41,9 +76,59 @@ class EMGConfig:
     sample_hz: int = 200
     gesture_hold_ms: int = 150
     cooldown_ms: int = 200
+    vote_window: int = 1
+    prob_window: int = 1
+    enter_threshold: float = 0.0
+    exit_threshold: float = 0.0
+    link: str = f"udp::{GL_DEFAULT_PORT}"
+    ping_ms: int = 200
     debug: bool = False
 
 
+class _HoldCooldown:
+    """
+    Cooldown and hold without libq8native.so: the last two steps of the
+    native decision stage (emg_decision.h), without voting or hysteresis
+    """
+
+    def __init__(self, hold_ms: float, cooldown_ms: float, stop: str = "stop"):
+        self.hold_s = hold_ms / 1000.0
+        self.cooldown_s = cooldown_ms / 1000.0
+        self.stop = stop
+        self.active: Optional[str] = None
+        self.output: Optional[str] = None
+        self.last_onset: Optional[float] = None
+        self.hold_label: Optional[str] = None
+        self.hold_until = 0.0
+
+    def update(self, label: Optional[str], probabilities=None, t: float = 0.0) -> Optional[str]:
+        nxt = label
+        # Cooldown on gesture onsets (stop is exempt)
+        if (nxt != self.active and nxt not in (None, self.stop) and self.last_onset is not None
+                and t - self.last_onset < self.cooldown_s):
+            nxt = self.active
+        if nxt != self.active and nxt is not None:
+            self.last_onset = t
+            if nxt != self.stop:
+                self.hold_label = nxt
+                self.hold_until = t + self.hold_s
+        self.active = nxt
+
+        # Hold (a stop cancels it)
+        if nxt == self.stop:
+            self.hold_label = None
+        elif self.hold_label is not None and t < self.hold_until:
+            nxt = self.hold_label
+        self.output = nxt
+        return nxt
+
+    def tick(self, t: float = 0.0) -> Optional[str]:
+        # Between decisions: the last output until its hold runs out
+        if self.output != self.active and self.output == self.hold_label and t >= self.hold_until:
+            self.output = self.active
+        return self.output
+
+
 class EMGInterface:
     """
     EMG-based gesture source (polled from main loop).
@@ -63,22 +148,53 @@ class EMGInterface:
         or None if no update / no confident gesture.
     """
 
-    def __init__(self, cfg: EMGConfig = EMGConfig()):
+    def __init__(self, cfg: EMGConfig = EMGConfig(), tracer=None, clock=None):
         self.cfg = cfg
+        self.tracer = tracer
+        # Hold / cooldown and latency timestamps (q8native.Clock in a simulation)
+        self.clock = clock if clock is not None else SYSTEM_CLOCK
 
         self._gesture: Optional[str] = None
 
-        # timing state
-        self._last_emit_t: float = 0.0
-        self._hold_until_t: float = 0.0
+        # Voting, hysteresis, hold and cooldown (native decision stage;
+        # hold and cooldown only without libq8native.so)
+        self._classes = sorted(GESTURES)
+        if DecisionStage is not None:
+            self._decision = DecisionStage(
+                self._classes,
+                vote_window=cfg.vote_window,
+                prob_window=cfg.prob_window,
+                enter=cfg.enter_threshold,
+                exit=cfg.exit_threshold,
+                hold_ms=cfg.gesture_hold_ms,
+                cooldown_ms=cfg.cooldown_ms,
+                stop="stop",
+            )
+        elif cfg.vote_window > 1 or cfg.prob_window > 1 or cfg.enter_threshold or cfg.exit_threshold:
+            raise ImportError("vote_window, prob_window and the hysteresis thresholds need libq8native.so. "
+                              "Build it with: make -C native")
+        else:
+            self._decision = _HoldCooldown(cfg.gesture_hold_ms, cfg.cooldown_ms, stop="stop")
 
         # optional debug state
         self.debug_last: Dict[str, Any] = {}
 
-        # TODO(EMG): initialize hardware / serial / BLE / file reader here.
-        # Example:
-        #   self.sensor = MyEMGSensor(port=..., baud=...)
-        self.sensor = None  # placeholder
+        # Decisions from the wristband host (native gesture link)
+        self.sensor = None
+        if GestureSubscriber is not None:
+            self.sensor = GestureSubscriber(cfg.link, ping_ms=cfg.ping_ms)
+        else:
+            print(f"[emg] The gesture link ({cfg.link}) needs libq8native.so (make -C native): "
+                  f"no EMG gestures", file=sys.stderr)
+
+        # Capture (wristband clock) of the gesture waiting to be acted on,
+        # and capture -> actuation latencies in ms
+        self._pending_capture_ns: Optional[int] = None
+        self.latencies_ms = deque(maxlen=1000)
+
+        # q8native.Tracer id of the decision behind the current gesture
+        # (read by MotionRunner when it acts on it)
+        self.trace_id = 0
 
     # ----------------------------
     # Public API expected by main
@@ -92,17 +208,14 @@ class EMGInterface:
           3) classify into a gesture string
           4) apply debounce/cooldown/hold logic
         """
-        now = time.time()
-
-        # 0) If we're holding a previous gesture, keep it active until hold ends
-        if self._gesture is not None and now < self._hold_until_t:
-            return
+        now = self.clock.now()
 
         # 1) Read one "frame" from the EMG sensor
         frame = self._read_sensor_frame()
         if frame is None:
-            # no new data available
-            self._gesture = None
+            # no new data available: the gesture stays, unless it was only
+            # held and the hold ran out (no vote is added)
+            self._gesture = self._decision.tick(now)
             return
 
         # 2) Compute features from raw data
@@ -114,8 +227,16 @@ class EMGInterface:
         # 4) Validate output + apply cooldown/hold rules
         gesture = self._apply_rules(gesture, now)
 
+        if gesture is not None and gesture != self._gesture:
+            self._pending_capture_ns = frame["t_capture_ns"]
+            self.trace_id = frame["trace_id"]
         self._gesture = gesture
 
+        if self.tracer is not None and frame["trace_id"]:
+            # Datagram in the socket until this poll, then the rules above
+            self.tracer.span("socket_wait", frame["t_recv_ns"], frame["t_read_ns"], frame["trace_id"])
+            self.tracer.span("robot_decision", frame["t_read_ns"], None, frame["trace_id"])
+
         if self.cfg.debug:
             self.debug_last = {
                 "t": now,
@@ -130,26 +251,67 @@ class EMGInterface:
         """
         return self._gesture
 
+    def actuated(self, t_ns: Optional[int] = None) -> None:
+        """
+        Called by the motion loop once a new gesture has reached the servos.
+        Records capture -> actuation latency on this host's clock, using the
+        link's estimate of the wristband host's clock offset.
+        """
+        if self._pending_capture_ns is None or self.sensor is None:
+            return
+        if t_ns is None:
+            t_ns = self.clock.now_ns()
+        capture = self.sensor.to_local_ns(self._pending_capture_ns)
+        self.latencies_ms.append((t_ns - capture) / 1e6)
+        self._pending_capture_ns = None
+
+    def latency_summary(self) -> str:
+        if self.sensor is None:
+            return "no gesture link"
+        stats = self.sensor.stats()
+        summary = f"{stats['received']} received, {stats['lost']} lost, {stats['stale']} stale, "
+        if stats['synced']:
+            summary += f"clock offset {stats['offset_ns'] / 1e6:+.3f} ms (rtt {stats['rtt_ns'] / 1e6:.3f} ms)"
+        else:
+            summary += "clock not synced"
+        if self.latencies_ms:
+            lat = np.array(self.latencies_ms)
+            summary += (f"; capture -> actuation mean {lat.mean():.1f} ms, "
+                        f"p99 {np.percentile(lat, 99):.1f} ms, max {lat.max():.1f} ms ({len(lat)} changes)")
+        return summary
+
+    def close(self) -> None:
+        if self.sensor is not None:
+            self.sensor.close()
+
     # ----------------------------
     # TODO blocks for teammate
     # ----------------------------
     def _read_sensor_frame(self) -> Optional[Any]:
         """
-        Read raw data from the EMG sensor.
+        Read the newest decision sent by the wristband classifier.
 
         Return:
-            A single frame/sample/batch in any format your teammate chooses.
-            Examples:
-              - float (1-channel amplitude)
-              - list[float] (multi-channel)
-              - dict with timestamps + channels
-              - bytes that later get parsed
-
-            Return None if no new data is available.
+            dict with gesture (name or None), confidence, seq,
+            t_capture_ns (wristband clock), t_recv_ns / t_read_ns (arrival
+            and this read, local clock) and trace_id, or None if nothing new
+            arrived. Non-blocking.
         """
-        # TODO(EMG): implement this.
-        # Must be NON-BLOCKING (or very fast) since main loop is real-time.
-        return None
+        if self.sensor is None:
+            return None
+        messages = self.sensor.poll(0)
+        if len(messages) == 0:
+            return None
+        m = messages[-1]
+        return {
+            "gesture": GESTURE_CODES[m["gesture"]],
+            "confidence": float(m["confidence"]),
+            "seq": int(m["seq"]),
+            "t_capture_ns": int(m["t_capture_ns"]),
+            "t_recv_ns": int(m["t_recv_ns"]),
+            "t_read_ns": self.clock.now_ns(),
+            "trace_id": int(m["trace_id"]),
+        }
 
     def _compute_features(self, frame: Any) -> Any:
         """
@@ -163,9 +325,11 @@ class EMGInterface:
           - IMU fusion features if available
 
         Return any object (dict recommended) consumed by _classify().
+
+        Features are extracted on the wristband host; frames already carry
+        the decision.
         """
-        # TODO(EMG): implement feature extraction.
-        return {"raw": frame}
+        return frame
 
     def _classify(self, features: Any) -> Optional[str]:
         """
@@ -175,8 +339,13 @@ class EMGInterface:
             "forward", "backward", "turn_left", "turn_right", "stop",
             "jump", "jump_forward", "jump_backward", "jump_left", "jump_right"
         or None (no confident gesture).
+
+        May also return (gesture, probabilities) with one probability per
+        gesture in sorted(GESTURES) order, to enable averaging/hysteresis.
         """
-        # TODO(EMG): implement classification logic.
+        # Gestures arrive classified from the wristband host. The notes below
+        # are for classifying here instead.
+        #
         # Suggested approach:
         #   - return "stop" when confidence is low / below thresholds
         #   - return "jump" or directional jump on a short high peak
@@ -238,32 +407,21 @@ class EMGInterface:
         #    - Require the spike to return to baseline quickly
         #    - Consider adding a "gesture preparation" phase detection
         #
-        return None
+        return features["gesture"]
 
     # ----------------------------
     # Internal helpers
     # ----------------------------
-    def _apply_rules(self, gesture: Optional[str], now: float) -> Optional[str]:
+    def _apply_rules(self, gesture: Any, now: float) -> Optional[str]:
         """
         Debounce/cooldown/hold behavior so you don't spam the robot.
+        Stop is always passed through immediately.
         """
-        if gesture is None:
-            return None
+        probabilities = None
+        if isinstance(gesture, tuple):
+            gesture, probabilities = gesture
 
-        if gesture not in GESTURES:
+        if gesture is not None and gesture not in GESTURES:
             raise ValueError(f"Invalid gesture '{gesture}'. Must be one of: {sorted(GESTURES)}")
 
-        # Always allow stop immediately
-        if gesture == "stop":
-            self._last_emit_t = now
-            self._hold_until_t = 0.0
-            return "stop"
-
-        # Cooldown for non-stop gestures
-        if (now - self._last_emit_t) * 1000.0 < self.cfg.cooldown_ms:
-            return None
-
-        # Hold the gesture for a short time to reduce flicker
-        self._last_emit_t = now
-        self._hold_until_t = now + (self.cfg.gesture_hold_ms / 1000.0)
-        return gesture
+        return self._decision.update(gesture, probabilities, t=now)
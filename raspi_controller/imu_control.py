@@ -14,6 +14,16 @@ sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'wristband_cont
 # Import IMU reader
 from read_imu import IMUReader
 
+# Native io_uring loop and orientation filter (optional: falls back to
+# polling + sleep and the raw tilt of the newest packet)
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'native'))
+try:
+    from q8native import Reactor, OrientationFilter, Tracer
+except ImportError:
+    Reactor = None
+    OrientationFilter = None
+    Tracer = None
+
 from q8gait.kinematics_solver import k_solver
 from q8gait.config_rx24f import default_config
 from q8gait.robot import Robot
@@ -35,13 +45,31 @@ class IMUInterface:
     - Positive pitch -> turn_left
     - Negative pitch -> turn_right
     - If both < 30 degrees -> stop
+
+    With libq8native.so built, every packet's accelerometer reading goes
+    through a native low-pass filter (tau_ms) and a direction is kept until
+    its angle drops below threshold - hysteresis.
     """
 
-    def __init__(self, threshold: float = 30.0):
+    # OrientationFilter direction -> gesture
+    DIRECTION_GESTURES = {
+        None: "stop",
+        'roll+': "forward",
+        'roll-': "backward",
+        'pitch+': "turn_left",
+        'pitch-': "turn_right",
+    }
+
+    def __init__(self, threshold: float = 30.0, hysteresis: float = 5.0, tau_ms: float = 150.0):
         self.threshold = threshold
         self._current_gesture: Optional[str] = "stop"
         self.imu_reader = IMUReader()
 
+        self.orientation = None
+        if OrientationFilter is not None:
+            self.orientation = OrientationFilter(tau_ms=tau_ms, enter_deg=threshold,
+                                                 exit_deg=threshold - hysteresis)
+
         # Connect to IMU
         if not self.imu_reader.connect():
             raise RuntimeError("Failed to connect to IMU")
@@ -56,6 +84,8 @@ class IMUInterface:
         print("  Positive pitch -> turn_left")
         print("  Negative pitch -> turn_right")
         print("  Below threshold -> stop")
+        if self.orientation is not None:
+            print(f"  Filter: {tau_ms:.0f} ms low-pass, exit below {threshold - hysteresis:.0f} degrees")
         print()
 
         # Wait for data to stabilize
@@ -71,23 +101,49 @@ class IMUInterface:
         if not packets:
             return
 
+        if self.orientation is not None:
+            # Every packet, stamped with the time this batch was read
+            self.orientation.push([p['aux'] for p in packets], time.monotonic_ns())
+            self._apply_orientation()
+            return
+
         # Use the most recent packet
         latest = packets[-1]
 
         if 'aux' in latest and len(latest['aux']) >= 3:
-            self.imu_reader.accel_x = latest['aux'][0]
-            self.imu_reader.accel_y = latest['aux'][1]
-            self.imu_reader.accel_z = latest['aux'][2]
-
-            # Calculate orientation
-            self.imu_reader.calculate_orientation(
-                self.imu_reader.accel_x,
-                self.imu_reader.accel_y,
-                self.imu_reader.accel_z
-            )
+            self._apply_aux(latest['aux'])
 
-            # Convert to gesture
-            self._update_gesture()
+    def feed_frames(self, frames) -> None:
+        """Use frames read by a q8native.Reactor instead of polling the port"""
+        if len(frames) == 0:
+            return
+        if self.orientation is not None:
+            self.orientation.push_frames(frames)
+            self._apply_orientation()
+            return
+        # Accelerometer axes decoded with the channels (aux bytes 26-31)
+        self._apply_aux(frames[-1]['accel'].tolist())
+
+    def _apply_orientation(self) -> None:
+        """Filtered pitch/roll and hysteresis direction from the native filter"""
+        self.imu_reader.pitch = self.orientation.pitch
+        self.imu_reader.roll = self.orientation.roll
+        self._set_gesture(self.DIRECTION_GESTURES[self.orientation.direction])
+
+    def _apply_aux(self, aux) -> None:
+        self.imu_reader.accel_x = aux[0]
+        self.imu_reader.accel_y = aux[1]
+        self.imu_reader.accel_z = aux[2]
+
+        # Calculate orientation
+        self.imu_reader.calculate_orientation(
+            self.imu_reader.accel_x,
+            self.imu_reader.accel_y,
+            self.imu_reader.accel_z
+        )
+
+        # Convert to gesture
+        self._update_gesture()
 
     def _update_gesture(self) -> None:
         """
@@ -119,6 +175,12 @@ class IMUInterface:
                 else:
                     new_gesture = "backward"
 
+        self._set_gesture(new_gesture)
+
+    def _set_gesture(self, new_gesture: str) -> None:
+        pitch = self.imu_reader.pitch
+        roll = self.imu_reader.roll
+
         # Update gesture if changed
         if new_gesture != self._current_gesture:
             print(f"[IMUInterface] Pitch: {pitch:6.2f}°, Roll: {roll:6.2f}° -> {new_gesture}")
@@ -161,7 +223,10 @@ def main():
         robot.open()
         robot.torque(True)
 
-        runner = MotionRunner(robot, leg, gait_name="TROT_LOW", hz=50)
+        # Q8_TRACE=path.json: latency trace from the frame that changed the
+        # gesture to the sync write that acted on it (reactor loop only)
+        tracer = Tracer.from_env() if Tracer is not None else None
+        runner = MotionRunner(robot, leg, gait_name="TROT_LOW", hz=50, tracer=tracer)
         runner.move_to_neutral(seconds=1.0)
 
         print("\n" + "=" * 80)
@@ -169,8 +234,28 @@ def main():
         print("=" * 80)
         print()
 
-        # Main control loop
-        runner.loop_forever(imu)
+        # Main control loop: one io_uring loop for both serial lines when
+        # the native library is available, otherwise poll + sleep
+        reactor = None
+        if Reactor is not None:
+            try:
+                reactor = Reactor(cyton_fd=imu.imu_reader.ser.fileno(), dxl_fd=robot.fileno())
+            except OSError as e:
+                print(f"[imu_control] io_uring reactor unavailable ({e}), using polling loop")
+
+        if reactor is not None:
+            try:
+                runner.loop_reactor(reactor, imu)
+            finally:
+                stats = reactor.stats()
+                print(f"\n[imu_control] {stats['frames']} frames, {stats['ticks']} ticks "
+                      f"({stats['missed_ticks']} missed), {stats['writes']} writes, "
+                      f"{stats['coalesced']} coalesced")
+                reactor.close()
+                if tracer is not None:
+                    print(f"[imu_control] trace: {tracer.write(process_name='imu control')} events -> {tracer.path}")
+        else:
+            runner.loop_forever(imu)
 
     except KeyboardInterrupt:
         print("\n\nStopping...")
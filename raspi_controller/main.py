@@ -1,8 +1,23 @@
+import os
+import sys
+
 from q8gait.kinematics_solver import k_solver
 from q8gait.config_rx24f import default_config
-from q8gait.robot import Robot
+from q8gait.robot import Robot, load_compliance_profile
 from q8gait.motion_runner import MotionRunner
+from q8gait.servo_model import ServoModel
 from keyboard_interface import KeyboardInterface
+from emg_interface import EMGInterface, EMGConfig
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'native'))
+try:
+    from q8native import LeadCompensator, Tracer
+except ImportError:
+    LeadCompensator = Tracer = None
+
+# dynamixel_tools/compliance_sweep's output; Q8_COMPLIANCE_PROFILE overrides
+TOOLS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'dynamixel_tools')
+COMPLIANCE_PROFILE = os.path.join(TOOLS_DIR, 'compliance.profile')
 
 CENTER_DIST = 30
 L1 = 33
@@ -13,18 +28,50 @@ def main():
     robot = Robot(cfg)
     leg = k_solver(CENTER_DIST, L1, L2, L1, L2)
 
-    kb = KeyboardInterface()
+    # Q8_GESTURE_LINK=udp::5860 (or unix:PATH): drive with the gestures
+    # classify_realtime.py sends, instead of the keyboard
+    link = os.environ.get('Q8_GESTURE_LINK')
+    # Q8_TRACE=path.json: latency trace of each gesture from the link to
+    # the servo write (native/trace_summary.py)
+    tracer = Tracer.from_env() if Tracer is not None else None
+    kb = EMGInterface(cfg=EMGConfig(link=link), tracer=tracer) if link else KeyboardInterface()
 
     robot.open()
     robot.torque(True)
+    profile = os.environ.get('Q8_COMPLIANCE_PROFILE', COMPLIANCE_PROFILE)
+    if os.path.exists(profile):
+        n, failed = robot.apply_compliance_profile(load_compliance_profile(profile))
+        print(f"[main] compliance: {profile} on {n} servos"
+              + (f", failed on IDs {', '.join(map(str, failed))}" if failed else ""))
+
+    # Q8_LEAD=1: send each joint's goals ahead by its lag, estimated from
+    # present-position reads, starting from the servo_sysid models in
+    # dynamixel_tools (native/joint_lead.h)
+    lead = None
+    if os.environ.get('Q8_LEAD') == '1' and LeadCompensator is not None:
+        lead = LeadCompensator(dt=1.0 / 50)
+        models = ServoModel.load_dir(TOOLS_DIR, [m.motor_id for m in cfg.motors])
+        for i, spec in enumerate(cfg.motors):
+            if spec.motor_id in models:
+                lead.set_lag(i, models[spec.motor_id].lag_ms)
 
-    runner = MotionRunner(robot, leg, gait_name="TROT_LOW", hz=50)
+    runner = MotionRunner(robot, leg, gait_name="TROT_LOW", hz=50, tracer=tracer, lead=lead)
 
     runner.move_to_neutral(seconds=1.0)
 
     try:
         runner.loop_forever(kb)
     finally:
+        if tracer is not None:
+            # On the wristband host's clock, so the two traces line up
+            offset = kb.sensor.offset_ns if link else 0
+            n = tracer.write(process_name="robot", clock_offset_ns=offset)
+            print(f"[main] trace: {n} events -> {tracer.path}")
+        if lead is not None:
+            print(f"[main] lead lags (ms): {[round(lag, 1) for lag in lead.lags_ms]}")
+        if link:
+            print(f"[main] gesture link: {kb.latency_summary()}")
+            kb.close()
         try:
             robot.torque(False)
         finally:
@@ -0,0 +1,31 @@
+from __future__ import annotations
+import time
+
+
+class SystemClock:
+    """
+    Real time, same interface as q8native.Clock (which also does virtual
+    time for simulate.py). The default for MotionRunner and EMGInterface,
+    so they run without libq8native.so.
+    """
+    virtual = False
+
+    def now_ns(self) -> int:
+        return time.monotonic_ns()
+
+    def now(self) -> float:
+        return time.monotonic_ns() / 1e9
+
+    __call__ = now
+
+    def sleep_until_ns(self, t_ns: int) -> None:
+        delay = t_ns - time.monotonic_ns()
+        if delay > 0:
+            time.sleep(delay / 1e9)
+
+    def sleep(self, seconds: float) -> None:
+        if seconds > 0:
+            time.sleep(seconds)
+
+
+SYSTEM_CLOCK = SystemClock()
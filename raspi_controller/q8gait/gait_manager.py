@@ -176,6 +176,18 @@ class GaitManager:
 
         return pos
 
+    def peek(self, n):
+        """
+        The next n positions tick() will return, without advancing.
+
+        Returns:
+            list: Up to n joint position lists ([] if no movement active)
+        """
+        if not self.ongoing or self.current_trajectory is None:
+            return []
+        size = len(self.current_trajectory)
+        return [self.current_trajectory[(self.phase_index + k) % size] for k in range(n)]
+
     def stop(self):
         """Stop current movement and reset state."""
         self.ongoing = False
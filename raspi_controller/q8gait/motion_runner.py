@@ -2,9 +2,10 @@ from __future__ import annotations
 import time
 from typing import Optional
 
+from .clock import SYSTEM_CLOCK
 from .gait_manager import GaitManager, GAITS
 from .kinematics_solver import k_solver
-from .robot import Robot
+from .robot import Robot, ADDR_GOAL_POSITION
 
 GESTURE_TO_DIR = {
     "forward": "f",
@@ -22,11 +23,25 @@ GESTURE_TO_DIR = {
 
 class MotionRunner:
     def __init__(self, robot: Robot, leg_solver: k_solver, gait_name: str = "TROT", hz: int = 10,
-                 neutral_center_deg: float = 150.0, custom_gaits: Optional[dict] = None):
+                 neutral_center_deg: float = 150.0, custom_gaits: Optional[dict] = None, tracer=None,
+                 clock=None, lead=None, lead_reads: int = 2):
         self.robot = robot
+        # Every timestamp and sleep goes through the clock (q8native.Clock
+        # in virtual time runs the loop as fast as the CPU allows)
+        self.clock = clock if clock is not None else SYSTEM_CLOCK
+        # q8native.Tracer: spans for the tick that acts on a new gesture,
+        # keyed by the gesture source's trace_id
+        self.tracer = tracer
+        # q8native.LeadCompensator: goals go out shifted earlier by each
+        # joint's lag, estimated from lead_reads present-position reads
+        # (round robin over the joints) after every loop_forever tick
+        self.lead = lead
+        self.lead_reads = lead_reads
+        self._read_joint = 0
         self.leg = leg_solver
         self.hz = hz
         self.dt = 1.0 / hz
+        self.dt_ns = int(round(1e9 / hz))
         self.neutral_center_deg = neutral_center_deg
         self.normal_speed = 0
         self.normal_torque = 600
@@ -51,6 +66,8 @@ class MotionRunner:
         if not ok:
             raise RuntimeError("IK failed for neutral pose.")
         self.q_neutral = [q1n, q2n, q1n, q2n, q1n, q2n, q1n, q2n]
+        # Latest goals before lead compensation (what the joints should be at)
+        self.intended = [self.neutral_center_deg] * 8
 
     def _recenter_to_150(self, q_abs_8):
         out = []
@@ -58,12 +75,40 @@ class MotionRunner:
             out.append(self.neutral_center_deg + (q_abs_8[i] - self.q_neutral[i]))
         return out
 
+    def _compensated(self, cmd: list[float], ahead: list[list[float]]) -> list[float]:
+        # cmd shifted by the lead, with the goals planned for the next ticks
+        # (held at the last one where the plan runs out)
+        self.intended = cmd
+        if self.lead is None:
+            return cmd
+        plan = [cmd] + ahead[:self.lead.horizon - 1]
+        plan += [plan[-1]] * (self.lead.horizon - len(plan))
+        return list(self.lead.command(self.clock.now_ns(), plan))
+
+    def _planned(self) -> list[list[float]]:
+        # The gait's goals for the ticks after this one
+        if self.lead is None:
+            return []
+        return [self._recenter_to_150(q) for q in self.gait_manager.peek(self.lead.horizon - 1)]
+
+    def observe_lag(self) -> None:
+        """Read the next lead_reads joints' present positions into the lag estimate"""
+        for _ in range(self.lead_reads):
+            i = self._read_joint
+            self._read_joint = (i + 1) % 8
+            t0 = self.clock.now_ns()
+            try:
+                deg = self.robot.read_position_deg(i)
+            except RuntimeError:
+                continue
+            self.lead.observe(i, (t0 + self.clock.now_ns()) // 2, deg)
+
     def move_to_neutral(self, seconds: float = 1.0) -> None:
         cmd = [self.neutral_center_deg] * 8
         n = max(1, int(seconds * self.hz))
         for _ in range(n):
-            self.robot.write_positions_deg(cmd)
-            time.sleep(self.dt)
+            self.robot.write_positions_deg(self._compensated(cmd, []))
+            self.clock.sleep(self.dt)
 
     def do_jump(self, direction: str = "in_place") -> None:
         """
@@ -113,8 +158,8 @@ class MotionRunner:
             q_abs = self.gait_manager.tick()
             if q_abs is not None:
                 cmd = self._recenter_to_150(q_abs)
-                self.robot.write_positions_deg(cmd)
-            time.sleep(self.dt)
+                self.robot.write_positions_deg(self._compensated(cmd, self._planned()))
+            self.clock.sleep(self.dt)
 
         # Stop the jump and restore the original gait
         self.gait_manager.stop()
@@ -157,30 +202,110 @@ class MotionRunner:
             self.gait_manager.stop()
             self.current_dir = None
 
-    def tick(self) -> None:
+    def next_command(self) -> list[float]:
         q_abs = self.gait_manager.tick()
 
         if q_abs is None:
-            self.robot.write_positions_deg([self.neutral_center_deg] * 8)
-            return
-        cmd = self._recenter_to_150(q_abs)
+            return self._compensated([self.neutral_center_deg] * 8, [])
+        return self._compensated(self._recenter_to_150(q_abs), self._planned())
+
+    def tick(self) -> None:
+        self.robot.write_positions_deg(self.next_command())
+
+    def traced_tick(self, trace_id: int, t_gesture_ns: int) -> None:
+        """
+        tick() recorded as tick_wait (gesture set -> tick start, the wait for
+        the control clock), tick (gait + IK) and bus_write (sync write)
+        """
+        t0 = self.clock.now_ns()
+        cmd = self.next_command()
+        t1 = self.clock.now_ns()
         self.robot.write_positions_deg(cmd)
-    
-    def loop_forever(self, keyboard_interface) -> None:
-        next_t = time.perf_counter()
-        last_gesture = None
+        self.tracer.span("tick_wait", t_gesture_ns, t0, trace_id)
+        self.tracer.span("tick", t0, t1, trace_id)
+        self.tracer.span("bus_write", t1, self.clock.now_ns(), trace_id)
 
-        while True:
+    def loop_forever(self, keyboard_interface, seconds: Optional[float] = None) -> None:
+        """
+        Poll the gesture source and tick at hz on an absolute schedule (in
+        integer ns, so ticks land exactly on it in virtual time). Returns
+        after `seconds` if given.
+        """
+        next_ns = self.clock.now_ns()
+        end_ns = None if seconds is None else next_ns + int(round(seconds * 1e9))
+        last_gesture = None
+        # Sources that measure latency (EMGInterface) are told when a new
+        # gesture has gone out to the servos
+        actuated = getattr(keyboard_interface, 'actuated', None)
+        changed = False
+        trace_id = 0
+        t_gesture_ns = 0
+
+        while end_ns is None or next_ns < end_ns:
             keyboard_interface.poll()
             gesture = keyboard_interface.read_gesture()
 
             if gesture != last_gesture and gesture is not None:
                 self.set_gesture(gesture)
                 last_gesture = gesture
-
-            now = time.perf_counter()
-            if now >= next_t:
-                self.tick()
-                next_t += self.dt
+                changed = True
+                if self.tracer is not None:
+                    trace_id = getattr(keyboard_interface, 'trace_id', 0)
+                    t_gesture_ns = self.clock.now_ns()
+
+            now = self.clock.now_ns()
+            if now >= next_ns:
+                if changed and trace_id:
+                    self.traced_tick(trace_id, t_gesture_ns)
+                else:
+                    self.tick()
+                if self.lead is not None:
+                    self.observe_lag()
+                next_ns += self.dt_ns
+                if changed and actuated is not None:
+                    actuated()
+                changed = False
             else:
-                time.sleep(max(0.0, next_t - now))
+                self.clock.sleep_until_ns(next_ns)
+
+    def loop_reactor(self, reactor, gesture_source) -> None:
+        """
+        loop_forever on a q8native.Reactor that owns the Cyton and servo fds.
+        Frames go to gesture_source.feed_frames(), ticks come from the
+        reactor's clock instead of sleeping, and goal positions go out as
+        sync writes the reactor submits on its next poll. Real time only:
+        the reactor's ticks are kernel timeouts. The reactor owns the bus,
+        so a lead compensator keeps its modelled lags here.
+        """
+        reactor.set_tick(self.hz)
+        last_gesture = None
+        # Trace id of a gesture change not yet written: the seq of the
+        # frame that caused it (the reactor records the sync_write span)
+        trace_id = 0
+        t_gesture_ns = 0
+
+        while True:
+            frames, ticks = reactor.poll(timeout=self.dt)
+
+            if len(frames):
+                gesture_source.feed_frames(frames)
+                gesture = gesture_source.read_gesture()
+                if gesture != last_gesture and gesture is not None:
+                    self.set_gesture(gesture)
+                    last_gesture = gesture
+                    if self.tracer is not None:
+                        trace_id = int(frames['seq'][-1])
+                        t_gesture_ns = time.monotonic_ns()
+                        self.tracer.span("imu_decision", int(frames['t_ns'][-1]), t_gesture_ns, trace_id)
+
+            if ticks:
+                # Catch up on ticks the loop missed, send only the latest pose
+                t0 = time.monotonic_ns()
+                for _ in range(ticks):
+                    cmd = self.next_command()
+                ids, goal = self.robot.goal_position_ticks(cmd)
+                reactor.sync_write(ADDR_GOAL_POSITION, ids, goal, trace_id=trace_id)
+                if trace_id:
+                    self.tracer.span("tick_wait", t_gesture_ns, t0, trace_id)
+                    self.tracer.span("tick", t0, None, trace_id)
+                    trace_id = 0
@@ -1,13 +1,20 @@
 from __future__ import annotations
 from typing import List, Optional
-from dynamixel_sdk import PortHandler, PacketHandler, GroupSyncWrite
+try:
+    from dynamixel_sdk import PortHandler, PacketHandler, GroupSyncWrite
+except ImportError:
+    # Only SimRobot (sim_robot.py) works without the SDK
+    PortHandler = None
 from .config_rx24f import RX24FConfig
 
 # Protocol 1.0 control table addresses (common for AX/RX series)
 ADDR_TORQUE_ENABLE = 24
+ADDR_CW_COMPLIANCE_MARGIN = 26   # CCW margin 27, CW slope 28, CCW slope 29
 ADDR_GOAL_POSITION = 30
 ADDR_MOVING_SPEED  = 32
 ADDR_TORQUE_LIMIT  = 34
+ADDR_PRESENT_POSITION = 36
+ADDR_PUNCH = 48
 
 TORQUE_ENABLE = 1
 TORQUE_DISABLE = 0
@@ -16,6 +23,19 @@ def clamp(v: int, lo: int, hi: int) -> int:
     return max(lo, min(hi, v))
 
 
+def load_compliance_profile(path: str) -> dict[int, tuple[int, int, int]]:
+    # motor id -> (margin, slope, punch) from dynamixel_tools/compliance_sweep's
+    # "id margin slope punch" lines
+    profile = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split('#', 1)[0].split()
+            if len(fields) == 4:
+                motor_id, margin, slope, punch = (int(v) for v in fields)
+                profile[motor_id] = (margin, slope, punch)
+    return profile
+
+
 ADDR_MOVING_SPEED  = 32
 ADDR_TORQUE_LIMIT  = 34
 ADDR_MAX_TORQUE   = 14 
@@ -25,6 +45,8 @@ class Robot:
         if cfg.motors is None or len(cfg.motors) != 8:
             raise ValueError("cfg.motors must have 8 MotorSpec entries.")
 
+        if PortHandler is None:
+            raise ImportError("Robot needs the dynamixel_sdk Python package (DynamixelSDK)")
         self.cfg = cfg
         self.port = PortHandler(cfg.port)
         self.packet = PacketHandler(cfg.protocol_version)
@@ -71,30 +93,54 @@ class Robot:
         ticks = clamp(ticks, 0, self.cfg.ticks_per_300deg)
         return ticks
 
+    def ticks_to_deg(self, ticks: float, motor_index: int) -> float:
+        # Inverse of deg_to_ticks (without the rounding and clamping)
+        spec = self.cfg.motors[motor_index]
+        ticks = ticks - spec.offset_ticks
+        if spec.reverse:
+            ticks = self.cfg.ticks_per_300deg - ticks
+        return ticks / self.cfg.ticks_per_300deg * self.cfg.max_deg
+
+    def goal_position_ticks(self, pos_deg_8: List[float]) -> tuple[list[int], list[int]]:
+        # Servo IDs and goal position ticks for a sync write (same order as
+        # write_positions_deg), for callers that send the packet themselves.
+        if len(pos_deg_8) != 8:
+            raise ValueError("pos_deg_8 must have length 8.")
+        ids = [spec.motor_id for spec in self.cfg.motors]
+        ticks = [self.deg_to_ticks(deg, i) for i, deg in enumerate(pos_deg_8)]
+        return ids, ticks
+
     def write_positions_deg(self, pos_deg_8: List[float]) -> None:
         # Write target positions to all 8 motors.
         # input is in this order: [FL_q1, FL_q2, FR_q1, FR_q2, BL_q1, BL_q2, BR_q1, BR_q2]
-        if len(pos_deg_8) != 8:
-            raise ValueError("pos_deg_8 must have length 8.")
+        ids, ticks_8 = self.goal_position_ticks(pos_deg_8)
 
         self.sync_write_pos.clearParam()
 
-        for i, deg in enumerate(pos_deg_8):
-            spec = self.cfg.motors[i]
-            ticks = self.deg_to_ticks(deg, i)
+        for motor_id, ticks in zip(ids, ticks_8):
             param = [ticks & 0xFF, (ticks >> 8) & 0xFF]
-            ok = self.sync_write_pos.addParam(spec.motor_id, bytes(param))
+            ok = self.sync_write_pos.addParam(motor_id, bytes(param))
             if not ok:
-                raise RuntimeError(f"Failed to add param for ID {spec.motor_id}")
+                raise RuntimeError(f"Failed to add param for ID {motor_id}")
 
         dxl_comm_result = self.sync_write_pos.txPacket()
         if dxl_comm_result != 0:
             raise RuntimeError(f"SyncWrite failed: comm={dxl_comm_result}")
+
+    def fileno(self) -> int:
+        # Serial fd of the open bus (for an external event loop)
+        return self.port.ser.fileno()
     
+    def _write1(self, motor_id: int, addr: int, value: int) -> None:
+        value = clamp(value, 0, 255)
+        dxl_comm_result, dxl_error = self.packet.write1ByteTxRx(self.port, motor_id, addr, value)
+        if dxl_comm_result != 0 or dxl_error != 0:
+            raise RuntimeError(f"Write1 failed ID {motor_id} addr {addr}: comm={dxl_comm_result}, err={dxl_error}")
+
     def _write2(self, motor_id: int, addr: int, value: int) -> None:
         value = clamp(value, 0, 1023)
         dxl_comm_result, dxl_error = self.packet.write2ByteTxRx(self.port, motor_id, addr, value)
-        if dxl_comm_result != 0:
+        if dxl_comm_result != 0 or dxl_error != 0:
             raise RuntimeError(f"Write2 failed ID {motor_id} addr {addr}: comm={dxl_comm_result}, err={dxl_error}")
 
     def set_moving_speed_all(self, speed: int) -> None:
@@ -105,6 +151,27 @@ class Robot:
         for m in self.cfg.motors:
             self._write2(m.motor_id, ADDR_TORQUE_LIMIT, limit)
 
+    def apply_compliance_profile(self, profile: dict[int, tuple[int, int, int]]) -> tuple[int, list[int]]:
+        # Compliance margin and slope (both directions) and punch per motor id;
+        # RAM registers, so after every power-up. Every write must succeed
+        # with no packet error; returns (servos set, motor ids that failed).
+        applied, failed = 0, []
+        for m in self.cfg.motors:
+            if m.motor_id not in profile:
+                continue
+            margin, slope, punch = profile[m.motor_id]
+            try:
+                self._write1(m.motor_id, ADDR_CW_COMPLIANCE_MARGIN, margin)
+                self._write1(m.motor_id, ADDR_CW_COMPLIANCE_MARGIN + 1, margin)
+                self._write1(m.motor_id, ADDR_CW_COMPLIANCE_MARGIN + 2, slope)
+                self._write1(m.motor_id, ADDR_CW_COMPLIANCE_MARGIN + 3, slope)
+                self._write2(m.motor_id, ADDR_PUNCH, punch)
+            except RuntimeError:
+                failed.append(m.motor_id)
+                continue
+            applied += 1
+        return applied, failed
+
 
     def _read2(self, motor_id: int, addr: int) -> int:
         val, dxl_comm_result, dxl_error = self.packet.read2ByteTxRx(self.port, motor_id, addr)
@@ -112,6 +179,11 @@ class Robot:
             raise RuntimeError(f"Read2 failed ID {motor_id} addr {addr}: comm={dxl_comm_result}, err={dxl_error}")
         return int(val)
 
+    def read_position_deg(self, motor_index: int) -> float:
+        # Present position of one motor, in the frame write_positions_deg takes
+        spec = self.cfg.motors[motor_index]
+        return self.ticks_to_deg(self._read2(spec.motor_id, ADDR_PRESENT_POSITION), motor_index)
+
     def get_moving_speed_all(self) -> list[int]:
         return [self._read2(m.motor_id, ADDR_MOVING_SPEED) for m in self.cfg.motors]
 
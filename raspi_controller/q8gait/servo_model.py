@@ -0,0 +1,135 @@
+from __future__ import annotations
+import math
+import os
+from collections import deque
+from dataclasses import dataclass
+from typing import Dict, Iterable
+
+# RX-24F no-load maximum (126 rpm at 12 V)
+MAX_DEG_PER_S = 126.0 * 360.0 / 60.0
+
+# Integration step of the first- and second-order models
+STEP_S = 0.001
+
+
+@dataclass
+class ServoModel:
+    """
+    Position response of one servo to its goal, as fitted by
+    dynamixel_tools/servo_sysid (the .model file it writes):
+
+        order 0:  x' = +-vmax until x reaches the goal (no dynamics)
+        order 1:  x' = clamp((u - x) / tau, +-vmax)
+        order 2:  v' = wn^2 (u - x) - 2 zeta wn v,  x' = clamp(v, +-vmax)
+
+    u is the goal delayed by dead_time_ms. The default (order 0, no dead
+    time, the RX-24F's maximum speed) is what SimRobot does without a
+    measured model.
+    """
+    order: int = 0
+    dead_time_ms: float = 0.0
+    vmax_dps: float = MAX_DEG_PER_S
+    tau_ms: float = 30.0
+    wn_hz: float = 5.0
+    zeta: float = 1.0
+
+    @property
+    def lag_ms(self) -> float:
+        """How far the servo trails a ramp in its goal (below the speed limit)"""
+        if self.order == 1:
+            return self.dead_time_ms + self.tau_ms
+        if self.order == 2:
+            return self.dead_time_ms + 1000.0 * 2.0 * self.zeta / (2.0 * math.pi * self.wn_hz)
+        return self.dead_time_ms
+
+    @classmethod
+    def load(cls, path: str) -> "ServoModel":
+        """Read a servo_sysid .model file (key value lines, # comments)"""
+        values = {}
+        with open(path) as f:
+            for line in f:
+                line = line.split('#', 1)[0].split()
+                if len(line) == 2:
+                    values[line[0]] = float(line[1])
+        return cls(order=int(values.get('order', 0)),
+                   dead_time_ms=values.get('dead_time_ms', 0.0),
+                   vmax_dps=values.get('vmax_dps', MAX_DEG_PER_S),
+                   tau_ms=values.get('tau_ms', 30.0),
+                   wn_hz=values.get('wn_hz', 5.0),
+                   zeta=values.get('zeta', 1.0))
+
+    @classmethod
+    def load_dir(cls, directory: str, ids: Iterable[int]) -> Dict[int, "ServoModel"]:
+        """servo_<id>.model for each id that has one (servo_sysid's default names)"""
+        models = {}
+        for motor_id in ids:
+            path = os.path.join(directory, f"servo_{motor_id}.model")
+            if os.path.exists(path):
+                models[motor_id] = cls.load(path)
+        return models
+
+
+class ServoState:
+    """One servo following its goals under a ServoModel (deg, seconds)"""
+
+    def __init__(self, model: ServoModel, position: float, t: float):
+        self.model = model
+        self.x = position
+        self.v = 0.0
+        self.goal = position
+        # Goals on their way to the servo: (time they take effect, goal)
+        self.pending = deque()
+        self.t = t
+
+    def command(self, t: float, goal: float) -> None:
+        self.pending.append((t + self.model.dead_time_ms / 1000.0, goal))
+
+    def advance(self, t: float, vmax: float = None, powered: bool = True) -> None:
+        """
+        Move to time t; vmax (deg/s) further limits the speed (moving speed
+        setting). Without torque the servo stays where it is.
+        """
+        if not powered:
+            self.goal = self.x
+            self.v = 0.0
+            self.pending.clear()
+            self.t = max(self.t, t)
+            return
+        m = self.model
+        limit = m.vmax_dps if vmax is None else min(m.vmax_dps, vmax)
+        while self.t < t:
+            # Up to the next goal change
+            end = t
+            if self.pending and self.pending[0][0] <= self.t:
+                self.goal = self.pending.popleft()[1]
+                continue
+            if self.pending:
+                end = min(end, self.pending[0][0])
+            self._integrate(end - self.t, limit)
+            self.t = end
+
+    def _integrate(self, dt: float, limit: float) -> None:
+        m = self.model
+        if m.order == 0:
+            step = limit * dt
+            self.x += max(-step, min(step, self.goal - self.x))
+            return
+        if m.order == 1:
+            # Exact while not rate limited
+            tau = m.tau_ms / 1000.0
+            while dt > 0:
+                h = min(STEP_S, dt)
+                e = self.goal - self.x
+                if abs(e) / tau > limit:
+                    self.x += math.copysign(limit * h, e)
+                else:
+                    self.x = self.goal - e * math.exp(-h / tau)
+                dt -= h
+            return
+        wn = 2.0 * math.pi * m.wn_hz
+        while dt > 0:
+            h = min(STEP_S, dt)
+            self.v += h * (wn * wn * (self.goal - self.x) - 2.0 * m.zeta * wn * self.v)
+            self.v = max(-limit, min(limit, self.v))
+            self.x += h * self.v
+            dt -= h
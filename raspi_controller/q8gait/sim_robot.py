@@ -0,0 +1,149 @@
+from __future__ import annotations
+from typing import Dict, List, Optional
+
+from .clock import SYSTEM_CLOCK
+from .config_rx24f import RX24FConfig
+from .robot import Robot, ADDR_PRESENT_POSITION
+from .servo_model import MAX_DEG_PER_S, ServoModel, ServoState
+
+# RX-24F: moving speed unit 0.111 rpm; 0 means the no-load maximum
+DEG_PER_S_PER_UNIT = 0.111 * 360.0 / 60.0
+
+# Protocol 1.0 packet sizes on the wire (header, id, length, instruction, checksum)
+SYNC_WRITE_BYTES = 8        # + (1 + data length) per servo
+WRITE1_BYTES = 8
+WRITE2_BYTES = 9
+READ2_BYTES = 8
+STATUS_BYTES = 6            # + parameters
+
+
+class SimRobot(Robot):
+    """
+    Robot on an emulated Dynamixel bus, for simulate.py and runs without
+    servos. Same interface as Robot.
+
+    Each transfer takes its time on the wire at cfg.baudrate (10 bits per
+    byte, on the clock: a sync write of 8 positions at 1 Mbaud is 0.32 ms),
+    status replies included. Goal positions are recorded with the time they
+    were written, and each servo's present position follows its goal under
+    its ServoModel (models, by motor id: servo_sysid fits), limited by the
+    moving speed. Servos without a model move at the moving speed with no
+    lag or dead time.
+    """
+
+    def __init__(self, cfg: RX24FConfig, clock=None,
+                 models: Optional[Dict[int, ServoModel]] = None):
+        if cfg.motors is None or len(cfg.motors) != 8:
+            raise ValueError("cfg.motors must have 8 MotorSpec entries.")
+
+        self.cfg = cfg
+        self.clock = clock if clock is not None else SYSTEM_CLOCK
+        self._is_open = False
+        self._torque_on = False
+
+        models = models or {}
+        center = cfg.ticks_per_300deg / 2.0
+        self.goal = [center] * 8
+        self.moving_speed = [0] * 8
+        self.torque_limit = [1023] * 8
+        self._deg_per_tick = cfg.max_deg / cfg.ticks_per_300deg
+        t = self.clock.now_ns() / 1e9
+        self.servos = [ServoState(models.get(spec.motor_id, ServoModel()), center * self._deg_per_tick, t)
+                       for spec in cfg.motors]
+
+        # (t_ns, goal ticks) of every goal position write
+        self.writes: list[tuple[int, list[int]]] = []
+        self.bus_bytes = 0
+        self.bus_ns = 0
+        # Largest |goal - present| seen by a goal write, in degrees
+        self.max_lag_deg = 0.0
+
+    def open(self) -> None:
+        self._is_open = True
+
+    def close(self) -> None:
+        self._torque_on = False
+        self._is_open = False
+
+    def fileno(self) -> int:
+        raise RuntimeError("SimRobot has no bus fd (loop_reactor needs a real Robot)")
+
+    def _transfer(self, n_bytes: int) -> None:
+        ns = int(n_bytes * 10 * 1e9 / self.cfg.baudrate)
+        self.bus_bytes += n_bytes
+        self.bus_ns += ns
+        self.clock.sleep_until_ns(self.clock.now_ns() + ns)
+
+    def _follow(self) -> float:
+        # Move the servos along to now; returns now in seconds
+        t = self.clock.now_ns() / 1e9
+        for servo, speed in zip(self.servos, self.moving_speed):
+            vmax = speed * DEG_PER_S_PER_UNIT if speed else MAX_DEG_PER_S
+            servo.advance(t, vmax, self._torque_on)
+        return t
+
+    def _command(self) -> None:
+        # Goal registers take effect (after the dead time) while torque is on
+        now = self._follow()
+        if self._torque_on:
+            for servo, g in zip(self.servos, self.goal):
+                servo.command(now, g * self._deg_per_tick)
+
+    def torque(self, on: bool) -> None:
+        self._follow()
+        for _ in self.cfg.motors:
+            self._transfer(WRITE1_BYTES + STATUS_BYTES)
+        self._follow()
+        self._torque_on = on
+        self._command()
+
+    def write_positions_deg(self, pos_deg_8: List[float]) -> None:
+        ids, ticks_8 = self.goal_position_ticks(pos_deg_8)
+        self._follow()
+        lag = max(abs(g * self._deg_per_tick - s.x) for g, s in zip(self.goal, self.servos))
+        self.max_lag_deg = max(self.max_lag_deg, lag)
+
+        self._transfer(SYNC_WRITE_BYTES + 3 * len(ids))
+        self.goal = [float(t) for t in ticks_8]
+        self._command()
+        self.writes.append((self.clock.now_ns(), list(ticks_8)))
+
+    def present_positions_deg(self) -> list[float]:
+        """Where the servos are now (servo frame, 0..300 deg)"""
+        self._follow()
+        return [s.x for s in self.servos]
+
+    def _write1(self, motor_id: int, addr: int, value: int) -> None:
+        self._transfer(WRITE1_BYTES + STATUS_BYTES)
+
+    def _write2(self, motor_id: int, addr: int, value: int) -> None:
+        self._transfer(WRITE2_BYTES + STATUS_BYTES)
+
+    def set_moving_speed_all(self, speed: int) -> None:
+        self._follow()
+        super().set_moving_speed_all(speed)
+        self.moving_speed = [max(0, min(1023, speed))] * 8
+
+    def set_torque_limit_all(self, limit: int) -> None:
+        super().set_torque_limit_all(limit)
+        self.torque_limit = [max(0, min(1023, limit))] * 8
+
+    def _read2(self, motor_id: int, addr: int) -> int:
+        self._transfer(READ2_BYTES + STATUS_BYTES + 2)
+        if addr != ADDR_PRESENT_POSITION:
+            return 0
+        self._follow()
+        i = [spec.motor_id for spec in self.cfg.motors].index(motor_id)
+        return int(round(self.servos[i].x / self._deg_per_tick))
+
+    def get_moving_speed_all(self) -> list[int]:
+        super().get_moving_speed_all()
+        return list(self.moving_speed)
+
+    def get_torque_limit_all(self) -> list[int]:
+        super().get_torque_limit_all()
+        return list(self.torque_limit)
+
+    def get_max_torque_all(self) -> list[int]:
+        super().get_max_torque_all()
+        return [1023] * 8
@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""
+Control stack simulation in virtual time
+
+Runs main.py's robot side without hardware: scripted wristband decisions go
+through the real gesture link (a Unix socket) into EMGInterface (voting,
+hold, cooldown), MotionRunner ticks the gait and writes to SimRobot, an
+emulated servo bus. Everything reads and sleeps on one q8native.Clock, so
+in virtual time a 10-minute scenario takes seconds and every timestamp is
+the one an ideal real-time run would see: two runs write identical
+--out files.
+
+Usage:
+    python3 simulate.py [--seconds 600] [--cycle 5] [--flicker 0.05]
+                        [--hz 50] [--hop-ms 20] [--seed 0]
+                        [--realtime] [--out writes.csv]
+                        [--servo-models DIR] [--lead] [--lead-kv 0]
+
+The script cycles through the gestures every --cycle seconds; --flicker is
+the fraction of decisions the "classifier" gets wrong (a random other
+gesture at low confidence). --realtime runs the same scenario on the wall
+clock, for comparison. --servo-models takes the servo_<id>.model files
+written by dynamixel_tools/servo_sysid, so the servos lag and overshoot as
+the measured ones do; without it they track their goals at full speed.
+
+--lead sends the goals through q8native.LeadCompensator (lag modelled from
+the servo models, then estimated from two present-position reads a tick).
+Every run reports how far each joint trails its intended trajectory, as a
+time and as phase of the gait cycle, and the phase error between the legs
+of each diagonal pair (FL/BR, FR/BL move together in a trot) and between
+the two pairs (half a cycle apart): run with and without --lead to compare.
+"""
+
+import argparse
+import csv
+import os
+import random
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'native'))
+try:
+    from q8native import Clock, GesturePublisher, LeadCompensator
+except ImportError:
+    Clock = None
+
+from q8gait.kinematics_solver import k_solver
+from q8gait.config_rx24f import default_config
+from q8gait.clock import SYSTEM_CLOCK
+from q8gait.motion_runner import MotionRunner
+from q8gait.servo_model import ServoModel
+from q8gait.sim_robot import SimRobot
+from emg_interface import EMGInterface, EMGConfig, GESTURES
+
+CENTER_DIST = 30
+L1 = 33
+L2 = 44
+
+# Joint order of MotionRunner's goals, and the legs that trot together
+JOINTS = ["FL_q1", "FL_q2", "FR_q1", "FR_q2", "BL_q1", "BL_q2", "BR_q1", "BR_q2"]
+DIAGONALS = [("FL", "BR"), ("FR", "BL")]
+
+SCRIPT = ["forward", "turn_left", "forward", "turn_right", "backward", "stop", "jump", "stop"]
+
+
+class ScriptedWristband:
+    """
+    Gesture source for MotionRunner.loop_forever: a decision every hop_ms
+    from the script, published on the gesture link as classify_realtime.py
+    does, and received by an EMGInterface on the other end.
+    """
+
+    def __init__(self, clock, cycle_s, hop_ms, flicker, seed, link):
+        self.clock = clock
+        self.cycle_ns = int(round(cycle_s * 1e9))
+        self.hop_ns = int(round(hop_ms * 1e6))
+        self.flicker = flicker
+        self.rng = random.Random(seed)
+        self.others = sorted(GESTURES)
+
+        # Subscriber first, so the first decision has somewhere to go
+        self.emg = EMGInterface(cfg=EMGConfig(link=link, vote_window=3), clock=clock)
+        self.pub = GesturePublisher(link)
+        self.t0_ns = clock.now_ns()
+        self.next_ns = self.t0_ns
+        self.seq = 0
+        self.published = 0
+        self.flickered = 0
+
+    def scripted(self, t_ns):
+        return SCRIPT[(t_ns - self.t0_ns) // self.cycle_ns % len(SCRIPT)]
+
+    def poll(self):
+        # Decisions due by now, stamped with their capture time
+        now = self.clock.now_ns()
+        while self.next_ns <= now:
+            self.seq += 1
+            gesture, confidence = self.scripted(self.next_ns), 0.9
+            if self.rng.random() < self.flicker:
+                gesture, confidence = self.rng.choice(self.others), 0.4
+                self.flickered += 1
+            self.pub.publish(gesture, confidence, t_capture_ns=self.next_ns, trace_id=self.seq)
+            self.published += 1
+            self.next_ns += self.hop_ns
+        self.emg.poll()
+        # The wristband answers clock-sync pings between decisions, long
+        # before the robot's next poll
+        if self.pub.service():
+            self.emg.sensor.poll(0)
+
+    def read_gesture(self):
+        return self.emg.read_gesture()
+
+    def actuated(self, t_ns=None):
+        self.emg.actuated(t_ns)
+
+    @property
+    def trace_id(self):
+        return self.emg.trace_id
+
+    def close(self):
+        self.emg.close()
+        self.pub.close()
+
+
+class ProbedRobot(SimRobot):
+    """SimRobot that logs, at every goal write, the runner's intended goals and where the joints are"""
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.runner = None
+        # (t_ns, intended deg x8, present deg x8), in the goals' frame
+        self.track = []
+
+    def write_positions_deg(self, pos_deg_8):
+        if self.runner is not None:
+            present = [self.ticks_to_deg(deg / self._deg_per_tick, i)
+                       for i, deg in enumerate(self.present_positions_deg())]
+            self.track.append((self.clock.now_ns(), list(self.runner.intended), present))
+        super().write_positions_deg(pos_deg_8)
+
+
+def joint_lags(track, max_lag_s=0.25, step_s=0.001):
+    """
+    Per joint, the delay d that best lines the present positions up with the
+    intended goals d earlier (least squares, goals moving), and the RMS
+    error left at it and at d = 0
+    """
+    t = np.array([row[0] for row in track]) / 1e9
+    goal = np.array([row[1] for row in track])
+    present = np.array([row[2] for row in track])
+    moving = np.abs(np.gradient(goal, t, axis=0)) > 20.0
+    delays = np.arange(0.0, max_lag_s, step_s)
+    out = []
+    for j in range(goal.shape[1]):
+        m = moving[:, j] & (t - t[0] > max_lag_s)
+        if not m.any():
+            out.append((0.0, 0.0, 0.0))
+            continue
+        cost = [np.mean((present[m, j] - np.interp(t[m] - d, t, goal[:, j])) ** 2) for d in delays]
+        k = int(np.argmin(cost))
+        out.append((delays[k], np.sqrt(cost[k]), np.sqrt(cost[0])))
+    return out
+
+
+def phase_report(track, period_s):
+    lags = joint_lags(track)
+    print(f"  Tracking (gait cycle {1000 * period_s:.0f} ms): lag behind the intended goals, phase, RMS error")
+    for name, (lag, _, rms) in zip(JOINTS, lags):
+        print(f"    {name}: {1000 * lag:5.1f} ms  {360 * lag / period_s:5.1f} deg  {rms:5.2f} deg")
+
+    # Diagonal legs should move as one: compare joint with joint
+    phase = {name: 360.0 * lag / period_s for name, (lag, _, _) in zip(JOINTS, lags)}
+    errors = []
+    for a, b in DIAGONALS:
+        errors.append(max(abs(phase[f"{a}_{q}"] - phase[f"{b}_{q}"]) for q in ("q1", "q2")))
+    pair = [np.mean([phase[f"{leg}_{q}"] for leg in legs for q in ("q1", "q2")]) for legs in DIAGONALS]
+    print(f"  Diagonal phase error: FL/BR {errors[0]:.1f} deg, FR/BL {errors[1]:.1f} deg, "
+          f"between the pairs {abs(pair[0] - pair[1]):.1f} deg; mean lag {np.mean(pair):.1f} deg")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the robot control stack on a simulated clock and servo bus")
+    parser.add_argument('--seconds', type=float, default=600.0, help="scenario length (simulated)")
+    parser.add_argument('--cycle', type=float, default=5.0, help="seconds per scripted gesture")
+    parser.add_argument('--flicker', type=float, default=0.05, help="fraction of wrong decisions")
+    parser.add_argument('--hz', type=int, default=50, help="control tick rate")
+    parser.add_argument('--hop-ms', type=float, default=20.0, help="wristband decision period")
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--realtime', action='store_true', help="run on the wall clock instead")
+    parser.add_argument('--out', help="write every goal position write (t_ms, 8 ticks) as CSV")
+    parser.add_argument('--servo-models', metavar='DIR', help="servo_sysid .model files for the servos")
+    parser.add_argument('--lead', action='store_true', help="compensate each joint's lag (q8native.LeadCompensator)")
+    parser.add_argument('--lead-kv', type=float, default=0.0, help="velocity lead gain, s")
+    args = parser.parse_args()
+
+    if Clock is None:
+        print("The simulation needs libq8native.so. Build it with: make -C native")
+        sys.exit(1)
+
+    cfg = default_config()
+    models = {}
+    if args.servo_models:
+        models = ServoModel.load_dir(args.servo_models, [spec.motor_id for spec in cfg.motors])
+        print(f"Servo models for ids {sorted(models)}")
+
+    clock = SYSTEM_CLOCK if args.realtime else Clock(virtual=True)
+    robot = ProbedRobot(cfg, clock=clock, models=models)
+    leg = k_solver(CENTER_DIST, L1, L2, L1, L2)
+
+    lead = None
+    if args.lead:
+        lead = LeadCompensator(dt=1.0 / args.hz, kv_s=args.lead_kv)
+        for i, spec in enumerate(cfg.motors):
+            if spec.motor_id in models:
+                lead.set_lag(i, models[spec.motor_id].lag_ms)
+
+    robot.open()
+    robot.torque(True)
+    runner = MotionRunner(robot, leg, gait_name="TROT_LOW", hz=args.hz, clock=clock, lead=lead)
+    robot.runner = runner
+
+    wall0 = time.perf_counter()
+    t0_ns = clock.now_ns()
+    runner.move_to_neutral(seconds=1.0)
+    # The wristband starts deciding when the loop starts reading
+    source = ScriptedWristband(clock, args.cycle, args.hop_ms, args.flicker, args.seed,
+                               link=f"unix:@q8sim-{os.getpid()}")
+    try:
+        runner.loop_forever(source, seconds=args.seconds)
+    finally:
+        wall = time.perf_counter() - wall0
+        simulated = (clock.now_ns() - t0_ns) / 1e9
+        robot.close()
+
+    mode = "real time" if args.realtime else "virtual time"
+    print(f"\nSimulated {simulated:.1f} s in {wall:.2f} s of wall time ({mode}, "
+          f"{simulated / wall:.0f}x)")
+    print(f"  Wristband: {source.published} decisions, {source.flickered} wrong")
+    print(f"  Link and rules: {source.emg.latency_summary()}")
+    times = [t for t, _ in robot.writes]
+    if len(times) > 1:
+        gaps = [(b - a) / 1e6 for a, b in zip(times, times[1:])]
+        print(f"  Bus: {len(times)} goal writes, interval {min(gaps):.3f}-{max(gaps):.3f} ms, "
+              f"{robot.bus_bytes} bytes, {100.0 * robot.bus_ns / 1e9 / simulated:.1f}% busy")
+    print(f"  Servos: max lag behind goal {robot.max_lag_deg:.1f} deg")
+    trot = runner.gait_manager.current_trajectories[runner.gait_name]['f']
+    phase_report(robot.track, len(trot) * runner.dt)
+    if lead is not None:
+        stats = lead.stats()
+        print(f"  Lead: lags {' '.join(f'{lag:.1f}' for lag in stats['lag_ms'])} ms, "
+              f"{sum(stats['observations'])} reads used, {stats['skipped']} skipped")
+    if not args.realtime:
+        print(f"  Clock: {clock.stats()}")
+
+    if args.out:
+        with open(args.out, 'w', newline='') as f:
+            out = csv.writer(f)
+            out.writerow(['t_ms'] + [f'id{spec.motor_id}' for spec in robot.cfg.motors])
+            for t, ticks in robot.writes:
+                out.writerow([f"{(t - t0_ns) / 1e6:.6f}"] + ticks)
+        print(f"\nWrites: {args.out}")
+
+    source.close()
+    if not args.realtime:
+        clock.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -14,10 +14,18 @@ import torch.nn.functional as F
 import matplotlib.pyplot as plt
 import numpy as np
 
-from scipy.signal import butter, lfilter
+from scipy.signal import butter, sosfilt
 from collections import deque
 
 import glob
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'native'))
+try:
+    from q8native import Envelope
+except ImportError:
+    Envelope = None
 
 # -----------------------------
 # Band-pass filter (stateful)
@@ -25,12 +33,13 @@ import glob
 class BandpassEMG:
     def __init__(self, fs, low=20, high=450, level=4):
         nyq = fs / 2.0
-        self.b, self.a = butter(level, [low / nyq, high / nyq], btype='band')
-        # max(len(self.a, len(self.b) -1)) should be replaced by level - 1 (I think)
-        self.zi = np.zeros(max(len(self.a), len(self.b)) - 1)
+        # Second-order sections: the (b, a) form of an 8th-order band-pass is
+        # numerically fragile. Multichannel streams: native/q8native.FilterBank
+        self.sos = butter(level, [low / nyq, high / nyq], btype='band', output='sos')
+        self.zi = np.zeros((self.sos.shape[0], 2))
 
     def process(self, x):
-        y, self.zi = lfilter(self.b, self.a, x, zi=self.zi)
+        y, self.zi = sosfilt(self.sos, x, zi=self.zi)
         return y
 
 
@@ -38,12 +47,22 @@ class BandpassEMG:
 # RMS envelope (stateful)
 # -----------------------------
 class RMSOnline:
+    # Native moving RMS (compensated running sum, whole chunk per call);
+    # the Python loop below without libq8native.so
     def __init__(self, fs, window_ms=50):
-        self.N = int(fs * window_ms / 1000)
-        self.buf = deque(maxlen=self.N)
-        self.running_sum_of_squares = 0.0
+        self.env = None
+        if Envelope is not None:
+            self.env = Envelope(1, fs, window_ms, mode='rms')
+            self.N = self.env.window
+        else:
+            self.N = int(fs * window_ms / 1000)
+            self.buf = deque(maxlen=self.N)
+            self.running_sum_of_squares = 0.0
 
     def process(self, x):
+        if self.env is not None:
+            x = np.ascontiguousarray(x, dtype=np.float64)
+            return self.env.process(x.reshape(-1, 1)).reshape(x.shape)
         out = np.zeros_like(x)
         for i, s in enumerate(x):
             if len(self.buf) == self.N:
@@ -6,12 +6,17 @@ Real-time visualization of 4 EMG differential pairs from forearm
 
 import serial
 import serial.tools.list_ports
+import os
+import sys
 import time
 import struct
 from datetime import datetime
 from collections import deque
 import numpy as np
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'gesture_recognition'))
+from terminal_display import TerminalDisplay, StallCounter, display_threaded
+
 class EMGVisualizer:
     def __init__(self):
         self.ser = None
@@ -39,6 +44,10 @@ class EMGVisualizer:
         # Packet buffer for syncing
         self.packet_buffer = bytearray()
 
+        # Screen is drawn by a render thread from snapshots
+        self.display = None
+        self.stalls = StallCounter(fs=250.0)
+
     def clear_screen(self):
         """Clear terminal screen"""
         print("\033[2J\033[H", end="")
@@ -57,6 +66,10 @@ class EMGVisualizer:
 
     def find_port(self):
         """Find OpenBCI port (excluding Dynamixel port)"""
+        # Explicit port, e.g. the native/cyton_emu pseudo-terminal
+        if os.environ.get('OPENBCI_PORT'):
+            return os.environ['OPENBCI_PORT']
+
         ports = list(serial.tools.list_ports.comports())
         available = [p for p in ports if p.device not in self.EXCLUDED_PORTS]
 
@@ -175,26 +188,38 @@ class EMGVisualizer:
         bar = '█' * bar_len + '░' * (width - bar_len)
         return bar
 
-    def display_channels(self):
-        """Display EMG differential pair activity"""
-        self.clear_screen()
+    def snapshot(self):
+        """Values shown on screen (taken on the acquisition thread)"""
+        return {
+            'connected': self.connected,
+            'streaming': self.streaming,
+            'packets': self.packet_count,
+            'errors': self.error_count,
+            'stalls': self.stalls.stalls,
+            'pairs': {n: dict(stats) for n, stats in self.pair_stats.items()},
+        }
 
-        print("=" * 90)
-        print("OpenBCI EMG Visualizer - 4 Differential Pairs")
-        print("=" * 90)
-        print()
-        print(f"Status: {'Connected' if self.connected else 'Disconnected'} | "
-              f"Streaming: {'Yes' if self.streaming else 'No'} | "
-              f"Packets: {self.packet_count} | "
-              f"Errors: {self.error_count}")
-        print()
-        print("Electrode Configuration:")
-        print("  Pair 1: Top/Bottom N1P  |  Pair 2: Top/Bottom N2P")
-        print("  Pair 3: Top/Bottom N5P  |  Pair 4: Top/Bottom N6P")
-        print("  Reference: Bottom BIAS (bony area)")
-        print()
-        print("Differential Pair Activity:")
-        print("-" * 90)
+    def render_channels(self, s):
+        """Screen lines for a snapshot (runs on the render thread)"""
+        lines = [
+            "=" * 90,
+            "OpenBCI EMG Visualizer - 4 Differential Pairs",
+            "=" * 90,
+            "",
+            f"Status: {'Connected' if s['connected'] else 'Disconnected'} | "
+            f"Streaming: {'Yes' if s['streaming'] else 'No'} | "
+            f"Packets: {s['packets']} | "
+            f"Errors: {s['errors']} | "
+            f"Stalls: {s['stalls']}",
+            "",
+            "Electrode Configuration:",
+            "  Pair 1: Top/Bottom N1P  |  Pair 2: Top/Bottom N2P",
+            "  Pair 3: Top/Bottom N5P  |  Pair 4: Top/Bottom N6P",
+            "  Reference: Bottom BIAS (bony area)",
+            "",
+            "Differential Pair Activity:",
+            "-" * 90,
+        ]
 
         # Display 4 differential pairs
         pair_labels = [
@@ -205,27 +230,31 @@ class EMGVisualizer:
         ]
 
         for pair_num, label in pair_labels:
-            stats = self.pair_stats[pair_num]
+            stats = s['pairs'][pair_num]
             current = stats['current']
-            min_val = stats['min']
-            max_val = stats['max']
-            rms = stats['rms']
 
             # Create bar graph
-            bar = self.create_bar(current, min_val, max_val, width=50)
+            bar = self.create_bar(current, stats['min'], stats['max'], width=50)
 
             # Display with RMS value
-            print(f"{label:15} [{bar}] {current:10d}  RMS: {rms:8.0f}")
+            lines.append(f"{label:15} [{bar}] {current:10d}  RMS: {stats['rms']:8.0f}")
+
+        lines += [
+            "",
+            "-" * 90,
+            "",
+            "Tips:",
+            "  - Flex/extend wrist to see muscle activity",
+            "  - RMS shows signal strength (higher = more muscle activity)",
+            "  - Make sure electrodes have good contact with skin",
+            "",
+            "Press Ctrl+C to exit",
+        ]
+        return lines
 
-        print()
-        print("-" * 90)
-        print()
-        print("Tips:")
-        print("  - Flex/extend wrist to see muscle activity")
-        print("  - RMS shows signal strength (higher = more muscle activity)")
-        print("  - Make sure electrodes have good contact with skin")
-        print()
-        print("Press Ctrl+C to exit")
+    def display_channels(self):
+        """Hand the current state to the display"""
+        self.display.update(self.snapshot())
 
     def update_pair_stats(self, pair_num, value):
         """Update differential pair statistics"""
@@ -250,8 +279,10 @@ class EMGVisualizer:
 
         try:
             # Read available data
-            if self.ser.in_waiting > 0:
-                data = self.ser.read(self.ser.in_waiting)
+            waiting = self.ser.in_waiting
+            self.stalls.check(waiting // 33)
+            if waiting > 0:
+                data = self.ser.read(waiting)
                 self.packet_buffer.extend(data)
 
                 # Process complete packets from buffer
@@ -317,6 +348,9 @@ class EMGVisualizer:
         try:
             last_update = time.time()
             update_interval = 0.1  # Update display 10 times per second
+            self.display = TerminalDisplay(self.render_channels, interval=update_interval,
+                                           threaded=display_threaded())
+            self.display.start()
 
             while True:
                 # Read data continuously
@@ -330,6 +364,8 @@ class EMGVisualizer:
                 time.sleep(0.01)
 
         except KeyboardInterrupt:
+            if self.display is not None:
+                self.display.stop()
             print("\n\nShutting down...")
 
         finally:
@@ -337,6 +373,9 @@ class EMGVisualizer:
 
     def cleanup(self):
         """Clean up resources"""
+        if self.display is not None:
+            self.display.stop()
+
         if self.streaming:
             self.stop_streaming()
 
@@ -348,6 +387,9 @@ class EMGVisualizer:
         print(f"\nSession summary:")
         print(f"  Packets received: {self.packet_count}")
         print(f"  Errors: {self.error_count}")
+        print(f"  Stalls: {self.stalls.summary()}")
+        if self.display is not None:
+            print(f"  Display: {self.display.summary()}")
 
 def main():
     viz = EMGVisualizer()
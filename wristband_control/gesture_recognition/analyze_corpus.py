@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""
+Corpus Separability Analysis
+Streams every window of one or more training sessions through a feature set
+once, on all cores, and reports how separable the gestures are
+(q8native.CorpusAnalytics):
+
+    - Fisher score of every feature and of every channel
+    - per-gesture window counts and covariance (spread, conditioning)
+    - pairwise Bhattacharyya and Mahalanobis distances
+    - the most confusion-prone gesture pairs, with a bound on their
+      pairwise Bayes error, sqrt(p_i p_j) exp(-D_B)
+
+Usage:
+    python3 analyze_corpus.py [SESSION ...] [--features time_domain]
+                              [--threads N] [--top 10] [--json report.json]
+
+SESSION is a directory under training_data/, any directory or a .jsonl file
+(default: all of training_data/). Only one line is held in memory at a
+time, so the corpus can be larger than RAM. Unlike check_separability.py,
+which compares MAV means of one session, this uses the feature set the
+classifier is trained on and the full class covariances.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import CorpusAnalytics, FEATURE_SETS
+except ImportError:
+    CorpusAnalytics = None
+    FEATURE_SETS = {}
+
+from emg_features import feature_names
+
+TRAINING_DATA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "training_data")
+
+
+def corpus_files(sessions):
+    """The .jsonl files of the given sessions (all of training_data/ by default)"""
+    files = []
+    for s in sessions or [TRAINING_DATA]:
+        if not os.path.exists(s) and os.path.isdir(os.path.join(TRAINING_DATA, s)):
+            s = os.path.join(TRAINING_DATA, s)
+        if os.path.isfile(s):
+            files.append(s)
+            continue
+        if not os.path.isdir(s):
+            raise FileNotFoundError(f"Session '{s}' not found")
+        for root, _, names in os.walk(s):
+            files.extend(os.path.join(root, n) for n in sorted(names) if n.endswith('.jsonl'))
+    return sorted(files)
+
+
+def confusion_pairs(classes, counts, bhattacharyya):
+    """Gesture pairs by increasing Bhattacharyya distance, with their error bound"""
+    total = float(sum(counts))
+    pairs = []
+    for i in range(len(classes)):
+        for j in range(i + 1, len(classes)):
+            db = bhattacharyya[i, j]
+            if np.isnan(db):
+                continue
+            bound = np.sqrt(counts[i] / total * counts[j] / total) * np.exp(-db)
+            pairs.append((classes[i], classes[j], db, bound))
+    pairs.sort(key=lambda p: p[2])
+    return pairs
+
+
+def analyze(files, feature_type, threads=0, shrinkage=0.1):
+    ca = CorpusAnalytics(feature_type, threads=threads, shrinkage=shrinkage)
+    for path in files:
+        # Lines without a "gesture" take the file's name
+        ca.add(path, label=os.path.splitext(os.path.basename(path))[0])
+    ca.run()
+
+    stats = ca.stats()
+    names = feature_names(feature_type, stats['n_channels'])
+    per_class = []
+    for c, name in enumerate(ca.classes):
+        count, mean, cov = ca.class_stats(c)
+        std = np.sqrt(np.diag(cov))
+        # Of the correlation matrix of the features that vary: large =
+        # nearly collinear features, inf = fewer windows than features
+        varying = std > 0
+        condition = float('inf')
+        if np.any(varying):
+            eig = np.linalg.eigvalsh(cov[np.ix_(varying, varying)] / np.outer(std[varying], std[varying]))
+            if eig[0] > 1e-12 * eig[-1]:
+                condition = float(eig[-1] / eig[0])
+        per_class.append({
+            'gesture': name,
+            'windows': count,
+            'mean': mean.tolist(),
+            'std': std.tolist(),
+            'constant_features': int(np.sum(~varying)),
+            'condition': condition,
+        })
+
+    return {
+        'feature_type': feature_type,
+        'files': len(files),
+        'stats': stats,
+        'feature_names': names,
+        'classes': ca.classes,
+        'per_class': per_class,
+        'fisher': ca.fisher.tolist(),
+        'channel_fisher': ca.channel_fisher.tolist(),
+        'bhattacharyya': ca.bhattacharyya.tolist(),
+        'mahalanobis': ca.mahalanobis.tolist(),
+        'confusion_pairs': [
+            {'a': a, 'b': b, 'bhattacharyya': db, 'bayes_error_bound': bound}
+            for a, b, db, bound in confusion_pairs(ca.classes, [p['windows'] for p in per_class],
+                                                   ca.bhattacharyya)
+        ],
+    }
+
+
+def print_matrix(title, classes, m):
+    label = max(len(c) for c in classes) + 1
+    print(f"\n{title}")
+    print(" " * label + "".join(f"{c[:7]:>8}" for c in classes))
+    for name, row in zip(classes, m):
+        print(f"{name:<{label}}" + "".join(f"{v:8.2f}" for v in row))
+
+
+def print_report(r, top):
+    s = r['stats']
+    print("=" * 70)
+    print("CORPUS SEPARABILITY")
+    print("=" * 70)
+    print(f"\nFeatures: {r['feature_type']} ({s['n_features']} over {s['n_channels']} channels)")
+    print(f"Corpus:   {r['files']} files, {s['bytes'] / 1e6:.1f} MB, {s['windows']} windows "
+          f"({s['skipped']} skipped, {s['malformed']} malformed lines)")
+    print(f"Pass:     {s['seconds']:.2f} s on {s['n_threads']} threads "
+          f"({s['bytes'] / 1e6 / max(s['seconds'], 1e-9):.0f} MB/s)")
+
+    print("\nGestures:")
+    print(f"  {'gesture':16s} {'windows':>8s} {'constant':>9s} {'cond':>10s}")
+    for p in r['per_class']:
+        print(f"  {p['gesture']:16s} {p['windows']:8d} {p['constant_features']:9d} {p['condition']:10.3g}")
+
+    fisher = np.array(r['fisher'])
+    order = np.argsort(-np.nan_to_num(fisher, nan=-1.0))
+    print(f"\nTop {min(top, len(order))} features by Fisher score:")
+    for k in order[:top]:
+        print(f"  {r['feature_names'][k]:20s} {fisher[k]:8.3f}")
+
+    print("\nChannels (Fisher criterion over their features):")
+    for ch, j in enumerate(r['channel_fisher']):
+        print(f"  Ch{ch + 1:<3d} {j:8.3f}")
+
+    classes = r['classes']
+    print_matrix("Bhattacharyya distance:", classes, np.array(r['bhattacharyya']))
+    print_matrix("Mahalanobis distance (pooled covariance):", classes, np.array(r['mahalanobis']))
+
+    print("\nMost confusion-prone pairs:")
+    for p in r['confusion_pairs'][:top]:
+        print(f"  {p['a']:>16s} / {p['b']:<16s} D_B {p['bhattacharyya']:7.2f}  "
+              f"error <= {100 * p['bayes_error_bound']:6.2f}%")
+    print("=" * 70)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Separability of the gestures in a training corpus")
+    parser.add_argument('sessions', nargs='*', help="sessions, directories or .jsonl files (default: all)")
+    parser.add_argument('--features', default='time_domain', choices=sorted(FEATURE_SETS) or None,
+                        help="feature set (emg_features.py feature_type)")
+    parser.add_argument('--threads', type=int, default=0, help="worker threads (default: all CPUs)")
+    parser.add_argument('--shrinkage', type=float, default=0.1,
+                        help="covariance shrinkage toward a scaled identity, 0..1")
+    parser.add_argument('--top', type=int, default=10, help="features and pairs to list")
+    parser.add_argument('--json', help="also write the full report (means, matrices) as JSON")
+    args = parser.parse_args()
+
+    if CorpusAnalytics is None:
+        print("analyze_corpus.py needs libq8native.so. Build it with: make -C native")
+        sys.exit(1)
+
+    try:
+        files = corpus_files(args.sessions)
+    except FileNotFoundError as e:
+        print(f"✗ {e}")
+        sys.exit(1)
+    if not files:
+        print("✗ No training data found!")
+        sys.exit(1)
+
+    report = analyze(files, args.features, threads=args.threads, shrinkage=args.shrinkage)
+    print_report(report, args.top)
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"\nReport: {args.json}")
+
+
+if __name__ == "__main__":
+    main()
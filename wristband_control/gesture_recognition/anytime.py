@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Anytime (early-decision) gesture classification
+
+Instead of waiting for the full 200-sample window (0.8 s at 250 Hz), one
+model is trained per window length (e.g. 50/100/150/200 samples). At each
+decision the shortest window is tried first; the result is committed as
+soon as its confidence reaches the threshold, otherwise the next longer
+window is evaluated. The longest window always commits.
+
+Models are stored in model_data['anytime'] by train_model_anytime.py:
+    {
+        'prefixes':  [50, 100, 150, 200],
+        'models':    {50: {'model': ..., 'scaler': ...}, ...},
+        'threshold': 0.8,
+        'tradeoff':  [{'threshold', 'latency_ms', 'accuracy', 'commits'}, ...]
+    }
+"""
+
+import numpy as np
+
+from emg_features import extract_features
+
+
+class AnytimeClassifier:
+    def __init__(self, anytime_data, feature_type='time_domain', threshold=None, fs=250.0):
+        self.prefixes = sorted(int(p) for p in anytime_data['prefixes'])
+        self.models = {int(k): v for k, v in anytime_data['models'].items()}
+        self.threshold = threshold if threshold is not None else anytime_data.get('threshold', 0.8)
+        self.feature_type = feature_type
+        self.fs = fs
+
+        # How often each window length produced the committed decision
+        self.commits = {p: 0 for p in self.prefixes}
+
+    @property
+    def min_samples(self):
+        return self.prefixes[0]
+
+    def predict_proba_prefix(self, window_data, prefix):
+        """Class probabilities using the model for one window length"""
+        entry = self.models[prefix]
+        features = extract_features(window_data, self.feature_type)
+        if entry.get('scaler') is not None:
+            features = entry['scaler'].transform([features])[0]
+        model = entry['model']
+        return model.classes_, model.predict_proba([features])[0]
+
+    def classify(self, window_data):
+        """
+        window_data: most recent samples, oldest first, shape (n, channels).
+        Returns (prediction, confidence, prefix) or (None, 0.0, 0) if the
+        window is still shorter than the smallest prefix.
+        """
+        available = len(window_data)
+        result = (None, 0.0, 0)
+        self.last_probabilities = None
+
+        for prefix in self.prefixes:
+            if prefix > available:
+                break
+            classes, probabilities = self.predict_proba_prefix(window_data[-prefix:], prefix)
+            idx = int(np.argmax(probabilities))
+            result = (classes[idx], float(probabilities[idx]), prefix)
+            self.last_probabilities = (classes, probabilities)
+            if result[1] >= self.threshold:
+                break
+
+        if result[2]:
+            self.commits[result[2]] += 1
+        return result
+
+    def latency_ms(self, prefix):
+        return 1000.0 * prefix / self.fs
+
+    def mean_latency_ms(self):
+        total = sum(self.commits.values())
+        if not total:
+            return 0.0
+        return sum(self.latency_ms(p) * n for p, n in self.commits.items()) / total
+
+
+def tradeoff_curve(probas_by_prefix, y_true, prefixes, thresholds, fs=250.0):
+    """
+    Simulate anytime decisions over a labelled set.
+
+    probas_by_prefix: {prefix: (classes, probabilities (n_samples, n_classes))}
+    Returns one dict per threshold: mean latency, accuracy, commits per prefix.
+    """
+    prefixes = sorted(prefixes)
+    n = len(y_true)
+    curve = []
+
+    for thr in thresholds:
+        correct = 0
+        latency = 0.0
+        commits = {p: 0 for p in prefixes}
+
+        for i in range(n):
+            for prefix in prefixes:
+                classes, probas = probas_by_prefix[prefix]
+                idx = int(np.argmax(probas[i]))
+                if probas[i][idx] >= thr or prefix == prefixes[-1]:
+                    commits[prefix] += 1
+                    latency += 1000.0 * prefix / fs
+                    correct += int(classes[idx] == y_true[i])
+                    break
+
+        curve.append({
+            'threshold': thr,
+            'latency_ms': latency / n if n else 0.0,
+            'accuracy': correct / n if n else 0.0,
+            'commits': commits,
+        })
+
+    return curve
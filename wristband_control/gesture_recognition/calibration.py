@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Session calibration of an LDA model
+
+Electrode placement moves between sessions. Instead of collecting a new
+session and retraining, the realtime classifier prompts each gesture of the
+model for a few seconds and folds the windows it classifies anyway into a
+native online LDA (q8native.OnlineLDA) seeded with the trained model. When
+the last gesture is done the discriminant is refit (microseconds) and
+replaces the model.
+
+The first settle_s of every prompt is left out while the hand moves into the
+gesture. Windows rejected by the quality monitor are never classified, so
+they are not used either.
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import OnlineLDA
+except ImportError:
+    OnlineLDA = None
+
+
+def can_calibrate(model):
+    """Whether the model is an LDA (sklearn or OnlineLDA) with class means"""
+    return OnlineLDA is not None and hasattr(model, 'means_') and hasattr(model, 'classes_')
+
+
+class Calibrator:
+    def __init__(self, model, seconds=30.0, settle_s=1.0, weight=20.0):
+        # Each class of the trained model counts as `weight` windows
+        self.lda = OnlineLDA.from_model(model, weight=weight)
+        self.gestures = [str(g) for g in self.lda.classes_]
+        self.hold_s = max(seconds / len(self.gestures), settle_s + 1.0)
+        self.settle_s = settle_s
+        self.t_start = None
+        self.windows = {g: 0 for g in self.gestures}
+        self.finished = False
+
+    @property
+    def duration(self):
+        return self.hold_s * len(self.gestures)
+
+    def prompt(self, now):
+        """(gesture, seconds left in its prompt, collecting) or None when done"""
+        if self.t_start is None:
+            self.t_start = now
+        t = now - self.t_start
+        i = int(t // self.hold_s)
+        if i >= len(self.gestures):
+            return None
+        into = t - i * self.hold_s
+        return self.gestures[i], self.hold_s - into, into >= self.settle_s
+
+    def add(self, features, now):
+        """A scaled feature vector of the window just classified"""
+        p = self.prompt(now)
+        if p is None or not p[2]:
+            return
+        self.lda.partial_fit([features], [p[0]])
+        self.windows[p[0]] += 1
+
+    def done(self, now):
+        return self.prompt(now) is None
+
+    def finish(self):
+        """Refit on everything collected; the new model, or None if it could not be fit"""
+        self.finished = True
+        return self.lda if self.lda.refit() else None
+
+    def summary(self):
+        s = self.lda.stats()
+        return (f"{s['windows']} windows ({min(self.windows.values())}-{max(self.windows.values())} per gesture), "
+                f"refit {s['refit_us']:.0f} µs")
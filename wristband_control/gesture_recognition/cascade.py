@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Cascade gesture classification
+
+A fast linear gate (the LDA model from train_model_lda.py) classifies every
+window. Only when its top-class margin (best minus second-best probability)
+falls below `margin` is the expensive expert run (Random Forest, SVM or the
+CNN from train_model_cnn.py), and its answer is used instead.
+
+Both stages must be trained on the same gestures and the same filter
+settings, since the realtime classifier filters the stream once.
+
+Every `audit_every`-th decision the gate settles on its own also runs the
+expert, so the agreement with always running the big model can be
+reported without labels. The audits run in the decision loop, so their time
+counts in the cost per decision (and is also reported on its own).
+"""
+
+import time
+
+import joblib
+import numpy as np
+
+from emg_features import extract_features
+
+
+class ModelStage:
+    """A trained model that maps one window to class probabilities"""
+
+    def __init__(self, model_path):
+        self.path = model_path
+        self.keras_model = None
+
+        if model_path.endswith('.h5'):
+            # CNN: Keras model with its metadata next to it (train_model_cnn.py)
+            from tensorflow import keras
+            self.keras_model = keras.models.load_model(model_path)
+            self.model_data = joblib.load(model_path.replace('.h5', '_metadata.pkl'))
+            self.classes = np.array(self.model_data['label_encoder'].classes_)
+        else:
+            self.model_data = joblib.load(model_path)
+            self.classes = np.array(self.model_data['model'].classes_)
+
+        self.method = self.model_data.get('method', 'Unknown')
+        self.feature_type = self.model_data.get('feature_type', 'default')
+        self.filter_config = self.model_data.get('filter')
+
+    def predict_proba(self, window_data, aux=None):
+        """Class probabilities for one (already filtered) window; aux for 'fused' models"""
+        if self.keras_model is not None:
+            x = np.array(window_data, dtype=np.float64)
+            std = np.std(x, axis=0)
+            std[std == 0] = 1.0
+            x = (x - np.mean(x, axis=0)) / std
+            return self.keras_model.predict(x[np.newaxis], verbose=0)[0]
+
+        features = extract_features(window_data, self.feature_type, aux=aux)
+        scaler = self.model_data.get('scaler')
+        if scaler is not None:
+            features = scaler.transform([features])[0]
+        return self.model_data['model'].predict_proba([features])[0]
+
+
+def top_margin(probabilities):
+    """Best minus second-best class probability"""
+    if len(probabilities) < 2:
+        return 1.0
+    top2 = np.partition(probabilities, -2)[-2:]
+    return float(top2[1] - top2[0])
+
+
+class CascadeClassifier:
+    def __init__(self, gate, expert, margin=0.2, audit_every=20):
+        if sorted(gate.classes) != sorted(expert.classes):
+            raise ValueError(f"Gate and expert gestures differ: {list(gate.classes)} vs {list(expert.classes)}")
+        if (gate.filter_config or None) != (expert.filter_config or None):
+            raise ValueError("Gate and expert were trained with different filter settings")
+
+        self.gate = gate
+        self.expert = expert
+        self.margin = margin
+        self.audit_every = audit_every
+
+        # Counters
+        self.decisions = 0
+        self.escalations = 0
+        self.audits = 0
+        self.audit_agree = 0
+        self.total_cost = 0.0     # seconds, gate + expert when escalated + audits
+        self.gate_time = 0.0
+        self.expert_time = 0.0
+        self.audit_time = 0.0
+
+    def classify(self, window_data, aux=None):
+        """Returns (prediction, confidence, escalated)"""
+        t0 = time.perf_counter()
+        probabilities = self.gate.predict_proba(window_data, aux)
+        t1 = time.perf_counter()
+        self.gate_time += t1 - t0
+
+        idx = int(np.argmax(probabilities))
+        prediction, confidence = self.gate.classes[idx], float(probabilities[idx])
+        # (classes, probabilities) of the stage whose answer is used
+        self.last_probabilities = (self.gate.classes, probabilities)
+        escalated = top_margin(probabilities) < self.margin
+        self.decisions += 1
+
+        if escalated:
+            self.escalations += 1
+            expert_p = self.expert.predict_proba(window_data, aux)
+            t2 = time.perf_counter()
+            self.expert_time += t2 - t1
+            self.total_cost += t2 - t0
+
+            idx = int(np.argmax(expert_p))
+            self.last_probabilities = (self.expert.classes, expert_p)
+            return self.expert.classes[idx], float(expert_p[idx]), True
+
+        # Audit: how often the gate alone agrees with the expert
+        kept = self.decisions - self.escalations
+        if self.audit_every and kept % self.audit_every == 0:
+            expert_p = self.expert.predict_proba(window_data, aux)
+            self.audits += 1
+            self.audit_agree += int(self.expert.classes[int(np.argmax(expert_p))] == prediction)
+            self.audit_time += time.perf_counter() - t1
+
+        self.total_cost += time.perf_counter() - t0
+
+        return prediction, confidence, False
+
+    @property
+    def escalation_rate(self):
+        return self.escalations / self.decisions if self.decisions else 0.0
+
+    def mean_cost_ms(self):
+        """What a decision costs on average, audits included"""
+        return 1000.0 * self.total_cost / self.decisions if self.decisions else 0.0
+
+    def audit_cost_ms(self):
+        """Share of mean_cost_ms() spent on audits"""
+        return 1000.0 * self.audit_time / self.decisions if self.decisions else 0.0
+
+    def expert_cost_ms(self):
+        return 1000.0 * self.expert_time / self.escalations if self.escalations else 0.0
+
+    def agreement(self):
+        """
+        Estimated agreement with always running the expert: escalated
+        decisions agree by construction, the rest from the audits.
+        None until the first audit.
+        """
+        if not self.audits:
+            return None
+        kept_agree = self.audit_agree / self.audits
+        return self.escalation_rate + (1.0 - self.escalation_rate) * kept_agree
+
+    def summary(self):
+        agreement = self.agreement()
+        agreement = f"{100 * agreement:.1f}%" if agreement is not None else "n/a"
+        return (f"decisions={self.decisions} escalated={self.escalations} ({100 * self.escalation_rate:.1f}%) "
+                f"cost={self.mean_cost_ms():.2f} ms/decision (audits {self.audit_cost_ms():.2f}, "
+                f"expert {self.expert_cost_ms():.2f} ms) "
+                f"agreement with expert~{agreement} ({self.audits} audits)")
@@ -12,9 +12,39 @@ from collections import deque
 from datetime import datetime
 import joblib
 import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import (FilterBank, MultiScaleFeatures, DecisionStage, CytonReader, OrientationFilter,
+                          GesturePublisher, GESTURE_CODES, Tracer, CytonRecorder,
+                          QualityMonitor, QUALITY_SATURATED, QUALITY_FLAT, SpectralFeatures)
+except ImportError:
+    FilterBank = None
+    MultiScaleFeatures = None
+    DecisionStage = None
+    CytonReader = None
+    OrientationFilter = None
+    GesturePublisher = None
+    GESTURE_CODES = ()
+    Tracer = None
+    CytonRecorder = None
+    QualityMonitor = None
+    SpectralFeatures = None
+
+from decision_scheduler import DecisionScheduler, StageTimer
+from emg_features import (extract_features, extract_features_time_domain, MULTISCALE_WINDOWS,
+                          SPECTRAL_WINDOW, SPECTRAL_FS, SPECTRAL_BAND_EDGES)
+from anytime import AnytimeClassifier
+from cascade import CascadeClassifier, ModelStage
+from calibration import Calibrator, can_calibrate
+from terminal_display import TerminalDisplay, StallCounter, display_threaded
 
 class RealtimeGestureClassifier:
-    def __init__(self, model_path="models/gesture_model.pkl"):
+    def __init__(self, model_path="models/gesture_model.pkl", filter_config=None,
+                 hop_samples=5, max_rate_hz=50.0, deadline_ms=None,
+                 gate_model_path=None, cascade_margin=0.2, link_addr=None, record_dir=None,
+                 calibrate_s=0.0, link_map=None):
         self.ser = None
         self.connected = False
         self.streaming = False
@@ -29,8 +59,14 @@ class RealtimeGestureClassifier:
             raise FileNotFoundError(f"Model not found: {model_path}\nRun a train_model script first!")
 
         print(f"Loading model from {model_path}...")
-        model_data = joblib.load(model_path)
-        self.model = model_data['model']
+        if model_path.endswith('.h5'):
+            # CNN (train_model_cnn.py): metadata is stored next to the Keras model
+            model_data = joblib.load(model_path.replace('.h5', '_metadata.pkl'))
+            if gate_model_path is None:
+                raise ValueError("CNN models run as the cascade expert; give an LDA gate model as well")
+        else:
+            model_data = joblib.load(model_path)
+        self.model = model_data.get('model')
         self.scaler = model_data.get('scaler', None)  # SVM/LDA use scaler
         self.gestures = model_data['gestures']
         self.feature_type = model_data.get('feature_type', 'default')
@@ -39,22 +75,166 @@ class RealtimeGestureClassifier:
         print(f"  Gestures: {self.gestures}")
         print(f"  Feature type: {self.feature_type}")
 
+        # Band-pass/notch filter ahead of feature extraction. Uses the same
+        # settings the model was trained with unless overridden.
+        self.filter_config = filter_config if filter_config is not None else model_data.get('filter')
+        self.filter_bank = None
+        if self.filter_config:
+            if FilterBank is None:
+                raise ImportError("Model expects filtered input but libq8native.so is not built.\n"
+                                  "Build it with: make -C native")
+            self.filter_bank = FilterBank(n_channels=4, config=self.filter_config)
+            print(f"  Filter: {self.filter_bank.config['low']}-{self.filter_bank.config['high']} Hz, "
+                  f"notch {self.filter_bank.config['notch'] or 'off'}")
+
         # Packet parsing
         self.start_byte = 0xA0
         self.end_byte = 0xC0
         self.packet_buffer = bytearray()
 
+        # Native acquisition thread (libq8native.so): frames are read and
+        # stamped with CLOCK_MONOTONIC as they arrive, not when we get to them
+        self.reader = None
+        self.consumer = None
+        self.frames_left = 0        # frames of the current batch not yet processed
+        self.frame_t_ns = None      # arrival time of the frame being processed
+        self.frame_seq = 0          # seq of that frame (counted here when polling)
+
+        # Raw stream log for replay.py (Q8_RECORD=dir), opened with the port
+        self.record_dir = record_dir
+        self.recorder = None
+        self.model_path = model_path
+
         # Sliding window for classification
         self.WINDOW_SIZE = 200  # Same as training
         self.window_buffer = deque(maxlen=self.WINDOW_SIZE)
 
+        # Accelerometer counts decoded from the same packets, kept in step
+        # with window_buffer ('fused' features), and a running orientation
+        # filter for the status screen
+        self.aux_buffer = deque(maxlen=self.WINDOW_SIZE)
+        self.orientation = OrientationFilter() if OrientationFilter is not None else None
+
+        # Multi-scale features are kept up to date sample by sample from
+        # prefix sums instead of being recomputed from the window
+        self.multiscale = None
+        if self.feature_type == 'multiscale' and MultiScaleFeatures is not None:
+            self.multiscale = MultiScaleFeatures(n_channels=4, windows=MULTISCALE_WINDOWS)
+
+        # Spectral features come from a sliding DFT updated per sample
+        # rather than an FFT of every window
+        self.spectral = None
+        if self.feature_type == 'spectral' and SpectralFeatures is not None:
+            self.spectral = SpectralFeatures(n_channels=4, window=SPECTRAL_WINDOW, fs=SPECTRAL_FS,
+                                             band_edges=SPECTRAL_BAND_EDGES)
+
+        # Electrode health of the raw samples (saturation, line noise,
+        # flatline, drift). A window that overlaps a saturated or flat
+        # channel (electrode off) is not classified
+        self.quality = QualityMonitor(n_channels=4) if QualityMonitor is not None else None
+        self.QUALITY_REJECT = (QUALITY_SATURATED | QUALITY_FLAT) if QualityMonitor is not None else 0
+        self.quality_rejected = 0
+
         # Classification output
         self.current_gesture = "unknown"
         self.gesture_confidence = 0.0
         self.classification_count = 0
+        self.on_decision = None     # called with (gesture, confidence) after each decision
 
-        # Gesture history for smoothing
+        # Smoothing: majority vote over the last 5 decisions (native decision
+        # stage, Python fallback when libq8native.so is not built)
         self.gesture_history = deque(maxlen=5)
+        self.last_probabilities = None
+        self.decision = None
+        if DecisionStage is not None:
+            classes = getattr(self.model, 'classes_', self.gestures)
+            self.decision = DecisionStage(list(classes), vote_window=5)
+
+        # When to classify (default: one decision per 50 Hz MotionRunner tick)
+        # and how long each stage takes
+        self.SAMPLE_RATE = 250.0
+        self.scheduler = DecisionScheduler(hop_samples=hop_samples, max_rate_hz=max_rate_hz,
+                                           deadline_ms=deadline_ms, fs=self.SAMPLE_RATE)
+        self.timer = StageTimer()
+        self.start_time = None
+
+        # Clock (seconds) the scheduler and the decision stage run on;
+        # replay.py substitutes the recorded arrival time of the frame, a
+        # q8native.Clock in virtual time also fits
+        self.clock = time.perf_counter
+
+        # Latency tracing (Q8_TRACE=path.json, see native/trace_summary.py):
+        # each stage of a decision is a span keyed by the seq of the frame
+        # that completed its window; window_t_ns holds the arrival times of
+        # the samples in window_buffer
+        self.trace = Tracer.from_env() if Tracer is not None else None
+        if self.trace is not None:
+            self.trace.thread_name("classifier")
+        self.trace_id = 0
+        self.window_t_ns = deque(maxlen=self.WINDOW_SIZE)
+
+        # Status screen is drawn by a render thread from snapshots; stalls
+        # count reads that found the serial input backed up
+        self.display = None
+        self.stalls = StallCounter(fs=self.SAMPLE_RATE)
+
+        # Early decisions on growing windows (train_model_anytime.py)
+        self.anytime = None
+        self.min_window = self.WINDOW_SIZE
+        self.decision_prefix = self.WINDOW_SIZE
+        if 'anytime' in model_data and gate_model_path is None:
+            self.anytime = AnytimeClassifier(model_data['anytime'], self.feature_type, fs=self.SAMPLE_RATE)
+            self.min_window = self.anytime.min_samples
+            print(f"  Anytime windows: {self.anytime.prefixes} (threshold {self.anytime.threshold:.2f})")
+
+        # Cascade: fast LDA gate on every decision, this model only when the
+        # gate's top-class margin is below cascade_margin
+        self.cascade = None
+        if gate_model_path is not None:
+            self.cascade = CascadeClassifier(ModelStage(gate_model_path), ModelStage(model_path),
+                                             margin=cascade_margin)
+            self.method = f"Cascade: {self.cascade.gate.method} -> {self.method}"
+            print(f"  Cascade gate: {self.cascade.gate.method} (escalate below margin {cascade_margin:.2f})")
+
+        # Session calibration: prompt each gesture for calibrate_s in total
+        # and swap in an online LDA refit on those windows
+        self.calibrator = None
+        self.calibrated = False
+        self.calibration_summary = None
+        self.last_features = None
+        if calibrate_s > 0:
+            if not can_calibrate(self.model) or self.anytime is not None or self.cascade is not None:
+                raise ValueError("Calibration needs a single LDA model (train_model_lda.py) and libq8native.so")
+            self.calibrator = Calibrator(self.model, seconds=calibrate_s)
+            print(f"  Calibration: {len(self.calibrator.gestures)} gestures, "
+                  f"{self.calibrator.hold_s:.1f} s each")
+
+        # Decisions go to the robot controller over the native gesture link
+        # (raspi_controller EMGInterface), labels mapped to its gesture names
+        self.link = None
+        if link_addr:
+            if GesturePublisher is None:
+                raise ImportError("The gesture link needs libq8native.so. Build it with: make -C native")
+            self.link = GesturePublisher(link_addr)
+            print(f"  Gesture link: {link_addr}")
+        # Label -> robot gesture: link_map, else the model's 'link_map', else
+        # the defaults below. Labels that already are robot gestures pass as is.
+        self.LINK_GESTURES = {
+            'left': 'turn_left',
+            'right': 'turn_right',
+            'relaxed': 'stop',
+        }
+        if link_map is None:
+            link_map = model_data.get('link_map')
+        if link_map is not None:
+            self.LINK_GESTURES = dict(link_map)
+        unknown = sorted(set(self.LINK_GESTURES.values()) - set(GESTURE_CODES[1:]))
+        if self.link is not None and unknown:
+            raise ValueError(f"Not robot gestures: {', '.join(unknown)} "
+                             f"(choose from {', '.join(GESTURE_CODES[1:])})")
+        self.unmapped_labels = set()    # labels warned about once
+        if self.link is not None:
+            print("  Link map: " + ", ".join(f"{k} -> {v}" for k, v in sorted(self.LINK_GESTURES.items())))
 
         # Quadruped command mapping
         self.COMMAND_MAP = {
@@ -84,6 +264,10 @@ class RealtimeGestureClassifier:
 
     def find_port(self):
         """Find OpenBCI port"""
+        # Explicit port, e.g. the native/cyton_emu pseudo-terminal
+        if os.environ.get('OPENBCI_PORT'):
+            return os.environ['OPENBCI_PORT']
+
         ports = list(serial.tools.list_ports.comports())
         available = [p for p in ports if p.device not in self.EXCLUDED_PORTS]
 
@@ -146,7 +330,7 @@ class RealtimeGestureClassifier:
                 self.print_status(f"Error stopping stream: {e}", "ERROR")
 
     def parse_packet(self, packet):
-        """Parse OpenBCI data packet"""
+        """Parse OpenBCI data packet into (channels, accelerometer aux)"""
         if len(packet) != 33:
             return None
 
@@ -161,10 +345,13 @@ class RealtimeGestureClassifier:
                 val -= 0x1000000
             channels.append(val)
 
+        # Accelerometer X, Y, Z: big-endian int16 in bytes 26-31
+        aux = [int.from_bytes(packet[26 + 2 * i:28 + 2 * i], 'big', signed=True) for i in range(3)]
+
         if packet[32] != self.end_byte:
             return None
 
-        return channels
+        return channels, aux
 
     def extract_pairs(self, channels):
         """Extract 4 pairs: N1P, N2P, N5P, N6P"""
@@ -180,152 +367,169 @@ class RealtimeGestureClassifier:
 
         return pairs
 
+    def window_aux(self):
+        """Accelerometer counts for the samples in window_buffer"""
+        return np.array(self.aux_buffer) if self.feature_type == 'fused' else None
+
     def extract_features(self, window_data):
         """Extract features from window (matches training method)"""
-        if self.feature_type == 'MAV':
-            return self.extract_features_mav(window_data)
-        elif self.feature_type == 'time_domain':
-            return self.extract_features_time_domain(window_data)
-        else:
-            return self.extract_features_default(window_data)
-
-    def extract_features_default(self, window_data):
-        """Default feature extraction (Random Forest)"""
-        features = []
-        num_channels = window_data.shape[1]
-
-        for ch in range(num_channels):
-            channel_data = window_data[:, ch]
-
-            # RMS
-            rms = np.sqrt(np.mean(channel_data**2))
-
-            # MAV
-            mav = np.mean(np.abs(channel_data))
-
-            # Waveform Length
-            wl = np.sum(np.abs(np.diff(channel_data)))
-
-            # Zero Crossings
-            threshold = 0.01 * np.max(np.abs(channel_data))
-            zc = np.sum(np.diff(np.sign(channel_data)) != 0)
-
-            # Variance
-            var = np.var(channel_data)
-
-            features.extend([rms, mav, wl, zc, var])
-
-        return np.array(features)
-
-    def extract_features_mav(self, window_data):
-        """MAV feature extraction (SVM)"""
-        features = []
-        num_channels = window_data.shape[1]
-
-        for ch in range(num_channels):
-            channel_data = window_data[:, ch]
-
-            # Mean Absolute Value
-            mav = np.mean(np.abs(channel_data))
-
-            # Root Mean Square
-            rms = np.sqrt(np.mean(channel_data**2))
-
-            # Variance
-            var = np.var(channel_data)
-
-            features.extend([mav, rms, var])
-
-        return np.array(features)
-
-    def extract_features_time_domain(self, window_data):
-        """Time-domain feature extraction (LDA)"""
-        features = []
-        num_channels = window_data.shape[1]
-
-        for ch in range(num_channels):
-            channel_data = window_data[:, ch]
-
-            # MAV
-            mav = np.mean(np.abs(channel_data))
-
-            # RMS
-            rms = np.sqrt(np.mean(channel_data**2))
-
-            # Waveform Length
-            wl = np.sum(np.abs(np.diff(channel_data)))
-
-            # Zero Crossings
-            threshold = 0.01 * np.max(np.abs(channel_data)) if np.max(np.abs(channel_data)) > 0 else 0.01
-            zc = np.sum(np.diff(np.sign(channel_data)) != 0)
-
-            # Slope Sign Changes
-            diff_signal = np.diff(channel_data)
-            ssc = np.sum(np.diff(np.sign(diff_signal)) != 0)
-
-            # Variance
-            var = np.var(channel_data)
-
-            # Integrated EMG
-            iemg = np.sum(np.abs(channel_data))
-
-            # Willison Amplitude
-            wa_threshold = 0.01 * np.max(np.abs(channel_data)) if np.max(np.abs(channel_data)) > 0 else 0.01
-            wa = np.sum(np.abs(np.diff(channel_data)) > wa_threshold)
-
-            features.extend([mav, rms, wl, zc, ssc, var, iemg, wa])
-
-        return np.array(features)
+        return extract_features(window_data, self.feature_type, aux=self.window_aux())
 
     def read_packet(self):
-        """Read and parse one packet"""
+        """Read and parse one packet; returns (pairs, aux) or None"""
         try:
-            if self.ser.in_waiting > 0:
-                data = self.ser.read(self.ser.in_waiting)
+            waiting = self.ser.in_waiting
+            self.stalls.check((waiting + len(self.packet_buffer)) // 33)
+            if waiting > 0:
+                data = self.ser.read(waiting)
+                if self.recorder is not None:
+                    self.recorder.write(data)
                 self.packet_buffer.extend(data)
 
-                while len(self.packet_buffer) >= 33:
-                    start_idx = self.packet_buffer.find(self.start_byte)
-
-                    if start_idx == -1:
-                        self.packet_buffer.clear()
-                        break
+            # Drain packets already buffered even when nothing new arrived,
+            # otherwise a backlog builds up and every decision runs late
+            while len(self.packet_buffer) >= 33:
+                start_idx = self.packet_buffer.find(self.start_byte)
 
-                    if start_idx > 0:
-                        self.packet_buffer = self.packet_buffer[start_idx:]
+                if start_idx == -1:
+                    self.packet_buffer.clear()
+                    break
 
-                    if len(self.packet_buffer) < 33:
-                        break
+                if start_idx > 0:
+                    self.packet_buffer = self.packet_buffer[start_idx:]
 
-                    packet = self.packet_buffer[:33]
-                    channels = self.parse_packet(packet)
+                if len(self.packet_buffer) < 33:
+                    break
 
-                    if channels is not None:
-                        pairs = self.extract_pairs(channels)
-                        self.packet_buffer = self.packet_buffer[33:]
-                        return pairs
+                packet = self.packet_buffer[:33]
+                parsed = self.parse_packet(packet)
 
+                if parsed is not None:
+                    channels, aux = parsed
                     self.packet_buffer = self.packet_buffer[33:]
+                    return self.extract_pairs(channels), aux
+
+                self.packet_buffer = self.packet_buffer[33:]
 
         except Exception as e:
             pass
 
         return None
 
+    def start_reader(self):
+        """Hand serial reads to the native acquisition thread if available"""
+        if CytonReader is None or self.ser is None:
+            return False
+        try:
+            self.reader = CytonReader(self.ser.fileno(), baud=self.BAUD_RATE)
+            self.consumer = self.reader.consumer()
+            self.reader.start()
+            return True
+        except (ValueError, OSError, AttributeError) as e:
+            self.print_status(f"Native reader unavailable ({e}), polling serial instead", "WARNING")
+            self.reader = None
+            self.consumer = None
+            return False
+
+    def stop_reader(self):
+        if self.reader is not None:
+            self.reader.stop()
+
+    def start_recording(self):
+        """Log the raw byte stream to record_dir (replay with replay.py)"""
+        if CytonRecorder is None:
+            raise ImportError("Recording needs libq8native.so. Build it with: make -C native")
+        self.recorder = CytonRecorder(self.record_dir, baud=self.BAUD_RATE)
+        self.recorder.mark(f"model {self.model_path}")
+        self.recorder.mark(f"hop {self.scheduler.hop_samples}")
+        if self.reader is not None:
+            self.reader.record(self.recorder)
+        self.print_status(f"Recording raw stream to {self.record_dir}", "SUCCESS")
+
+    def stop_recording(self):
+        """Close the log (after the reader has stopped writing to it)"""
+        self.recorder.flush()
+        stats = self.recorder.stats()
+        self.recorder.close()
+        self.recorder = None
+        print(f"  Recording: {stats['records']} chunks, {stats['bytes']} bytes in {stats['segments']} "
+              f"segments, {stats['dropped']} dropped -> {self.record_dir}")
+
+    def poll_reader(self, timeout):
+        """Wait up to timeout seconds for frames, then process all of them"""
+        if not self.consumer.pending:
+            t0 = time.perf_counter()
+            self.consumer.wait(timeout)
+            self.timer.add('wait', time.perf_counter() - t0)
+
+        self.stalls.check(self.consumer.pending)
+        return self.process_frames(self.consumer.read())
+
+    def process_frames(self, frames):
+        """Run a batch of decoded frames (dtype CYTON_FRAME) through the pipeline"""
+        if self.orientation is not None:
+            self.orientation.push_frames(frames)
+        self.frames_left = len(frames)
+        for frame in frames:
+            self.frames_left -= 1
+            self.frame_t_ns = int(frame['t_ns'])
+            self.frame_seq = int(frame['seq'])
+            pairs = self.extract_pairs(frame['channels'].tolist())
+            if pairs is not None:
+                self.process_sample(pairs, frame['accel'])
+        return len(frames)
+
+    def backlog_samples(self):
+        """Complete packets received but not yet consumed"""
+        if self.consumer is not None:
+            return self.frames_left + self.consumer.pending
+
+        waiting = len(self.packet_buffer)
+        try:
+            waiting += self.ser.in_waiting
+        except Exception:
+            pass
+        return waiting // 33
+
     def classify_gesture(self):
         """Classify current window"""
-        if len(self.window_buffer) < self.WINDOW_SIZE:
+        if len(self.window_buffer) < self.min_window:
             return None, 0.0
 
-        # Convert to numpy array
-        window_data = np.array(self.window_buffer)
+        t0 = time.perf_counter()
+        self.last_probabilities = None
+
+        if self.anytime is not None:
+            # Shortest window whose confidence clears the threshold
+            prediction, confidence, self.decision_prefix = self.anytime.classify(np.array(self.window_buffer))
+            self.set_probabilities(self.anytime.last_probabilities)
+            self.timer.add('anytime', time.perf_counter() - t0)
+            self.trace_span('anytime', t0)
+            return prediction, confidence
+
+        if self.cascade is not None:
+            # Gate first, expert only when the gate is unsure
+            prediction, confidence, _ = self.cascade.classify(np.array(self.window_buffer), self.window_aux())
+            self.set_probabilities(self.cascade.last_probabilities)
+            self.timer.add('cascade', time.perf_counter() - t0)
+            self.trace_span('cascade', t0)
+            return prediction, confidence
 
         # Extract features
-        features = self.extract_features(window_data)
+        if self.multiscale is not None:
+            features = self.multiscale.features()
+        elif self.spectral is not None:
+            features = np.concatenate([extract_features_time_domain(np.array(self.window_buffer)),
+                                       self.spectral.features()])
+        else:
+            window_data = np.array(self.window_buffer)
+            features = self.extract_features(window_data)
+        t1 = time.perf_counter()
 
         # Scale features if scaler is available (for SVM/LDA)
         if self.scaler is not None:
             features = self.scaler.transform([features])[0]
+            self.last_features = features
             prediction = self.model.predict([features])[0]
             probabilities = self.model.predict_proba([features])[0]
         else:
@@ -333,11 +537,37 @@ class RealtimeGestureClassifier:
             probabilities = self.model.predict_proba([features])[0]
 
         confidence = np.max(probabilities)
+        self.set_probabilities((self.model.classes_, probabilities))
+        t2 = time.perf_counter()
+
+        self.timer.add('features', t1 - t0)
+        self.timer.add('inference', t2 - t1)
+        self.trace_span('features', t0, t1)
+        self.trace_span('inference', t1, t2)
 
         return prediction, confidence
 
+    def set_probabilities(self, result):
+        """
+        last_probabilities from a (classes, probabilities) pair, in the
+        decision stage's class order (None when nothing was classified)
+        """
+        if result is None:
+            self.last_probabilities = None
+            return
+        classes, probabilities = result
+        if self.decision is None:
+            self.last_probabilities = np.asarray(probabilities)
+            return
+        order = {str(c): i for i, c in enumerate(classes)}
+        self.last_probabilities = np.array([probabilities[order[str(c)]] if str(c) in order else 0.0
+                                            for c in self.decision.classes])
+
     def smooth_prediction(self, gesture):
         """Smooth predictions using history"""
+        if self.decision is not None:
+            return self.decision.update(gesture, self.last_probabilities, self.clock())
+
         self.gesture_history.append(gesture)
 
         if len(self.gesture_history) < 3:
@@ -347,43 +577,231 @@ class RealtimeGestureClassifier:
         unique, counts = np.unique(list(self.gesture_history), return_counts=True)
         return unique[np.argmax(counts)]
 
-    def display_status(self):
-        """Display current classification status"""
-        self.clear_screen()
-
-        print("=" * 80)
-        print("Real-time EMG Gesture Classifier - Quadruped Control")
-        print("=" * 80)
-        print()
-        print(f"Status: {'Connected' if self.connected else 'Disconnected'} | "
-              f"Streaming: {'Yes' if self.streaming else 'No'} | "
-              f"Classifications: {self.classification_count}")
-        print()
-        print("-" * 80)
-
-        # Current gesture
-        command = self.COMMAND_MAP.get(self.current_gesture, "UNKNOWN")
-        confidence_bar = "█" * int(self.gesture_confidence * 50)
+    def process_sample(self, pairs, aux=(0, 0, 0)):
+        """Push one sample through filter, window, scheduler and classifier"""
+        if self.quality is not None:
+            self.quality.push([pairs])
+        if self.filter_bank is not None:
+            t0 = time.perf_counter()
+            pairs = self.filter_bank.process([pairs])[0]
+            self.timer.add('filter', time.perf_counter() - t0)
+
+        self.window_buffer.append(pairs)
+        self.aux_buffer.append(aux)
+        if self.trace is not None:
+            self.window_t_ns.append(self.frame_t_ns if self.frame_t_ns is not None else time.monotonic_ns())
+        if self.multiscale is not None:
+            self.multiscale.push([pairs])
+        if self.spectral is not None:
+            self.spectral.push([pairs])
+        self.scheduler.on_samples(1)
+
+        # Classify when window is full (or long enough for an early
+        # decision) and a decision is due
+        if len(self.window_buffer) < self.min_window:
+            return
+        now = self.clock()
+        if not self.scheduler.should_decide(now, self.backlog_samples()):
+            return
+        if self.quality is not None and self.quality.window_flags(len(self.window_buffer)) & self.QUALITY_REJECT:
+            self.quality_rejected += 1
+            self.scheduler.decision_done(now, self.clock())
+            return
 
-        print()
-        print(f"  DETECTED GESTURE: {command}")
-        print(f"  Confidence: [{confidence_bar:<50}] {self.gesture_confidence:.1%}")
-        print()
+        self.trace_id = self.frame_seq
+        gesture, confidence = self.classify_gesture()
+        if self.trace is not None:
+            self.trace_window(now)
+        # Past its deadline: a newer window is about to be classified, so
+        # this one is dropped instead of steering the robot late
+        late = gesture is not None and self.scheduler.late(now, self.clock())
+
+        if gesture is not None and not late:
+            # Smooth prediction
+            t0 = time.perf_counter()
+            smoothed_gesture = self.smooth_prediction(gesture)
+            self.timer.add('smoothing', time.perf_counter() - t0)
+            self.trace_span('smoothing', t0)
+
+            self.current_gesture = smoothed_gesture if smoothed_gesture is not None else "unknown"
+
+            # Age of the newest sample when its decision is ready
+            if self.frame_t_ns is not None:
+                self.timer.add('frame age', self.clock() - self.frame_t_ns / 1e9)
+            self.gesture_confidence = confidence
+            self.classification_count += 1
+            if self.on_decision is not None:
+                self.on_decision(self.current_gesture, confidence)
+            # The user is following calibration prompts, not steering
+            if self.link is not None and self.calibrator is None:
+                self.publish_gesture(smoothed_gesture, confidence)
+
+        if self.calibrator is not None:
+            self.calibrate_step(gesture is not None, now)
+
+        self.scheduler.decision_done(now, self.clock())
+
+    def calibrate_step(self, classified, now):
+        """Feed the window to the calibration and swap the model in when it ends"""
+        if classified and self.last_features is not None:
+            self.calibrator.add(self.last_features, now)
+        if not self.calibrator.done(now):
+            return
+        model = self.calibrator.finish()
+        if model is not None:
+            self.model = model
+            self.calibrated = True
+            self.gesture_history.clear()
+        self.calibration_summary = self.calibrator.summary() if model is not None else "could not refit"
+        self.calibrator = None
+
+    def publish_gesture(self, gesture, confidence):
+        """Send the decision to the robot, stamped with its newest sample's arrival"""
+        name = gesture if gesture in GESTURE_CODES else self.LINK_GESTURES.get(gesture)
+        if name is None and gesture is not None and gesture not in self.unmapped_labels:
+            # Sent as "no gesture"; say so once per label
+            self.unmapped_labels.add(gesture)
+            self.print_status(f"'{gesture}' has no robot gesture (set Q8_LINK_MAP); sent as none", "WARNING")
+        t_capture = self.frame_t_ns if self.frame_t_ns is not None else time.monotonic_ns()
+        t0 = time.perf_counter()
+        self.link.publish(name, confidence, t_capture_ns=t_capture, trace_id=self.trace_id)
+        self.timer.add('publish', time.perf_counter() - t0)
+        self.trace_span('publish', t0)
+
+    def trace_span(self, stage, t0, t1=None):
+        """
+        Record a stage of the current decision. t0 / t1 are perf_counter()
+        seconds: CLOCK_MONOTONIC on Linux, the clock frames are stamped with.
+        """
+        if self.trace is not None:
+            t1 = time.perf_counter() if t1 is None else t1
+            self.trace.span(stage, int(t0 * 1e9), int(t1 * 1e9), self.trace_id)
+
+    def trace_window(self, t_decide):
+        """
+        The window the decision used (oldest to newest sample arrival) and
+        the wait from the newest sample's arrival until the decision began
+        """
+        used = self.decision_prefix if self.anytime is not None else len(self.window_buffer)
+        used = min(used, len(self.window_t_ns))
+        if used == 0:
+            return
+        newest = self.window_t_ns[-1]
+        self.trace.span('window', self.window_t_ns[-used], newest, self.trace_id)
+        self.trace.span('queue', newest, int(t_decide * 1e9), self.trace_id)
+
+    def status_snapshot(self):
+        """Values shown on the status screen (taken on the acquisition thread)"""
+        elapsed = time.time() - self.start_time if self.start_time else 0.0
+        snapshot = {
+            'connected': self.connected,
+            'streaming': self.streaming,
+            'classifications': self.classification_count,
+            'decision_rate': self.scheduler.decision_rate(elapsed),
+            'hop': self.scheduler.effective_hop,
+            'skipped': self.scheduler.skipped_backlog + self.scheduler.skipped_rate + self.scheduler.late_dropped,
+            'features_ms': self.timer.mean_ms('features'),
+            'inference_ms': self.timer.mean_ms('inference'),
+            'stalls': self.stalls.stalls,
+            'max_backlog': self.stalls.max_backlog,
+            'gesture': self.current_gesture,
+            'confidence': self.gesture_confidence,
+            'buffer': len(self.window_buffer),
+        }
+        if self.link is not None:
+            link = self.link.stats()
+            snapshot['link_sent'] = link['sent']
+            snapshot['link_errors'] = link['send_errors']
+        if self.orientation is not None:
+            snapshot['pitch'] = self.orientation.pitch
+            snapshot['roll'] = self.orientation.roll
+            snapshot['direction'] = self.orientation.direction
+        if self.anytime is not None:
+            snapshot['prefix'] = self.decision_prefix
+            snapshot['prefix_ms'] = self.anytime.latency_ms(self.decision_prefix)
+            snapshot['mean_prefix_ms'] = self.anytime.mean_latency_ms()
+        if self.cascade is not None:
+            snapshot['escalation_rate'] = self.cascade.escalation_rate
+            snapshot['cascade_ms'] = self.cascade.mean_cost_ms()
+        if self.calibrator is not None:
+            snapshot['calibration'] = self.calibrator.prompt(self.clock())
+        if self.quality is not None and self.quality.stats()['blocks'] > 0:
+            snapshot['electrodes'] = self.quality.channels()
+            snapshot['quality_rejected'] = self.quality_rejected
+        return snapshot
+
+    def render_status(self, s):
+        """Status screen lines for a snapshot (runs on the render thread)"""
+        command = self.COMMAND_MAP.get(s['gesture'], "UNKNOWN")
+        confidence_bar = "█" * int(s['confidence'] * 50)
+
+        lines = [
+            "=" * 80,
+            "Real-time EMG Gesture Classifier - Quadruped Control",
+            "=" * 80,
+            "",
+            f"Status: {'Connected' if s['connected'] else 'Disconnected'} | "
+            f"Streaming: {'Yes' if s['streaming'] else 'No'} | "
+            f"Classifications: {s['classifications']}",
+            f"Decisions: {s['decision_rate']:5.1f}/s | "
+            f"Hop: {s['hop']} samples | "
+            f"Skipped: {s['skipped']} | "
+            f"Features: {s['features_ms']:.2f} ms | "
+            f"Inference: {s['inference_ms']:.2f} ms",
+            f"Acquisition stalls: {s['stalls']} | Max backlog: {s['max_backlog']} samples",
+        ]
+        if 'link_sent' in s:
+            lines.append(f"Gesture link: {self.link.addr} | Sent: {s['link_sent']} | "
+                         f"Not delivered: {s['link_errors']}")
+        if 'electrodes' in s:
+            lines.append("Electrodes: " + " | ".join(
+                f"Ch{ch + 1} {','.join(c['flags']) or 'ok'} (line {c['line_uv']:.0f} µV)"
+                for ch, c in enumerate(s['electrodes'])) + f" | Rejected: {s['quality_rejected']}")
+        if s.get('calibration'):
+            gesture, left, collecting = s['calibration']
+            lines += [
+                "",
+                f"  CALIBRATION: hold {gesture.upper()} ({left:.1f} s)"
+                f"{'' if collecting else ' - get ready'}",
+            ]
+        lines += [
+            "",
+            "-" * 80,
+            "",
+            f"  DETECTED GESTURE: {command}",
+            f"  Confidence: [{confidence_bar:<50}] {s['confidence']:.1%}",
+        ]
+        if 'pitch' in s:
+            lines.append(f"  Wrist: pitch {s['pitch']:6.1f}° | roll {s['roll']:6.1f}° | "
+                         f"tilt: {s['direction'] or 'level'}")
+        if 'prefix' in s:
+            lines.append(f"  Window: {s['prefix']} samples ({s['prefix_ms']:.0f} ms) | "
+                         f"Mean: {s['mean_prefix_ms']:.0f} ms")
+        if 'escalation_rate' in s:
+            lines.append(f"  Escalated: {100 * s['escalation_rate']:.1f}% | "
+                         f"Cost: {s['cascade_ms']:.2f} ms/decision (audits included)")
+        lines += [
+            "",
+            "-" * 80,
+            "",
+            "Gesture Guide:",
+            "  FORWARD  → Wrist extension (hand up)",
+            "  BACKWARD → Wrist flexion (hand down)",
+            "  LEFT     → Ulnar deviation (toward pinky)",
+            "  RIGHT    → Radial deviation (toward thumb)",
+            "  STOP     → Rest/neutral position",
+            "  JUMP     → Spread fingers wide",
+            "",
+            "-" * 80,
+            "Buffer: " + ("█" * int(s['buffer'] / self.WINDOW_SIZE * 50)),
+            "",
+            "Press Ctrl+C to exit",
+        ]
+        return lines
 
-        print("-" * 80)
-        print()
-        print("Gesture Guide:")
-        print("  FORWARD  → Wrist extension (hand up)")
-        print("  BACKWARD → Wrist flexion (hand down)")
-        print("  LEFT     → Ulnar deviation (toward pinky)")
-        print("  RIGHT    → Radial deviation (toward thumb)")
-        print("  STOP     → Rest/neutral position")
-        print("  JUMP     → Spread fingers wide")
-        print()
-        print("-" * 80)
-        print("Buffer: " + ("█" * int(len(self.window_buffer) / self.WINDOW_SIZE * 50)))
-        print()
-        print("Press Ctrl+C to exit")
+    def display_status(self):
+        """Hand the current state to the display"""
+        self.display.update(self.status_snapshot())
 
     def run(self):
         """Main classification loop"""
@@ -398,37 +816,58 @@ class RealtimeGestureClassifier:
 
         print("\nWaiting for data stream to stabilize...")
         time.sleep(2)
+        if self.start_reader():
+            self.ser.reset_input_buffer()
+            self.print_status("Native acquisition thread started", "SUCCESS")
+        if self.record_dir:
+            self.start_recording()
 
         try:
             last_update = time.time()
             update_interval = 0.1  # Update display 10 times per second
+            self.start_time = time.time()
+            self.display = TerminalDisplay(self.render_status, interval=update_interval,
+                                           threaded=display_threaded())
+            self.display.start()
 
             while True:
-                # Read packets continuously
-                pairs = self.read_packet()
-                if pairs is not None:
-                    self.window_buffer.append(pairs)
-
-                    # Classify when window is full
-                    if len(self.window_buffer) == self.WINDOW_SIZE:
-                        gesture, confidence = self.classify_gesture()
-
-                        if gesture is not None:
-                            # Smooth prediction
-                            smoothed_gesture = self.smooth_prediction(gesture)
-
-                            self.current_gesture = smoothed_gesture
-                            self.gesture_confidence = confidence
-                            self.classification_count += 1
+                if self.reader is not None:
+                    # Block on the acquisition ring until frames arrive or
+                    # the display is due
+                    timeout = max(0.0, update_interval - (time.time() - last_update))
+                    pairs = self.poll_reader(timeout) or None
+                else:
+                    # Read packets continuously
+                    t0 = time.perf_counter()
+                    packet = self.read_packet()
+                    self.timer.add('read', time.perf_counter() - t0)
+
+                    pairs = None
+                    if packet is not None:
+                        pairs, aux = packet
+                        self.frame_seq += 1
+                        if self.orientation is not None:
+                            self.orientation.push([aux])
+                        self.process_sample(pairs, aux)
+
+                # Answer the robot's clock pings between decisions
+                if self.link is not None:
+                    self.link.service()
 
                 # Update display periodically
                 if time.time() - last_update > update_interval:
+                    t0 = time.perf_counter()
                     self.display_status()
+                    self.timer.add('display', time.perf_counter() - t0)
                     last_update = time.time()
 
-                time.sleep(0.001)
+                # Only idle when the serial buffer is drained
+                if pairs is None and self.reader is None:
+                    time.sleep(0.001)
 
         except KeyboardInterrupt:
+            if self.display is not None:
+                self.display.stop()
             print("\n\nShutting down...")
 
         finally:
@@ -436,6 +875,10 @@ class RealtimeGestureClassifier:
 
     def cleanup(self):
         """Clean up resources"""
+        if self.display is not None:
+            self.display.stop()
+        self.stop_reader()
+
         if self.streaming:
             self.stop_streaming()
 
@@ -445,7 +888,57 @@ class RealtimeGestureClassifier:
             print("Connection closed")
 
         print(f"\nSession summary:")
+        if self.recorder is not None:
+            self.stop_recording()
         print(f"  Total classifications: {self.classification_count}")
+        print(f"  Scheduler: {self.scheduler.summary()}")
+        print(f"  Stalls: {self.stalls.summary()}")
+        if self.quality is not None:
+            print(f"  Electrodes: {self.quality_rejected} windows rejected; bad blocks per channel "
+                  f"{self.quality.stats()['bad_blocks']} of {self.quality.stats()['blocks']}")
+        if self.display is not None:
+            print(f"  Display: {self.display.summary()}")
+        if self.calibrated:
+            path = os.path.splitext(self.model_path)[0].replace('_calibrated', '') + '_calibrated.pkl'
+            model_data = dict(joblib.load(self.model_path), model=self.model,
+                              method=f"{self.method} (calibrated)", training_date=datetime.now().isoformat())
+            joblib.dump(model_data, path)
+            print(f"  Calibration: {self.calibration_summary}; saved as {path}")
+        elif self.calibration_summary:
+            print(f"  Calibration: {self.calibration_summary}")
+        if self.reader is not None:
+            stats = self.reader.stats(self.consumer.id)
+            print(f"  Acquisition: {stats['frames']} frames in {stats['reads']} reads "
+                  f"(max {stats['max_batch']} per read), {stats['resync_bytes']} resync bytes, "
+                  f"{stats['dropped']} dropped")
+        print("  Stage timing:")
+        for line in self.timer.report():
+            print(line)
+        if self.anytime is not None:
+            print(f"  Anytime commits per window length: {self.anytime.commits}")
+            print(f"  Mean decision window: {self.anytime.mean_latency_ms():.0f} ms")
+        if self.cascade is not None:
+            print(f"  Cascade: {self.cascade.summary()}")
+        if self.link is not None:
+            link = self.link.stats()
+            print(f"  Gesture link: {link['sent']} sent, {link['send_errors']} not delivered, "
+                  f"{link['pings']} clock pings answered")
+            self.link.close()
+        if self.trace is not None:
+            n = self.trace.write(process_name="wristband classifier")
+            stats = self.trace.stats()
+            print(f"  Trace: {n} events -> {self.trace.path} ({stats['dropped']} overwritten); "
+                  f"python3 native/trace_summary.py {self.trace.path}")
+
+def parse_link_map(text):
+    """'left=turn_left,right=turn_right,relaxed=stop' -> {label: robot gesture}"""
+    link_map = {}
+    for item in text.split(','):
+        label, sep, gesture = item.partition('=')
+        if not sep or not label.strip() or not gesture.strip():
+            raise ValueError(f"Bad link map entry '{item}' (expected label=gesture)")
+        link_map[label.strip()] = gesture.strip()
+    return link_map
 
 def main():
     print("=" * 80)
@@ -460,7 +953,8 @@ def main():
         print("Run a train_model script first.")
         return
 
-    available_models = [f for f in os.listdir(models_dir) if f.endswith('.pkl')]
+    available_models = [f for f in os.listdir(models_dir)
+                        if (f.endswith('.pkl') and not f.endswith('_metadata.pkl')) or f.endswith('.h5')]
 
     if not available_models:
         print("Error: No models found!")
@@ -471,6 +965,8 @@ def main():
     print()
     for i, model in enumerate(sorted(available_models), 1):
         model_path = os.path.join(models_dir, model)
+        if model_path.endswith('.h5'):
+            model_path = model_path.replace('.h5', '_metadata.pkl')
         try:
             model_data = joblib.load(model_path)
             method = model_data.get('method', 'Unknown')
@@ -509,9 +1005,51 @@ def main():
     print()
     print(f"Using model: {selected_model}")
     print()
+
+    # Cascade: a cheap LDA gate in front of an expensive model
+    gate_model_path = None
+    cascade_margin = 0.2
+    gate_candidates = [m for m in sorted(available_models) if m != selected_model and 'lda' in m.lower()]
+    if gate_candidates and 'lda' not in selected_model.lower():
+        print("Cascade: run a fast LDA gate first and this model only when the gate is unsure")
+        for i, model in enumerate(gate_candidates, 1):
+            print(f"  [{i}] {model}")
+        gate_choice = input("Gate model (number, Enter for no cascade): ").strip()
+        if gate_choice.isdigit() and 1 <= int(gate_choice) <= len(gate_candidates):
+            gate_model_path = os.path.join(models_dir, gate_candidates[int(gate_choice) - 1])
+            margin = input("Escalation margin (default=0.2, see evaluate_cascade.py): ").strip()
+            try:
+                cascade_margin = float(margin) if margin else 0.2
+            except ValueError:
+                cascade_margin = 0.2
+        print()
+
+    hop = input("Decision hop in samples (default=5, one decision per 50 Hz robot tick): ").strip()
+    hop_samples = int(hop) if hop.isdigit() and int(hop) > 0 else 5
+    print()
+
+    # Session calibration (LDA models): adapt to today's electrode placement
+    calibrate_s = 0.0
+    if gate_model_path is None and 'lda' in selected_model.lower():
+        answer = input("Calibrate to this session first (hold each gesture when prompted)? "
+                       "Seconds in total, Enter to skip: ").strip()
+        try:
+            calibrate_s = float(answer) if answer else 0.0
+        except ValueError:
+            calibrate_s = 0.0
+        print()
     input("Press Enter to start classification...")
 
-    classifier = RealtimeGestureClassifier(model_path=model_path)
+    # Q8_GESTURE_LINK=udp:ROBOT_HOST:5860 (or unix:PATH) sends every decision
+    # to the robot controller, labels mapped by Q8_LINK_MAP=label=gesture,...;
+    # Q8_TRACE=path.json records a latency trace; Q8_RECORD=dir logs the raw
+    # stream for replay.py
+    link_map = parse_link_map(os.environ['Q8_LINK_MAP']) if os.environ.get('Q8_LINK_MAP') else None
+    classifier = RealtimeGestureClassifier(model_path=model_path, hop_samples=hop_samples,
+                                           gate_model_path=gate_model_path, cascade_margin=cascade_margin,
+                                           link_addr=os.environ.get('Q8_GESTURE_LINK'),
+                                           record_dir=os.environ.get('Q8_RECORD'), calibrate_s=calibrate_s,
+                                           link_map=link_map)
     classifier.run()
 
 if __name__ == "__main__":
@@ -73,6 +73,10 @@ class GestureDataCollector:
 
     def find_port(self):
         """Find OpenBCI port"""
+        # Explicit port, e.g. the native/cyton_emu pseudo-terminal
+        if os.environ.get('OPENBCI_PORT'):
+            return os.environ['OPENBCI_PORT']
+
         ports = list(serial.tools.list_ports.comports())
         available = [p for p in ports if p.device not in self.EXCLUDED_PORTS]
 
@@ -13,6 +13,16 @@ from datetime import datetime
 from collections import deque
 import numpy as np
 import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import (CytonReader, CytonRecorder, QualityMonitor, quality_names,
+                          QUALITY_SATURATED, QUALITY_FLAT)
+except ImportError:
+    CytonReader = None
+    CytonRecorder = None
+    QualityMonitor = None
 
 class AutoGestureCollector:
     def __init__(self, session_name=None):
@@ -35,8 +45,34 @@ class AutoGestureCollector:
         self.end_byte = 0xC0
         self.packet_buffer = bytearray()
 
+        # Native acquisition thread (libq8native.so); falls back to polling
+        self.reader = None
+        self.consumer = None
+
+        # Raw stream log with prompt markers (Q8_RECORD=dir), so the whole
+        # session, not just the labeled windows, can be replayed (replay.py)
+        self.record_dir = os.environ.get('Q8_RECORD')
+        self.recorder = None
+
         # Window settings
         self.WINDOW_SIZE = 200
+        self.recording = None       # whole capture of the last window (data, aux, start)
+
+        # The last samples read before each prompt are saved ahead of the
+        # capture, so training can run the filters over them first and see
+        # the window with the filter history classify_realtime has (the
+        # 60 Hz notch takes ~1.5 s to settle)
+        self.PRE_ROLL = 500
+        self.pre_roll = deque(maxlen=self.PRE_ROLL)
+
+        # Electrode health from every sample read (saturation, line noise,
+        # flatline, drift). Windows with a saturated or flat channel
+        # (electrode off) are not saved and the gesture is asked for again;
+        # other problems are saved with a 'quality' field.
+        self.quality = QualityMonitor(n_channels=4) if QualityMonitor is not None else None
+        self.QUALITY_REJECT = (QUALITY_SATURATED | QUALITY_FLAT) if QualityMonitor is not None else 0
+        self.rejected = 0
+        self.flagged = 0
 
         # Gesture definitions with detailed instructions
         self.GESTURES = [
@@ -140,6 +176,10 @@ class AutoGestureCollector:
 
     def find_port(self):
         """Find OpenBCI port"""
+        # Explicit port, e.g. the native/cyton_emu pseudo-terminal
+        if os.environ.get('OPENBCI_PORT'):
+            return os.environ['OPENBCI_PORT']
+
         ports = list(serial.tools.list_ports.comports())
         available = [p for p in ports if p.device not in self.EXCLUDED_PORTS]
 
@@ -202,7 +242,7 @@ class AutoGestureCollector:
                 self.print_status(f"Error stopping stream: {e}", "ERROR")
 
     def parse_packet(self, packet):
-        """Parse OpenBCI data packet"""
+        """Parse OpenBCI data packet into (channels, accelerometer aux)"""
         if len(packet) != 33:
             return None
 
@@ -217,10 +257,13 @@ class AutoGestureCollector:
                 val -= 0x1000000
             channels.append(val)
 
+        # Accelerometer X, Y, Z: big-endian int16 in bytes 26-31
+        aux = [int.from_bytes(packet[26 + 2 * i:28 + 2 * i], 'big', signed=True) for i in range(3)]
+
         if packet[32] != self.end_byte:
             return None
 
-        return channels
+        return channels, aux
 
     def extract_pairs(self, channels):
         """Extract 4 pairs: N1P, N2P, N5P, N6P"""
@@ -236,13 +279,56 @@ class AutoGestureCollector:
 
         return pairs
 
+    def start_reader(self):
+        """Hand serial reads to the native acquisition thread if available"""
+        if CytonReader is None:
+            return False
+        try:
+            self.ser.reset_input_buffer()
+            self.reader = CytonReader(self.ser.fileno(), baud=self.BAUD_RATE)
+            self.consumer = self.reader.consumer()
+            self.reader.start()
+            return True
+        except (ValueError, OSError) as e:
+            self.print_status(f"Native reader unavailable ({e}), polling serial instead", "WARNING")
+            self.reader = None
+            self.consumer = None
+            return False
+
+    def start_recording(self):
+        """Log the raw byte stream to record_dir"""
+        if CytonRecorder is None:
+            self.print_status("Recording needs libq8native.so (make -C native); not recording", "WARNING")
+            return
+        self.recorder = CytonRecorder(self.record_dir, baud=self.BAUD_RATE)
+        self.recorder.mark(f"session {self.session_name}")
+        if self.reader is not None:
+            self.reader.record(self.recorder)
+        self.print_status(f"Recording raw stream to {self.record_dir}", "SUCCESS")
+
+    def mark(self, text):
+        """Marker in the raw stream log (prompts, collection windows, rest)"""
+        if self.recorder is not None:
+            self.recorder.mark(text)
+
     def read_packets(self):
-        """Read and parse all available packets, return list of pairs"""
+        """Read and parse all available packets, return list of (pairs, aux)"""
         pairs_list = []
 
+        if self.consumer is not None:
+            for frame in self.consumer.read():
+                pairs = self.extract_pairs(frame['channels'].tolist())
+                if pairs is not None:
+                    pairs_list.append((pairs, frame['accel'].tolist()))
+            self.monitor_quality([pairs for pairs, _ in pairs_list])
+            self.pre_roll.extend(pairs_list)
+            return pairs_list
+
         try:
             if self.ser.in_waiting > 0:
                 data = self.ser.read(self.ser.in_waiting)
+                if self.recorder is not None:
+                    self.recorder.write(data)
                 self.packet_buffer.extend(data)
 
                 while len(self.packet_buffer) >= 33:
@@ -259,34 +345,84 @@ class AutoGestureCollector:
                         break
 
                     packet = self.packet_buffer[:33]
-                    channels = self.parse_packet(packet)
+                    parsed = self.parse_packet(packet)
 
-                    if channels is not None:
+                    if parsed is not None:
+                        channels, aux = parsed
                         pairs = self.extract_pairs(channels)
                         if pairs is not None:
-                            pairs_list.append(pairs)
+                            pairs_list.append((pairs, aux))
 
                     self.packet_buffer = self.packet_buffer[33:]
 
         except Exception as e:
             print(f"  Exception in read_packets: {e}")
 
+        self.monitor_quality([pairs for pairs, _ in pairs_list])
+        self.pre_roll.extend(pairs_list)
         return pairs_list
 
+    def monitor_quality(self, samples):
+        """Feed raw samples to the electrode quality monitor"""
+        if self.quality is not None and samples:
+            self.quality.push(samples)
+
+    def drain_for(self, seconds):
+        """Keep reading (and monitoring) the stream instead of sleeping"""
+        end = time.time() + seconds
+        while time.time() < end:
+            self.read_packets()
+            time.sleep(0.01)
+
+    def quality_line(self):
+        """Electrode status per channel for the prompt screens"""
+        if self.quality is None or self.quality.stats()['blocks'] == 0:
+            return None
+        parts = []
+        for ch, c in enumerate(self.quality.channels()):
+            state = ",".join(c['flags']) if c['flags'] else "ok"
+            parts.append(f"Ch{ch + 1} {state} ({c['rms_uv']:.0f} µV, line {c['line_uv']:.0f} µV)")
+        return "  Electrodes: " + " | ".join(parts)
+
     def collect_window(self, duration_seconds):
-        """Collect EMG data for specified duration"""
+        """Collect EMG data (and the accelerometer aux alongside) for specified duration"""
         window_buffer = deque(maxlen=self.WINDOW_SIZE * 10)  # Large buffer
+        aux_buffer = deque(maxlen=self.WINDOW_SIZE * 10)
         start_time = time.time()
         packets_read = 0
         read_calls = 0
 
-        while time.time() - start_time < duration_seconds:
+        # Frames that arrived before the prompt go to the pre-roll
+        self.read_packets()
+        pre_roll = list(self.pre_roll)
+
+        if self.consumer is not None:
+            # Keep only frames that arrived after the prompt, by their
+            # arrival timestamps rather than by when we got to read them
+            start_ns = time.monotonic_ns()
+            end_ns = start_ns + int(duration_seconds * 1e9)
+            while time.monotonic_ns() < end_ns or self.consumer.pending:
+                self.consumer.wait(0.05)
+                frames = self.consumer.read()
+                read_calls += 1
+                for frame in frames:
+                    if start_ns <= frame['t_ns'] < end_ns:
+                        pairs = self.extract_pairs(frame['channels'].tolist())
+                        window_buffer.append(pairs)
+                        aux_buffer.append(frame['accel'].tolist())
+                        self.monitor_quality([pairs])
+                        packets_read += 1
+                if frames.size and frames['t_ns'][-1] >= end_ns:
+                    break
+
+        while self.consumer is None and time.time() - start_time < duration_seconds:
             pairs_list = self.read_packets()
             read_calls += 1
 
             if pairs_list:
-                for pairs in pairs_list:
+                for pairs, aux in pairs_list:
                     window_buffer.append(pairs)
+                    aux_buffer.append(aux)
                     packets_read += 1
 
             time.sleep(0.001)
@@ -300,23 +436,43 @@ class AutoGestureCollector:
             print(f"  Sample data shape: {np.array(list(window_buffer)[:1]).shape}")
             print(f"  First sample: {list(window_buffer)[0]}")
 
+        # Quality over everything collected for this prompt (the saved
+        # window is its first WINDOW_SIZE samples)
+        self.window_quality = self.quality.window_flags(len(window_buffer)) if self.quality is not None else 0
+
         # Return the collected data as numpy array (EXACTLY WINDOW_SIZE samples)
         if len(window_buffer) >= self.WINDOW_SIZE:
             result = np.array(list(window_buffer)[:self.WINDOW_SIZE])  # FIX: Take only first WINDOW_SIZE samples
-            print(f"  Final array shape: {result.shape}")
-            return result
+            aux = np.array(list(aux_buffer)[:self.WINDOW_SIZE])
+            # The whole capture is kept alongside, after the pre-roll, for
+            # training-time filtering and augmentation (emg_features)
+            self.recording = (np.array([p for p, _ in pre_roll] + list(window_buffer)),
+                              np.array([a for _, a in pre_roll] + list(aux_buffer)), len(pre_roll))
+            print(f"  Final array shape: {result.shape} (recording {self.recording[0].shape}, "
+                  f"{len(pre_roll)} samples pre-roll)")
+            return result, aux
         else:
             print(f"  WARNING: Not enough samples! Only got {len(window_buffer)}/{self.WINDOW_SIZE}")
-            return None
+            return None, None
 
-    def save_sample(self, window_data, gesture_label):
-        """Save a sample with label"""
+    def save_sample(self, window_data, gesture_label, aux=None, quality=0, recording=None):
+        """Save a sample with label (aux: accelerometer counts per sample, for 'fused' features;
+        recording: (data, aux, start) of the whole capture the window starts at sample
+        start of, after the samples read before the prompt)"""
         sample = {
             'timestamp': datetime.now().isoformat(),
             'gesture': gesture_label,
             'data': window_data.tolist(),
             'shape': window_data.shape
         }
+        if aux is not None:
+            sample['aux'] = aux.tolist()
+        if recording is not None:
+            sample['recording'] = recording[0].tolist()
+            sample['recording_aux'] = recording[1].tolist()
+            sample['recording_start'] = recording[2]
+        if quality:
+            sample['quality'] = quality_names(quality)
 
         self.samples.append(sample)
 
@@ -352,6 +508,10 @@ class AutoGestureCollector:
             print(f"  Get ready in: {countdown} seconds...")
             print()
             print("  " + "░" * 60)
+            line = self.quality_line()
+            if line:
+                print()
+                print(line)
         else:
             print(f"Current Gesture: {gesture['display']}")
             print()
@@ -372,6 +532,10 @@ class AutoGestureCollector:
         print()
         print("  Relax your hand...")
         print(f"  Next gesture in: {seconds_left:.1f} seconds")
+        line = self.quality_line()
+        if line:
+            print()
+            print(line)
         print()
         print("=" * 80)
 
@@ -428,6 +592,10 @@ class AutoGestureCollector:
 
         print("\nWaiting for data stream to stabilize...")
         time.sleep(2)
+        if self.start_reader():
+            self.print_status("Native acquisition thread started", "SUCCESS")
+        if self.record_dir:
+            self.start_recording()
 
         # Test if we're receiving data
         print("\nTesting data reception...")
@@ -436,7 +604,7 @@ class AutoGestureCollector:
         while time.time() - test_start < 2.0 and test_count < 10:
             pairs_list = self.read_packets()
             if pairs_list:
-                for pairs in pairs_list:
+                for pairs, _ in pairs_list:
                     test_count += 1
                     if test_count == 1:
                         print(f"  ✓ First packet received: {pairs}")
@@ -459,6 +627,7 @@ class AutoGestureCollector:
         for _ in range(preset['samples_per_gesture']):
             gesture_sequence.extend(self.GESTURES.copy())
         random.shuffle(gesture_sequence)
+        retries = {}
 
         session_start = time.time()
 
@@ -471,18 +640,34 @@ class AutoGestureCollector:
                     break
 
                 # Show gesture prompt with countdown
+                self.mark(f"prompt {gesture['name']}")
                 for countdown in range(3, 0, -1):
                     self.display_gesture_prompt(gesture, countdown=countdown)
-                    time.sleep(1)
+                    self.drain_for(1)
 
                 # Show collecting state
                 self.display_gesture_prompt(gesture, collecting=True)
 
                 # Collect data
-                window_data = self.collect_window(preset['gesture_duration'])
-
-                if window_data is not None and len(window_data) >= self.WINDOW_SIZE:
-                    self.save_sample(window_data, gesture['name'])
+                self.mark(f"collect {gesture['name']}")
+                window_data, aux = self.collect_window(preset['gesture_duration'])
+                self.mark("end")
+
+                if window_data is not None and self.window_quality & self.QUALITY_REJECT:
+                    # Electrode off: ask for this gesture again later (at
+                    # most 3 times, so a dead channel cannot stall the session)
+                    self.rejected += 1
+                    retries[gesture['name']] = retries.get(gesture['name'], 0) + 1
+                    if retries[gesture['name']] <= 3:
+                        gesture_sequence.append(gesture)
+                    print(f"  ✗ Rejected ({', '.join(quality_names(self.window_quality))}); "
+                          f"check the electrodes: {self.quality_line() or ''}")
+                    time.sleep(1)
+                elif window_data is not None and len(window_data) >= self.WINDOW_SIZE:
+                    if self.window_quality:
+                        self.flagged += 1
+                        print(f"  ⚠ Saved with quality flags: {', '.join(quality_names(self.window_quality))}")
+                    self.save_sample(window_data, gesture['name'], aux, self.window_quality, self.recording)
                     samples_collected += 1
                     gesture_counts[gesture['name']] += 1
 
@@ -493,10 +678,11 @@ class AutoGestureCollector:
                 # Rest period
                 rest_time = preset['rest_duration']
                 rest_start = time.time()
+                self.mark("rest")
                 while time.time() - rest_start < rest_time:
                     seconds_left = rest_time - (time.time() - rest_start)
                     self.display_rest(seconds_left)
-                    time.sleep(0.1)
+                    self.drain_for(0.1)
 
         except KeyboardInterrupt:
             print("\n\nSession interrupted by user...")
@@ -517,6 +703,12 @@ class AutoGestureCollector:
             'session_preset': preset['name'],
             'collection_date': datetime.now().isoformat()
         }
+        if self.quality is not None:
+            summary['quality'] = {
+                'rejected_windows': self.rejected,
+                'flagged_windows': self.flagged,
+                'bad_blocks': self.quality.stats()['bad_blocks'],
+            }
 
         with open(summary_file, 'w') as f:
             json.dump(summary, f, indent=2)
@@ -526,6 +718,8 @@ class AutoGestureCollector:
         print("=" * 80)
         print()
         print(f"Total samples collected: {sum(gesture_counts.values())}")
+        if self.quality is not None:
+            print(f"Electrode quality: {self.rejected} windows rejected, {self.flagged} saved with flags")
         print()
         print("Samples per gesture:")
         for gesture_name, count in sorted(gesture_counts.items()):
@@ -540,6 +734,22 @@ class AutoGestureCollector:
 
     def cleanup(self):
         """Clean up resources"""
+        if self.reader is not None:
+            stats = self.reader.stats(self.consumer.id)
+            self.reader.stop()
+            self.reader = None
+            self.consumer = None
+            print(f"Acquisition: {stats['frames']} frames, {stats['resync_bytes']} resync bytes, "
+                  f"{stats['dropped']} dropped")
+
+        if self.recorder is not None:
+            self.recorder.flush()
+            stats = self.recorder.stats()
+            self.recorder.close()
+            self.recorder = None
+            print(f"Recording: {stats['records']} chunks, {stats['bytes']} bytes, {stats['marks']} markers, "
+                  f"{stats['dropped']} dropped -> {self.record_dir}")
+
         if self.streaming:
             self.stop_streaming()
 
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Decision scheduling and per-stage timing for the real-time classifier
+
+The Cyton delivers 250 samples/s but the robot only consumes one gesture per
+MotionRunner tick (50 Hz by default), so classifying every packet wastes CPU
+on the Pi. DecisionScheduler decides when a new classification is due:
+
+- hop_samples:  new samples required since the last decision
+- max_rate_hz:  upper bound on decisions per second
+- deadline_ms:  budget for one decision. When inference falls behind (a
+                backlog of unread packets, or decisions slower than the
+                budget) decisions are skipped or the hop is stretched so the
+                classifier always works on the newest window. A decision
+                still classifying when its budget (or the stretched hop,
+                if longer) runs out is dropped, not published late (late()).
+
+StageTimer collects how long each pipeline stage takes.
+"""
+
+import math
+
+
+class StageTimer:
+    """Accumulate wall time per pipeline stage"""
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self.totals = {}
+        self.counts = {}
+        self.maxima = {}
+        self.order = []
+
+    def add(self, stage, seconds):
+        if stage not in self.totals:
+            self.totals[stage] = 0.0
+            self.counts[stage] = 0
+            self.maxima[stage] = 0.0
+            self.order.append(stage)
+        self.totals[stage] += seconds
+        self.counts[stage] += 1
+        if seconds > self.maxima[stage]:
+            self.maxima[stage] = seconds
+
+    def mean_ms(self, stage):
+        if not self.counts.get(stage):
+            return 0.0
+        return 1000.0 * self.totals[stage] / self.counts[stage]
+
+    def report(self):
+        """One line per stage: calls, mean and max in ms"""
+        lines = []
+        for stage in self.order:
+            lines.append(f"  {stage:12} {self.counts[stage]:8d} calls  "
+                         f"mean {self.mean_ms(stage):7.3f} ms  max {1000.0 * self.maxima[stage]:7.3f} ms")
+        return lines
+
+
+class DecisionScheduler:
+    """Decide when the classifier should run on the sliding window"""
+
+    def __init__(self, hop_samples=5, max_rate_hz=50.0, deadline_ms=None, fs=250.0):
+        if hop_samples < 1:
+            raise ValueError("hop_samples must be >= 1")
+        self.hop_samples = hop_samples
+        self.max_rate_hz = max_rate_hz
+        self.fs = fs
+        # Default budget: one hop of real time
+        self.deadline_ms = deadline_ms if deadline_ms is not None else 1000.0 * hop_samples / fs
+
+        self.samples_since = 0
+        self.last_decision_t = None
+        self.cost_ema = 0.0            # seconds per decision
+        self.effective_hop = hop_samples
+        self._rate_limited = False
+
+        # Counters
+        self.decisions = 0
+        self.skipped_backlog = 0
+        self.skipped_rate = 0
+        self.deadline_misses = 0
+        self.late_dropped = 0
+
+    def on_samples(self, n=1):
+        self.samples_since += n
+
+    def should_decide(self, now, backlog_samples=0):
+        """
+        True if a decision is due at time `now` (perf_counter seconds).
+        backlog_samples: complete samples already received but not yet consumed.
+        """
+        if self.samples_since < self.effective_hop:
+            return False
+
+        # A newer window is already waiting: skip this one and catch up
+        if backlog_samples >= self.effective_hop:
+            self.skipped_backlog += 1
+            self.samples_since = 0
+            return False
+
+        if self.max_rate_hz and self.last_decision_t is not None:
+            if now - self.last_decision_t < 1.0 / self.max_rate_hz:
+                if not self._rate_limited:
+                    self.skipped_rate += 1
+                    self._rate_limited = True
+                return False
+
+        return True
+
+    def late(self, start, now):
+        """
+        True (and counted) if a decision that started at start is past its
+        deadline at now: its result is stale and should not be acted on.
+        While the hop is stretched the deadline is the stretched hop, so
+        only decisions slower than usual are dropped.
+        """
+        budget_ms = max(self.deadline_ms, 1000.0 * self.effective_hop / self.fs)
+        if 1000.0 * (now - start) > budget_ms:
+            self.late_dropped += 1
+            return True
+        return False
+
+    def decision_done(self, start, end):
+        """Record a decision that ran from start to end (perf_counter seconds)"""
+        cost = end - start
+        self.decisions += 1
+        self.samples_since = 0
+        self._rate_limited = False
+        self.last_decision_t = start
+        self.cost_ema = cost if self.decisions == 1 else 0.9 * self.cost_ema + 0.1 * cost
+
+        if 1000.0 * cost > self.deadline_ms:
+            self.deadline_misses += 1
+
+        # Stretch the hop while decisions cost more than a hop of real time
+        needed = int(math.ceil(self.cost_ema * self.fs))
+        self.effective_hop = max(self.hop_samples, needed)
+
+    def decision_rate(self, elapsed):
+        return self.decisions / elapsed if elapsed > 0 else 0.0
+
+    def summary(self):
+        return (f"decisions={self.decisions} hop={self.effective_hop}/{self.hop_samples} "
+                f"skipped(backlog)={self.skipped_backlog} skipped(rate)={self.skipped_rate} "
+                f"deadline_misses={self.deadline_misses} late_dropped={self.late_dropped} cost={1000.0 * self.cost_ema:.2f} ms")
@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+"""
+EMG window feature extraction shared by the classifiers
+
+feature_type values (stored in the model as 'feature_type'):
+    'default'      RMS, MAV, WL, ZC, VAR per channel      (train_model.py)
+    'MAV'          MAV, RMS, VAR per channel              (train_model_svm.py)
+    'time_domain'  MAV, RMS, WL, ZC, SSC, VAR, IEMG, WA   (train_model_lda.py)
+    'multiscale'   MAV, RMS, WL, ZC, SSC, VAR over the last 50, 100 and 200
+                   samples, per channel                  (train_model_lda.py)
+    'fused'        'time_domain' plus wrist pitch and roll (degrees) at the
+                   end of the window                     (train_model_lda.py)
+    'spectral'     'time_domain' plus MNF, MDF and the relative power of the
+                   10-30, 30-60, 60-90 and 90-125 Hz bands per channel, over
+                   the last 200 samples                  (train_model_lda.py)
+
+window_data has shape (window_size, n_channels). 'fused' also needs aux,
+the Cyton accelerometer counts of the same samples, shape (window_size, 3),
+with zero rows between readings as the board sends them.
+
+'multiscale' uses the native prefix-sum stage (q8native.MultiScaleFeatures)
+when libq8native.so is built and falls back to numpy otherwise; both give
+the same vector. 'fused' runs the native orientation filter
+(q8native.OrientationFilter) over the window's aux; the numpy fallback
+averages the window's readings instead, which agrees while the wrist is
+still but not during movement. 'spectral' uses the native sliding DFT
+(q8native.SpectralFeatures) and falls back to an FFT of the window; both
+take the Hann-windowed periodogram of the window with its mean removed (a
+shorter window padded at the front with its first sample) between 10 and
+125 Hz.
+
+augmented_features() turns whole recordings (collect_data_auto.py saves
+everything captured while a gesture was held as 'recording') into many
+training windows: one every `stride` samples plus `copies` randomly shifted,
+scaled and channel-gain jittered variants of each (q8native.Augmenter). The
+windows are generated and reduced to features one at a time, never stored.
+The numpy fallback draws the same kinds of variants from numpy's generator,
+so the augmented rows (not the plain ones) differ from the native ones.
+
+The trainers read saved samples with sample_window() / sample_capture().
+With a filter bank these filter the whole saved recording in one pass,
+starting at the pre-roll collect_data_auto.py saves ahead of the prompt,
+and then cut the window out, as classify_realtime.py filters the stream and
+then cuts windows. Filtering each window from a fresh state would leave the
+filters' start-up transient in every training window but in no live one.
+"""
+
+import os
+import sys
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import Augmenter, MultiScaleFeatures, OrientationFilter, SpectralFeatures
+except ImportError:
+    Augmenter = None
+    MultiScaleFeatures = None
+    OrientationFilter = None
+    SpectralFeatures = None
+
+MULTISCALE_WINDOWS = (50, 100, 200)
+SPECTRAL_WINDOW = 200
+SPECTRAL_FS = 250.0
+SPECTRAL_BAND_EDGES = (10.0, 30.0, 60.0, 90.0, 125.0)
+AUGMENT_DEFAULTS = {'stride': 25, 'copies': 2, 'shift': 10, 'scale': 0.2, 'gain_jitter': 0.1}
+
+FEATURE_NAMES = {
+    'default': ['RMS', 'MAV', 'WL', 'ZC', 'VAR'],
+    'MAV': ['MAV', 'RMS', 'VAR'],
+    'time_domain': ['MAV', 'RMS', 'WL', 'ZC', 'SSC', 'VAR', 'IEMG', 'WA'],
+    'multiscale': ['MAV', 'RMS', 'WL', 'ZC', 'SSC', 'VAR'],
+}
+ORIENTATION_NAMES = ['Pitch', 'Roll']
+SPECTRAL_NAMES = ['MNF', 'MDF'] + [f"BP{lo:g}_{hi:g}" for lo, hi in zip(SPECTRAL_BAND_EDGES, SPECTRAL_BAND_EDGES[1:])]
+
+# Native extractors by channel count, reused across windows
+_multiscale = {}
+_spectral = {}
+_orientation = None
+
+
+def extract_features_default(window_data):
+    """Default feature extraction (Random Forest)"""
+    features = []
+    num_channels = window_data.shape[1]
+
+    for ch in range(num_channels):
+        channel_data = window_data[:, ch]
+
+        # RMS
+        rms = np.sqrt(np.mean(channel_data**2))
+
+        # MAV
+        mav = np.mean(np.abs(channel_data))
+
+        # Waveform Length
+        wl = np.sum(np.abs(np.diff(channel_data)))
+
+        # Zero Crossings
+        zc = np.sum(np.diff(np.sign(channel_data)) != 0)
+
+        # Variance
+        var = np.var(channel_data)
+
+        features.extend([rms, mav, wl, zc, var])
+
+    return np.array(features)
+
+
+def extract_features_mav(window_data):
+    """MAV feature extraction (SVM)"""
+    features = []
+    num_channels = window_data.shape[1]
+
+    for ch in range(num_channels):
+        channel_data = window_data[:, ch]
+
+        # Mean Absolute Value
+        mav = np.mean(np.abs(channel_data))
+
+        # Root Mean Square
+        rms = np.sqrt(np.mean(channel_data**2))
+
+        # Variance
+        var = np.var(channel_data)
+
+        features.extend([mav, rms, var])
+
+    return np.array(features)
+
+
+def extract_features_time_domain(window_data):
+    """Time-domain feature extraction (LDA)"""
+    features = []
+    num_channels = window_data.shape[1]
+
+    for ch in range(num_channels):
+        channel_data = window_data[:, ch]
+
+        # MAV
+        mav = np.mean(np.abs(channel_data))
+
+        # RMS
+        rms = np.sqrt(np.mean(channel_data**2))
+
+        # Waveform Length
+        wl = np.sum(np.abs(np.diff(channel_data)))
+
+        # Zero Crossings
+        zc = np.sum(np.diff(np.sign(channel_data)) != 0)
+
+        # Slope Sign Changes
+        diff_signal = np.diff(channel_data)
+        ssc = np.sum(np.diff(np.sign(diff_signal)) != 0)
+
+        # Variance
+        var = np.var(channel_data)
+
+        # Integrated EMG
+        iemg = np.sum(np.abs(channel_data))
+
+        # Willison Amplitude
+        wa_threshold = 0.01 * np.max(np.abs(channel_data)) if np.max(np.abs(channel_data)) > 0 else 0.01
+        wa = np.sum(np.abs(np.diff(channel_data)) > wa_threshold)
+
+        features.extend([mav, rms, wl, zc, ssc, var, iemg, wa])
+
+    return np.array(features)
+
+
+def extract_features_multiscale(window_data, windows=MULTISCALE_WINDOWS):
+    """
+    Multi-scale feature extraction: the last `w` samples for each w in
+    windows (the whole window when shorter). Layout [scale][channel][feature].
+    """
+    window_data = np.asarray(window_data, dtype=np.float64)
+    num_channels = window_data.shape[1]
+
+    if MultiScaleFeatures is not None:
+        key = (num_channels, tuple(windows))
+        if key not in _multiscale:
+            _multiscale[key] = MultiScaleFeatures(num_channels, windows)
+        return _multiscale[key].extract(window_data)
+
+    features = []
+    for w in windows:
+        segment = window_data[-w:]
+        for ch in range(num_channels):
+            channel_data = segment[:, ch]
+            diff_signal = np.diff(channel_data)
+
+            mav = np.mean(np.abs(channel_data))
+            rms = np.sqrt(np.mean(channel_data**2))
+            wl = np.sum(np.abs(diff_signal))
+            zc = np.sum(np.diff(np.sign(channel_data)) != 0)
+            ssc = np.sum(np.diff(np.sign(diff_signal)) != 0)
+            var = np.var(channel_data)
+
+            features.extend([mav, rms, wl, zc, ssc, var])
+
+    return np.array(features)
+
+
+def window_orientation(aux):
+    """Wrist [pitch, roll] in degrees from a window of accelerometer counts"""
+    global _orientation
+    aux = np.asarray(aux).reshape(-1, 3)
+
+    if OrientationFilter is not None:
+        # Fresh filter per window so training and realtime see the same state
+        if _orientation is None:
+            _orientation = OrientationFilter()
+        _orientation.reset()
+        _orientation.push(aux)
+        return np.array([_orientation.pitch, _orientation.roll])
+
+    readings = aux[np.any(aux != 0, axis=1)].astype(np.float64)
+    if len(readings) == 0:
+        return np.zeros(2)
+    ax, ay, az = readings.mean(axis=0)
+    roll = np.degrees(np.arctan2(ay, az))
+    pitch = np.degrees(np.arctan2(-ax, np.sqrt(ay * ay + az * az)))
+    return np.array([pitch, roll])
+
+
+def extract_features_fused(window_data, aux):
+    """EMG time-domain features followed by the window's wrist orientation"""
+    if aux is None:
+        raise ValueError("'fused' features need the window's accelerometer readings (aux)")
+    return np.concatenate([extract_features_time_domain(window_data), window_orientation(aux)])
+
+
+def window_spectrum(window_data):
+    """
+    MNF, MDF (Hz) and relative band powers of the last SPECTRAL_WINDOW
+    samples, layout [channel][feature]
+    """
+    window_data = np.asarray(window_data, dtype=np.float64)
+    num_channels = window_data.shape[1]
+
+    if SpectralFeatures is not None:
+        if num_channels not in _spectral:
+            _spectral[num_channels] = SpectralFeatures(num_channels, SPECTRAL_WINDOW, SPECTRAL_FS,
+                                                       SPECTRAL_BAND_EDGES)
+        return _spectral[num_channels].extract(window_data)
+
+    n = SPECTRAL_WINDOW
+    segment = window_data[-n:]
+    segment = np.concatenate([np.repeat(segment[:1], n - len(segment), axis=0), segment])
+    hann = 0.5 - 0.5 * np.cos(2 * np.pi * np.arange(n) / n)
+    power = np.abs(np.fft.rfft((segment - segment.mean(axis=0)) * hann[:, None], axis=0)[1:n // 2 + 1]) ** 2
+    freqs = np.arange(1, n // 2 + 1) * SPECTRAL_FS / n
+    df = SPECTRAL_FS / n
+
+    # Only the bins inside the bands count (baseline wander below them would
+    # dominate raw counts)
+    bands = []
+    for b, (lo, hi) in enumerate(zip(SPECTRAL_BAND_EDGES, SPECTRAL_BAND_EDGES[1:])):
+        last = b == len(SPECTRAL_BAND_EDGES) - 2
+        bands.append((freqs >= lo) & ((freqs <= hi) if last else (freqs < hi)))
+    power[~np.any(bands, axis=0)] = 0.0
+
+    features = []
+    for ch in range(num_channels):
+        p = power[:, ch]
+        total = np.sum(p)
+        if not total > 0:
+            features.extend([0.0] * len(SPECTRAL_NAMES))
+            continue
+        mnf = np.sum(freqs * p) / total
+        cum = np.cumsum(p)
+        k = np.argmax(cum >= total / 2)
+        mdf = freqs[k] + df / 2 - df * (cum[k] - total / 2) / p[k]
+        features.extend([mnf, mdf] + [np.sum(p[inside]) / total for inside in bands])
+
+    return np.array(features)
+
+
+def extract_features_spectral(window_data):
+    """EMG time-domain features followed by the window's spectral features"""
+    return np.concatenate([extract_features_time_domain(window_data), window_spectrum(window_data)])
+
+
+def extract_features(window_data, feature_type='default', aux=None):
+    """Extract the feature vector the model was trained with"""
+    if feature_type == 'fused':
+        return extract_features_fused(window_data, aux)
+    elif feature_type == 'spectral':
+        return extract_features_spectral(window_data)
+    elif feature_type == 'multiscale':
+        return extract_features_multiscale(window_data)
+    elif feature_type == 'MAV':
+        return extract_features_mav(window_data)
+    elif feature_type == 'time_domain':
+        return extract_features_time_domain(window_data)
+    else:
+        return extract_features_default(window_data)
+
+
+def sample_capture(sample, filter_bank=None):
+    """
+    (data, aux) of everything captured while the gesture of a saved sample
+    was held ('recording' from its 'recording_start'; 'data' for samples
+    saved without one). With filter_bank the filters run continuously from
+    the first sample of the recording, pre-roll included. aux is None if the
+    sample has none.
+    """
+    if 'recording' in sample:
+        data = np.array(sample['recording'])
+        aux = np.array(sample['recording_aux'])
+        start = sample.get('recording_start', 0)
+    else:
+        data = np.array(sample['data'])
+        aux = np.array(sample['aux']) if 'aux' in sample else None
+        start = 0
+    if filter_bank is not None:
+        filter_bank.reset()
+        data = filter_bank.process(data)
+    return data[start:], aux[start:] if aux is not None else None
+
+
+def sample_window(sample, filter_bank=None):
+    """The saved window of a sample ('data', 'aux'), filtered as sample_capture()"""
+    n = len(sample['data'])
+    data, aux = sample_capture(sample, filter_bank)
+    return data[:n], aux[:n] if aux is not None else None
+
+
+def augment_windows(recording, aux=None, window=200, stride=25, copies=2, shift=10, scale=0.2,
+                    gain_jitter=0.1, rng=None):
+    """Numpy counterpart of q8native.Augmenter.windows(): yields (window, aux, augmented)"""
+    rng = rng if rng is not None else np.random.default_rng()
+    recording = np.asarray(recording, dtype=np.float64)
+    n = len(recording)
+    for position in range(0, n - window + 1, stride):
+        yield recording[position:position + window], aux[position:position + window] if aux is not None else None, False
+        for _ in range(copies):
+            start = min(max(position + int(rng.integers(-shift, shift + 1)), 0), n - window)
+            amp = 1.0 + scale * rng.uniform(-1.0, 1.0)
+            gain = amp * np.maximum(1.0 + gain_jitter * rng.standard_normal(recording.shape[1]), 0.0)
+            yield (recording[start:start + window] * gain,
+                   aux[start:start + window] if aux is not None else None, True)
+
+
+def augmented_features(recordings, feature_type='default', window=200, seed=0, **augment):
+    """
+    Feature vectors of the augmented windows of each (recording, aux) pair,
+    one [windows][n_features] array per recording (empty if it is shorter
+    than a window). augment: AUGMENT_DEFAULTS keys.
+    """
+    settings = dict(AUGMENT_DEFAULTS, **augment)
+    recordings = [(np.asarray(r, dtype=np.float64), np.asarray(a) if a is not None else None)
+                  for r, a in recordings]
+    if Augmenter is not None and recordings:
+        aug = Augmenter(n_channels=recordings[0][0].shape[1], window=window, feature_type=feature_type,
+                        seed=seed, **settings)
+        return [aug.features(r, a) for r, a in recordings]
+    rng = np.random.default_rng(seed)
+    return [np.array([extract_features(w, feature_type, aux=wa)
+                      for w, wa, _ in augment_windows(r, a, window, rng=rng, **settings)])
+            for r, a in recordings]
+
+
+def feature_names(feature_type='default', num_channels=4):
+    if feature_type == 'multiscale':
+        return [f"Ch{ch+1}_{feat}_{w}"
+                for w in MULTISCALE_WINDOWS
+                for ch in range(num_channels)
+                for feat in FEATURE_NAMES['multiscale']]
+    if feature_type == 'fused':
+        return feature_names('time_domain', num_channels) + ORIENTATION_NAMES
+    if feature_type == 'spectral':
+        return feature_names('time_domain', num_channels) + [
+            f"Ch{ch+1}_{feat}" for ch in range(num_channels) for feat in SPECTRAL_NAMES]
+    names = FEATURE_NAMES.get(feature_type, FEATURE_NAMES['default'])
+    return [f"Ch{ch+1}_{feat}" for ch in range(num_channels) for feat in names]
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Cascade Evaluation
+Replays labelled windows through an LDA gate and an expensive expert model
+and reports, for a range of margin thresholds, how often the cascade
+escalates, what a decision costs on average and how accurate it is
+compared with always running the expert.
+
+Usage:
+    python3 evaluate_cascade.py [gate.pkl] [expert.pkl|expert.h5] [session ...]
+
+Defaults: models/gesture_model_lda.pkl, models/gesture_model.pkl, all
+sessions. Evaluate on sessions the models were not trained on.
+"""
+
+import json
+import os
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import FilterBank
+except ImportError:
+    FilterBank = None
+
+from cascade import ModelStage, top_margin
+from emg_features import sample_window
+
+MARGINS = [0.0, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.7, 1.01]
+
+
+def load_windows(sessions, window_size=200, filter_bank=None):
+    """Labelled windows of exactly window_size samples (filtered as in training)"""
+    windows = []
+    labels = []
+    for session in sessions:
+        session_dir = os.path.join("training_data", session)
+        if not os.path.isdir(session_dir):
+            print(f"  Warning: Session '{session}' not found, skipping...")
+            continue
+        for filename in sorted(os.listdir(session_dir)):
+            if not filename.endswith('.jsonl'):
+                continue
+            with open(os.path.join(session_dir, filename), 'r') as f:
+                for line in f:
+                    sample = json.loads(line)
+                    data, _ = sample_window(sample, filter_bank)
+                    data = np.asarray(data, dtype=np.float64)
+                    if len(data) < window_size:
+                        continue
+                    windows.append(data[:window_size])
+                    labels.append(sample['gesture'])
+    return windows, np.array(labels)
+
+
+def run_stage(stage, windows):
+    """Predicted labels, top margins and mean ms per window"""
+    predictions = []
+    margins = []
+    t0 = time.perf_counter()
+    for window in windows:
+        probabilities = stage.predict_proba(window)
+        predictions.append(stage.classes[int(np.argmax(probabilities))])
+        margins.append(top_margin(probabilities))
+    elapsed = time.perf_counter() - t0
+    return np.array(predictions), np.array(margins), 1000.0 * elapsed / max(len(windows), 1)
+
+
+def main():
+    args = sys.argv[1:]
+    gate_path = args[0] if len(args) > 0 else "models/gesture_model_lda.pkl"
+    expert_path = args[1] if len(args) > 1 else "models/gesture_model.pkl"
+    sessions = args[2:]
+    if not sessions:
+        sessions = sorted(d for d in os.listdir("training_data")
+                          if os.path.isdir(os.path.join("training_data", d)))
+
+    print("=" * 70)
+    print("CASCADE EVALUATION")
+    print("=" * 70)
+
+    gate = ModelStage(gate_path)
+    expert = ModelStage(expert_path)
+    print(f"\nGate:   {gate_path} ({gate.method})")
+    print(f"Expert: {expert_path} ({expert.method})")
+    print(f"Sessions: {', '.join(sessions)}")
+
+    if (gate.filter_config or None) != (expert.filter_config or None):
+        print("\n✗ Gate and expert were trained with different filter settings")
+        return
+
+    filter_bank = None
+    if gate.filter_config:
+        if FilterBank is None:
+            print("\n✗ Models expect filtered input but libq8native.so is not built (make -C native)")
+            return
+        filter_bank = FilterBank(n_channels=4, config=gate.filter_config)
+
+    windows, y = load_windows(sessions, filter_bank=filter_bank)
+    if not windows:
+        print("\n✗ No windows found!")
+        return
+    print(f"Windows: {len(windows)}")
+
+    gate_pred, gate_margin, gate_ms = run_stage(gate, windows)
+    expert_pred, _, expert_ms = run_stage(expert, windows)
+
+    gate_acc = np.mean(gate_pred == y)
+    expert_acc = np.mean(expert_pred == y)
+
+    print("\n" + "=" * 70)
+    print("RESULTS")
+    print("=" * 70)
+    print(f"\nGate only:   accuracy {gate_acc:.3f}  cost {gate_ms:6.2f} ms/decision")
+    print(f"Expert only: accuracy {expert_acc:.3f}  cost {expert_ms:6.2f} ms/decision")
+    print()
+    print(f"{'margin':>7} {'escalated':>10} {'cost':>10} {'accuracy':>9} {'vs expert':>10} {'agreement':>10}")
+
+    best = None
+    for margin in MARGINS:
+        escalate = gate_margin < margin
+        pred = np.where(escalate, expert_pred, gate_pred)
+        rate = np.mean(escalate)
+        cost = gate_ms + rate * expert_ms
+        acc = np.mean(pred == y)
+        agreement = np.mean(pred == expert_pred)
+        label = "always" if margin > 1.0 else f"{margin:.2f}"
+        print(f"{label:>7} {100 * rate:9.1f}% {cost:8.2f}ms {acc:9.3f} {acc - expert_acc:+10.3f} {100 * agreement:9.1f}%")
+        if best is None and acc >= expert_acc - 0.01:
+            best = margin
+
+    print()
+    if best is not None and best <= 1.0:
+        print(f"Suggested margin: {best:.2f} (within 1% of the expert at lower cost)")
+    else:
+        print("The gate needs the expert on every window to stay within 1% of its accuracy")
+    print("Use it with classify_realtime.py: pick the expert model, then the gate model and margin")
+
+
+if __name__ == "__main__":
+    main()
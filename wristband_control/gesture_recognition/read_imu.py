@@ -1,6 +1,10 @@
 #!/usr/bin/env python3
 """
 Read IMU data from OpenBCI Cyton board and display yaw, pitch, roll
+
+This opens the dongle on its own. To see orientation while classifying
+gestures, use classify_realtime.py: it decodes the accelerometer from the
+same packets and shows wrist pitch/roll on its status screen.
 """
 
 import serial
@@ -8,6 +12,14 @@ import serial.tools.list_ports
 import time
 import numpy as np
 import math
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import CytonDecoder
+except ImportError:
+    CytonDecoder = None
 
 class IMUReader:
     def __init__(self):
@@ -25,6 +37,9 @@ class IMUReader:
         self.end_byte = 0xC0
         self.packet_buffer = bytearray()
 
+        # Native single-pass decoder (libq8native.so): channels and aux together
+        self.decoder = CytonDecoder() if CytonDecoder is not None else None
+
         # IMU data
         self.accel_x = 0
         self.accel_y = 0
@@ -40,6 +55,10 @@ class IMUReader:
 
     def find_port(self):
         """Find OpenBCI port"""
+        # Explicit port, e.g. the native/cyton_emu pseudo-terminal
+        if os.environ.get('OPENBCI_PORT'):
+            return os.environ['OPENBCI_PORT']
+
         ports = list(serial.tools.list_ports.comports())
         available = [p for p in ports if p.device not in self.EXCLUDED_PORTS]
 
@@ -144,6 +163,13 @@ class IMUReader:
         packets = []
 
         try:
+            if self.decoder is not None:
+                if self.ser.in_waiting > 0:
+                    for frame in self.decoder.decode(self.ser.read(self.ser.in_waiting)):
+                        packets.append({'channels': frame['channels'].tolist(),
+                                        'aux': frame['accel'].tolist()})
+                return packets
+
             if self.ser.in_waiting > 0:
                 data = self.ser.read(self.ser.in_waiting)
                 self.packet_buffer.extend(data)
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+Session Replay
+Feeds a raw Cyton log (recorded with Q8_RECORD=dir by classify_realtime.py
+or collect_data_auto.py) through the real-time classifier: frame parser,
+filters, features, classifier and smoothing, exactly as they run live.
+
+Usage:
+    python3 replay.py SESSION_DIR [--model PATH] [--hop N] [--realtime]
+                      [--out decisions.csv] [--diff other.csv]
+
+As fast as possible (default) the pipeline runs on the recorded clock: the
+scheduler and the decision stage see each frame's arrival time, so the same
+log always gives the same decisions and two pipeline versions can be
+diffed with --out / --diff. --realtime paces the chunks as they arrived and
+runs on the wall clock, like a live session (decisions then depend on how
+fast this machine is).
+
+Reports throughput, per-stage timing and the decisions; with the
+collect_data_auto.py markers, also agreement with the prompted gesture.
+--model / --hop default to what the recording session used.
+"""
+
+import argparse
+import csv
+import os
+import sys
+import time
+from collections import Counter
+from types import SimpleNamespace
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import CytonLog, CytonDecoder, CYTON_LOG_DATA
+except ImportError:
+    CytonLog = None
+
+from classify_realtime import RealtimeGestureClassifier
+
+
+def session_settings(directory):
+    """'model' / 'hop' markers written before the first stream bytes"""
+    settings = {}
+    log = CytonLog(directory)
+    for _, kind, payload in log:
+        if kind == CYTON_LOG_DATA:
+            break
+        key, _, value = payload.decode(errors='replace').partition(' ')
+        settings[key] = value
+    log.close()
+    return settings
+
+
+def replay(clf, directory, realtime=False):
+    """Run the log through clf; returns (decisions, report dict)"""
+    log = CytonLog(directory)
+    decoder = CytonDecoder()
+
+    # The batch the frames came in is the backlog the scheduler sees, as
+    # with the native reader; nothing is ever pending beyond it
+    clf.consumer = SimpleNamespace(pending=0)
+    if not realtime:
+        clf.clock = lambda: clf.frame_t_ns / 1e9
+
+    decisions = []
+    label = None
+    t_first = None
+    clf.on_decision = lambda gesture, confidence: decisions.append(
+        (clf.frame_seq, (clf.frame_t_ns - t_first) / 1e6, str(gesture), float(confidence), label))
+
+    chunks = 0
+    marks = 0
+    t_last = None
+    wall0 = time.perf_counter()
+    for t_ns, kind, payload in log:
+        if t_first is None:
+            t_first = t_ns
+        t_last = t_ns
+        if kind != CYTON_LOG_DATA:
+            marks += 1
+            text = payload.decode(errors='replace')
+            if text.startswith('collect '):
+                label = text.split(' ', 1)[1]
+            elif text in ('end', 'rest') or text.startswith('prompt '):
+                label = None
+            continue
+
+        chunks += 1
+        if realtime:
+            delay = wall0 + (t_ns - t_first) / 1e9 - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            t_ns = time.monotonic_ns()
+        clf.process_frames(decoder.decode(payload, t_ns))
+    wall = time.perf_counter() - wall0
+
+    report = {
+        'chunks': chunks,
+        'marks': marks,
+        'frames': decoder.frames,
+        'resync_bytes': decoder.resync_bytes,
+        'recorded_s': (t_last - t_first) / 1e9 if t_first is not None else 0.0,
+        'wall_s': wall,
+        'segments': log.segments,
+        'truncated': log.truncated,
+    }
+    log.close()
+    return decisions, report
+
+
+def write_decisions(path, decisions):
+    with open(path, 'w', newline='') as f:
+        out = csv.writer(f)
+        out.writerow(['seq', 't_ms', 'gesture', 'confidence'])
+        for seq, t_ms, gesture, confidence, _ in decisions:
+            out.writerow([seq, f"{t_ms:.3f}", gesture, f"{confidence:.6f}"])
+
+
+def read_decisions(path):
+    with open(path, newline='') as f:
+        return [(int(row['seq']), row['gesture']) for row in csv.DictReader(f)]
+
+
+def held(decisions, frames):
+    """Gesture in effect at each of frames (sorted): the latest decision at or before it"""
+    out, k, current = [], 0, None
+    for seq in frames:
+        while k < len(decisions) and decisions[k][0] <= seq:
+            current = decisions[k][1]
+            k += 1
+        out.append(current)
+    return out
+
+
+def diff_decisions(decisions, path):
+    """
+    Compare with a decisions file from another run on the same log: at every
+    frame where either run decided, is the gesture in effect the same?
+    """
+    ours = [(seq, gesture) for seq, _, gesture, _, _ in decisions]
+    other = read_decisions(path)
+    frames = sorted({seq for seq, _ in ours} | {seq for seq, _ in other})
+    a, b = held(ours, frames), held(other, frames)
+    same_frames = len({seq for seq, _ in ours} & {seq for seq, _ in other})
+    agree = sum(x == y for x, y in zip(a, b))
+    print(f"\nDiff against {path}:")
+    print(f"  decisions: {len(ours)} here, {len(other)} there, {same_frames} at the same frames")
+    if frames:
+        print(f"  same gesture in effect: {agree}/{len(frames)} decision points ({100.0 * agree / len(frames):.1f}%)")
+    for seq, x, y in zip(frames, a, b):
+        if x != y:
+            print(f"  first divergence: frame {seq}: {x} here, {y} there")
+            break
+    else:
+        if len(ours) == len(other) == same_frames:
+            print("  identical")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Replay a raw Cyton log through the real-time classifier")
+    parser.add_argument('session', help="log directory (Q8_RECORD=dir)")
+    parser.add_argument('--model', help="model to run (default: the one the session used)")
+    parser.add_argument('--gate', help="LDA gate model: run as a cascade")
+    parser.add_argument('--margin', type=float, default=0.2, help="cascade escalation margin")
+    parser.add_argument('--hop', type=int, help="decision hop in samples (default: the session's, else 5)")
+    parser.add_argument('--realtime', action='store_true', help="pace the stream as recorded")
+    parser.add_argument('--out', help="write decisions (seq, t_ms, gesture, confidence) as CSV")
+    parser.add_argument('--diff', help="compare with a decisions CSV from another run")
+    args = parser.parse_args()
+
+    if CytonLog is None:
+        print("Replay needs libq8native.so. Build it with: make -C native")
+        sys.exit(1)
+
+    settings = session_settings(args.session)
+    model_path = args.model or settings.get('model')
+    if not model_path:
+        print("The session did not record its model; give one with --model")
+        sys.exit(1)
+    hop = args.hop or int(settings.get('hop', 5))
+
+    clf = RealtimeGestureClassifier(model_path=model_path, hop_samples=hop,
+                                    gate_model_path=args.gate, cascade_margin=args.margin)
+    decisions, report = replay(clf, args.session, realtime=args.realtime)
+
+    wall = report['wall_s']
+    print(f"\nReplayed {args.session} ({'real time' if args.realtime else 'as fast as possible'})")
+    print(f"  Log: {report['chunks']} chunks, {report['marks']} markers in {report['segments']} segments, "
+          f"{report['truncated']} truncated records")
+    print(f"  Stream: {report['frames']} frames, {report['resync_bytes']} resync bytes, "
+          f"{report['recorded_s']:.1f} s recorded")
+    if wall > 0:
+        print(f"  Throughput: {report['frames'] / wall:.0f} samples/s in {wall:.2f} s "
+              f"({report['recorded_s'] / wall:.1f}x real time)")
+    print(f"  Decisions: {len(decisions)}; {Counter(d[2] for d in decisions).most_common()}")
+    print(f"  Scheduler: {clf.scheduler.summary()}")
+    print("  Stage timing:")
+    for line in clf.timer.report():
+        print(line)
+    if clf.cascade is not None:
+        print(f"  Cascade: {clf.cascade.summary()}")
+
+    labelled = [(d[2], d[4]) for d in decisions if d[4] is not None]
+    if labelled:
+        print("  Agreement with the prompted gesture:")
+        for name in sorted({lbl for _, lbl in labelled}):
+            hits = [g == name for g, lbl in labelled if lbl == name]
+            print(f"    {name:12} {sum(hits):6d}/{len(hits):<6d} {100.0 * sum(hits) / len(hits):5.1f}%")
+
+    if args.out:
+        write_decisions(args.out, decisions)
+        print(f"\nDecisions: {args.out}")
+    if args.diff:
+        diff_decisions(decisions, args.diff)
+
+
+if __name__ == "__main__":
+    main()
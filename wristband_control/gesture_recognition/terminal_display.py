@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Terminal rendering off the acquisition thread
+
+Clearing the screen and reprinting a 30-line status block on the thread
+that reads the Cyton blocks that thread whenever the terminal is slow (SSH,
+a busy console): serial input backs up and decisions run late.
+
+TerminalDisplay moves the work to a low-priority background thread:
+
+- the acquisition loop hands over a snapshot (a plain dict of values) with
+  update(); that is all it pays
+- the render thread turns the newest snapshot into lines at most once per
+  interval and rewrites only the lines that changed, with cursor
+  addressing, in a single write()
+
+StallCounter counts reads that find the input already backed up, so the
+difference is measurable: Q8_DISPLAY=inline renders on the acquisition
+thread with a full redraw, as before.
+"""
+
+import os
+import sys
+import threading
+import time
+
+
+def display_threaded():
+    """False when Q8_DISPLAY=inline asks for the old synchronous redraw"""
+    return os.environ.get('Q8_DISPLAY', 'thread') != 'inline'
+
+
+class StallCounter:
+    """
+    Acquisition stalls: reads that find more than `threshold` samples
+    already waiting, i.e. the loop was away for more than threshold / fs.
+    One stall is counted per episode, until the backlog drains again.
+    """
+
+    def __init__(self, threshold=5, fs=250.0):
+        self.threshold = threshold
+        self.fs = fs
+        self.reads = 0
+        self.stalls = 0
+        self.max_backlog = 0
+        self._stalled = False
+
+    def check(self, backlog):
+        """Call with the number of samples waiting just before a read"""
+        self.reads += 1
+        if backlog > self.max_backlog:
+            self.max_backlog = backlog
+        if backlog > self.threshold:
+            if not self._stalled:
+                self.stalls += 1
+            self._stalled = True
+        else:
+            self._stalled = False
+
+    def summary(self):
+        return (f"{self.stalls} stalls (> {self.threshold} samples = "
+                f"{1000.0 * self.threshold / self.fs:.0f} ms waiting) in {self.reads} reads, "
+                f"max backlog {self.max_backlog} samples")
+
+
+class TerminalDisplay:
+    """
+    Redraw a block of lines from the top of the terminal.
+
+    render(snapshot) -> list of str is called on the render thread (or on
+    the caller's thread when threaded=False) with the latest snapshot
+    passed to update(). Snapshots must not be modified after update().
+    """
+
+    def __init__(self, render, interval=0.1, threaded=True, out=None):
+        self.render = render
+        self.interval = interval
+        self.threaded = threaded
+        self.fd = (out or sys.stdout).fileno()
+
+        self._snapshot = None
+        self._version = 0
+        self._drawn_version = 0
+        self._lines = None           # what is on screen now
+        self._stop = threading.Event()
+        self._thread = None
+
+        # Counters
+        self.redraws = 0
+        self.lines_written = 0
+        self.bytes_written = 0
+        self.render_time = 0.0       # seconds spent rendering and writing
+
+    def start(self):
+        if self.threaded and self._thread is None:
+            self._stop.clear()
+            self._thread = threading.Thread(target=self._run, name="display", daemon=True)
+            self._thread.start()
+
+    def stop(self):
+        """Stop the render thread and leave the cursor below the block"""
+        if self._thread is not None:
+            self._stop.set()
+            self._thread.join()
+            self._thread = None
+        if self._lines is not None:
+            self._write(f"\033[{len(self._lines) + 1};1H")
+            self._lines = None
+
+    def update(self, snapshot):
+        """Hand over new state; drawn by the render thread within one interval"""
+        self._snapshot = snapshot
+        self._version += 1
+        if not self.threaded:
+            self._draw(full=True)
+
+    def summary(self):
+        mode = "render thread" if self.threaded else "inline"
+        mean_ms = 1000.0 * self.render_time / self.redraws if self.redraws else 0.0
+        return (f"{mode}, {self.redraws} redraws, {self.lines_written} lines / "
+                f"{self.bytes_written} bytes written, {mean_ms:.2f} ms per redraw")
+
+    def _run(self):
+        # Lowest priority for this thread only (Linux: per-thread nice value)
+        try:
+            os.setpriority(os.PRIO_PROCESS, threading.get_native_id(), 19)
+        except (AttributeError, OSError):
+            pass
+
+        while not self._stop.wait(self.interval):
+            if self._version != self._drawn_version:
+                self._draw()
+
+    def _draw(self, full=False):
+        t0 = time.perf_counter()
+        version = self._version
+        lines = self.render(self._snapshot)
+
+        if full or self._lines is None:
+            parts = ["\033[2J\033[H", "\n".join(lines)]
+            changed = len(lines)
+        else:
+            parts = []
+            for row, line in enumerate(lines):
+                if row >= len(self._lines) or self._lines[row] != line:
+                    parts.append(f"\033[{row + 1};1H{line}\033[K")
+            changed = len(parts)
+            if len(lines) < len(self._lines):
+                parts.append(f"\033[{len(lines) + 1};1H\033[J")
+            # Park the cursor under the block
+            parts.append(f"\033[{len(lines) + 1};1H")
+
+        self._write("".join(parts))
+        self._lines = lines
+        self._drawn_version = version
+        self.redraws += 1
+        self.lines_written += changed
+        self.render_time += time.perf_counter() - t0
+
+    def _write(self, text):
+        data = text.encode('utf-8')
+        self.bytes_written += len(data)
+        while data:
+            try:
+                n = os.write(self.fd, data)
+            except InterruptedError:
+                continue
+            data = data[n:]
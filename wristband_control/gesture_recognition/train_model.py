@@ -11,16 +11,34 @@ from sklearn.ensemble import RandomForestClassifier
 from sklearn.model_selection import train_test_split, cross_val_score
 from sklearn.metrics import classification_report, confusion_matrix
 import joblib
+import sys
 from datetime import datetime
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import FilterBank
+except ImportError:
+    FilterBank = None
+
+from emg_features import sample_window
+
 class GestureModelTrainer:
-    def __init__(self, sessions=None):
+    def __init__(self, sessions=None, filter_config=None):
         self.sessions = sessions if sessions else []
         self.model = None
         self.gesture_labels = []
         self.X = None
         self.y = None
 
+        # Optional band-pass/notch filter run over each recording before its
+        # window is cut (saved with the model so classify_realtime matches)
+        self.filter_config = filter_config
+        self.filter_bank = None
+        if filter_config:
+            if FilterBank is None:
+                raise ImportError("Filtering needs libq8native.so. Build it with: make -C native")
+            self.filter_bank = FilterBank(n_channels=4, config=filter_config)
+
     def extract_features(self, window_data):
         """
         Extract time-domain features from EMG window
@@ -87,7 +105,8 @@ class GestureModelTrainer:
                         count = 0
                         for line in f:
                             sample = json.loads(line)
-                            all_samples.append(np.array(sample['data']))
+                            window, _ = sample_window(sample, self.filter_bank)
+                            all_samples.append(window)
                             all_labels.append(sample['gesture'])
                             count += 1
 
@@ -218,7 +237,8 @@ class GestureModelTrainer:
             ],
             'gestures': sorted(set(self.y)),
             'training_date': datetime.now().isoformat(),
-            'n_samples': len(self.y)
+            'n_samples': len(self.y),
+            'filter': self.filter_bank.config if self.filter_bank else None
         }
 
         joblib.dump(model_data, output_path)
@@ -313,9 +333,16 @@ def main():
     print()
     print(f"Training on {len(selected_sessions)} session(s): {', '.join(selected_sessions)}")
     print()
+    filter_config = None
+    if FilterBank is not None:
+        answer = input("Apply band-pass + 60 Hz notch filter before feature extraction? (y/N): ").strip().lower()
+        if answer == 'y':
+            filter_config = dict(FilterBank.DEFAULTS)
+        print()
+
     input("Press Enter to begin training...")
 
-    trainer = GestureModelTrainer(sessions=selected_sessions)
+    trainer = GestureModelTrainer(sessions=selected_sessions, filter_config=filter_config)
     trainer.run()
 
 if __name__ == "__main__":
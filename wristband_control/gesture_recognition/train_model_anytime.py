@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+EMG Gesture Model Trainer - Anytime (early decision) classification
+Trains one model per window length so the realtime classifier can commit
+to a gesture after 50/100/150 samples instead of always waiting for 200,
+and reports the latency/accuracy trade-off on held-out windows
+"""
+
+import json
+import os
+import numpy as np
+from sklearn.discriminant_analysis import LinearDiscriminantAnalysis
+from sklearn.ensemble import RandomForestClassifier
+from sklearn.preprocessing import StandardScaler
+from sklearn.model_selection import train_test_split
+import joblib
+from datetime import datetime
+
+from anytime import tradeoff_curve
+from emg_features import extract_features, feature_names
+
+SAMPLE_RATE = 250.0
+
+
+class AnytimeGestureTrainer:
+    def __init__(self, sessions=None, prefixes=(50, 100, 150, 200), method='lda',
+                 feature_type='time_domain', max_accuracy_drop=0.02):
+        self.sessions = sessions if sessions else []
+        self.prefixes = sorted(prefixes)
+        self.method = method
+        self.feature_type = feature_type
+        self.max_accuracy_drop = max_accuracy_drop
+
+        self.windows = None
+        self.y = None
+        self.models = {}
+        self.curve = []
+        self.threshold = None
+
+    def make_model(self):
+        if self.method == 'rf':
+            return RandomForestClassifier(
+                n_estimators=100,
+                max_depth=10,
+                min_samples_split=5,
+                min_samples_leaf=2,
+                random_state=42,
+                n_jobs=-1
+            ), None
+        return LinearDiscriminantAnalysis(solver='svd'), StandardScaler()
+
+    def load_data(self):
+        """Load all collected gesture windows from selected sessions"""
+        print("Loading data...")
+        print(f"Sessions: {', '.join(self.sessions)}")
+        print()
+
+        all_samples = []
+        all_labels = []
+        too_short = 0
+        full = self.prefixes[-1]
+
+        for session in self.sessions:
+            session_dir = os.path.join("training_data", session)
+
+            if not os.path.exists(session_dir):
+                print(f"  Warning: Session '{session}' not found, skipping...")
+                continue
+
+            print(f"  Session: {session}")
+
+            for filename in os.listdir(session_dir):
+                if filename.endswith('.jsonl'):
+                    filepath = os.path.join(session_dir, filename)
+                    gesture_name = filename.replace('.jsonl', '')
+
+                    with open(filepath, 'r') as f:
+                        count = 0
+                        for line in f:
+                            sample = json.loads(line)
+                            data = np.array(sample['data'])
+                            if len(data) < full:
+                                too_short += 1
+                                continue
+                            all_samples.append(data[:full])
+                            all_labels.append(sample['gesture'])
+                            count += 1
+
+                    if count > 0:
+                        print(f"    {gesture_name}: {count} samples")
+
+        if not all_samples:
+            raise ValueError("No data found! Run collect_data_auto.py or collect_data.py first.")
+        if too_short:
+            print(f"\n  Skipped {too_short} windows shorter than {full} samples")
+
+        self.windows = np.array(all_samples)
+        self.y = np.array(all_labels)
+        print(f"\nTotal samples loaded: {len(self.y)}")
+
+    def prefix_features(self, windows, prefix):
+        """Features of the first `prefix` samples of each window (gesture onset)"""
+        return np.array([extract_features(w[:prefix], self.feature_type) for w in windows])
+
+    def train(self):
+        """Train one model per window length and evaluate the trade-off"""
+        print("\n" + "=" * 70)
+        print(f"Training Anytime Classifier ({self.method.upper()}, prefixes {self.prefixes})")
+        print("=" * 70)
+
+        idx = np.arange(len(self.y))
+        train_idx, test_idx = train_test_split(
+            idx, test_size=0.2, random_state=42, stratify=self.y
+        )
+        y_train, y_test = self.y[train_idx], self.y[test_idx]
+
+        print(f"\nTraining set: {len(train_idx)} samples")
+        print(f"Test set: {len(test_idx)} samples")
+
+        probas = {}
+        print("\nPer-window-length accuracy:")
+        for prefix in self.prefixes:
+            X_train = self.prefix_features(self.windows[train_idx], prefix)
+            X_test = self.prefix_features(self.windows[test_idx], prefix)
+
+            model, scaler = self.make_model()
+            if scaler is not None:
+                X_train = scaler.fit_transform(X_train)
+                X_test = scaler.transform(X_test)
+            model.fit(X_train, y_train)
+
+            self.models[prefix] = {'model': model, 'scaler': scaler}
+            probas[prefix] = (model.classes_, model.predict_proba(X_test))
+
+            acc = model.score(X_test, y_test)
+            print(f"  {prefix:4d} samples ({1000.0 * prefix / SAMPLE_RATE:5.0f} ms): {acc:.3f}")
+
+        thresholds = [0.5, 0.6, 0.7, 0.8, 0.9, 0.95, 0.99, 1.01]
+        self.curve = tradeoff_curve(probas, y_test, self.prefixes, thresholds, fs=SAMPLE_RATE)
+
+        # Fastest threshold whose accuracy stays close to full-window accuracy
+        full_acc = self.curve[-1]['accuracy']
+        self.threshold = thresholds[-2]
+        for point in self.curve:
+            if point['accuracy'] >= full_acc - self.max_accuracy_drop:
+                self.threshold = point['threshold']
+                break
+
+        print("\n" + "=" * 70)
+        print("Latency / Accuracy Trade-off (held-out windows)")
+        print("=" * 70)
+        print(f"\n{'threshold':>10} {'latency':>10} {'accuracy':>9}   commits per window length")
+        for point in self.curve:
+            label = "full" if point['threshold'] > 1.0 else f"{point['threshold']:.2f}"
+            commits = " ".join(f"{p}:{n}" for p, n in point['commits'].items())
+            marker = "  <- selected" if point['threshold'] == self.threshold else ""
+            print(f"{label:>10} {point['latency_ms']:8.0f}ms {point['accuracy']:9.3f}   {commits}{marker}")
+
+        # Refit on all data for deployment
+        for prefix in self.prefixes:
+            X = self.prefix_features(self.windows, prefix)
+            model, scaler = self.make_model()
+            if scaler is not None:
+                X = scaler.fit_transform(X)
+            model.fit(X, self.y)
+            self.models[prefix] = {'model': model, 'scaler': scaler}
+
+    def save_model(self, output_path="models/gesture_model_anytime.pkl"):
+        """Save per-window-length models"""
+        os.makedirs(os.path.dirname(output_path), exist_ok=True)
+
+        full = self.models[self.prefixes[-1]]
+        model_data = {
+            # Full-window model, so the file also works as a regular model
+            'model': full['model'],
+            'scaler': full['scaler'],
+            'feature_names': feature_names(self.feature_type),
+            'gestures': sorted(set(self.y)),
+            'training_date': datetime.now().isoformat(),
+            'n_samples': len(self.y),
+            'method': f"Anytime {self.method.upper()} ({'/'.join(str(p) for p in self.prefixes)} samples)",
+            'feature_type': self.feature_type,
+            'anytime': {
+                'prefixes': list(self.prefixes),
+                'models': self.models,
+                'threshold': self.threshold,
+                'tradeoff': self.curve,
+            }
+        }
+
+        joblib.dump(model_data, output_path)
+        print(f"\n✓ Model saved to {output_path}")
+        print(f"  Confidence threshold: {self.threshold:.2f}")
+
+    def run(self):
+        """Run complete training pipeline"""
+        print("=" * 70)
+        print("EMG Gesture Recognition - Anytime Training")
+        print("=" * 70)
+        print()
+
+        try:
+            self.load_data()
+            self.train()
+            self.save_model()
+
+            print("\n" + "=" * 70)
+            print("✓ Training Complete!")
+            print("=" * 70)
+            print("\nUse this model with classify_realtime.py for early decisions")
+
+        except Exception as e:
+            print(f"\n✗ Error: {e}")
+            import traceback
+            traceback.print_exc()
+
+def main():
+    print("=" * 70)
+    print("EMG Gesture Recognition - Anytime Training")
+    print("=" * 70)
+    print()
+
+    # List available sessions
+    training_data_dir = "training_data"
+    if not os.path.exists(training_data_dir):
+        print("Error: No training data directory found!")
+        print("Run collect_data_auto.py or collect_data.py first.")
+        return
+
+    available_sessions = [d for d in os.listdir(training_data_dir)
+                         if os.path.isdir(os.path.join(training_data_dir, d))]
+
+    if not available_sessions:
+        print("Error: No sessions found!")
+        print("Run collect_data_auto.py or collect_data.py first.")
+        return
+
+    print("Available sessions:")
+    print()
+
+    session_info_list = []
+    for i, session in enumerate(sorted(available_sessions), 1):
+        session_info_file = os.path.join(training_data_dir, session, "session_info.json")
+        if os.path.exists(session_info_file):
+            with open(session_info_file, 'r') as f:
+                info = json.load(f)
+                print(f"  [{i}] {session}")
+                print(f"      Samples: {info['total_samples']} | Date: {info['collection_date'][:10]}")
+                session_info_list.append((session, info))
+        else:
+            print(f"  [{i}] {session} (no info available)")
+            session_info_list.append((session, None))
+        print()
+
+    print(f"  [a] All sessions ({len(available_sessions)} total)")
+    print()
+    print("=" * 70)
+    print()
+
+    # Get user selection
+    choice = input("Select session(s) to train on (number, 'a' for all, or comma-separated): ").strip().lower()
+
+    selected_sessions = []
+
+    if choice == 'a':
+        selected_sessions = [s[0] for s in session_info_list]
+    elif ',' in choice:
+        indices = [int(x.strip()) - 1 for x in choice.split(',') if x.strip().isdigit()]
+        selected_sessions = [session_info_list[i][0] for i in indices if 0 <= i < len(session_info_list)]
+    elif choice.isdigit():
+        idx = int(choice) - 1
+        if 0 <= idx < len(session_info_list):
+            selected_sessions = [session_info_list[idx][0]]
+
+    if not selected_sessions:
+        print("Error: Invalid selection!")
+        return
+
+    print()
+    print(f"Training on {len(selected_sessions)} session(s): {', '.join(selected_sessions)}")
+    print()
+    method = input("Model per window length: [1] LDA (default) [2] Random Forest: ").strip()
+    method = 'rf' if method == '2' else 'lda'
+    feature_type = 'default' if method == 'rf' else 'time_domain'
+    print()
+    input("Press Enter to begin training...")
+
+    trainer = AnytimeGestureTrainer(sessions=selected_sessions, method=method, feature_type=feature_type)
+    trainer.run()
+
+if __name__ == "__main__":
+    main()
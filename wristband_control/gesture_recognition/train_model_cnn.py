@@ -12,8 +12,17 @@ from sklearn.model_selection import train_test_split
 from sklearn.preprocessing import LabelEncoder
 from sklearn.metrics import classification_report, confusion_matrix
 import joblib
+import sys
 from datetime import datetime
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import FilterBank
+except ImportError:
+    FilterBank = None
+
+from emg_features import sample_window
+
 # Check if TensorFlow is available
 try:
     import tensorflow as tf
@@ -26,7 +35,7 @@ except ImportError:
     print("Warning: TensorFlow not installed. Install with: pip install tensorflow")
 
 class CNNGestureTrainer:
-    def __init__(self, sessions=None):
+    def __init__(self, sessions=None, filter_config=None):
         if not TENSORFLOW_AVAILABLE:
             raise ImportError("TensorFlow is required for CNN training. Install with: pip install tensorflow")
 
@@ -36,6 +45,16 @@ class CNNGestureTrainer:
         self.X = None
         self.y = None
 
+        # Optional band-pass/notch filter run over each recording before its
+        # window is cut (saved with the model: a cascade's gate and expert
+        # must use the same one)
+        self.filter_config = filter_config
+        self.filter_bank = None
+        if filter_config:
+            if FilterBank is None:
+                raise ImportError("Filtering needs libq8native.so. Build it with: make -C native")
+            self.filter_bank = FilterBank(n_channels=4, config=filter_config)
+
     def load_data(self):
         """Load all collected gesture data from selected sessions"""
         print("Loading data...")
@@ -63,7 +82,8 @@ class CNNGestureTrainer:
                         count = 0
                         for line in f:
                             sample = json.loads(line)
-                            all_samples.append(np.array(sample['data']))
+                            window, _ = sample_window(sample, self.filter_bank)
+                            all_samples.append(window)
                             all_labels.append(sample['gesture'])
                             count += 1
 
@@ -264,6 +284,7 @@ class CNNGestureTrainer:
             'n_samples': len(self.y),
             'method': 'CNN with raw signal processing',
             'input_shape': self.X.shape[1:],
+            'filter': self.filter_bank.config if self.filter_bank else None,
             'feature_type': 'raw'
         }
 
@@ -381,9 +402,16 @@ def main():
     batch_size = int(batch_input) if batch_input.isdigit() else 32
 
     print()
+    filter_config = None
+    if FilterBank is not None:
+        answer = input("Apply band-pass + 60 Hz notch filter before training? (y/N): ").strip().lower()
+        if answer == 'y':
+            filter_config = dict(FilterBank.DEFAULTS)
+        print()
+
     input("Press Enter to begin training...")
 
-    trainer = CNNGestureTrainer(sessions=selected_sessions)
+    trainer = CNNGestureTrainer(sessions=selected_sessions, filter_config=filter_config)
     trainer.run(epochs=epochs, batch_size=batch_size)
 
 if __name__ == "__main__":
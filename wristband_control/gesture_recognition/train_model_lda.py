@@ -13,17 +13,42 @@ from sklearn.preprocessing import StandardScaler
 from sklearn.model_selection import train_test_split, cross_val_score
 from sklearn.metrics import classification_report, confusion_matrix
 import joblib
+import sys
 from datetime import datetime
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import FilterBank
+except ImportError:
+    FilterBank = None
+
+from emg_features import (extract_features, feature_names, augmented_features, sample_capture,
+                          AUGMENT_DEFAULTS, MULTISCALE_WINDOWS, SPECTRAL_NAMES)
+
 class LDAGestureTrainer:
-    def __init__(self, sessions=None):
+    def __init__(self, sessions=None, filter_config=None, feature_type='time_domain', augment=None):
         self.sessions = sessions if sessions else []
+        self.feature_type = feature_type
+        # Training windows cut from each sample's whole recording
+        # (AUGMENT_DEFAULTS keys), or None for one window per sample
+        self.augment = augment
+        self.recordings = []
+        self.WINDOW_SIZE = 200  # window of the realtime classifier
         self.model = None
         self.scaler = StandardScaler()
         self.gesture_labels = []
         self.X = None
         self.y = None
 
+        # Optional band-pass/notch filter run over each recording before its
+        # window is cut (saved with the model so classify_realtime matches)
+        self.filter_config = filter_config
+        self.filter_bank = None
+        if filter_config:
+            if FilterBank is None:
+                raise ImportError("Filtering needs libq8native.so. Build it with: make -C native")
+            self.filter_bank = FilterBank(n_channels=4, config=filter_config)
+
     def extract_features_time_domain(self, window_data):
         """
         Extract comprehensive time-domain features
@@ -83,6 +108,8 @@ class LDAGestureTrainer:
 
         all_samples = []
         all_labels = []
+        all_aux = []
+        skipped = 0
 
         for session in self.sessions:
             session_dir = os.path.join("training_data", session)
@@ -102,23 +129,48 @@ class LDAGestureTrainer:
                         count = 0
                         for line in f:
                             sample = json.loads(line)
-                            all_samples.append(np.array(sample['data']))
+                            if self.feature_type == 'fused' and 'aux' not in sample:
+                                # Recorded without accelerometer data
+                                skipped += 1
+                                continue
+                            # Older sessions saved the whole capture as 'data'
+                            data, aux = sample_capture(sample, self.filter_bank)
+                            self.recordings.append((data, aux))
+                            # The saved window (as long as the augmented
+                            # ones when augmenting)
+                            n = self.WINDOW_SIZE if self.augment else len(sample['data'])
+                            data = data[:n]
+                            aux = aux[:n] if aux is not None else None
+                            all_samples.append(data)
+                            all_aux.append(aux)
                             all_labels.append(sample['gesture'])
                             count += 1
 
                     if count > 0:
                         print(f"    {gesture_name}: {count} samples")
 
+        if skipped:
+            print(f"  Skipped {skipped} samples without accelerometer data (re-record with collect_data_auto.py)")
         if not all_samples:
             raise ValueError("No data found! Run collect_data_auto.py or collect_data.py first.")
 
         print(f"\nTotal samples loaded: {len(all_samples)}")
 
         # Extract time-domain features
-        print("\nExtracting time-domain features...")
+        if self.feature_type == 'multiscale':
+            print(f"\nExtracting multi-scale features ({'/'.join(str(w) for w in MULTISCALE_WINDOWS)} samples)...")
+        elif self.feature_type == 'fused':
+            print("\nExtracting time-domain features + wrist orientation...")
+        elif self.feature_type == 'spectral':
+            print("\nExtracting time-domain + spectral features...")
+        else:
+            print("\nExtracting time-domain features...")
         X = []
         for i, window in enumerate(all_samples):
-            features = self.extract_features_time_domain(window)
+            if self.feature_type in ('multiscale', 'fused', 'spectral'):
+                features = extract_features(window, self.feature_type, aux=all_aux[i])
+            else:
+                features = self.extract_features_time_domain(window)
             X.append(features)
 
             if (i + 1) % 50 == 0:
@@ -136,19 +188,45 @@ class LDAGestureTrainer:
         for label, count in zip(unique, counts):
             print(f"  {label:15} - {count:3d} samples ({100*count/len(self.y):.1f}%)")
 
+    def recording_windows(self, indices, **augment):
+        """Features and labels of the augmented windows of the recordings at indices
+        (augment overrides self.augment, e.g. copies=0 for the plain windows)"""
+        recordings = [self.recordings[i] for i in indices]
+        features = augmented_features(recordings, self.feature_type, window=self.WINDOW_SIZE,
+                                      **dict(self.augment, **augment))
+        kept = [f for f in features if len(f)]
+        if not kept:
+            raise ValueError(f"No data found! Every recording is shorter than the "
+                             f"{self.WINDOW_SIZE}-sample window.")
+        X = np.vstack(kept)
+        y = np.concatenate([[self.y[i]] * len(f) for i, f in zip(indices, features)])
+        return X, y
+
     def train(self):
         """Train LDA classifier"""
         print("\n" + "=" * 70)
         print("Training LDA Classifier")
         print("=" * 70)
 
-        # Split data
-        X_train, X_test, y_train, y_test = train_test_split(
-            self.X, self.y, test_size=0.2, random_state=42, stratify=self.y
+        # Split data (by sample, before augmenting: windows cut from one
+        # recording overlap, so each recording stays on one side)
+        train_idx, test_idx = train_test_split(
+            np.arange(len(self.y)), test_size=0.2, random_state=42, stratify=self.y
         )
+        X_train, X_test = self.X[train_idx], self.X[test_idx]
+        y_train, y_test = self.y[train_idx], self.y[test_idx]
+
+        if self.augment:
+            print(f"\nAugmenting {len(train_idx)} training recordings (window every {self.augment['stride']} "
+                  f"samples, {self.augment['copies']} augmented copies each)...")
+            X_train, y_train = self.recording_windows(train_idx)
+            # Tested on every window of the held-out recordings, as the
+            # realtime classifier slides over a gesture
+            X_test, y_test = self.recording_windows(test_idx, copies=0)
 
-        print(f"\nTraining set: {len(X_train)} samples")
-        print(f"Test set: {len(X_test)} samples")
+        unit = 'windows' if self.augment else 'samples'
+        print(f"\nTraining set: {len(X_train)} {unit}")
+        print(f"Test set: {len(X_test)} {unit}")
 
         # Scale features
         print("\nScaling features...")
@@ -164,7 +242,8 @@ class LDAGestureTrainer:
 
         self.model = LinearDiscriminantAnalysis(
             solver='svd',  # SVD solver doesn't require regularization
-            n_components=n_components
+            n_components=n_components,
+            store_covariance=True  # seeds session calibration (calibration.py)
         )
 
         self.model.fit(X_train_scaled, y_train)
@@ -226,22 +305,30 @@ class LDAGestureTrainer:
         model_data = {
             'model': self.model,
             'scaler': self.scaler,
-            'feature_names': [
-                f"Ch{ch+1}_{feat}"
-                for ch in range(4)
-                for feat in ['MAV', 'RMS', 'WL', 'ZC', 'SSC', 'VAR', 'IEMG', 'WA']
-            ],
+            'feature_names': feature_names(self.feature_type),
             'gestures': sorted(set(self.y)),
             'training_date': datetime.now().isoformat(),
             'n_samples': len(self.y),
-            'method': 'LDA with time-domain features',
-            'feature_type': 'time_domain'
+            'augment': self.augment,
+            'filter': self.filter_bank.config if self.filter_bank else None,
+            'method': {'multiscale': 'LDA with multi-scale features',
+                       'fused': 'LDA with time-domain + orientation features',
+                       'spectral': 'LDA with time-domain + spectral features'}.get(
+                           self.feature_type, 'LDA with time-domain features'),
+            'feature_type': self.feature_type
         }
 
         joblib.dump(model_data, output_path)
         print(f"\n✓ Model saved to {output_path}")
         print(f"  Method: Linear Discriminant Analysis")
-        print(f"  Features: 8 time-domain features per channel")
+        if self.feature_type == 'multiscale':
+            print(f"  Features: 6 time-domain features per channel over {len(MULTISCALE_WINDOWS)} window lengths")
+        elif self.feature_type == 'fused':
+            print(f"  Features: 8 time-domain features per channel + wrist pitch/roll")
+        elif self.feature_type == 'spectral':
+            print(f"  Features: 8 time-domain + {len(SPECTRAL_NAMES)} spectral features per channel")
+        else:
+            print(f"  Features: 8 time-domain features per channel")
 
     def run(self):
         """Run complete training pipeline"""
@@ -335,9 +422,31 @@ def main():
     print()
     print(f"Training on {len(selected_sessions)} session(s): {', '.join(selected_sessions)}")
     print()
+    filter_config = None
+    if FilterBank is not None:
+        answer = input("Apply band-pass + 60 Hz notch filter before feature extraction? (y/N): ").strip().lower()
+        if answer == 'y':
+            filter_config = dict(FilterBank.DEFAULTS)
+        print()
+
+    answer = input("Features: [1] time-domain (default) [2] multi-scale (last 50/100/200 samples) "
+                   "[3] time-domain + wrist orientation [4] time-domain + spectral: ").strip()
+    feature_type = {'2': 'multiscale', '3': 'fused', '4': 'spectral'}.get(answer, 'time_domain')
+    print()
+
+    augment = None
+    answer = input("Augment: train on windows every N samples of each whole recording, with shifted/"
+                   "scaled copies (stride N, blank for no augmentation): ").strip()
+    if answer.isdigit() and int(answer) > 0:
+        copies = input(f"  Augmented copies per window [{AUGMENT_DEFAULTS['copies']}]: ").strip()
+        augment = dict(AUGMENT_DEFAULTS, stride=int(answer),
+                       copies=int(copies) if copies.isdigit() else AUGMENT_DEFAULTS['copies'])
+    print()
+
     input("Press Enter to begin training...")
 
-    trainer = LDAGestureTrainer(sessions=selected_sessions)
+    trainer = LDAGestureTrainer(sessions=selected_sessions, filter_config=filter_config,
+                                feature_type=feature_type, augment=augment)
     trainer.run()
 
 if __name__ == "__main__":
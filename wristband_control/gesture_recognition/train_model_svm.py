@@ -13,10 +13,19 @@ from sklearn.preprocessing import StandardScaler
 from sklearn.model_selection import train_test_split, cross_val_score, GridSearchCV
 from sklearn.metrics import classification_report, confusion_matrix
 import joblib
+import sys
 from datetime import datetime
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'native'))
+try:
+    from q8native import FilterBank
+except ImportError:
+    FilterBank = None
+
+from emg_features import sample_window
+
 class SVMGestureTrainer:
-    def __init__(self, sessions=None):
+    def __init__(self, sessions=None, filter_config=None):
         self.sessions = sessions if sessions else []
         self.model = None
         self.scaler = StandardScaler()
@@ -24,6 +33,15 @@ class SVMGestureTrainer:
         self.X = None
         self.y = None
 
+        # Optional band-pass/notch filter run over each recording before its
+        # window is cut (saved with the model so classify_realtime matches)
+        self.filter_config = filter_config
+        self.filter_bank = None
+        if filter_config:
+            if FilterBank is None:
+                raise ImportError("Filtering needs libq8native.so. Build it with: make -C native")
+            self.filter_bank = FilterBank(n_channels=4, config=filter_config)
+
     def extract_features_mav(self, window_data):
         """
         Extract Mean Absolute Value (MAV) features - myo_ecn style
@@ -79,7 +97,8 @@ class SVMGestureTrainer:
                         count = 0
                         for line in f:
                             sample = json.loads(line)
-                            all_samples.append(np.array(sample['data']))
+                            window, _ = sample_window(sample, self.filter_bank)
+                            all_samples.append(window)
                             all_labels.append(sample['gesture'])
                             count += 1
 
@@ -224,6 +243,7 @@ class SVMGestureTrainer:
             'gestures': sorted(set(self.y)),
             'training_date': datetime.now().isoformat(),
             'n_samples': len(self.y),
+            'filter': self.filter_bank.config if self.filter_bank else None,
             'method': 'SVM with MAV features (myo_ecn style)',
             'feature_type': 'MAV'
         }
@@ -330,9 +350,16 @@ def main():
     grid_search = grid_search_choice != 'n'
 
     print()
+    filter_config = None
+    if FilterBank is not None:
+        answer = input("Apply band-pass + 60 Hz notch filter before feature extraction? (y/N): ").strip().lower()
+        if answer == 'y':
+            filter_config = dict(FilterBank.DEFAULTS)
+        print()
+
     input("Press Enter to begin training...")
 
-    trainer = SVMGestureTrainer(sessions=selected_sessions)
+    trainer = SVMGestureTrainer(sessions=selected_sessions, filter_config=filter_config)
     trainer.run(grid_search=grid_search)
 
 if __name__ == "__main__":
@@ -6,11 +6,15 @@ Real-time connection status and data display for OpenBCI Cyton 16-channel board
 
 import serial
 import serial.tools.list_ports
+import os
 import time
 import sys
 import struct
 from datetime import datetime
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'gesture_recognition'))
+from terminal_display import TerminalDisplay, StallCounter, display_threaded
+
 class OpenBCIMonitor:
     def __init__(self):
         self.ser = None
@@ -29,6 +33,14 @@ class OpenBCIMonitor:
         # Ports to exclude (used by other devices like Dynamixel motors)
         self.EXCLUDED_PORTS = ['/dev/ttyUSB1']
 
+        # Live view, drawn by a render thread from snapshots
+        self.display = None
+        self.stalls = StallCounter(fs=self.SAMPLE_RATE)
+        self.byte_count = 0
+        self.last_preview = ""
+        self.last_size = 0
+        self.start_time = None
+
     def clear_screen(self):
         """Clear terminal screen"""
         print("\033[2J\033[H", end="")
@@ -186,32 +198,66 @@ class OpenBCIMonitor:
             self.print_status(f"Error stopping stream: {e}", "ERROR")
 
     def read_data(self):
-        """Read and display incoming data"""
+        """Read incoming data and remember a preview of the latest chunk"""
         if not self.connected:
             return
 
         try:
-            if self.ser.in_waiting > 0:
+            waiting = self.ser.in_waiting
+            self.stalls.check(waiting // 33)
+            if waiting > 0:
                 # Read available data
-                data = self.ser.read(self.ser.in_waiting)
+                data = self.ser.read(waiting)
 
                 if len(data) > 0:
                     self.packet_count += 1
-
-                    # Display data info every 10 packets to avoid spam
-                    if self.packet_count % 10 == 0:
-                        hex_preview = ' '.join([f'{b:02x}' for b in data[:16]])
-                        if len(data) > 16:
-                            hex_preview += "..."
-
-                        self.print_status(
-                            f"Packet #{self.packet_count} | {len(data)} bytes | {hex_preview}",
-                            "DATA"
-                        )
+                    self.byte_count += len(data)
+                    self.last_size = len(data)
+                    self.last_preview = ' '.join([f'{b:02x}' for b in data[:16]])
+                    if len(data) > 16:
+                        self.last_preview += "..."
 
         except Exception as e:
             self.error_count += 1
-            self.print_status(f"Read error: {e}", "ERROR")
+            self.last_preview = f"Read error: {e}"
+
+    def snapshot(self):
+        """Values shown on screen (taken on the acquisition thread)"""
+        return {
+            'connected': self.connected,
+            'streaming': self.streaming,
+            'packets': self.packet_count,
+            'bytes': self.byte_count,
+            'errors': self.error_count,
+            'stalls': self.stalls.stalls,
+            'max_backlog': self.stalls.max_backlog,
+            'elapsed': time.time() - self.start_time if self.start_time else 0.0,
+            'last_size': self.last_size,
+            'last_preview': self.last_preview,
+        }
+
+    def render_monitor(self, s):
+        """Screen lines for a snapshot (runs on the render thread)"""
+        elapsed = max(s['elapsed'], 1e-9)
+        return [
+            "=" * 70,
+            "OpenBCI Cyton 16-Channel Monitor",
+            "=" * 70,
+            "",
+            f"Status: {'Connected' if s['connected'] else 'Disconnected'} | "
+            f"Streaming: {'Yes' if s['streaming'] else 'No'} | "
+            f"Packets: {s['packets']} | "
+            f"Errors: {s['errors']}",
+            f"Data rate: {s['bytes'] / elapsed:8.0f} bytes/s "
+            f"(~{s['bytes'] / 33 / elapsed:5.1f} frames/s, expected {self.SAMPLE_RATE})",
+            f"Stalls: {s['stalls']} | Max backlog: {s['max_backlog']} frames",
+            "",
+            f"Latest read: {s['last_size']} bytes | {s['last_preview']}",
+            "",
+            "-" * 70,
+            "Press Ctrl+C to stop",
+            "-" * 70,
+        ]
 
     def monitor_loop(self):
         """Main monitoring loop"""
@@ -225,36 +271,31 @@ class OpenBCIMonitor:
         if not self.connect():
             return
 
-        print()
-        print("-" * 70)
-        print("Press Ctrl+C to stop")
-        print("-" * 70)
-        print()
-
         # Start streaming
         self.start_streaming()
 
         try:
-            last_status_time = time.time()
+            last_update = time.time()
+            update_interval = 0.1  # Update display 10 times per second
+            self.start_time = time.time()
+            self.display = TerminalDisplay(self.render_monitor, interval=update_interval,
+                                           threaded=display_threaded())
+            self.display.start()
 
             while True:
                 # Read data
                 self.read_data()
 
-                # Print periodic status update every 5 seconds
-                if time.time() - last_status_time > 5:
-                    self.print_status(
-                        f"Status: {'Connected' if self.connected else 'Disconnected'} | "
-                        f"Streaming: {'Yes' if self.streaming else 'No'} | "
-                        f"Packets: {self.packet_count} | "
-                        f"Errors: {self.error_count}",
-                        "INFO"
-                    )
-                    last_status_time = time.time()
+                # Hand the current state to the display periodically
+                if time.time() - last_update > update_interval:
+                    self.display.update(self.snapshot())
+                    last_update = time.time()
 
                 time.sleep(0.01)  # Small delay to prevent CPU spinning
 
         except KeyboardInterrupt:
+            if self.display is not None:
+                self.display.stop()
             print("\n")
             self.print_status("Shutting down...", "INFO")
 
@@ -263,6 +304,9 @@ class OpenBCIMonitor:
 
     def cleanup(self):
         """Clean up resources"""
+        if self.display is not None:
+            self.display.stop()
+
         if self.streaming:
             self.stop_streaming()
 
@@ -276,6 +320,9 @@ class OpenBCIMonitor:
         print(f"Session summary:")
         print(f"  Total packets received: {self.packet_count}")
         print(f"  Total errors: {self.error_count}")
+        print(f"  Stalls: {self.stalls.summary()}")
+        if self.display is not None:
+            print(f"  Display: {self.display.summary()}")
         print()
 
 def main():